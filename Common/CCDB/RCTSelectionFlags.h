@@ -206,22 +206,27 @@ class RCTFlagsChecker : public o2::utils::EnumFlags<RCTSelectionFlags>
     }
   }
 
-  // Check the RCT column of a given event selection table.
-  // The function returns true if none of the checked flags is set in the RCT column.
-  bool checkTable(const HasRCTFlags auto& table)
+  // Check a bitmask of RCT flags, e.g. from the RCT column or from RunConditions.
+  // The function returns true if none of the checked flags is set in the bitmask.
+  bool checkBits(uint64_t bits)
   {
     // throw an exception if none of the bits in the checker mask is set
     if (!any()) {
       throw std::out_of_range("RCTFlagsChecker has empty RCTSelectionFlags bits mask");
     }
 
-    // bitmask of the current table
-    uint64_t tableBits = table.rct_raw();
     // bitmask of flags to be checked
     uint64_t flagsBits = value();
 
-    // return true if none of the checked bits is set in the table bitmask
-    return ((tableBits & flagsBits) == 0);
+    // return true if none of the checked bits is set in the bitmask
+    return ((bits & flagsBits) == 0);
+  }
+
+  // Check the RCT column of a given event selection table.
+  // The function returns true if none of the checked flags is set in the RCT column.
+  bool checkTable(const HasRCTFlags auto& table)
+  {
+    return checkBits(table.rct_raw());
   }
 
   // Check the validity of the RCT column of a given event selection table.
@@ -0,0 +1,190 @@
+// Copyright 2019-2020 CERN and copyright holders of ALICE O2.
+// See https://alice-o2.web.cern.ch/copyright for details of the copyright holders.
+// All rights not expressly granted are reserved.
+//
+// This software is distributed under the terms of the GNU General Public
+// License v3 (GPL Version 3), copied verbatim in the file "COPYING".
+//
+// In applying this license CERN does not waive the privileges and immunities
+// granted to it by virtue of its status as an Intergovernmental Organization
+// or submit itself to any jurisdiction.
+
+/// \file RunConditions.h
+/// \brief Compact per-run lookup tables of the RCT flags and of the ITS inactive chips
+///
+/// The RCT flags (RCT/Flags/RunFlags) and the number of inactive ITS chips per layer are
+/// stored as sorted key arrays with packed value arrays. Lookups use a binary search,
+/// short-circuited by a forward cursor when the queries are ordered in time, as in the BC loops.
+/// RunConditionsService keeps one instance per run, shared by all the users of a device.
+
+#ifndef COMMON_CCDB_RUNCONDITIONS_H_
+#define COMMON_CCDB_RUNCONDITIONS_H_
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <vector>
+
+namespace o2::aod::rctsel
+{
+
+// Sorted keys with an upper bound search which remembers the last result
+template <typename TKey>
+class SortedKeys
+{
+ public:
+  void clear()
+  {
+    mKeys.clear();
+    mCursor = 0;
+  }
+  // keys must be added in increasing order
+  void push_back(TKey key) { mKeys.push_back(key); }
+  std::size_t size() const { return mKeys.size(); }
+  TKey operator[](std::size_t i) const { return mKeys[i]; }
+
+  // Index of the first key greater than value, like std::upper_bound
+  std::size_t upperBound(TKey value) const
+  {
+    const std::size_t n = mKeys.size();
+    if (!contains(mCursor, value)) {
+      if (mCursor < n && contains(mCursor + 1, value)) { // next interval, for time-ordered queries
+        mCursor++;
+      } else {
+        mCursor = std::upper_bound(mKeys.begin(), mKeys.end(), value) - mKeys.begin();
+      }
+    }
+    return mCursor;
+  }
+
+ private:
+  std::vector<TKey> mKeys;
+  mutable std::size_t mCursor = 0; // last result of upperBound
+
+  // whether i is the upper bound of value
+  bool contains(std::size_t i, TKey value) const
+  {
+    return (i == 0 || mKeys[i - 1] <= value) && (i == mKeys.size() || value < mKeys[i]);
+  }
+};
+
+// Flag words valid from their timestamp to the next one
+template <typename TWord>
+class RunFlagsTable
+{
+ public:
+  void clear()
+  {
+    mTimestamps.clear();
+    mWords.clear();
+  }
+
+  // fill from the map stored in the CCDB
+  template <typename TMap>
+  void fill(TMap const& map)
+  {
+    clear();
+    mWords.reserve(map.size());
+    for (const auto& [timestamp, word] : map) {
+      mTimestamps.push_back(timestamp);
+      mWords.push_back(static_cast<TWord>(word));
+    }
+  }
+
+  void add(uint64_t timestamp, TWord word)
+  {
+    mTimestamps.push_back(timestamp);
+    mWords.push_back(word);
+  }
+
+  std::size_t size() const { return mWords.size(); }
+
+  // Flags of the last entry starting before or at the timestamp, or of the first entry for earlier timestamps
+  TWord get(uint64_t timestamp) const
+  {
+    if (mWords.empty()) {
+      return 0;
+    }
+    const std::size_t i = mTimestamps.upperBound(timestamp);
+    return mWords[i > 0 ? i - 1 : 0];
+  }
+
+ private:
+  SortedKeys<uint64_t> mTimestamps;
+  std::vector<TWord> mWords;
+};
+
+// Number of inactive chips per layer vs orbit, one array per layer
+class InactiveChipsTable
+{
+ public:
+  void clear()
+  {
+    mOrbits.clear();
+    mCounts.clear();
+  }
+
+  void setNLayers(int nLayers) { mCounts.assign(nLayers, {}); }
+  int getNLayers() const { return mCounts.size(); }
+
+  // add an orbit with no inactive chips, orbits must be added in increasing order
+  void addOrbit(int64_t orbit)
+  {
+    mOrbits.push_back(orbit);
+    for (auto& counts : mCounts) {
+      counts.push_back(0);
+    }
+  }
+  // count an inactive chip in the last orbit added
+  void addInactiveChip(int layer) { mCounts[layer].back()++; }
+
+  std::size_t size() const { return mOrbits.size(); }
+  int64_t getOrbit(std::size_t i) const { return mOrbits[i]; }
+  int16_t getInactiveChips(int layer, std::size_t i) const { return mCounts[layer][i]; }
+
+  // Index of the first orbit greater than the given one, like std::upper_bound
+  std::size_t upperBound(int64_t orbit) const { return mOrbits.upperBound(orbit); }
+
+ private:
+  SortedKeys<int64_t> mOrbits;
+  std::vector<std::vector<int16_t>> mCounts; // [layer][orbit index]
+};
+
+struct RunConditions {
+  int run = -1;
+  bool isFilled = false;
+  RunFlagsTable<uint32_t> rctFlags;
+  InactiveChipsTable inactiveChips;
+};
+
+// One instance of the run conditions per run, shared within the device
+class RunConditionsService
+{
+ public:
+  // Returns the conditions of the run, to be filled if isFilled is false
+  static RunConditions& get(int run)
+  {
+    auto& conditions = instances()[run];
+    if (!conditions) {
+      conditions = std::make_unique<RunConditions>();
+      conditions->run = run;
+    }
+    return *conditions;
+  }
+
+  // Frees the conditions of the run
+  static void release(int run) { instances().erase(run); }
+
+ private:
+  static std::map<int, std::unique_ptr<RunConditions>>& instances()
+  {
+    static std::map<int, std::unique_ptr<RunConditions>> sInstances;
+    return sInstances;
+  }
+};
+
+} // namespace o2::aod::rctsel
+
+#endif // COMMON_CCDB_RUNCONDITIONS_H_
@@ -0,0 +1,319 @@
+// Copyright 2019-2020 CERN and copyright holders of ALICE O2.
+// See https://alice-o2.web.cern.ch/copyright for details of the copyright holders.
+// All rights not expressly granted are reserved.
+//
+// This software is distributed under the terms of the GNU General Public
+// License v3 (GPL Version 3), copied verbatim in the file "COPYING".
+//
+// In applying this license CERN does not waive the privileges and immunities
+// granted to it by virtue of its status as an Intergovernmental Organization
+// or submit itself to any jurisdiction.
+
+///
+/// \file   CCDBNodeCache.cxx
+/// \brief  Node-local on-disk cache of CCDB objects shared by the devices of a node
+///
+
+#include "Common/Core/CCDBNodeCache.h"
+
+#include <CCDB/CcdbApi.h>
+#include <Framework/Logger.h>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cctype>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <system_error>
+
+namespace
+{
+/// 64-bit FNV-1a hash, used to name the index directories and the blobs without ETag
+uint64_t fnv1a(const std::string& str)
+{
+  uint64_t hash = 14695981039346656037ULL;
+  for (const unsigned char c : str) {
+    hash ^= c;
+    hash *= 1099511628211ULL;
+  }
+  return hash;
+}
+
+/// Unique suffix for the temporary files of this process
+std::string tmpSuffix()
+{
+  static uint64_t counter = 0;
+  return ".tmp." + std::to_string(getpid()) + "." + std::to_string(counter++);
+}
+} // namespace
+
+using namespace o2::common::core;
+
+MappedFile::~MappedFile()
+{
+  if (mData != nullptr) {
+    munmap(mData, mSize);
+  }
+}
+
+bool MappedFile::open(const std::string& fileName)
+{
+  const int fd = ::open(fileName.c_str(), O_RDONLY);
+  if (fd < 0) {
+    return false;
+  }
+  struct stat st;
+  if (fstat(fd, &st) != 0) {
+    ::close(fd);
+    return false;
+  }
+  mSize = static_cast<std::size_t>(st.st_size);
+  if (mSize == 0) { // nothing to map, an empty payload is still valid
+    ::close(fd);
+    return true;
+  }
+  void* data = mmap(nullptr, mSize, PROT_READ, MAP_SHARED, fd, 0);
+  ::close(fd); // the mapping stays valid
+  if (data == MAP_FAILED) {
+    mSize = 0;
+    return false;
+  }
+  mData = data;
+  return true;
+}
+
+void CCDBNodeCache::init(const o2::ccdb::CcdbApi* ccdbApi, const std::string& cacheDir)
+{
+  std::lock_guard<std::mutex> lock(mMutex);
+  mCcdbApi = ccdbApi;
+  mCacheDir = cacheDir;
+  if (mCacheDir.empty()) {
+    const char* envDir = std::getenv("O2PHYSICS_CCDB_NODE_CACHE");
+    mCacheDir = envDir != nullptr ? envDir : "/tmp/o2physics-ccdb-cache-" + std::to_string(getuid());
+  }
+  std::error_code ec;
+  std::filesystem::create_directories(mCacheDir + "/blobs", ec);
+  std::filesystem::create_directories(mCacheDir + "/index", ec);
+  if (ec) {
+    LOGP(error, "[CCDBNodeCache] Could not create the cache directory {}: {}", mCacheDir, ec.message());
+  }
+  LOGP(info, "[CCDBNodeCache] Using node cache directory {}", mCacheDir);
+}
+
+std::string CCDBNodeCache::getFile(const std::string& path, const std::map<std::string, std::string>& metadata, int64_t timestamp)
+{
+  // the key identifies the object series: path and metadata (std::map keeps them sorted)
+  std::string key = path;
+  for (const auto& [name, value] : metadata) {
+    key += ";" + name + "=" + value;
+  }
+
+  std::lock_guard<std::mutex> lock(mMutex);
+  mStats.nRequests++;
+  auto& processEntries = mProcessEntries[key];
+  for (const auto& entry : processEntries) {
+    if (entry.validFrom <= timestamp && timestamp < entry.validUntil) {
+      mStats.nProcessHits++;
+      return entry.blobFile;
+    }
+  }
+
+  // the node index persists across jobs: an entry is used only if the CCDB still serves the same object
+  // (same ETag, or same creation time without ETag) with the same validity, e.g. not after a re-upload.
+  // The headers are retrieved once per validity interval, later requests in the interval are process hits.
+  // If the CCDB cannot be reached, the node index is trusted.
+  Entry entry;
+  const auto headers = retrieveHeaders(path, metadata, timestamp);
+  if (findInNodeIndex(key, timestamp, headers, entry)) {
+    mStats.nNodeHits++;
+  } else if (fetch(path, metadata, timestamp, key, headers, entry)) {
+    mStats.nFetches++;
+  } else {
+    mStats.nFailures++;
+    LOGP(error, "[CCDBNodeCache] Object {} not available for timestamp {}", key, timestamp);
+    return "";
+  }
+  processEntries.push_back(entry);
+  return entry.blobFile;
+}
+
+std::map<std::string, std::string> CCDBNodeCache::retrieveHeaders(const std::string& path, const std::map<std::string, std::string>& metadata, int64_t timestamp) const
+{
+  return mCcdbApi != nullptr ? mCcdbApi->retrieveHeaders(path, metadata, timestamp) : std::map<std::string, std::string>{};
+}
+
+bool CCDBNodeCache::retrieveBlob(const std::string& path, const std::string& targetDir, const std::map<std::string, std::string>& metadata, int64_t timestamp, const std::string& fileName) const
+{
+  if (mCcdbApi == nullptr) {
+    LOGP(error, "[CCDBNodeCache] Not initialised");
+    return false;
+  }
+  return mCcdbApi->retrieveBlob(path, targetDir, metadata, timestamp, false, fileName);
+}
+
+bool CCDBNodeCache::findInNodeIndex(const std::string& key, int64_t timestamp, const std::map<std::string, std::string>& headers, Entry& entry) const
+{
+  std::string currentBlobId;
+  int64_t currentValidFrom = 0, currentValidUntil = 0;
+  if (!headers.empty()) {
+    identifyObject(headers, key, timestamp, currentBlobId, currentValidFrom, currentValidUntil);
+  }
+  const std::filesystem::path indexDir = mCacheDir + "/index/" + std::to_string(fnv1a(key));
+  std::error_code ec;
+  for (const auto& item : std::filesystem::directory_iterator(indexDir, ec)) {
+    const std::string name = item.path().filename().string();
+    const auto separator = name.find('_');
+    if (separator == std::string::npos || name.find(".tmp.") != std::string::npos) {
+      continue;
+    }
+    int64_t validFrom, validUntil;
+    try {
+      validFrom = std::stoll(name.substr(0, separator));
+      validUntil = std::stoll(name.substr(separator + 1));
+    } catch (...) {
+      continue;
+    }
+    if (timestamp < validFrom || validUntil <= timestamp) {
+      continue;
+    }
+    if (!headers.empty() && (validFrom != currentValidFrom || validUntil != currentValidUntil)) {
+      continue;
+    }
+    std::ifstream indexFile(item.path());
+    std::string blobId;
+    if (!(indexFile >> blobId) || (!headers.empty() && blobId != currentBlobId)) {
+      continue;
+    }
+    const std::string blobFile = mCacheDir + "/blobs/" + blobId;
+    if (!std::filesystem::exists(blobFile, ec)) {
+      continue;
+    }
+    entry = Entry{validFrom, validUntil, blobFile};
+    return true;
+  }
+  return false;
+}
+
+void CCDBNodeCache::identifyObject(const std::map<std::string, std::string>& headers, const std::string& key, int64_t timestamp, std::string& blobId, int64_t& validFrom, int64_t& validUntil)
+{
+  validFrom = timestamp; // without validity, valid at this timestamp only
+  validUntil = timestamp + 1;
+  try {
+    if (headers.count("Valid-From") && headers.count("Valid-Until")) {
+      validFrom = std::stoll(headers.at("Valid-From"));
+      validUntil = std::stoll(headers.at("Valid-Until"));
+    }
+  } catch (...) {
+    validFrom = timestamp;
+    validUntil = timestamp + 1;
+  }
+  blobId.clear();
+  if (headers.count("ETag")) {
+    for (const char c : headers.at("ETag")) {
+      if (std::isalnum(static_cast<unsigned char>(c)) || c == '-') {
+        blobId += c;
+      }
+    }
+  }
+  if (blobId.empty()) { // the creation time distinguishes objects re-uploaded with the same validity
+    const std::string created = headers.count("Created") ? headers.at("Created") : "";
+    blobId = std::to_string(fnv1a(key + "@" + std::to_string(validFrom) + "_" + std::to_string(validUntil) + "@" + created));
+  }
+}
+
+bool CCDBNodeCache::fetch(const std::string& path, const std::map<std::string, std::string>& metadata, int64_t timestamp, const std::string& key,
+                          const std::map<std::string, std::string>& headers, Entry& entry)
+{
+  const auto start = std::chrono::steady_clock::now();
+
+  // validity and identity of the object, from the headers retrieved without downloading it
+  std::string blobId;
+  int64_t validFrom, validUntil;
+  identifyObject(headers, key, timestamp, blobId, validFrom, validUntil);
+
+  const std::string blobsDir = mCacheDir + "/blobs";
+  const std::string blobFile = blobsDir + "/" + blobId;
+  std::error_code ec;
+  if (!std::filesystem::exists(blobFile, ec)) {
+    const std::string tmpName = blobId + tmpSuffix();
+    if (!retrieveBlob(path, blobsDir, metadata, timestamp, tmpName)) {
+      std::filesystem::remove(blobsDir + "/" + tmpName, ec);
+      return false;
+    }
+    mStats.fetchedBytes += std::filesystem::file_size(blobsDir + "/" + tmpName, ec);
+    std::filesystem::rename(blobsDir + "/" + tmpName, blobFile, ec);
+    if (ec) {
+      LOGP(error, "[CCDBNodeCache] Could not store {}: {}", blobFile, ec.message());
+      return false;
+    }
+  }
+
+  // publish the validity to the other devices of the node
+  const std::string indexDir = mCacheDir + "/index/" + std::to_string(fnv1a(key));
+  std::filesystem::create_directories(indexDir, ec);
+  writeFileAtomically(indexDir + "/" + std::to_string(validFrom) + "_" + std::to_string(validUntil), blobId.data(), blobId.size());
+
+  mStats.fetchTimeMs += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+  entry = Entry{validFrom, validUntil, blobFile};
+  return true;
+}
+
+bool CCDBNodeCache::writeFileAtomically(const std::string& fileName, const char* data, std::size_t size) const
+{
+  const std::string tmpName = fileName + tmpSuffix();
+  {
+    std::ofstream file(tmpName, std::ios::binary | std::ios::trunc);
+    if (!file || !file.write(data, static_cast<std::streamsize>(size))) {
+      LOGP(error, "[CCDBNodeCache] Could not write {}", tmpName);
+      return false;
+    }
+  }
+  std::error_code ec;
+  std::filesystem::rename(tmpName, fileName, ec);
+  if (ec) {
+    LOGP(error, "[CCDBNodeCache] Could not store {}: {}", fileName, ec.message());
+    std::filesystem::remove(tmpName, ec);
+    return false;
+  }
+  return true;
+}
+
+std::string CCDBNodeCache::flatTypeTag(const char* typeName, std::size_t typeSize)
+{
+  return std::to_string(fnv1a(typeName)) + "." + std::to_string(typeSize);
+}
+
+std::shared_ptr<const MappedFile> CCDBNodeCache::mapFlatFile(const std::string& flatFile)
+{
+  const auto found = mMappedFiles.find(flatFile);
+  if (found != mMappedFiles.end()) {
+    return found->second;
+  }
+  auto mapped = std::make_shared<MappedFile>();
+  if (!mapped->open(flatFile)) {
+    return nullptr;
+  }
+  mStats.mappedBytes += mapped->size();
+  mMappedFiles.emplace(flatFile, mapped);
+  return mapped;
+}
+
+void CCDBNodeCache::printStats() const
+{
+  LOGF(info, "[CCDBNodeCache] %llu requests: %llu from the process, %llu from the node cache, %llu fetched (%llu bytes in %.1f ms), %llu not available",
+       static_cast<unsigned long long>(mStats.nRequests), static_cast<unsigned long long>(mStats.nProcessHits), static_cast<unsigned long long>(mStats.nNodeHits),
+       static_cast<unsigned long long>(mStats.nFetches), static_cast<unsigned long long>(mStats.fetchedBytes), mStats.fetchTimeMs, static_cast<unsigned long long>(mStats.nFailures));
+  LOGF(info, "[CCDBNodeCache] %llu bytes of flat payloads mapped, %llu of them deserialised by this process",
+       static_cast<unsigned long long>(mStats.mappedBytes), static_cast<unsigned long long>(mStats.deserialisedBytes));
+}
@@ -0,0 +1,181 @@
+// Copyright 2019-2020 CERN and copyright holders of ALICE O2.
+// See https://alice-o2.web.cern.ch/copyright for details of the copyright holders.
+// All rights not expressly granted are reserved.
+//
+// This software is distributed under the terms of the GNU General Public
+// License v3 (GPL Version 3), copied verbatim in the file "COPYING".
+//
+// In applying this license CERN does not waive the privileges and immunities
+// granted to it by virtue of its status as an Intergovernmental Organization
+// or submit itself to any jurisdiction.
+
+///
+/// \file   CCDBNodeCache.h
+/// \brief  Node-local on-disk cache of CCDB objects shared by the devices of a node
+///
+
+#ifndef COMMON_CORE_CCDBNODECACHE_H_
+#define COMMON_CORE_CCDBNODECACHE_H_
+
+#include <CCDB/CcdbApi.h>
+#include <Framework/Logger.h>
+
+#include <TFile.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <type_traits>
+#include <typeinfo>
+#include <utility>
+#include <vector>
+
+namespace o2::common::core
+{
+
+/// Read-only memory mapping of a file
+class MappedFile
+{
+ public:
+  MappedFile() = default;
+  MappedFile(const MappedFile&) = delete;
+  MappedFile& operator=(const MappedFile&) = delete;
+  ~MappedFile();
+
+  /// Maps the whole file, returns false if the file cannot be opened or mapped
+  bool open(const std::string& fileName);
+
+  const char* data() const { return static_cast<const char*>(mData); }
+  std::size_t size() const { return mSize; }
+
+ private:
+  void* mData = nullptr;
+  std::size_t mSize = 0;
+};
+
+/// Read-only view of a flat array of T stored in a mapped file
+template <typename T>
+class FlatView
+{
+ public:
+  FlatView() = default;
+  explicit FlatView(std::shared_ptr<const MappedFile> file) : mFile(std::move(file)) {}
+
+  bool isValid() const { return mFile != nullptr; }
+  std::size_t size() const { return mFile ? mFile->size() / sizeof(T) : 0; }
+  const T* data() const { return mFile ? reinterpret_cast<const T*>(mFile->data()) : nullptr; }
+  const T* begin() const { return data(); }
+  const T* end() const { return data() + size(); }
+  const T& operator[](std::size_t i) const { return data()[i]; }
+
+ private:
+  std::shared_ptr<const MappedFile> mFile{};
+};
+
+/// Node-local, content-addressed cache of CCDB objects.
+///
+/// The devices of all the jobs running on a node share one cache directory:
+///  - blobs/<id>: the object file as served by the CCDB, <id> being its ETag (or a hash of path and validity)
+///  - index/<hash of path and metadata>/<validFrom>_<validUntil>: the id of the blob valid in that interval
+///  - blobs/<id>.flat.<type>: flat payloads (std::vector<T>) already deserialised, served as mapped views
+/// A request is served, in order, from the objects already used by the process, from the node cache or
+/// from the CCDB. Files are written to a temporary name and renamed, so concurrent devices never see
+/// partial files. The node cache outlives the jobs, so its entries are revalidated against the headers
+/// of the CCDB (ETag or creation time, and validity) the first time a process uses them. The validity
+/// interval is then kept by the process, which serves the object without contacting the CCDB until a
+/// timestamp leaves that interval.
+/// Any URL supported by CcdbApi can back the cache, e.g. a file:// stand-in of the server.
+class CCDBNodeCache
+{
+ public:
+  struct Stats {
+    uint64_t nRequests = 0;
+    uint64_t nProcessHits = 0;       // served from the objects already used by this process
+    uint64_t nNodeHits = 0;          // served from the node cache
+    uint64_t nFetches = 0;           // fetched from the CCDB
+    uint64_t nFailures = 0;          // not available
+    double fetchTimeMs = 0.;         // total time spent fetching from the CCDB
+    uint64_t fetchedBytes = 0;       // size of the objects fetched from the CCDB
+    uint64_t mappedBytes = 0;        // size of the flat payloads mapped, shared with the other devices of the node
+    uint64_t deserialisedBytes = 0;  // size of the flat payloads deserialised by this process
+  };
+
+  virtual ~CCDBNodeCache() = default;
+
+  /// Sets the CCDB and the cache directory. Without a directory, O2PHYSICS_CCDB_NODE_CACHE is used,
+  /// or a directory per user in /tmp.
+  void init(const o2::ccdb::CcdbApi* ccdbApi, const std::string& cacheDir = "");
+
+  /// Returns the local path of the object file valid at the timestamp, empty if not available
+  /// \param path is the CCDB path of the object
+  /// \param metadata is the metadata to be matched
+  /// \param timestamp is the timestamp of validity
+  std::string getFile(const std::string& path, const std::map<std::string, std::string>& metadata, int64_t timestamp);
+
+  /// Returns a mapped view of an object of type std::vector<T> valid at the timestamp, invalid if not available
+  template <typename T>
+  FlatView<T> getFlatVector(const std::string& path, const std::map<std::string, std::string>& metadata, int64_t timestamp)
+  {
+    static_assert(std::is_trivially_copyable_v<T>, "flat payloads are mapped as raw bytes");
+    const std::string blobFile = getFile(path, metadata, timestamp);
+    if (blobFile.empty()) {
+      return FlatView<T>{};
+    }
+    const std::string flatFile = blobFile + ".flat." + flatTypeTag(typeid(T).name(), sizeof(T));
+    std::lock_guard<std::mutex> lock(mMutex);
+    auto mapped = mapFlatFile(flatFile);
+    if (!mapped) {
+      // first device of the node using this payload: deserialise it once for everybody
+      std::unique_ptr<TFile> file(TFile::Open(blobFile.c_str(), "READ"));
+      std::unique_ptr<std::vector<T>> payload(file ? file->Get<std::vector<T>>("ccdb_object") : nullptr);
+      if (!payload) {
+        LOGP(error, "[CCDBNodeCache] Could not read a std::vector payload from {}", blobFile);
+        return FlatView<T>{};
+      }
+      mStats.deserialisedBytes += payload->size() * sizeof(T);
+      if (!writeFileAtomically(flatFile, reinterpret_cast<const char*>(payload->data()), payload->size() * sizeof(T))) {
+        return FlatView<T>{};
+      }
+      mapped = mapFlatFile(flatFile);
+    }
+    return FlatView<T>{mapped};
+  }
+
+  const Stats& getStats() const { return mStats; }
+  void printStats() const;
+
+ protected:
+  /// Headers of the object valid at the timestamp, empty if the CCDB cannot be reached
+  virtual std::map<std::string, std::string> retrieveHeaders(const std::string& path, const std::map<std::string, std::string>& metadata, int64_t timestamp) const;
+  /// Downloads the object valid at the timestamp to targetDir/fileName
+  virtual bool retrieveBlob(const std::string& path, const std::string& targetDir, const std::map<std::string, std::string>& metadata, int64_t timestamp, const std::string& fileName) const;
+
+ private:
+  struct Entry {
+    int64_t validFrom;
+    int64_t validUntil;
+    std::string blobFile;
+  };
+
+  const o2::ccdb::CcdbApi* mCcdbApi = nullptr;
+  std::string mCacheDir{};
+  std::map<std::string, std::vector<Entry>> mProcessEntries{};            // objects already validated by this process, per key
+  std::map<std::string, std::shared_ptr<const MappedFile>> mMappedFiles{}; // flat payloads mapped by this process
+  Stats mStats{};
+  std::mutex mMutex{};
+
+  static std::string flatTypeTag(const char* typeName, std::size_t typeSize);
+  std::shared_ptr<const MappedFile> mapFlatFile(const std::string& flatFile);
+  bool writeFileAtomically(const std::string& fileName, const char* data, std::size_t size) const;
+  bool findInNodeIndex(const std::string& key, int64_t timestamp, const std::map<std::string, std::string>& headers, Entry& entry) const;
+  bool fetch(const std::string& path, const std::map<std::string, std::string>& metadata, int64_t timestamp, const std::string& key,
+             const std::map<std::string, std::string>& headers, Entry& entry);
+  static void identifyObject(const std::map<std::string, std::string>& headers, const std::string& key, int64_t timestamp, std::string& blobId, int64_t& validFrom, int64_t& validUntil);
+};
+
+} // namespace o2::common::core
+
+#endif // COMMON_CORE_CCDBNODECACHE_H_
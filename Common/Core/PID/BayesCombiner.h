@@ -0,0 +1,272 @@
+// Copyright 2019-2020 CERN and copyright holders of ALICE O2.
+// See https://alice-o2.web.cern.ch/copyright for details of the copyright holders.
+// All rights not expressly granted are reserved.
+//
+// This software is distributed under the terms of the GNU General Public
+// License v3 (GPL Version 3), copied verbatim in the file "COPYING".
+//
+// In applying this license CERN does not waive the privileges and immunities
+// granted to it by virtue of its status as an Intergovernmental Organization
+// or submit itself to any jurisdiction.
+
+///
+/// \file   BayesCombiner.h
+/// \brief  Batched Bayesian combination of the TPC and TOF PID responses.
+///         Works on the nSigma of the PID tables, the likelihoods of all species are summed in log space
+///         and exponentiated with a vectorisable approximation of exp. Priors are resampled once per run
+///         in a flat table of logarithmic momentum bins.
+///
+
+#ifndef COMMON_CORE_PID_BAYESCOMBINER_H_
+#define COMMON_CORE_PID_BAYESCOMBINER_H_
+
+#include <ReconstructionDataFormats/PID.h>
+
+#include <TAxis.h>
+#include <TH1.h>
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+namespace o2::pid::bayes
+{
+
+static constexpr int NSpecies = o2::track::PID::NIDs;
+
+/// Approximation of exp(x) for x <= 0, relative precision of few 1e-7, flushed to 0 below -87.
+/// Cody-Waite range reduction and polynomial, inlined in the normalisation loop of BayesCombiner.
+/// The underflow is handled on the integer exponent: clamping x instead lets gcc fold the clamped case
+/// into a separate branch, and the normalisation loop is then no longer vectorised.
+inline float fastExp(float x)
+{
+  constexpr float Log2e = 1.44269504088896341f;
+  constexpr float Ln2Hi = 0.693359375f;
+  constexpr float Ln2Lo = -2.12194440e-4f;
+  // round to nearest for negative values with a truncation, which vectorises without SSE4
+  const int32_t k = static_cast<int32_t>(x * Log2e - 0.5f);
+  const float kf = static_cast<float>(k);
+  const float r = (x - kf * Ln2Hi) - kf * Ln2Lo;
+  float poly = 1.9875691500e-4f;
+  poly = poly * r + 1.3981999507e-3f;
+  poly = poly * r + 8.3334519073e-3f;
+  poly = poly * r + 4.1665795894e-2f;
+  poly = poly * r + 1.6666665459e-1f;
+  poly = poly * r + 5.0000001201e-1f;
+  poly = poly * r * r + r + 1.f;
+  const int32_t exponent = std::max(k + 127, 0); // 2^k, or 0 if it is not a normal number
+  return poly * std::bit_cast<float>(static_cast<uint32_t>(exponent) << 23);
+}
+
+/// Prior probabilities vs momentum, resampled in logarithmic bins and stored as logarithms
+class PriorTable
+{
+ public:
+  /// Flat priors
+  void setFlat()
+  {
+    mNBins = 1;
+    mLogPMin = 0.f;
+    mInvDelta = 0.f;
+    mLogPrior.assign(NSpecies, 0.f);
+  }
+
+  /// Resamples the prior histograms vs momentum, species without histogram get a prior of 1/NSpecies
+  /// \param priors histograms of the prior vs momentum, one per species, can be nullptr
+  /// \param nBins number of logarithmic momentum bins
+  /// \param pMin lower edge of the momentum range
+  /// \param pMax upper edge of the momentum range
+  void fill(const std::array<const TH1*, NSpecies>& priors, int nBins, float pMin, float pMax)
+  {
+    mNBins = std::max(nBins, 1);
+    mLogPMin = std::log(pMin);
+    const float delta = (std::log(pMax) - mLogPMin) / mNBins;
+    mInvDelta = 1.f / delta;
+    mLogPrior.assign(mNBins * NSpecies, -std::log(static_cast<float>(NSpecies)));
+    for (int bin = 0; bin < mNBins; bin++) {
+      const double p = std::exp(mLogPMin + (bin + 0.5f) * delta);
+      for (int id = 0; id < NSpecies; id++) {
+        if (priors[id] == nullptr) {
+          continue;
+        }
+        const double prior = priors[id]->GetBinContent(priors[id]->GetXaxis()->FindFixBin(p));
+        mLogPrior[bin * NSpecies + id] = std::log(std::max(prior, 1.e-30)); // null priors are kept finite
+      }
+    }
+  }
+
+  /// Momentum bin, momenta outside of the range are in the first or last bin
+  int getBin(float p) const
+  {
+    if (!(p > 0.f)) {
+      return 0;
+    }
+    const float bin = (std::log(p) - mLogPMin) * mInvDelta;
+    return bin <= 0.f ? 0 : std::min(static_cast<int>(bin), mNBins - 1);
+  }
+
+  float getLogPrior(int id, int bin) const { return mLogPrior[bin * NSpecies + id]; }
+
+ private:
+  int mNBins = 1;
+  float mLogPMin = 0.f;
+  float mInvDelta = 0.f;
+  std::vector<float> mLogPrior = std::vector<float>(NSpecies, 0.f); // [bin][species]
+};
+
+/// Bayesian combination of the TPC and TOF responses for a batch of tracks.
+/// The inputs are filled per species as flat arrays, the probabilities are computed for all tracks at once.
+class BayesCombiner
+{
+ public:
+  std::array<bool, NSpecies> enabled{}; /// species taking part in the combination
+  bool useTPC = true;                   /// include the TPC response
+  bool useTOF = true;                   /// include the TOF response
+  float tpcRange = 5.f;                 /// TPC nSigma beyond which the response of a species is a flat mismatch probability
+  float tofTail = 0.9f;                 /// TOF nSigma where the exponential tail starts
+
+  // inputs, one entry per track
+  std::vector<float> p;                                   /// momentum, for the priors
+  std::vector<uint8_t> hasTOF;                            /// whether the TOF response is available
+  std::array<std::vector<float>, NSpecies> tpcNSigma;     /// TPC nSigma per species
+  std::array<std::vector<float>, NSpecies> tofNSigma;     /// TOF nSigma per species
+  std::array<std::vector<float>, NSpecies> tofExpSigma;   /// TOF expected resolution per species
+
+  // outputs, one entry per track
+  std::array<std::vector<int8_t>, NSpecies> probability; /// Bayesian probability in percent, 0 for disabled species
+  std::vector<int8_t> mostProbableProbability;           /// Bayesian probability of the most probable species in percent
+  std::vector<uint8_t> mostProbableId;                   /// most probable species
+
+  /// Prepares the inputs and outputs for a batch of nTracks tracks.
+  /// The arrays are padded to a multiple of the block size, only the first nTracks entries are meaningful.
+  void resize(std::size_t nTracks)
+  {
+    const std::size_t nPadded = (nTracks + BlockSize - 1) / BlockSize * BlockSize;
+    p.resize(nPadded);
+    hasTOF.resize(nPadded);
+    for (int id = 0; id < NSpecies; id++) {
+      tpcNSigma[id].resize(nPadded);
+      tofNSigma[id].resize(nPadded);
+      tofExpSigma[id].resize(nPadded);
+      probability[id].resize(nPadded);
+    }
+    mostProbableProbability.resize(nPadded);
+    mostProbableId.resize(nPadded);
+  }
+
+  /// Computes the Bayesian probabilities of all the tracks of the batch
+  void compute(const PriorTable& priors)
+  {
+    for (std::size_t first = 0; first < p.size(); first += BlockSize) {
+      computeBlock(priors, first);
+    }
+  }
+
+ private:
+  static constexpr std::size_t BlockSize = 256; /// tracks processed together
+
+  /// Computes the probabilities of the tracks [first, first + BlockSize).
+  /// Intermediate values are kept in local arrays, which cannot alias the inputs. The per-species loops have a
+  /// fixed length and select with masks (TPC mismatch, TOF availability, best species) instead of conditionals;
+  /// the prior bin lookup of the first loop is not vectorised.
+  void computeBlock(const PriorTable& priors, std::size_t first)
+  {
+    constexpr std::size_t n = BlockSize;
+    const float logTPCMismatch = -std::log(static_cast<float>(NSpecies)); // as the flat TPC mismatch probability of 1/NSpecies
+    const float tofMeanCorrection = 0.07f / tofTail;                      // correction on the mean because of the tail
+    const float range = tpcRange;
+    const float tail = tofTail;
+    const float tpcWeight = useTPC ? 1.f : 0.f;
+    const float tofWeight = useTOF ? 1.f : 0.f;
+
+    std::array<std::array<float, BlockSize>, NSpecies> likelihood; // log likelihood, then likelihood
+    std::array<float, BlockSize> maxLogL;
+    std::array<float, BlockSize> sum;
+    std::array<float, BlockSize> tofMask;
+    std::array<int, BlockSize> priorBin;
+    for (std::size_t i = 0; i < n; i++) {
+      priorBin[i] = priors.getBin(p[first + i]);
+      maxLogL[i] = -std::numeric_limits<float>::max();
+      sum[i] = 0.f;
+      tofMask[i] = hasTOF[first + i] ? tofWeight : 0.f;
+    }
+
+    // log likelihoods, species by species
+    for (int id = 0; id < NSpecies; id++) {
+      if (!enabled[id]) {
+        continue;
+      }
+      float* logL = likelihood[id].data();
+      const float* nTPC = tpcNSigma[id].data() + first;
+      const float* nTOF = tofNSigma[id].data() + first;
+      for (std::size_t i = 0; i < n; i++) {
+        logL[i] = priors.getLogPrior(id, priorBin[i]);
+      }
+      for (std::size_t i = 0; i < n; i++) {
+        const float gaus = -0.5f * nTPC[i] * nTPC[i];
+        const float isMismatch = std::abs(nTPC[i]) > range ? 1.f : 0.f;
+        const float tpc = gaus + isMismatch * (logTPCMismatch - gaus);
+        // gaussian up to the tail, then exponential, written without branches
+        const float nSigma = nTOF[i] + tofMeanCorrection;
+        const float core = std::min(nSigma, tail);
+        const float tof = -0.5f * core * core - (nSigma - core) * tail;
+        const float total = logL[i] + tpcWeight * tpc + tofMask[i] * tof;
+        logL[i] = total;
+        maxLogL[i] = std::max(maxLogL[i], total); // on a local value, not on a reference to the array
+      }
+    }
+
+    // likelihoods relative to the largest one, TOF densities include the resolution of each species
+    for (int id = 0; id < NSpecies; id++) {
+      if (!enabled[id]) {
+        continue;
+      }
+      float* logL = likelihood[id].data();
+      const float* sigmaTOF = tofExpSigma[id].data() + first;
+      for (std::size_t i = 0; i < n; i++) {
+        const float isValid = sigmaTOF[i] > 0.f ? 1.f : 0.f;
+        const float sigma = 1.f + tofMask[i] * isValid * (sigmaTOF[i] - 1.f);
+        logL[i] = fastExp(logL[i] - maxLogL[i]) / sigma;
+        sum[i] += logL[i];
+      }
+    }
+
+    // normalisation, the first species with the largest probability is the most probable one
+    auto& best = maxLogL;    // reused for the largest probability
+    auto& bestId = tofMask;  // reused for the most probable species
+    for (std::size_t i = 0; i < n; i++) {
+      sum[i] = 100.f / sum[i];
+      best[i] = -1.f;
+      bestId[i] = 0.f;
+    }
+    for (int id = 0; id < NSpecies; id++) {
+      int8_t* prob = probability[id].data() + first;
+      if (!enabled[id]) {
+        std::fill(prob, prob + n, 0);
+        continue;
+      }
+      const float* l = likelihood[id].data();
+      const float fid = static_cast<float>(id);
+      for (std::size_t i = 0; i < n; i++) {
+        const float percent = l[i] * sum[i];
+        const float isBest = percent > best[i] ? 1.f : 0.f;
+        best[i] += isBest * (percent - best[i]);
+        bestId[i] += isBest * (fid - bestId[i]);
+        prob[i] = static_cast<int8_t>(percent);
+      }
+    }
+    for (std::size_t i = 0; i < n; i++) {
+      mostProbableProbability[first + i] = static_cast<int8_t>(best[i]);
+      mostProbableId[first + i] = static_cast<uint8_t>(bestId[i]);
+    }
+  }
+};
+
+} // namespace o2::pid::bayes
+
+#endif // COMMON_CORE_PID_BAYESCOMBINER_H_
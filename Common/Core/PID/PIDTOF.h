@@ -30,12 +30,15 @@
 #include <TGraph.h>
 #include <TString.h>
 
+#include <algorithm>
 #include <array>
 #include <cmath>
+#include <cstddef>
 #include <cstdint>
 #include <cstdlib>
 #include <string>
 #include <unordered_map>
+#include <utility>
 #include <vector>
 
 namespace o2::pid::tof
@@ -559,6 +562,304 @@ class ExpTimes
   }
 };
 
+/// \brief Column-wise TOF response for all the tracks of a table and all the enabled species.
+/// Same results as ExpTimes::GetExpectedSigma and ExpTimes::GetSeparation, up to the precision of the resolution
+/// tables. The species independent inputs (corrected expected momentum, time shift, momentum and eta bins) are
+/// prepared once per track, then beta, the expected times, the expected resolutions and the nSigma are computed
+/// in blocks of tracks. The tracks needing the exact formulas are listed before the blocks are processed, so the
+/// loops over the tracks of a block do not test them; with -fno-math-errno, the interpolation of the resolution
+/// and the loop computing the response of a species are vectorised.
+/// The resolution parametrizations are tabulated vs log(p) and eta once per parameter update and interpolated.
+/// The cells where the interpolation deviates by more than MaxRelativeError from the parametrization (e.g. at the
+/// kinks of the parametrization), the tracks outside of the tables and the tracks without collision are computed
+/// with the exact formulas.
+class ExpTimesBatch
+{
+ public:
+  static constexpr int NSpecies = o2::track::PID::NIDs;
+  static constexpr std::size_t BlockSize = 256;     /// tracks processed together
+  static constexpr int NBinsP = 400;                /// logarithmic momentum bins of the resolution tables
+  static constexpr float PMin = 0.05f;              /// lower momentum of the resolution tables
+  static constexpr float PMax = 20.f;               /// upper momentum of the resolution tables
+  static constexpr int NBinsEta = 80;               /// eta bins of the resolution tables
+  static constexpr float EtaMax = 1.f;              /// eta range of the resolution tables is [-EtaMax, EtaMax]
+  static constexpr float MaxRelativeError = 5.e-4f; /// largest relative deviation of the interpolated resolution
+
+  std::array<bool, NSpecies> enabled{}; /// species for which the response is computed
+
+  // outputs, one entry per track
+  std::vector<float> beta;                           /// beta, defaultReturnValue without TOF
+  std::array<std::vector<float>, NSpecies> expSigma; /// expected resolution of t-texp-t0 per species
+  std::array<std::vector<float>, NSpecies> nSigma;   /// nSigma per species, defaultReturnValue without TOF
+
+  /// Tabulates the resolution parametrizations of the enabled species, to be called when the parameters change
+  template <typename ParamType>
+  void setup(const ParamType& parameters)
+  {
+    [&]<std::size_t... id>(std::index_sequence<id...>) {
+      ((enabled[id] ? fillResolutionTable(id, [&](float p, float eta) { return parameters.template getResolution<static_cast<o2::track::PID::ID>(id)>(p, eta); }) : void()), ...);
+    }(std::make_index_sequence<NSpecies>{});
+    for (std::size_t i = 0; i < mParameters.size(); i++) {
+      mParameters[i] = parameters[i];
+    }
+  }
+
+  /// Prepares the inputs of a table of tracks, in the order of the table
+  /// \param tracks Tracks with the TOF signal and the TOF event time
+  /// \param parameters Parameters for the momentum and time shifts
+  template <typename TrackType, typename ParamType>
+  void fill(const TrackType& tracks, const ParamType& parameters)
+  {
+    resize(tracks.size());
+    std::size_t i = 0;
+    for (auto const& track : tracks) {
+      const bool isRun2 = track.trackType() == o2::aod::track::Run2Track;
+      setTrack(i++, track.p(), track.eta(), track.length(), track.tofExpMom(), track.sign(), isRun2,
+               track.tofSignal(), track.tofEvTime(), track.tofEvTimeErr(), track.hasTOF(), track.has_collision(), parameters);
+    }
+  }
+
+  /// Prepares the inputs and outputs for nTracks tracks, the arrays are padded to a multiple of the block size
+  void resize(std::size_t nTracks)
+  {
+    mNTracks = nTracks;
+    const std::size_t nPadded = (nTracks + BlockSize - 1) / BlockSize * BlockSize;
+    for (auto* column : {&mP, &mEta, &mInvP, &mLengthInvC, &mExpMom, &mInvExpMom, &mTimeShift, &mTOFSignal, &mDeltaT, &mTimeReso2, &mWeightP, &mWeightEta, &mHasTOF, &beta}) {
+      column->assign(nPadded, 0.f);
+    }
+    mTableIndex.assign(nPadded, 0);
+    for (int id = 0; id < NSpecies; id++) {
+      expSigma[id].resize(enabled[id] ? nPadded : 0);
+      nSigma[id].resize(enabled[id] ? nPadded : 0);
+      mExactSpecies[id].clear();
+    }
+    mExact.clear();
+    mNoCollision.clear();
+  }
+
+  /// Sets the inputs of the track i
+  /// \param tofExpMom expected momentum from the TOF table, in GeV/c (in GeV/c times c for Run 2 tracks)
+  template <typename ParamType>
+  void setTrack(std::size_t i, float p, float eta, float length, float tofExpMom, int sign, bool isRun2,
+                float tofSignal, float evTime, float evTimeErr, bool hasTOF, bool hasCollision, const ParamType& parameters)
+  {
+    const float chargeShift = 1.f + sign * parameters.getMomentumChargeShift(eta);
+    const float expMom = (isRun2 ? tofExpMom * o2::constants::physics::invLightSpeedCm2PS : tofExpMom) / chargeShift;
+    mP[i] = p;
+    mEta[i] = eta;
+    mInvP[i] = p > 0.f ? 1.f / p : 0.f;
+    mLengthInvC[i] = length / o2::constants::physics::LightSpeedCm2PS;
+    mExpMom[i] = expMom;
+    mInvExpMom[i] = expMom > 0.f ? 1.f / expMom : 0.f;
+    mTimeShift[i] = (hasTOF && !isRun2) ? parameters.getTimeShift(eta, sign) : 0.f;
+    mTOFSignal[i] = tofSignal;
+    mDeltaT[i] = hasTOF ? tofSignal - evTime : 1.f;
+    mTimeReso2[i] = evTimeErr * evTimeErr + parameters[4] * parameters[4];
+    mHasTOF[i] = hasTOF ? 1.f : 0.f;
+
+    // bin of the resolution tables, the tracks outside of the tables are computed with the exact formulas
+    const bool isInTable = p >= PMin && p < PMax && std::abs(eta) < EtaMax;
+    const float binP = isInTable ? (std::log(p) - LogPMin) * (NBinsP / (LogPMax - LogPMin)) : 0.f;
+    const float binEta = isInTable ? (eta + EtaMax) * (NBinsEta / (2.f * EtaMax)) : 0.f;
+    const int iP = std::min(static_cast<int>(binP), NBinsP - 1);
+    const int iEta = std::min(static_cast<int>(binEta), NBinsEta - 1);
+    mTableIndex[i] = iP * (NBinsEta + 1) + iEta;
+    mWeightP[i] = binP - iP;
+    mWeightEta[i] = binEta - iEta;
+
+    if (!hasCollision) {
+      mNoCollision.push_back(i);
+    } else if (!isInTable || (hasTOF && !(expMom > 0.f))) {
+      mExact.push_back(i);
+    }
+  }
+
+  /// Computes the response of all the tracks for the enabled species
+  template <typename ParamType>
+  void compute(const ParamType& parameters)
+  {
+    // tracks in the cells where the interpolation is not precise enough, computed after the blocks
+    for (int id = 0; id < NSpecies; id++) {
+      mExactSpecies[id].clear();
+      if (!enabled[id]) {
+        continue;
+      }
+      const uint8_t* exactCell = mExactCell[id].data();
+      for (std::size_t i = 0; i < mNTracks; i++) {
+        if (exactCell[mTableIndex[i]]) {
+          mExactSpecies[id].push_back(i);
+        }
+      }
+    }
+    for (std::size_t first = 0; first < mTableIndex.size(); first += BlockSize) {
+      computeBlock(first);
+    }
+    [&]<std::size_t... id>(std::index_sequence<id...>) {
+      ((enabled[id] ? computeExact<static_cast<o2::track::PID::ID>(id)>(parameters) : void()), ...);
+    }(std::make_index_sequence<NSpecies>{});
+    for (const auto i : mNoCollision) {
+      for (int id = 0; id < NSpecies; id++) {
+        if (enabled[id]) {
+          expSigma[id][i] = defaultReturnValue;
+          nSigma[id][i] = defaultReturnValue;
+        }
+      }
+    }
+  }
+
+  std::size_t size() const { return mNTracks; }
+
+ private:
+  static constexpr float LogPMin = -2.99573227f; // log(PMin)
+  static constexpr float LogPMax = 2.99573227f;  // log(PMax)
+
+  std::size_t mNTracks = 0;
+  std::array<std::vector<float>, NSpecies> mResolution;  // [bin in p][bin in eta] per species
+  std::array<std::vector<uint8_t>, NSpecies> mExactCell; // cells where the interpolation is not precise enough
+  std::array<float, 13> mParameters{};                   // parameters of the resolution without tables
+  // inputs, one entry per track
+  std::vector<float> mP, mEta, mInvP, mLengthInvC, mExpMom, mInvExpMom, mTimeShift, mTOFSignal, mDeltaT, mTimeReso2, mWeightP, mWeightEta, mHasTOF;
+  std::vector<int> mTableIndex;
+  std::vector<std::size_t> mExact;                              // tracks computed with the exact formulas for all species
+  std::array<std::vector<std::size_t>, NSpecies> mExactSpecies; // tracks computed with the exact formulas for one species
+  std::vector<std::size_t> mNoCollision;                        // tracks without collision, no response
+
+  /// Interpolation of the resolution table at the position (wP, wEta) inside of a cell
+  static float interpolate(const float* table, int index, float wP, float wEta)
+  {
+    const float low = table[index] + wEta * (table[index + 1] - table[index]);
+    const float high = table[index + NBinsEta + 1] + wEta * (table[index + NBinsEta + 2] - table[index + NBinsEta + 1]);
+    return low + wP * (high - low);
+  }
+
+  /// Tabulates the resolution of a species, and flags the cells where the interpolation is checked against the
+  /// parametrization in the middle of the cell in eta, at 1/4, 1/2 and 3/4 of the cell in momentum
+  template <typename FunctionType>
+  void fillResolutionTable(int id, FunctionType resolution)
+  {
+    constexpr float DeltaLogP = (LogPMax - LogPMin) / NBinsP;
+    constexpr float DeltaEta = 2.f * EtaMax / NBinsEta;
+    auto& table = mResolution[id];
+    table.resize((NBinsP + 1) * (NBinsEta + 1));
+    for (int iP = 0; iP <= NBinsP; iP++) {
+      for (int iEta = 0; iEta <= NBinsEta; iEta++) {
+        table[iP * (NBinsEta + 1) + iEta] = resolution(std::exp(LogPMin + iP * DeltaLogP), -EtaMax + iEta * DeltaEta);
+      }
+    }
+    auto& exactCell = mExactCell[id];
+    exactCell.assign(table.size(), 0);
+    for (int iP = 0; iP < NBinsP; iP++) {
+      for (int iEta = 0; iEta < NBinsEta; iEta++) {
+        const int index = iP * (NBinsEta + 1) + iEta;
+        for (const float wP : {0.25f, 0.5f, 0.75f}) {
+          const float exact = resolution(std::exp(LogPMin + (iP + wP) * DeltaLogP), -EtaMax + (iEta + 0.5f) * DeltaEta);
+          if (!(std::abs(interpolate(table.data(), index, wP, 0.5f) - exact) <= MaxRelativeError * std::abs(exact))) {
+            exactCell[index] = 1;
+          }
+        }
+      }
+    }
+  }
+
+  /// Parameters of the resolution used when the parametrization is not available, as in ExpTimes::GetExpectedSigma
+  static constexpr int parameterOffset(int id) { return id <= o2::track::PID::Pion ? 0 : (id == o2::track::PID::Kaon ? 5 : 9); }
+
+  void computeBlock(std::size_t first)
+  {
+    constexpr std::size_t n = BlockSize;
+    constexpr float Default = defaultReturnValue;
+    // species independent inputs, copied in local arrays which cannot alias the outputs
+    std::array<float, BlockSize> p, invP, lengthInvC, invExpMom, deltaT, tofSignal, timeReso2, hasTOF;
+    float* betaOut = beta.data() + first;
+    for (std::size_t i = 0; i < n; i++) {
+      p[i] = mP[first + i];
+      invP[i] = mInvP[first + i];
+      lengthInvC[i] = mLengthInvC[first + i];
+      invExpMom[i] = mInvExpMom[first + i];
+      tofSignal[i] = mTOFSignal[first + i];
+      timeReso2[i] = mTimeReso2[first + i];
+      hasTOF[i] = mHasTOF[first + i];
+      const float value = lengthInvC[i] / mDeltaT[first + i];
+      betaOut[i] = Default + hasTOF[i] * (value - Default);
+      deltaT[i] = mDeltaT[first + i] - mTimeShift[first + i]; // the time shift corrects the expected time
+    }
+
+    std::array<float, BlockSize> resolution, sigma, separationOut;
+    for (int id = 0; id < NSpecies; id++) {
+      if (!enabled[id]) {
+        continue;
+      }
+      // resolution of the tracking, bilinear interpolation of the table
+      const float* table = mResolution[id].data();
+      for (std::size_t i = 0; i < n; i++) {
+        resolution[i] = interpolate(table, mTableIndex[first + i], mWeightP[first + i], mWeightEta[first + i]);
+      }
+      const float massZ = o2::track::pid_constants::sMasses2Z[id];
+      const float massZ2 = massZ * massZ;
+      const float invMassZ2 = 1.f / massZ2;
+      const int offset = parameterOffset(id);
+      const float p0 = mParameters[offset], p1 = mParameters[offset + 1], p2 = mParameters[offset + 2], p3 = mParameters[offset + 3];
+      for (std::size_t i = 0; i < n; i++) {
+        // resolution parametrization if available, parametrization of the momentum resolution otherwise
+        const float useTable = resolution[i] > 0.f ? 1.f : 0.f;
+        const float dpp = p0 + p1 * p[i] + p2 * massZ * invP[i];
+        const float sigmaMom = dpp * tofSignal[i] / (1.f + p[i] * p[i] * invMassZ2);
+        const float sigmaTrk2 = sigmaMom * sigmaMom + p3 * p3 * invP[i] * invP[i];
+        const float reso2 = resolution[i] * resolution[i];
+        const float isValid = p[i] > 0.f ? 1.f : 0.f;
+        const float value = Default + isValid * (std::sqrt(sigmaTrk2 + useTable * (reso2 - sigmaTrk2) + timeReso2[i]) - Default);
+        // expected time, as length * sqrt(m^2 + p^2) / (c * p)
+        const float expTime = lengthInvC[i] * std::sqrt(1.f + massZ2 * invExpMom[i] * invExpMom[i]);
+        const float separation = (deltaT[i] - expTime) / value;
+        sigma[i] = value;
+        separationOut[i] = Default + hasTOF[i] * (separation - Default);
+      }
+      // the outputs are written in separate loops, so that the loop above does not need alias checks
+      std::copy(sigma.begin(), sigma.end(), expSigma[id].begin() + first);
+      std::copy(separationOut.begin(), separationOut.end(), nSigma[id].begin() + first);
+    }
+  }
+
+  /// Response of one track with the exact formulas, as in ExpTimes
+  template <o2::track::PID::ID id, typename ParamType>
+  void computeExact(const ParamType& parameters, std::size_t i)
+  {
+    constexpr float MassZ = o2::track::pid_constants::sMasses2Z[id];
+    constexpr int Offset = parameterOffset(id);
+    const float p = mP[i];
+    float sigma = defaultReturnValue;
+    if (p > 0.f) {
+      const float reso = parameters.template getResolution<id>(p, mEta[i]);
+      if (reso > 0.f) {
+        sigma = std::sqrt(reso * reso + mTimeReso2[i]);
+      } else {
+        const float dpp = mParameters[Offset] + mParameters[Offset + 1] * p + mParameters[Offset + 2] * MassZ / p;
+        const float sigmaMom = dpp * mTOFSignal[i] / (1.f + p * p / (MassZ * MassZ));
+        sigma = std::sqrt(sigmaMom * sigmaMom + mParameters[Offset + 3] * mParameters[Offset + 3] / p / p + mTimeReso2[i]);
+      }
+    }
+    expSigma[id][i] = sigma;
+    if (mHasTOF[i] > 0.f) {
+      const float expMom = mExpMom[i];
+      const float expTime = mLengthInvC[i] * std::sqrt(MassZ * MassZ + expMom * expMom) / expMom + mTimeShift[i];
+      nSigma[id][i] = (mDeltaT[i] - expTime) / sigma;
+    } else {
+      nSigma[id][i] = defaultReturnValue;
+    }
+  }
+
+  template <o2::track::PID::ID id, typename ParamType>
+  void computeExact(const ParamType& parameters)
+  {
+    for (const auto i : mExact) {
+      computeExact<id>(parameters, i);
+    }
+    for (const auto i : mExactSpecies[id]) {
+      computeExact<id>(parameters, i);
+    }
+  }
+};
+
 /// \brief Class to convert the trackTime to the tofSignal used for PID
 template <typename TrackType>
 class TOFSignal
@@ -18,6 +18,9 @@
 #include <Framework/DataTypes.h>
 #include <Framework/Logger.h>
 
+#include <array>
+#include <cmath>
+#include <cstddef>
 #include <cstdint>
 #include <functional>
 #include <set>
@@ -37,6 +40,74 @@ bool TrackSelection::FulfillsITSHitRequirements(uint8_t itsClusterMap) const
   return true;
 }
 
+void TrackSelection::IsSelectedMask(TrackBlock const& block, uint16_t* masks) const
+{
+  const std::size_t n = block.size();
+  const auto bit = [](TrackCuts cut) { return static_cast<int>(cut); };
+
+  // maximum DCAxy of each track, the pT-dependent cut is an arbitrary function and is evaluated track by track
+  std::array<float, TrackBlock::Size> maxDcaXY;
+  if (mMaxDcaXYPtDep) {
+    for (std::size_t i = 0; i < n; ++i) {
+      maxDcaXY[i] = mMaxDcaXYPtDep(block.pt[i]);
+    }
+  } else {
+    maxDcaXY.fill(mMaxDcaXY);
+  }
+
+  // loop-invariant parts of the refit and golden chi2 cuts
+  const uint32_t notRequireTPCRefit = !mRequireTPCRefit;
+  const uint32_t notRequireITSRefit = !mRequireITSRefit;
+  const uint32_t requireGoldenChi2 = mRequireGoldenChi2;
+  const uint8_t trackType = mTrackType;
+  const uint8_t run2Track = o2::aod::track::Run2Track;
+  const uint8_t run2Tracklet = o2::aod::track::Run2Tracklet;
+
+  // same cuts as IsSelected(track, cut), every cut is evaluated for every track and written to its bit of the mask
+  for (std::size_t i = 0; i < n; ++i) {
+    const uint32_t isRun2 = (block.trackType[i] == run2Track) | (block.trackType[i] == run2Tracklet);
+    const uint32_t flags = block.flags[i];
+    const uint32_t tpcRefit = (isRun2 & ((flags & o2::aod::track::TPCrefit) != 0)) | (!isRun2 & block.hasTPC[i]);
+    const uint32_t itsRefit = (isRun2 & ((flags & o2::aod::track::ITSrefit) != 0)) | (!isRun2 & block.hasITS[i]);
+    const uint32_t goldenChi2 = !(isRun2 & requireGoldenChi2) | ((flags & o2::aod::track::GoldenChi2) != 0);
+
+    uint32_t mask = 0;
+    mask |= static_cast<uint32_t>(block.trackType[i] == trackType) << bit(TrackCuts::kTrackType);
+    mask |= static_cast<uint32_t>((block.pt[i] >= mMinPt) & (block.pt[i] <= mMaxPt)) << bit(TrackCuts::kPtRange);
+    mask |= static_cast<uint32_t>((block.eta[i] >= mMinEta) & (block.eta[i] <= mMaxEta)) << bit(TrackCuts::kEtaRange);
+    mask |= static_cast<uint32_t>(block.tpcNClsFound[i] >= mMinNClustersTPC) << bit(TrackCuts::kTPCNCls);
+    mask |= static_cast<uint32_t>(block.tpcNClsCrossedRows[i] >= mMinNCrossedRowsTPC) << bit(TrackCuts::kTPCCrossedRows);
+    mask |= static_cast<uint32_t>(block.tpcCrossedRowsOverFindableCls[i] >= mMinNCrossedRowsOverFindableClustersTPC) << bit(TrackCuts::kTPCCrossedRowsOverNCls);
+    mask |= static_cast<uint32_t>(block.tpcChi2NCl[i] <= mMaxChi2PerClusterTPC) << bit(TrackCuts::kTPCChi2NDF);
+    mask |= (notRequireTPCRefit | tpcRefit) << bit(TrackCuts::kTPCRefit);
+    mask |= static_cast<uint32_t>(block.itsNCls[i] >= mMinNClustersITS) << bit(TrackCuts::kITSNCls);
+    mask |= static_cast<uint32_t>(block.itsChi2NCl[i] <= mMaxChi2PerClusterITS) << bit(TrackCuts::kITSChi2NDF);
+    mask |= (notRequireITSRefit | itsRefit) << bit(TrackCuts::kITSRefit);
+    mask |= 1u << bit(TrackCuts::kITSHits); // updated below
+    mask |= goldenChi2 << bit(TrackCuts::kGoldenChi2);
+    mask |= static_cast<uint32_t>(std::fabs(block.dcaXY[i]) <= maxDcaXY[i]) << bit(TrackCuts::kDCAxy);
+    mask |= static_cast<uint32_t>(std::fabs(block.dcaZ[i]) <= mMaxDcaZ) << bit(TrackCuts::kDCAz);
+    mask |= static_cast<uint32_t>(block.tpcFractionSharedCls[i] <= mMaxTPCFractionSharedCls) << bit(TrackCuts::kTPCFracSharedCls);
+    masks[i] = static_cast<uint16_t>(mask);
+  }
+
+  // ITS hit requirements, one pass over the block per requirement
+  for (const auto& [minHits, layerMask] : mRequiredITSHits) {
+    const uint16_t clearITSHits = static_cast<uint16_t>(~(1u << bit(TrackCuts::kITSHits)));
+    if (minHits == -1) {
+      for (std::size_t i = 0; i < n; ++i) {
+        const bool fails = (block.itsClusterMap[i] & layerMask) != 0;
+        masks[i] &= fails ? clearITSHits : static_cast<uint16_t>(0xffff);
+      }
+    } else {
+      for (std::size_t i = 0; i < n; ++i) {
+        const bool fails = __builtin_popcount(block.itsClusterMap[i] & layerMask) < minHits;
+        masks[i] &= fails ? clearITSHits : static_cast<uint16_t>(0xffff);
+      }
+    }
+  }
+}
+
 const std::string TrackSelection::mCutNames[static_cast<int>(TrackSelection::TrackCuts::kNCuts)] = {"TrackType", "PtRange", "EtaRange", "TPCNCls", "TPCCrossedRows", "TPCCrossedRowsOverNCls", "TPCChi2NDF", "TPCRefit", "ITSNCls", "ITSChi2NDF", "ITSRefit", "ITSHits", "GoldenChi2", "DCAxy", "DCAz", "TPCFracSharedCls"};
 
 void TrackSelection::SetTrackType(o2::aod::track::TrackTypeEnum trackType)
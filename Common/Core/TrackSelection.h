@@ -20,7 +20,9 @@
 
 #include <Rtypes.h>
 
+#include <array>
 #include <cmath>
+#include <cstddef>
 #include <cstdint>
 #include <functional>
 #include <set>
@@ -70,6 +72,67 @@ class TrackSelection
 
   static const std::string mCutNames[static_cast<int>(TrackCuts::kNCuts)];
 
+  /// Mask with all the selection bits set, i.e. the value of IsSelectedMask for a track passing all the cuts
+  static constexpr uint16_t AllCutsMask = static_cast<uint16_t>((1u << static_cast<int>(TrackCuts::kNCuts)) - 1u);
+
+  /// \brief Block of tracks stored column-wise for the evaluation of the selection bits of many tracks at once
+  /// The columns are gathered once per block with fill() and can be evaluated by any number of selections with
+  /// IsSelectedMask(TrackBlock const&, ...), which reads each column once per block instead of once per track and cut.
+  struct TrackBlock {
+    static constexpr std::size_t Size = 256; // maximum number of tracks in a block
+
+    std::size_t nTracks{0};
+    std::array<uint8_t, Size> trackType{};
+    std::array<uint32_t, Size> flags{};
+    std::array<uint8_t, Size> hasTPC{};
+    std::array<uint8_t, Size> hasITS{};
+    std::array<uint8_t, Size> itsClusterMap{};
+    std::array<int16_t, Size> tpcNClsFound{};
+    std::array<int16_t, Size> tpcNClsCrossedRows{};
+    std::array<uint8_t, Size> itsNCls{};
+    std::array<float, Size> pt{};
+    std::array<float, Size> eta{};
+    std::array<float, Size> tpcCrossedRowsOverFindableCls{};
+    std::array<float, Size> tpcChi2NCl{};
+    std::array<float, Size> itsChi2NCl{};
+    std::array<float, Size> tpcFractionSharedCls{};
+    std::array<float, Size> dcaXY{};
+    std::array<float, Size> dcaZ{};
+
+    void clear() { nTracks = 0; }
+    bool empty() const { return nTracks == 0; }
+    bool full() const { return nTracks == Size; }
+    std::size_t size() const { return nTracks; }
+
+    /// Append a track to the block, the block must not be full
+    template <typename T>
+    void fill(T const& track)
+    {
+      const auto i = nTracks++;
+      trackType[i] = track.trackType();
+      flags[i] = track.flags();
+      hasTPC[i] = track.hasTPC();
+      hasITS[i] = track.hasITS();
+      itsClusterMap[i] = track.itsClusterMap();
+      tpcNClsFound[i] = track.tpcNClsFound();
+      tpcNClsCrossedRows[i] = track.tpcNClsCrossedRows();
+      itsNCls[i] = track.itsNCls();
+      pt[i] = track.pt();
+      eta[i] = track.eta();
+      tpcCrossedRowsOverFindableCls[i] = track.tpcCrossedRowsOverFindableCls();
+      tpcChi2NCl[i] = track.tpcChi2NCl();
+      itsChi2NCl[i] = track.itsChi2NCl();
+      tpcFractionSharedCls[i] = track.tpcFractionSharedCls();
+      dcaXY[i] = track.dcaXY();
+      dcaZ[i] = track.dcaZ();
+    }
+  };
+
+  /// \brief Evaluate the selection bits of all the tracks of a block
+  /// \param block tracks stored column-wise
+  /// \param masks output, masks[i] is the same as IsSelectedMask(track) for the i-th track of the block
+  void IsSelectedMask(TrackBlock const& block, uint16_t* masks) const;
+
   // Temporary function to check if track passes selection criteria. To be replaced by framework filters.
   template <typename T>
   bool IsSelected(T const& track) const
@@ -0,0 +1,287 @@
+// Copyright 2019-2020 CERN and copyright holders of ALICE O2.
+// See https://alice-o2.web.cern.ch/copyright for details of the copyright holders.
+// All rights not expressly granted are reserved.
+//
+// This software is distributed under the terms of the GNU General Public
+// License v3 (GPL Version 3), copied verbatim in the file "COPYING".
+//
+// In applying this license CERN does not waive the privileges and immunities
+// granted to it by virtue of its status as an Intergovernmental Organization
+// or submit itself to any jurisdiction.
+
+///
+/// \file   TwoProngPreFitter.h
+/// \brief  Batched pre-selection of track pairs for 2-prong vertexing
+///
+/// The tracks are approximated by circles in the transverse plane and by straight lines in the
+/// (arc length, z) plane, as done for the seeding of the DCAFitterN. For each pair of tracks the
+/// closest approach of the two circles provides the seed of the secondary vertex, the transverse
+/// distance of the two tracks and their distance along z at the seed. Pairs whose seed is too far
+/// apart or outside the fiducial radius are rejected before running the full DCAFitterN.
+///
+/// The tracks are stored as structure of arrays and the pairs are evaluated in blocks: the track
+/// parameters of the two prongs of a block are first gathered in contiguous arrays, then all the
+/// pairs of the block are evaluated in one pass, both crossing and non-crossing configurations
+/// being computed and selected per pair, and the selections are applied at the end.
+///
+
+#ifndef COMMON_CORE_TWOPRONGPREFITTER_H_
+#define COMMON_CORE_TWOPRONGPREFITTER_H_
+
+#include <MathUtils/Primitive2D.h>
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace o2::common::core
+{
+
+class TwoProngPreFitter
+{
+ public:
+  static constexpr std::size_t BlockSize = 32;     // number of pairs evaluated together
+  static constexpr double RadiusStraightLine = 1.e7; // radius (cm) of the circle used to approximate straight tracks
+
+  /// Result of the pre-fit of a pair of tracks
+  struct PairResult {
+    float distanceXY{0.f}; // transverse distance of the two tracks at the closest approach (cm)
+    float distanceZ{0.f};  // distance of the two tracks along z at the seed (cm)
+    float seedX{0.f};      // seed of the secondary vertex (cm)
+    float seedY{0.f};
+    float seedZ{0.f};
+    bool isAccepted{false};
+  };
+
+  void setBz(float bz) { mBz = bz; }
+  void setMaxR(float maxR) { mMaxR = maxR; }
+  void setMaxDXYIni(float maxDXY) { mMaxDXY = maxDXY; }
+  void setMaxDZIni(float maxDZ) { mMaxDZ = maxDZ; }
+
+  float getBz() const { return mBz; }
+  float getMaxR() const { return mMaxR; }
+  float getMaxDXYIni() const { return mMaxDXY; }
+  float getMaxDZIni() const { return mMaxDZ; }
+
+  /// Removes all the tracks and pairs
+  void clear()
+  {
+    clearPairs();
+    mXRef.clear();
+    mYRef.clear();
+    mZRef.clear();
+    mCosPhi.clear();
+    mSinPhi.clear();
+    mTgl.clear();
+    mXC.clear();
+    mYC.clear();
+    mRC.clear();
+  }
+
+  /// Removes the pairs, keeping the tracks
+  void clearPairs()
+  {
+    mFirst.clear();
+    mSecond.clear();
+    mResults.clear();
+  }
+
+  /// Reserves the memory for the tracks and the pairs
+  void reserve(std::size_t nTracks, std::size_t nPairs)
+  {
+    for (auto* vec : {&mXRef, &mYRef, &mZRef, &mCosPhi, &mSinPhi, &mTgl, &mXC, &mYC, &mRC}) {
+      vec->reserve(nTracks);
+    }
+    mFirst.reserve(nPairs);
+    mSecond.reserve(nPairs);
+    mResults.reserve(nPairs);
+  }
+
+  /// Adds a track
+  /// \param trackPar is the track parametrisation (o2::track::TrackParametrization or derived)
+  /// \return index of the track, to be used in addPair
+  template <typename TTrackPar>
+  int addTrack(const TTrackPar& trackPar)
+  {
+    const auto xyz = trackPar.getXYZGlo();
+    const double phi = trackPar.getPhi();
+    const double cosPhi = std::cos(phi);
+    const double sinPhi = std::sin(phi);
+    o2::math_utils::CircleXYf_t circle;
+    float sna{0.f}, csa{0.f};
+    trackPar.getCircleParams(mBz, circle, sna, csa);
+    mXRef.push_back(xyz.X());
+    mYRef.push_back(xyz.Y());
+    mZRef.push_back(xyz.Z());
+    mCosPhi.push_back(cosPhi);
+    mSinPhi.push_back(sinPhi);
+    mTgl.push_back(trackPar.getTgl());
+    if (circle.rC > 0.f) {
+      mXC.push_back(circle.xC);
+      mYC.push_back(circle.yC);
+      mRC.push_back(circle.rC);
+    } else { // straight line, approximated by a circle with large radius
+      mXC.push_back(xyz.X() - sinPhi * RadiusStraightLine);
+      mYC.push_back(xyz.Y() + cosPhi * RadiusStraightLine);
+      mRC.push_back(RadiusStraightLine);
+    }
+    return static_cast<int>(mXRef.size()) - 1;
+  }
+
+  /// Queues a pair of tracks for the pre-fit
+  /// \return index of the pair, to be used to retrieve the result
+  int addPair(int iTrack0, int iTrack1)
+  {
+    mFirst.push_back(iTrack0);
+    mSecond.push_back(iTrack1);
+    return static_cast<int>(mFirst.size()) - 1;
+  }
+
+  std::size_t getNTracks() const { return mXRef.size(); }
+  std::size_t getNPairs() const { return mFirst.size(); }
+
+  /// Evaluates all the queued pairs
+  /// \return number of accepted pairs
+  std::size_t process()
+  {
+    const std::size_t nPairs = mFirst.size();
+    mResults.resize(nPairs);
+    std::size_t nAccepted{0};
+    for (std::size_t iStart = 0; iStart < nPairs; iStart += BlockSize) {
+      nAccepted += processBlock(iStart, std::min(BlockSize, nPairs - iStart));
+    }
+    return nAccepted;
+  }
+
+  const PairResult& getResult(std::size_t iPair) const { return mResults[iPair]; }
+  bool isAccepted(std::size_t iPair) const { return mResults[iPair].isAccepted; }
+  int getFirst(std::size_t iPair) const { return mFirst[iPair]; }
+  int getSecond(std::size_t iPair) const { return mSecond[iPair]; }
+
+ private:
+  /// Block of track parameters gathered for one prong of the pairs
+  struct ProngBlock {
+    std::array<double, BlockSize> xRef{}, yRef{}, zRef{}, cosPhi{}, sinPhi{}, tgl{}, xC{}, yC{}, rC{};
+  };
+
+  void gather(ProngBlock& block, const std::vector<int>& indices, std::size_t iStart, std::size_t nLanes) const
+  {
+    for (std::size_t iLane = 0; iLane < nLanes; ++iLane) {
+      const auto iTrack = indices[iStart + iLane];
+      block.xRef[iLane] = mXRef[iTrack];
+      block.yRef[iLane] = mYRef[iTrack];
+      block.zRef[iLane] = mZRef[iTrack];
+      block.cosPhi[iLane] = mCosPhi[iTrack];
+      block.sinPhi[iLane] = mSinPhi[iTrack];
+      block.tgl[iLane] = mTgl[iTrack];
+      block.xC[iLane] = mXC[iTrack];
+      block.yC[iLane] = mYC[iTrack];
+      block.rC[iLane] = mRC[iTrack];
+    }
+  }
+
+  /// z of the track at a point of its transverse circle
+  /// The arc length is obtained from the chord with the expansion of 2 r asin(c / 2r), the sign from the direction of the track
+  static double zAtPoint(const ProngBlock& block, std::size_t iLane, double x, double y)
+  {
+    const double dx = x - block.xRef[iLane];
+    const double dy = y - block.yRef[iLane];
+    const double chord2 = dx * dx + dy * dy;
+    const double chord = std::sqrt(chord2);
+    const double arc = chord * (1. + chord2 / (24. * block.rC[iLane] * block.rC[iLane]));
+    const double sign = (dx * block.cosPhi[iLane] + dy * block.sinPhi[iLane]) < 0. ? -1. : 1.;
+    return block.zRef[iLane] + block.tgl[iLane] * sign * arc;
+  }
+
+  std::size_t processBlock(std::size_t iStart, std::size_t nLanes)
+  {
+    gather(mBlock0, mFirst, iStart, nLanes);
+    gather(mBlock1, mSecond, iStart, nLanes);
+
+    std::array<float, BlockSize> distanceXY{}, distanceZ{}, seedX{}, seedY{}, seedZ{};
+    const double maxR2 = static_cast<double>(mMaxR) * mMaxR;
+    for (std::size_t iLane = 0; iLane < nLanes; ++iLane) {
+      const double r0 = mBlock0.rC[iLane];
+      const double r1 = mBlock1.rC[iLane];
+      const double dxC = mBlock1.xC[iLane] - mBlock0.xC[iLane];
+      const double dyC = mBlock1.yC[iLane] - mBlock0.yC[iLane];
+      const double d = std::max(std::sqrt(dxC * dxC + dyC * dyC), 1.e-9);
+      const double ux = dxC / d;
+      const double uy = dyC / d;
+
+      // circles not crossing: closest points on the line joining the centres
+      const bool isSeparate = d > r0 + r1;
+      const bool isInside = d < std::abs(r0 - r1);
+      const double side0 = (isInside && r1 > r0) ? -1. : 1.;
+      const double side1 = isSeparate ? -1. : side0;
+      const double p0x = mBlock0.xC[iLane] + side0 * ux * r0;
+      const double p0y = mBlock0.yC[iLane] + side0 * uy * r0;
+      const double p1x = mBlock1.xC[iLane] + side1 * ux * r1;
+      const double p1y = mBlock1.yC[iLane] + side1 * uy * r1;
+      const double gap = isSeparate ? d - r0 - r1 : std::abs(r0 - r1) - d;
+
+      // crossing circles: two crossing points, the one with the smallest distance in z is kept
+      const double a = (d * d + r0 * r0 - r1 * r1) / (2. * d);
+      const double h = std::sqrt(std::max(r0 * r0 - a * a, 0.));
+      const double bx = mBlock0.xC[iLane] + ux * a;
+      const double by = mBlock0.yC[iLane] + uy * a;
+      const double qAx = bx - uy * h;
+      const double qAy = by + ux * h;
+      const double qBx = bx + uy * h;
+      const double qBy = by - ux * h;
+
+      const bool isCrossing = !isSeparate && !isInside;
+      const double x0A = isCrossing ? qAx : p0x;
+      const double y0A = isCrossing ? qAy : p0y;
+      const double x1A = isCrossing ? qAx : p1x;
+      const double y1A = isCrossing ? qAy : p1y;
+      const double z0A = zAtPoint(mBlock0, iLane, x0A, y0A);
+      const double z1A = zAtPoint(mBlock1, iLane, x1A, y1A);
+      const double z0B = zAtPoint(mBlock0, iLane, qBx, qBy);
+      const double z1B = zAtPoint(mBlock1, iLane, qBx, qBy);
+      const double dzA = std::abs(z0A - z1A);
+      const double dzB = isCrossing ? std::abs(z0B - z1B) : dzA + 1.;
+      const bool useB = dzB < dzA;
+
+      distanceXY[iLane] = isCrossing ? 0.f : static_cast<float>(gap);
+      distanceZ[iLane] = static_cast<float>(useB ? dzB : dzA);
+      seedX[iLane] = static_cast<float>(useB ? qBx : 0.5 * (x0A + x1A));
+      seedY[iLane] = static_cast<float>(useB ? qBy : 0.5 * (y0A + y1A));
+      seedZ[iLane] = static_cast<float>(useB ? 0.5 * (z0B + z1B) : 0.5 * (z0A + z1A));
+    }
+
+    std::size_t nAccepted{0};
+    for (std::size_t iLane = 0; iLane < nLanes; ++iLane) {
+      auto& result = mResults[iStart + iLane];
+      result.distanceXY = distanceXY[iLane];
+      result.distanceZ = distanceZ[iLane];
+      result.seedX = seedX[iLane];
+      result.seedY = seedY[iLane];
+      result.seedZ = seedZ[iLane];
+      const double r2 = static_cast<double>(seedX[iLane]) * seedX[iLane] + static_cast<double>(seedY[iLane]) * seedY[iLane];
+      result.isAccepted = distanceXY[iLane] < mMaxDXY && distanceZ[iLane] < mMaxDZ && r2 < maxR2;
+      nAccepted += result.isAccepted;
+    }
+    return nAccepted;
+  }
+
+  float mBz{0.f};     // magnetic field (kG)
+  float mMaxR{200.f}; // maximum radius of the seed (cm)
+  float mMaxDXY{4.f}; // maximum transverse distance of the tracks at the closest approach (cm)
+  float mMaxDZ{4.f};  // maximum distance along z of the tracks at the seed (cm)
+
+  // tracks, structure of arrays
+  std::vector<double> mXRef{}, mYRef{}, mZRef{}, mCosPhi{}, mSinPhi{}, mTgl{}, mXC{}, mYC{}, mRC{};
+  // pairs
+  std::vector<int> mFirst{}, mSecond{};
+  std::vector<PairResult> mResults{};
+  // scratch blocks
+  ProngBlock mBlock0{}, mBlock1{};
+};
+
+} // namespace o2::common::core
+
+#endif // COMMON_CORE_TWOPRONGPREFITTER_H_
@@ -16,8 +16,6 @@
 
 #include <CCDB/BasicCCDBManager.h>
 #include <CommonConstants/LHCConstants.h>
-#include <CommonDataFormat/IRFrame.h>
-#include <CommonDataFormat/InteractionRecord.h>
 #include <CommonUtils/StringUtils.h>
 #include <Framework/HistogramRegistry.h>
 #include <Framework/HistogramSpec.h>
@@ -29,16 +27,22 @@
 
 #include <RtypesCore.h>
 
+#include <unistd.h>
+
 #include <algorithm>
+#include <array>
+#include <bit>
 #include <bitset>
 #include <cstddef>
 #include <cstdint>
+#include <cstdio>
+#include <fstream>
 #include <memory>
+#include <numeric>
 #include <string>
+#include <utility>
 #include <vector>
 
-using o2::InteractionRecord;
-
 namespace
 {
 int findBin(TH1* hist, const std::string& label)
@@ -189,9 +193,16 @@ std::vector<int> Zorro::initCCDB(o2::ccdb::BasicCCDBManager* ccdb, int runNumber
   mScalers = mCCDB->getForRun<TH1D>(mBaseCCDBPath + "FilterCounters", runNumber, true);
   mSelections = mCCDB->getForRun<TH1D>(mBaseCCDBPath + "SelectionCounters", runNumber, true);
   mInspectedTVX = mCCDB->getForRun<TH1D>(mBaseCCDBPath + "InspectedTVX", runNumber, true);
-  setupHelpers(timestamp);
-  mLastBCglobalId = 0;
+  mIndex.clear();
+  if (!mLocalIndexPath.empty() && mIndex.read(getLocalIndexFileName())) {
+    LOGF(info, "Zorro index for run %d read from %s", runNumber, getLocalIndexFileName().data());
+    mAccountedBCranges.assign(mIndex.size(), false);
+  } else {
+    setupHelpers(timestamp);
+  }
+  mLastBCmin = 0;
   mLastSelectedIdx = 0;
+  mCursor = 0;
   mTOIs.clear();
   mTOIidx.clear();
   std::vector<std::string> tokens = o2::utils::Str::tokenize(tois, ','); // tokens are trimmed
@@ -219,39 +230,46 @@ std::vector<int> Zorro::initCCDB(o2::ccdb::BasicCCDBManager* ccdb, int runNumber
 std::bitset<128> Zorro::fetch(uint64_t bcGlobalId, uint64_t tolerance)
 {
   mLastResult.reset();
-  if (bcGlobalId < mBCranges.front().getMin().toLong() - tolerance || bcGlobalId > mBCranges.back().getMax().toLong() + tolerance) {
+  if (mIndex.empty() || bcGlobalId + tolerance < mIndex.bcStart.front() || bcGlobalId > mIndex.bcEndMax.back() + tolerance) { /// also when the index was read from the local file, it only covers the ZorroHelpers of one timestamp
     setupHelpers((mOrbitResetTimestamp + static_cast<int64_t>(bcGlobalId * o2::constants::lhc::LHCBunchSpacingNS * 1e-3)) / 1000);
   }
 
-  o2::dataformats::IRFrame bcFrame{InteractionRecord::long2IR(bcGlobalId) - tolerance, InteractionRecord::long2IR(bcGlobalId) + tolerance};
-  if (bcGlobalId < mLastBCglobalId) { /// Handle the possible discontinuity in the BC processed by the analyses
-    mLastSelectedIdx = 0;
+  const uint64_t bcMin = bcGlobalId > tolerance ? bcGlobalId - tolerance : 0;
+  const uint64_t bcMax = bcGlobalId + tolerance;
+  if (bcMin < mLastBCmin) { /// Handle the possible discontinuity in the BC processed by the analyses
+    mCursor = 0;
   }
-  uint64_t lastSelectedIdx = mLastSelectedIdx;
-  mLastBCglobalId = bcGlobalId;
-  for (size_t i = mLastSelectedIdx; i < mBCranges.size(); i++) {
-    if (!mBCranges[i].isOutside(bcFrame)) {
+  mLastBCmin = bcMin;
+  const auto [first, last] = mIndex.findCandidates(bcMin, bcMax, mCursor);
+  mCursor = first;
+
+  std::array<uint64_t, 2> result{0ull, 0ull};
+  bool isFirstMatch{true};
+  for (size_t i = first; i < last; i++) {
+    if (mIndex.bcEnd[i] < bcMin) {
+      continue;
+    }
+    const auto& selMask = mIndex.selMask[i];
+    result[0] |= selMask[0];
+    result[1] |= selMask[1];
+    if (isFirstMatch) {
+      mLastSelectedIdx = i;
+      isFirstMatch = false;
+    }
+    if (!mAccountedBCranges[i]) {
+      mAccountedBCranges[i] = true;
       for (int iMask{0}; iMask < 2; ++iMask) {
-        for (int iTOI{0}; iTOI < 64; ++iTOI) {
-          if (mZorroHelpers->at(i).selMask[iMask] & (1ull << iTOI)) {
-            mLastResult.set(iMask * 64 + iTOI, 1);
-            if (!mAccountedBCranges[i]) {
-              mATcounts[iMask * 64 + iTOI]++;
-              if (mAnalysedTriggers) {
-                mAnalysedTriggers->Fill(iMask * 64 + iTOI);
-              }
-            }
+        for (uint64_t bits = selMask[iMask]; bits; bits &= bits - 1) {
+          const int iTrigger = iMask * 64 + std::countr_zero(bits);
+          mATcounts[iTrigger]++;
+          if (mAnalysedTriggers) {
+            mAnalysedTriggers->Fill(iTrigger);
           }
         }
       }
-      mAccountedBCranges[i] = true;
-      mLastSelectedIdx = mLastSelectedIdx == lastSelectedIdx-- ? i : mLastSelectedIdx; /// Decrease lastSelectedIdx to make sure this check is valid only in its first instance
-    } else if (mBCranges[i].getMax() < bcFrame.getMin()) {
-      mLastSelectedIdx = i;
-    } else if (mBCranges[i].getMin() > bcFrame.getMax()) {
-      break;
     }
   }
+  mLastResult = (std::bitset<128>(result[1]) << 64) | std::bitset<128>(result[0]);
   return mLastResult;
 }
 
@@ -315,10 +333,127 @@ void Zorro::setupHelpers(int64_t timestamp)
   }
   mZorroHelpers = mCCDB->getSpecific<std::vector<ZorroHelper>>(mBaseCCDBPath + "ZorroHelpers", timestamp, {{"runNumber", std::to_string(mRunNumber)}});
   std::sort(mZorroHelpers->begin(), mZorroHelpers->end(), [](const auto& a, const auto& b) { return std::min(a.bcAOD, a.bcEvSel) < std::min(b.bcAOD, b.bcEvSel); });
-  mBCranges.clear();
-  mAccountedBCranges.clear();
-  for (const auto& helper : *mZorroHelpers) {
-    mBCranges.emplace_back(InteractionRecord::long2IR(std::min(helper.bcAOD, helper.bcEvSel)), InteractionRecord::long2IR(std::max(helper.bcAOD, helper.bcEvSel)));
+  ZorroIndex index;
+  index.build(*mZorroHelpers);
+  if (index == mIndex) { /// same BC ranges, keep track of the ranges already accounted
+    return;
+  }
+  mIndex = std::move(index);
+  mAccountedBCranges.assign(mIndex.size(), false);
+  mCursor = 0;
+  if (!mLocalIndexPath.empty() && !mIndex.write(getLocalIndexFileName())) { /// keep the local file in sync with the last ZorroHelpers fetched
+    LOGF(warning, "Zorro index for run %d could not be written to %s", mRunNumber, getLocalIndexFileName().data());
+  }
+}
+
+std::string Zorro::getLocalIndexFileName() const
+{
+  /// FNV-1a hash of the CCDB path, std::hash is not guaranteed to be the same across jobs
+  uint64_t pathHash{0xcbf29ce484222325};
+  for (const char c : mBaseCCDBPath) {
+    pathHash = (pathHash ^ static_cast<unsigned char>(c)) * 0x100000001b3;
+  }
+  return mLocalIndexPath + "/zorroIndex_" + std::to_string(mRunNumber) + "_" + std::to_string(pathHash) + ".bin";
+}
+
+void ZorroIndex::build(const std::vector<ZorroHelper>& helpers)
+{
+  clear();
+  std::vector<size_t> order(helpers.size());
+  std::iota(order.begin(), order.end(), 0);
+  std::stable_sort(order.begin(), order.end(), [&helpers](size_t a, size_t b) { return std::min(helpers[a].bcAOD, helpers[a].bcEvSel) < std::min(helpers[b].bcAOD, helpers[b].bcEvSel); });
+  bcStart.reserve(helpers.size());
+  bcEnd.reserve(helpers.size());
+  bcEndMax.reserve(helpers.size());
+  selMask.reserve(helpers.size());
+  uint64_t endMax{0};
+  for (const auto& iHelper : order) {
+    const auto& helper = helpers[iHelper];
+    bcStart.push_back(std::min(helper.bcAOD, helper.bcEvSel));
+    bcEnd.push_back(std::max(helper.bcAOD, helper.bcEvSel));
+    endMax = std::max<uint64_t>(endMax, bcEnd.back());
+    bcEndMax.push_back(endMax);
+    selMask.push_back({helper.selMask[0], helper.selMask[1]});
+  }
+}
+
+void ZorroIndex::clear()
+{
+  bcStart.clear();
+  bcEnd.clear();
+  bcEndMax.clear();
+  selMask.clear();
+}
+
+std::pair<size_t, size_t> ZorroIndex::findCandidates(uint64_t bcMin, uint64_t bcMax, size_t cursor) const
+{
+  cursor = std::min(cursor, size());
+  const size_t first = std::lower_bound(bcEndMax.begin() + cursor, bcEndMax.end(), bcMin) - bcEndMax.begin();
+  const size_t last = std::upper_bound(bcStart.begin() + first, bcStart.end(), bcMax) - bcStart.begin();
+  return {first, std::max(first, last)};
+}
+
+namespace
+{
+constexpr uint64_t ZorroIndexMagic{0x5a4f52524f494458}; // "ZORROIDX"
+}
+
+bool ZorroIndex::write(const std::string& fileName) const
+{
+  const std::string tmpFileName = fileName + ".tmp" + std::to_string(getpid());
+  {
+    std::ofstream out(tmpFileName, std::ios::binary | std::ios::trunc);
+    if (!out) {
+      std::remove(tmpFileName.data());
+      return false;
+    }
+    const uint64_t nRanges = size();
+    out.write(reinterpret_cast<const char*>(&ZorroIndexMagic), sizeof(ZorroIndexMagic));
+    out.write(reinterpret_cast<const char*>(&nRanges), sizeof(nRanges));
+    out.write(reinterpret_cast<const char*>(bcStart.data()), nRanges * sizeof(uint64_t));
+    out.write(reinterpret_cast<const char*>(bcEnd.data()), nRanges * sizeof(uint64_t));
+    out.write(reinterpret_cast<const char*>(selMask.data()), nRanges * sizeof(std::array<uint64_t, 2>));
+    if (!out) {
+      out.close();
+      std::remove(tmpFileName.data());
+      return false;
+    }
+  }
+  if (std::rename(tmpFileName.data(), fileName.data()) != 0) { /// atomic replacement, other jobs never see a partial file
+    std::remove(tmpFileName.data());
+    return false;
+  }
+  return true;
+}
+
+bool ZorroIndex::read(const std::string& fileName)
+{
+  clear();
+  std::ifstream in(fileName, std::ios::binary);
+  if (!in) {
+    return false;
+  }
+  uint64_t magic{0}, nRanges{0};
+  in.read(reinterpret_cast<char*>(&magic), sizeof(magic));
+  in.read(reinterpret_cast<char*>(&nRanges), sizeof(nRanges));
+  if (!in || magic != ZorroIndexMagic) {
+    return false;
+  }
+  bcStart.resize(nRanges);
+  bcEnd.resize(nRanges);
+  selMask.resize(nRanges);
+  in.read(reinterpret_cast<char*>(bcStart.data()), nRanges * sizeof(uint64_t));
+  in.read(reinterpret_cast<char*>(bcEnd.data()), nRanges * sizeof(uint64_t));
+  in.read(reinterpret_cast<char*>(selMask.data()), nRanges * sizeof(std::array<uint64_t, 2>));
+  if (!in) {
+    clear();
+    return false;
+  }
+  bcEndMax.resize(nRanges);
+  uint64_t endMax{0};
+  for (size_t i{0}; i < nRanges; ++i) {
+    endMax = std::max(endMax, bcEnd[i]);
+    bcEndMax[i] = endMax;
   }
-  mAccountedBCranges.resize(mBCranges.size(), false);
+  return true;
 }
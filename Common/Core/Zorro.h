@@ -28,7 +28,9 @@
 #include <TH1.h>
 #include <TH2.h>
 
+#include <array>
 #include <bitset>
+#include <cstddef>
 #include <cstdint>
 #include <string>
 #include <utility>
@@ -42,6 +44,26 @@ class BasicCCDBManager;
 };
 }; // namespace o2
 
+/// Index of the BC ranges of the software trigger decisions of a run
+/// The ranges are sorted by their first BC, the running maximum of the last BC makes it possible to find
+/// with a binary search the first range that can overlap with a given BC window
+struct ZorroIndex {
+  std::vector<uint64_t> bcStart;                /// first BC of each range, sorted
+  std::vector<uint64_t> bcEnd;                  /// last BC of each range
+  std::vector<uint64_t> bcEndMax;               /// running maximum of bcEnd
+  std::vector<std::array<uint64_t, 2>> selMask; /// selection mask of each range
+
+  void build(const std::vector<ZorroHelper>& helpers);
+  void clear();
+  bool empty() const { return bcStart.empty(); }
+  size_t size() const { return bcStart.size(); }
+  /// Range [first, last) of the BC ranges that can overlap with [bcMin, bcMax], the search starts from cursor
+  std::pair<size_t, size_t> findCandidates(uint64_t bcMin, uint64_t bcMax, size_t cursor = 0) const;
+  bool write(const std::string& fileName) const;
+  bool read(const std::string& fileName);
+  bool operator==(const ZorroIndex&) const = default;
+};
+
 class Zorro
 {
  public:
@@ -67,11 +89,13 @@ class Zorro
   void setCCDBpath(const std::string& path) { mBaseCCDBPath = path; }
   void setBaseCCDBPath(const std::string& path) { mBaseCCDBPath = path; }
   void setBCtolerance(int tolerance) { mBCtolerance = tolerance; }
+  void setLocalIndexPath(const std::string& path) { mLocalIndexPath = path; } /// Directory where the index of the BC ranges is stored for reuse by other jobs on the same run
 
   ZorroSummary* getZorroSummary() { return &mZorroSummary; }
 
  private:
   void setupHelpers(int64_t timestamp);
+  std::string getLocalIndexFileName() const;
 
   ZorroSummary mZorroSummary{"ZorroSummary", "ZorroSummary"};
 
@@ -87,14 +111,16 @@ class Zorro
   std::vector<TH1*> mAnalysedTriggersOfInterestList; /// Per run histograms
 
   int mBCtolerance = 100;
-  uint64_t mLastBCglobalId = 0;
+  uint64_t mLastBCmin = 0;
   uint64_t mLastSelectedIdx = 0;
+  size_t mCursor = 0; /// First BC range that can overlap with the last fetched BC window
   TH1D* mScalers = nullptr;
   TH1D* mSelections = nullptr;
   TH1D* mInspectedTVX = nullptr;
   std::bitset<128> mLastResult;
   std::vector<bool> mAccountedBCranges; /// Avoid double accounting of inspected BC ranges
-  std::vector<o2::dataformats::IRFrame> mBCranges;
+  ZorroIndex mIndex;
+  std::string mLocalIndexPath;
   std::vector<ZorroHelper>* mZorroHelpers = nullptr;
   std::vector<std::string> mTOIs;
   std::vector<int> mTOIidx;
@@ -0,0 +1,185 @@
+// Copyright 2019-2020 CERN and copyright holders of ALICE O2.
+// See https://alice-o2.web.cern.ch/copyright for details of the copyright holders.
+// All rights not expressly granted are reserved.
+//
+// This software is distributed under the terms of the GNU General Public
+// License v3 (GPL Version 3), copied verbatim in the file "COPYING".
+//
+// In applying this license CERN does not waive the privileges and immunities
+// granted to it by virtue of its status as an Intergovernmental Organization
+// or submit itself to any jurisdiction.
+
+///
+/// \file   testCCDBNodeCache.cxx
+/// \brief  Hits, misses and stale entries of the node-local CCDB cache, against an in-memory CCDB
+///
+
+#define BOOST_TEST_MODULE Test CCDBNodeCache
+#define BOOST_TEST_MAIN
+#define BOOST_TEST_DYN_LINK
+
+#include "Common/Core/CCDBNodeCache.h"
+
+#include <boost/test/unit_test.hpp>
+
+#include <unistd.h>
+
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <map>
+#include <string>
+
+using o2::common::core::CCDBNodeCache;
+
+namespace
+{
+struct TestObject {
+  std::string content;
+  std::string etag;
+  int64_t validFrom;
+  int64_t validUntil;
+};
+
+/// Node cache served by an in-memory CCDB, counting the requests sent to it
+class TestNodeCache : public CCDBNodeCache
+{
+ public:
+  explicit TestNodeCache(const std::map<std::string, TestObject>& objects) : mObjects(objects) {}
+
+  mutable int nHeaderRequests = 0;
+  mutable int nBlobRequests = 0;
+
+ protected:
+  std::map<std::string, std::string> retrieveHeaders(const std::string& path, const std::map<std::string, std::string>&, int64_t timestamp) const override
+  {
+    nHeaderRequests++;
+    const auto* object = find(path, timestamp);
+    if (object == nullptr) {
+      return {};
+    }
+    return {{"ETag", object->etag}, {"Valid-From", std::to_string(object->validFrom)}, {"Valid-Until", std::to_string(object->validUntil)}};
+  }
+
+  bool retrieveBlob(const std::string& path, const std::string& targetDir, const std::map<std::string, std::string>&, int64_t timestamp, const std::string& fileName) const override
+  {
+    nBlobRequests++;
+    const auto* object = find(path, timestamp);
+    if (object == nullptr) {
+      return false;
+    }
+    std::ofstream(targetDir + "/" + fileName, std::ios::binary) << object->content;
+    return true;
+  }
+
+ private:
+  const std::map<std::string, TestObject>& mObjects;
+
+  const TestObject* find(const std::string& path, int64_t timestamp) const
+  {
+    const auto found = mObjects.find(path);
+    if (found == mObjects.end() || timestamp < found->second.validFrom || found->second.validUntil <= timestamp) {
+      return nullptr;
+    }
+    return &found->second;
+  }
+};
+
+std::string readFile(const std::string& fileName)
+{
+  std::ifstream file(fileName, std::ios::binary);
+  return {std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>()};
+}
+
+/// Empty cache directory, removed at the end of the test
+struct CacheDir {
+  const std::string path = (std::filesystem::temp_directory_path() / ("o2physics-ccdb-node-cache-test-" + std::to_string(getpid()))).string();
+  CacheDir() { std::filesystem::remove_all(path); }
+  ~CacheDir() { std::filesystem::remove_all(path); }
+};
+} // namespace
+
+BOOST_AUTO_TEST_CASE(NodeCacheMiss)
+{
+  CacheDir dir;
+  std::map<std::string, TestObject> ccdb;
+  TestNodeCache cache(ccdb);
+  cache.init(nullptr, dir.path);
+
+  // not on the CCDB
+  BOOST_CHECK(cache.getFile("Test/Object", {}, 150).empty());
+  BOOST_CHECK_EQUAL(cache.getStats().nFailures, 1u);
+
+  // first request: fetched from the CCDB
+  ccdb["Test/Object"] = TestObject{"first", "etag-1", 100, 200};
+  const std::string file = cache.getFile("Test/Object", {}, 150);
+  BOOST_CHECK_EQUAL(readFile(file), "first");
+  BOOST_CHECK_EQUAL(cache.getStats().nFetches, 1u);
+  BOOST_CHECK_EQUAL(cache.nBlobRequests, 2);
+
+  // outside of the validity
+  BOOST_CHECK(cache.getFile("Test/Object", {}, 250).empty());
+  BOOST_CHECK_EQUAL(cache.getStats().nFailures, 2u);
+}
+
+BOOST_AUTO_TEST_CASE(NodeCacheHit)
+{
+  CacheDir dir;
+  std::map<std::string, TestObject> ccdb{{"Test/Object", TestObject{"first", "etag-1", 100, 200}}};
+  std::string file;
+  {
+    TestNodeCache cache(ccdb);
+    cache.init(nullptr, dir.path);
+    file = cache.getFile("Test/Object", {}, 150);
+    BOOST_CHECK_EQUAL(cache.getStats().nFetches, 1u);
+
+    // same validity interval: served by the process without contacting the CCDB
+    BOOST_CHECK_EQUAL(cache.getFile("Test/Object", {}, 120), file);
+    BOOST_CHECK_EQUAL(cache.getFile("Test/Object", {}, 199), file);
+    BOOST_CHECK_EQUAL(cache.getStats().nProcessHits, 2u);
+    BOOST_CHECK_EQUAL(cache.nHeaderRequests, 1);
+    BOOST_CHECK_EQUAL(cache.nBlobRequests, 1);
+  }
+
+  // another device of the node: validated once, not downloaded again
+  TestNodeCache cache(ccdb);
+  cache.init(nullptr, dir.path);
+  BOOST_CHECK_EQUAL(cache.getFile("Test/Object", {}, 150), file);
+  BOOST_CHECK_EQUAL(cache.getFile("Test/Object", {}, 160), file);
+  BOOST_CHECK_EQUAL(cache.getStats().nNodeHits, 1u);
+  BOOST_CHECK_EQUAL(cache.getStats().nProcessHits, 1u);
+  BOOST_CHECK_EQUAL(cache.getStats().nFetches, 0u);
+  BOOST_CHECK_EQUAL(cache.nHeaderRequests, 1);
+  BOOST_CHECK_EQUAL(cache.nBlobRequests, 0);
+  BOOST_CHECK_EQUAL(readFile(file), "first");
+}
+
+BOOST_AUTO_TEST_CASE(NodeCacheStale)
+{
+  CacheDir dir;
+  std::map<std::string, TestObject> ccdb{{"Test/Object", TestObject{"first", "etag-1", 100, 200}}};
+  {
+    TestNodeCache cache(ccdb);
+    cache.init(nullptr, dir.path);
+    BOOST_CHECK_EQUAL(readFile(cache.getFile("Test/Object", {}, 150)), "first");
+  }
+
+  // re-uploaded with the same validity: the node entry is stale and the new object is fetched
+  ccdb["Test/Object"] = TestObject{"second", "etag-2", 100, 200};
+  {
+    TestNodeCache cache(ccdb);
+    cache.init(nullptr, dir.path);
+    BOOST_CHECK_EQUAL(readFile(cache.getFile("Test/Object", {}, 150)), "second");
+    BOOST_CHECK_EQUAL(cache.getStats().nNodeHits, 0u);
+    BOOST_CHECK_EQUAL(cache.getStats().nFetches, 1u);
+  }
+
+  // re-uploaded with a shorter validity: the node entry does not match the CCDB any more
+  ccdb["Test/Object"] = TestObject{"third", "etag-3", 140, 200};
+  TestNodeCache cache(ccdb);
+  cache.init(nullptr, dir.path);
+  BOOST_CHECK_EQUAL(readFile(cache.getFile("Test/Object", {}, 150)), "third");
+  BOOST_CHECK_EQUAL(cache.getStats().nNodeHits, 0u);
+  BOOST_CHECK_EQUAL(cache.getStats().nFetches, 1u);
+}
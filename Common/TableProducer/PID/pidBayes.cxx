@@ -14,8 +14,11 @@
 /// \author Nicolo' Jacazio
 /// \brief  Task to produce PID tables for Bayes PID.
 ///         Only the tables for the mass hypotheses requested are filled, the others are sent empty.
+///         The processNSigma* modes combine the nSigma of the TPC and TOF tables for all tracks at once
+///         with the BayesCombiner, with priors resampled once per run.
 ///
 
+#include "Common/Core/PID/BayesCombiner.h"
 #include "Common/Core/PID/DetectorResponse.h"
 #include "Common/Core/PID/PIDTOF.h"
 #include "Common/Core/PID/ParamBase.h"
@@ -23,6 +26,7 @@
 #include "Common/DataModel/Multiplicity.h"
 #include "Common/DataModel/PIDResponseCombined.h"
 #include "Common/DataModel/PIDResponseTOF.h"
+#include "Common/DataModel/PIDResponseTPC.h"
 #include "Common/DataModel/TrackSelectionTables.h"
 
 #include <CCDB/BasicCCDBManager.h>
@@ -41,6 +45,7 @@
 #include <ReconstructionDataFormats/PID.h>
 
 #include <TFile.h>
+#include <TH1.h>
 #include <TMath.h>
 #include <TString.h>
 
@@ -48,10 +53,12 @@
 #include <array>
 #include <chrono>
 #include <cmath>
+#include <cstddef>
 #include <cstdint>
 #include <cstdlib>
 #include <iterator>
 #include <memory>
+#include <span>
 #include <string>
 #include <string_view>
 #include <utility>
@@ -116,6 +123,10 @@ struct bayesPid {
   Configurable<std::string> ccdbPathTOF{"ccdbPathTOF", "TOF/Calib", "Path of the TOF parametrization on the CCDB"};
   Configurable<std::string> ccdbPathTPC{"ccdbPathTPC", "Analysis/PID/TPC/Response", "Path of the TPC parametrization on the CCDB"};
   Configurable<int64_t> timestamp{"ccdb-timestamp", -1, "timestamp of the object"};
+  Configurable<std::string> ccdbPathPriors{"ccdbPathPriors", "", "Path of the priors on the CCDB, one TH1 vs momentum per species in <path>/<El, Mu, ...>. If empty the priors are flat"};
+  Configurable<int> nBinsPrior{"nBinsPrior", 200, "Number of logarithmic momentum bins of the prior tables"};
+  Configurable<float> minPPrior{"minPPrior", 0.1f, "Minimum momentum of the prior tables"};
+  Configurable<float> maxPPrior{"maxPPrior", 20.f, "Maximum momentum of the prior tables"};
 
   // Configuration flags to include and exclude particle hypotheses
   // Configurable<LabeledArray<int>> pid{"pid",
@@ -158,6 +169,10 @@ struct bayesPid {
 
   float fRange = 5.f;
 
+  o2::pid::bayes::BayesCombiner combiner; /// Batched combination of the nSigma
+  o2::pid::bayes::PriorTable priorTable;  /// Priors of the current run
+  int lastRun = -1;
+
   void init(o2::framework::InitContext& initContext)
   {
     for (int i = 0; i < kNProb; i++) { // Setting all probabilities to the default value
@@ -231,6 +246,13 @@ struct bayesPid {
     enableParticle(PID::Helium3, pidHe);
     enableParticle(PID::Alpha, pidAl);
 
+    if (doprocessStandard + doprocessNSigmaLight + doprocessNSigmaAll > 1) {
+      LOG(fatal) << "Only one of processStandard, processNSigmaLight and processNSigmaAll can be enabled";
+    }
+    if (doprocessNSigmaLight && (pidDe == 1 || pidTr == 1 || pidHe == 1 || pidAl == 1)) {
+      LOG(fatal) << "The light nuclei tables are requested but processNSigmaLight only combines electrons, muons, pions, kaons and protons, use processNSigmaAll";
+    }
+
     enabledSpecies.shrink_to_fit();
     std::sort(enabledSpecies.begin(), enabledSpecies.end());
     if (enabledSpecies.size() == 0) { // No enabled species
@@ -242,14 +264,17 @@ struct bayesPid {
     } else { // All ok
       LOG(info) << enabledSpecies.size() << " species enabled for the Bayesian PID computation";
     }
-    // Getting the parametrization parameters
     ccdb->setURL(url.value);
     ccdb->setTimestamp(timestamp.value);
     ccdb->setCaching(true);
     ccdb->setLocalObjectValidityChecking();
     // Not later than now objects
     ccdb->setCreatedNotAfter(std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::system_clock::now().time_since_epoch()).count());
-    //
+    priorTable.setFlat();
+    if (!doprocessStandard) { // The nSigma modes do not need the parametrizations
+      return;
+    }
+    // Getting the parametrization parameters
     const std::vector<float> p = {0.008, 0.008, 0.002, 40.0};
     Response[kTOF].SetParameters(DetectorResponse::kSigma, p);
     const std::string fnameTOF = paramfileTOF.value;
@@ -458,7 +483,7 @@ struct bayesPid {
     }
   }
 
-  void process(Coll const& collisions, Trks const& tracks)
+  void processStandard(Coll const& collisions, Trks const& tracks)
   {
 
     // Check and fill enabled tables
@@ -538,6 +563,119 @@ struct bayesPid {
       tableBayes((*mostProbable) * 100.f, std::distance(Probability[kBayesian].begin(), mostProbable));
     }
   }
+  PROCESS_SWITCH(bayesPid, processStandard, "Compute the probabilities from the detector signals, track by track", true);
+
+  /// Resamples the priors of the run in the prior table
+  void updatePriors(aod::BCsWithTimestamps::iterator const& bc)
+  {
+    if (bc.runNumber() == lastRun) {
+      return;
+    }
+    lastRun = bc.runNumber();
+    if (ccdbPathPriors.value.empty()) {
+      priorTable.setFlat();
+      return;
+    }
+    static constexpr const char* particles[PID::NIDs] = {"El", "Mu", "Pi", "Ka", "Pr", "De", "Tr", "He", "Al"};
+    std::array<const TH1*, PID::NIDs> priors{};
+    bool missingPrior = false;
+    const bool fatalWhenNull = ccdb->getFatalWhenNull();
+    ccdb->setFatalWhenNull(false); // missing priors are replaced by flat ones
+    for (int id = 0; id < PID::NIDs; id++) {
+      if (!combiner.enabled[id]) { // only the priors of the combined species are needed
+        continue;
+      }
+      priors[id] = ccdb->getForTimeStamp<TH1>(ccdbPathPriors.value + "/" + particles[id], bc.timestamp());
+      if (priors[id] == nullptr) {
+        LOG(warning) << "No prior for " << PID::getName(id) << " in run " << lastRun;
+        missingPrior = true;
+      }
+    }
+    ccdb->setFatalWhenNull(fatalWhenNull);
+    if (missingPrior) { // priors of different species are only comparable if they come from the same set
+      LOG(warning) << "Using flat priors for all species in run " << lastRun;
+      priorTable.setFlat();
+      return;
+    }
+    priorTable.fill(priors, nBinsPrior, minPPrior, maxPPrior);
+    LOG(info) << "Priors resampled for run " << lastRun;
+  }
+
+  /// Copies the nSigma of the first nSpecies species from the tables and computes the probabilities of all tracks at once.
+  /// Species without nSigma tables get a null probability.
+  template <std::size_t nSpecies, typename TrksType>
+  void fillFromNSigma(TrksType const& tracks, aod::BCsWithTimestamps const& bcs)
+  {
+    if (bcs.size() == 0) {
+      return;
+    }
+    combiner.enabled.fill(false);
+    for (const auto enabledPid : enabledSpecies) {
+      combiner.enabled[enabledPid] = enabledPid < nSpecies;
+    }
+    updatePriors(bcs.begin());
+    combiner.useTPC = enabledDet[kTPC];
+    combiner.useTOF = enabledDet[kTOF];
+    combiner.tpcRange = fRange;
+    combiner.tofTail = fTOFtail;
+
+    combiner.resize(tracks.size());
+    std::size_t i = 0;
+    for (auto const& trk : tracks) {
+      combiner.p[i] = trk.p();
+      combiner.hasTOF[i] = trk.hasTOF();
+      [&]<std::size_t... id>(std::index_sequence<id...>) {
+        ((combiner.tpcNSigma[id][i] = o2::aod::pidutils::tpcNSigma<static_cast<PID::ID>(id)>(trk)), ...);
+        ((combiner.tofNSigma[id][i] = o2::aod::pidutils::tofNSigma<static_cast<PID::ID>(id)>(trk)), ...);
+        ((combiner.tofExpSigma[id][i] = o2::aod::pidutils::tofExpSigma<static_cast<PID::ID>(id)>(trk)), ...);
+      }(std::make_index_sequence<nSpecies>{});
+      i++;
+    }
+    combiner.compute(priorTable);
+
+    auto fillTable = [&](const Configurable<int>& flag, auto& table, PID::ID id) {
+      if (flag.value != 1) {
+        return;
+      }
+      table.reserve(tracks.size());
+      for (const auto prob : std::span(combiner.probability[id].data(), tracks.size())) {
+        table(prob);
+      }
+    };
+    fillTable(pidEl, tablePIDEl, PID::Electron);
+    fillTable(pidMu, tablePIDMu, PID::Muon);
+    fillTable(pidPi, tablePIDPi, PID::Pion);
+    fillTable(pidKa, tablePIDKa, PID::Kaon);
+    fillTable(pidPr, tablePIDPr, PID::Proton);
+    fillTable(pidDe, tablePIDDe, PID::Deuteron);
+    fillTable(pidTr, tablePIDTr, PID::Triton);
+    fillTable(pidHe, tablePIDHe, PID::Helium3);
+    fillTable(pidAl, tablePIDAl, PID::Alpha);
+    tableBayes.reserve(tracks.size());
+    for (std::size_t iTrk = 0; iTrk < static_cast<std::size_t>(tracks.size()); iTrk++) {
+      tableBayes(combiner.mostProbableProbability[iTrk], combiner.mostProbableId[iTrk]);
+    }
+  }
+
+  using TrksNSigmaLight = soa::Join<aod::Tracks, aod::TracksExtra,
+                                    aod::pidTPCFullEl, aod::pidTPCFullMu, aod::pidTPCFullPi, aod::pidTPCFullKa, aod::pidTPCFullPr,
+                                    aod::pidTOFFullEl, aod::pidTOFFullMu, aod::pidTOFFullPi, aod::pidTOFFullKa, aod::pidTOFFullPr>;
+  void processNSigmaLight(TrksNSigmaLight const& tracks, aod::BCsWithTimestamps const& bcs)
+  {
+    fillFromNSigma<PID::Proton + 1>(tracks, bcs);
+  }
+  PROCESS_SWITCH(bayesPid, processNSigmaLight, "Combine the TPC and TOF nSigma of electrons, muons, pions, kaons and protons", false);
+
+  using TrksNSigmaAll = soa::Join<aod::Tracks, aod::TracksExtra,
+                                  aod::pidTPCFullEl, aod::pidTPCFullMu, aod::pidTPCFullPi, aod::pidTPCFullKa, aod::pidTPCFullPr,
+                                  aod::pidTPCFullDe, aod::pidTPCFullTr, aod::pidTPCFullHe, aod::pidTPCFullAl,
+                                  aod::pidTOFFullEl, aod::pidTOFFullMu, aod::pidTOFFullPi, aod::pidTOFFullKa, aod::pidTOFFullPr,
+                                  aod::pidTOFFullDe, aod::pidTOFFullTr, aod::pidTOFFullHe, aod::pidTOFFullAl>;
+  void processNSigmaAll(TrksNSigmaAll const& tracks, aod::BCsWithTimestamps const& bcs)
+  {
+    fillFromNSigma<PID::NIDs>(tracks, bcs);
+  }
+  PROCESS_SWITCH(bayesPid, processNSigmaAll, "Combine the TPC and TOF nSigma of all species", false);
 };
 
 struct bayesPidQa {
@@ -49,6 +49,7 @@
 
 #include <array>
 #include <cmath>
+#include <cstddef>
 #include <cstdint>
 #include <cstdlib>
 #include <memory>
@@ -607,6 +608,7 @@ struct tofPidMerge {
 
   Configurable<bool> enableQaHistograms{"enableQaHistograms", false, "Flag to enable the QA histograms"};
   Configurable<bool> enableTOFParamsForBetaMass{"enableTOFParamsForBetaMass", false, "Flag to use TOF parameters for TOF Beta and Mass"};
+  Configurable<bool> useBatchedResponse{"useBatchedResponse", false, "Flag to compute the nSigma of all the tracks and species column-wise, with tabulated resolutions (relative precision of 5e-4)"};
 
   // Configuration flags to include and exclude particle hypotheses
   Configurable<LabeledArray<int>> enableParticle{"enableParticle",
@@ -622,6 +624,8 @@ struct tofPidMerge {
   // Running variables
   std::vector<int> mEnabledParticles;     // Vector of enabled PID hypotheses to loop on when making tables
   std::vector<int> mEnabledParticlesFull; // Vector of enabled PID hypotheses to loop on when making full tables
+  o2::pid::tof::ExpTimesBatch batchResponse; // Column-wise response, used with useBatchedResponse
+  int mLastRunNumberBatch = -1;              // Run for which the resolution tables of batchResponse are filled
   void init(o2::framework::InitContext& initContext)
   {
     LOG(debug) << "Initializing the TOF PID Merge task";
@@ -685,6 +689,12 @@ struct tofPidMerge {
       }
       hnsigmaFull[i] = histos.add<TH2>(Form("nsigmaFull/%s", particleNames[i].c_str()), Form("N_{#sigma}^{TOF}(%s)", particleNames[i].c_str()), kTH2F, {pAxis, nSigmaAxis});
     }
+    for (const int& i : mEnabledParticles) {
+      batchResponse.enabled[i] = true;
+    }
+    for (const int& i : mEnabledParticlesFull) {
+      batchResponse.enabled[i] = true;
+    }
 
     // Checking the TOF mass and TOF beta tables
     enableTableBeta = o2::common::core::isTableRequiredInWorkflow(initContext, "pidTOFbeta");
@@ -876,6 +886,118 @@ struct tofPidMerge {
     }
   }
 
+  // Fills the tables of the enabled species with the column-wise response of all the tracks
+  template <typename TrackType>
+  void fillTablesBatched(TrackType const& tracks, aod::BCsWithTimestamps::iterator const& bc)
+  {
+    if (bc.runNumber() != mLastRunNumberBatch) { // The parameters are updated only when the run changes
+      mLastRunNumberBatch = bc.runNumber();
+      batchResponse.setup(tofResponse->parameters);
+    }
+    batchResponse.fill(tracks, tofResponse->parameters);
+    batchResponse.compute(tofResponse->parameters);
+
+    for (auto const& pidId : mEnabledParticles) {
+      reserveTable(pidId, tracks.size(), false);
+      const auto& nSigma = batchResponse.nSigma[pidId];
+      auto fillTable = [&](auto& table) {
+        for (std::size_t i = 0; i < batchResponse.size(); i++) {
+          aod::pidtof_tiny::binning::packInTable(nSigma[i], table);
+        }
+      };
+      switch (pidId) {
+        case kIdxEl:
+          fillTable(tablePIDEl);
+          break;
+        case kIdxMu:
+          fillTable(tablePIDMu);
+          break;
+        case kIdxPi:
+          fillTable(tablePIDPi);
+          break;
+        case kIdxKa:
+          fillTable(tablePIDKa);
+          break;
+        case kIdxPr:
+          fillTable(tablePIDPr);
+          break;
+        case kIdxDe:
+          fillTable(tablePIDDe);
+          break;
+        case kIdxTr:
+          fillTable(tablePIDTr);
+          break;
+        case kIdxHe:
+          fillTable(tablePIDHe);
+          break;
+        case kIdxAl:
+          fillTable(tablePIDAl);
+          break;
+        default:
+          LOG(fatal) << "Wrong particle ID for standard tables";
+          break;
+      }
+    }
+    for (auto const& pidId : mEnabledParticlesFull) {
+      reserveTable(pidId, tracks.size(), true);
+      const auto& expSigma = batchResponse.expSigma[pidId];
+      const auto& nSigma = batchResponse.nSigma[pidId];
+      auto fillTable = [&](auto& table) {
+        for (std::size_t i = 0; i < batchResponse.size(); i++) {
+          table(expSigma[i], nSigma[i]);
+        }
+      };
+      switch (pidId) {
+        case kIdxEl:
+          fillTable(tablePIDFullEl);
+          break;
+        case kIdxMu:
+          fillTable(tablePIDFullMu);
+          break;
+        case kIdxPi:
+          fillTable(tablePIDFullPi);
+          break;
+        case kIdxKa:
+          fillTable(tablePIDFullKa);
+          break;
+        case kIdxPr:
+          fillTable(tablePIDFullPr);
+          break;
+        case kIdxDe:
+          fillTable(tablePIDFullDe);
+          break;
+        case kIdxTr:
+          fillTable(tablePIDFullTr);
+          break;
+        case kIdxHe:
+          fillTable(tablePIDFullHe);
+          break;
+        case kIdxAl:
+          fillTable(tablePIDFullAl);
+          break;
+        default:
+          LOG(fatal) << "Wrong particle ID for full tables";
+          break;
+      }
+    }
+
+    if (!enableQaHistograms) {
+      return;
+    }
+    std::size_t i = 0;
+    for (auto const& trk : tracks) {
+      if (trk.has_collision()) {
+        for (auto const& pidId : mEnabledParticles) {
+          hnsigma[pidId]->Fill(trk.p(), batchResponse.nSigma[pidId][i]);
+        }
+        for (auto const& pidId : mEnabledParticlesFull) {
+          hnsigmaFull[pidId]->Fill(trk.p(), batchResponse.nSigma[pidId][i]);
+        }
+      }
+      i++;
+    }
+  }
+
   void process(aod::BCs const&) {}
 
   template <o2::track::PID::ID pid>
@@ -895,6 +1017,10 @@ struct tofPidMerge {
     constexpr auto responseAl = ResponseImplementation<PID::Alpha>();
 
     tofResponse->processSetup(bcs.iteratorAt(0)); // Update the calibration parameters
+    if (useBatchedResponse && collisions.size() > 0) {
+      fillTablesBatched(tracks, bcs.iteratorAt(0));
+      return;
+    }
 
     for (auto const& pidId : mEnabledParticles) {
       reserveTable(pidId, tracks.size(), false);
@@ -1057,6 +1183,10 @@ struct tofPidMerge {
     constexpr auto responseAl = ResponseImplementationRun2<PID::Alpha>();
 
     tofResponse->processSetup(bcs.iteratorAt(0)); // Update the calibration parameters
+    if (useBatchedResponse && collisions.size() > 0) {
+      fillTablesBatched(tracks, bcs.iteratorAt(0));
+      return;
+    }
 
     for (auto const& pidId : mEnabledParticles) {
       reserveTable(pidId, tracks.size(), false);
@@ -166,6 +166,40 @@ struct OccupancyTableProducer {
   std::vector<std::vector<float>> occMultNTracksITSTPCUnfm80;
   std::vector<std::vector<float>> occMultAllTracksTPCOnlyUnfm80;
 
+  // estimators accumulated per collision over the drift window
+  enum OccEstimators {
+    kEstPrim = 0,
+    kEstFV0A,
+    kEstFV0C,
+    kEstFT0A,
+    kEstFT0C,
+    kEstFDDA,
+    kEstFDDC,
+    kEstNTrackITS,
+    kEstNTrackTPC,
+    kEstNTrackTRD,
+    kEstNTrackTOF,
+    kEstNTrackSize,
+    kEstNTrackTPCA,
+    kEstNTrackTPCC,
+    kEstNTrackITSTPC,
+    kEstNTrackITSTPCA,
+    kEstNTrackITSTPCC,
+    kEstMultNTracksHasITS,
+    kEstMultNTracksHasTPC,
+    kEstMultNTracksHasTOF,
+    kEstMultNTracksHasTRD,
+    kEstMultNTracksITSOnly,
+    kEstMultNTracksTPCOnly,
+    kEstMultNTracksITSTPC,
+    kEstMultAllTracksTPCOnly,
+    kNOccEstimators
+  };
+  // per TF difference array of all estimators, interleaved as [bin * kNOccEstimators + estimator],
+  // with one extra bin for windows ending at the end of the TF
+  std::vector<std::vector<double>> occDiffUnfm80;
+  std::array<std::vector<std::vector<float>>*, kNOccEstimators> occEstimatorVectors;
+
   std::vector<float> vecRobustOccT0V0PrimUnfm80;
   std::vector<float> vecRobustOccFDDT0V0PrimUnfm80;
   std::vector<float> vecRobustOccNtrackDetUnfm80;
@@ -267,6 +301,16 @@ struct OccupancyTableProducer {
       }
     }
 
+    occEstimatorVectors = {&occPrimUnfm80, &occFV0AUnfm80, &occFV0CUnfm80, &occFT0AUnfm80, &occFT0CUnfm80, &occFDDAUnfm80, &occFDDCUnfm80,
+                           &occNTrackITSUnfm80, &occNTrackTPCUnfm80, &occNTrackTRDUnfm80, &occNTrackTOFUnfm80, &occNTrackSizeUnfm80,
+                           &occNTrackTPCAUnfm80, &occNTrackTPCCUnfm80, &occNTrackITSTPCUnfm80, &occNTrackITSTPCAUnfm80, &occNTrackITSTPCCUnfm80,
+                           &occMultNTracksHasITSUnfm80, &occMultNTracksHasTPCUnfm80, &occMultNTracksHasTOFUnfm80, &occMultNTracksHasTRDUnfm80,
+                           &occMultNTracksITSOnlyUnfm80, &occMultNTracksTPCOnlyUnfm80, &occMultNTracksITSTPCUnfm80, &occMultAllTracksTPCOnlyUnfm80};
+    occDiffUnfm80.resize(occVecArraySize);
+    for (auto& occDiff : occDiffUnfm80) {
+      occDiff.resize((nBCinTF / bcGrouping + 1) * kNOccEstimators);
+    }
+
     if (buildFullOccTableProducer || buildOnlyOccsT0V0Prim || buildFlag02OccRobustTable || buildFlag03OccMeanRobustTable) {
       vecRobustOccT0V0PrimUnfm80.resize(nBCinTF / bcGrouping);
       vecRobustOccT0V0PrimUnfm80medianPosVec.resize(nBCinTF / bcGrouping); // Median => one for odd and two for even entries
@@ -305,6 +349,50 @@ struct OccupancyTableProducer {
     std::transform(OriginalVec.begin(), OriginalVec.end(), OriginalVec.begin(), [scaleFactor](float x) { return x * scaleFactor; });
   }
 
+  // Adds the estimators of one collision to every bin of its drift window, (bin80Zero + deltaBin) % nBins for
+  // deltaBin < nBCinDrift / bcGrouping, as +value at the window start and -value one past its end
+  void addToDriftWindow(std::vector<double>& occDiff, const int& bin80Zero, const std::array<double, kNOccEstimators>& occValues)
+  {
+    const int nBins = nBCinTF / bcGrouping;
+    const int nDriftBins = nBCinDrift / bcGrouping;
+    auto addAt = [&](int bin, double weight) {
+      double* row = &occDiff[bin * kNOccEstimators];
+      for (int iEst = 0; iEst < kNOccEstimators; iEst++) {
+        row[iEst] += weight * occValues[iEst];
+      }
+    };
+    if (nDriftBins >= nBins) { // window covering the full TF at least once
+      addAt(0, nDriftBins / nBins);
+      addAt(nBins, -(nDriftBins / nBins));
+    }
+    const int firstBin = bin80Zero % nBins;
+    const int endBin = firstBin + nDriftBins % nBins;
+    addAt(firstBin, 1.);
+    if (endBin <= nBins) {
+      addAt(endBin, -1.);
+    } else { // wrap around the end of the TF
+      addAt(nBins, -1.);
+      addAt(0, 1.);
+      addAt(endBin - nBins, -1.);
+    }
+  }
+
+  // Prefix sum of the difference array of one TF into the occupancy vectors of the enabled estimators
+  void integrateDriftWindows(const std::vector<double>& occDiff, const int& tfIndex)
+  {
+    const int nBins = nBCinTF / bcGrouping;
+    std::array<double, kNOccEstimators> occSum{};
+    for (int bin = 0; bin < nBins; bin++) {
+      const double* row = &occDiff[bin * kNOccEstimators];
+      for (int iEst = 0; iEst < kNOccEstimators; iEst++) {
+        occSum[iEst] += row[iEst];
+        if (!occEstimatorVectors[iEst]->empty()) {
+          (*occEstimatorVectors[iEst])[tfIndex][bin] = occSum[iEst];
+        }
+      }
+    }
+  }
+
   template <typename... Vecs>
   void getMedianOccVect(
     std::vector<float>& medianVector,
@@ -481,6 +569,7 @@ struct OccupancyTableProducer {
       for (int i = 0; i < occVecArraySize; i++) {
         tfList[i] = -1;
         bcTFMap[i].clear(); // list of BCs used in one time frame;
+        std::fill(occDiffUnfm80[i].begin(), occDiffUnfm80[i].end(), 0.);
         if constexpr (processMode == kProcessFullOccTableProducer || processMode == kProcessOnlyOccPrim || processMode == kProcessOnlyOccT0V0Prim || processMode == kProcessOnlyOccFDDT0V0Prim || processMode == kProcessOnlyOccNtrackDet || processMode == kProcessOnlyOccMultExtra) {
           std::fill(occPrimUnfm80[i].begin(), occPrimUnfm80[i].end(), 0.);
         }
@@ -547,35 +636,7 @@ struct OccupancyTableProducer {
       int fNTrackITSTPCA = -9999;
       int fNTrackITSTPCC = -9999;
 
-      decltype(&occPrimUnfm80[0]) tfOccPrimUnfm80 = nullptr;
-      decltype(&occFV0AUnfm80[0]) tfOccFV0AUnfm80 = nullptr;
-      decltype(&occFV0CUnfm80[0]) tfOccFV0CUnfm80 = nullptr;
-      decltype(&occFT0AUnfm80[0]) tfOccFT0AUnfm80 = nullptr;
-      decltype(&occFT0CUnfm80[0]) tfOccFT0CUnfm80 = nullptr;
-
-      decltype(&occFDDAUnfm80[0]) tfOccFDDAUnfm80 = nullptr;
-      decltype(&occFDDCUnfm80[0]) tfOccFDDCUnfm80 = nullptr;
-
-      decltype(&occNTrackITSTPCUnfm80[0]) tfOccNTrackITSTPCUnfm80 = nullptr;
-
-      decltype(&occNTrackITSUnfm80[0]) tfOccNTrackITSUnfm80 = nullptr;
-      decltype(&occNTrackTPCUnfm80[0]) tfOccNTrackTPCUnfm80 = nullptr;
-      decltype(&occNTrackTRDUnfm80[0]) tfOccNTrackTRDUnfm80 = nullptr;
-      decltype(&occNTrackTOFUnfm80[0]) tfOccNTrackTOFUnfm80 = nullptr;
-      decltype(&occNTrackSizeUnfm80[0]) tfOccNTrackSizeUnfm80 = nullptr;
-      decltype(&occNTrackTPCAUnfm80[0]) tfOccNTrackTPCAUnfm80 = nullptr;
-      decltype(&occNTrackTPCCUnfm80[0]) tfOccNTrackTPCCUnfm80 = nullptr;
-      decltype(&occNTrackITSTPCAUnfm80[0]) tfOccNTrackITSTPCAUnfm80 = nullptr;
-      decltype(&occNTrackITSTPCCUnfm80[0]) tfOccNTrackITSTPCCUnfm80 = nullptr;
-
-      decltype(&occMultNTracksHasITSUnfm80[0]) tfOccMultNTracksHasITSUnfm80 = nullptr;
-      decltype(&occMultNTracksHasTPCUnfm80[0]) tfOccMultNTracksHasTPCUnfm80 = nullptr;
-      decltype(&occMultNTracksHasTOFUnfm80[0]) tfOccMultNTracksHasTOFUnfm80 = nullptr;
-      decltype(&occMultNTracksHasTRDUnfm80[0]) tfOccMultNTracksHasTRDUnfm80 = nullptr;
-      decltype(&occMultNTracksITSOnlyUnfm80[0]) tfOccMultNTracksITSOnlyUnfm80 = nullptr;
-      decltype(&occMultNTracksTPCOnlyUnfm80[0]) tfOccMultNTracksTPCOnlyUnfm80 = nullptr;
-      decltype(&occMultNTracksITSTPCUnfm80[0]) tfOccMultNTracksITSTPCUnfm80 = nullptr;
-      decltype(&occMultAllTracksTPCOnlyUnfm80[0]) tfOccMultAllTracksTPCOnlyUnfm80 = nullptr;
+      std::array<double, kNOccEstimators> occValues{}; // estimators not filled in this processMode stay at zero
 
       for (const auto& collision : collisions) {
         const auto& bc = collision.template bc_as<B>();
@@ -649,44 +710,6 @@ struct OccupancyTableProducer {
         }
 
         bcTFMap[tfIDX].push_back(bc.globalIndex());
-        if constexpr (processMode == kProcessFullOccTableProducer || processMode == kProcessOnlyOccPrim || processMode == kProcessOnlyOccT0V0Prim || processMode == kProcessOnlyOccFDDT0V0Prim || processMode == kProcessOnlyOccNtrackDet || processMode == kProcessOnlyOccMultExtra) {
-          tfOccPrimUnfm80 = &occPrimUnfm80[tfIDX];
-        }
-        if constexpr (processMode == kProcessFullOccTableProducer || processMode == kProcessOnlyOccT0V0Prim || processMode == kProcessOnlyOccFDDT0V0Prim) {
-          tfOccFV0AUnfm80 = &occFV0AUnfm80[tfIDX];
-          tfOccFV0CUnfm80 = &occFV0CUnfm80[tfIDX];
-          tfOccFT0AUnfm80 = &occFT0AUnfm80[tfIDX];
-          tfOccFT0CUnfm80 = &occFT0CUnfm80[tfIDX];
-        }
-        if constexpr (processMode == kProcessFullOccTableProducer || processMode == kProcessOnlyOccFDDT0V0Prim) {
-          tfOccFDDAUnfm80 = &occFDDAUnfm80[tfIDX];
-          tfOccFDDCUnfm80 = &occFDDCUnfm80[tfIDX];
-        }
-        if constexpr (processMode == kProcessFullOccTableProducer || processMode == kProcessOnlyOccNtrackDet) {
-          tfOccNTrackITSUnfm80 = &occNTrackITSUnfm80[tfIDX];
-          tfOccNTrackTPCUnfm80 = &occNTrackTPCUnfm80[tfIDX];
-          tfOccNTrackTRDUnfm80 = &occNTrackTRDUnfm80[tfIDX];
-          tfOccNTrackTOFUnfm80 = &occNTrackTOFUnfm80[tfIDX];
-          tfOccNTrackSizeUnfm80 = &occNTrackSizeUnfm80[tfIDX];
-          tfOccNTrackTPCAUnfm80 = &occNTrackTPCAUnfm80[tfIDX];
-          tfOccNTrackTPCCUnfm80 = &occNTrackTPCCUnfm80[tfIDX];
-          tfOccNTrackITSTPCAUnfm80 = &occNTrackITSTPCAUnfm80[tfIDX];
-          tfOccNTrackITSTPCCUnfm80 = &occNTrackITSTPCCUnfm80[tfIDX];
-        }
-        if constexpr (processMode == kProcessFullOccTableProducer || processMode == kProcessOnlyOccNtrackDet || processMode == kProcessOnlyOccMultExtra) {
-          tfOccNTrackITSTPCUnfm80 = &occNTrackITSTPCUnfm80[tfIDX];
-        }
-        if constexpr (processMode == kProcessFullOccTableProducer || processMode == kProcessOnlyOccMultExtra) {
-          tfOccMultNTracksHasITSUnfm80 = &occMultNTracksHasITSUnfm80[tfIDX];
-          tfOccMultNTracksHasTPCUnfm80 = &occMultNTracksHasTPCUnfm80[tfIDX];
-          tfOccMultNTracksHasTOFUnfm80 = &occMultNTracksHasTOFUnfm80[tfIDX];
-          tfOccMultNTracksHasTRDUnfm80 = &occMultNTracksHasTRDUnfm80[tfIDX];
-          tfOccMultNTracksITSOnlyUnfm80 = &occMultNTracksITSOnlyUnfm80[tfIDX];
-          tfOccMultNTracksTPCOnlyUnfm80 = &occMultNTracksTPCOnlyUnfm80[tfIDX];
-          tfOccMultNTracksITSTPCUnfm80 = &occMultNTracksITSTPCUnfm80[tfIDX];
-          tfOccMultAllTracksTPCOnlyUnfm80 = &occMultAllTracksTPCOnlyUnfm80[tfIDX];
-        }
-
         // current collision bin in 80/160 bcGrouping.
         int bin80Zero = bcInTF / bcGrouping;
         // int bin160_0=bcInTF/160;
@@ -719,50 +742,51 @@ struct OccupancyTableProducer {
           fNTrackITSTPCC = nTrackITSTPCC;
         }
         // Processing for bcGrouping of 80 BCs
-        for (int deltaBin = 0; deltaBin < nBCinDrift / bcGrouping; deltaBin++) {
-
-          if constexpr (processMode == kProcessFullOccTableProducer || processMode == kProcessOnlyOccPrim || processMode == kProcessOnlyOccT0V0Prim || processMode == kProcessOnlyOccFDDT0V0Prim || processMode == kProcessOnlyOccNtrackDet || processMode == kProcessOnlyOccMultExtra) {
-            (*tfOccPrimUnfm80)[(bin80Zero + deltaBin) % (nBCinTF / bcGrouping)] += fNumContrib * 1;
-          }
-          if constexpr (processMode == kProcessFullOccTableProducer || processMode == kProcessOnlyOccT0V0Prim || processMode == kProcessOnlyOccFDDT0V0Prim) {
-            (*tfOccFV0AUnfm80)[(bin80Zero + deltaBin) % (nBCinTF / bcGrouping)] += fMultFV0A * 1;
-            (*tfOccFV0CUnfm80)[(bin80Zero + deltaBin) % (nBCinTF / bcGrouping)] += fMultFV0C * 1;
-            (*tfOccFT0AUnfm80)[(bin80Zero + deltaBin) % (nBCinTF / bcGrouping)] += fMultFT0A * 1;
-            (*tfOccFT0CUnfm80)[(bin80Zero + deltaBin) % (nBCinTF / bcGrouping)] += fMultFT0C * 1;
-          }
-          if constexpr (processMode == kProcessFullOccTableProducer || processMode == kProcessOnlyOccFDDT0V0Prim) {
-            (*tfOccFDDAUnfm80)[(bin80Zero + deltaBin) % (nBCinTF / bcGrouping)] += fMultFDDA * 1;
-            (*tfOccFDDCUnfm80)[(bin80Zero + deltaBin) % (nBCinTF / bcGrouping)] += fMultFDDC * 1;
-          }
-          if constexpr (processMode == kProcessFullOccTableProducer || processMode == kProcessOnlyOccNtrackDet) {
-            (*tfOccNTrackITSUnfm80)[(bin80Zero + deltaBin) % (nBCinTF / bcGrouping)] += fNTrackITS * 1;
-            (*tfOccNTrackTPCUnfm80)[(bin80Zero + deltaBin) % (nBCinTF / bcGrouping)] += fNTrackTPC * 1;
-            (*tfOccNTrackTRDUnfm80)[(bin80Zero + deltaBin) % (nBCinTF / bcGrouping)] += fNTrackTRD * 1;
-            (*tfOccNTrackTOFUnfm80)[(bin80Zero + deltaBin) % (nBCinTF / bcGrouping)] += fNTrackTOF * 1;
-            (*tfOccNTrackSizeUnfm80)[(bin80Zero + deltaBin) % (nBCinTF / bcGrouping)] += fNTrackSize * 1;
-            (*tfOccNTrackTPCAUnfm80)[(bin80Zero + deltaBin) % (nBCinTF / bcGrouping)] += fNTrackTPCA * 1;
-            (*tfOccNTrackTPCCUnfm80)[(bin80Zero + deltaBin) % (nBCinTF / bcGrouping)] += fNTrackTPCC * 1;
-            (*tfOccNTrackITSTPCAUnfm80)[(bin80Zero + deltaBin) % (nBCinTF / bcGrouping)] += fNTrackITSTPCA * 1;
-            (*tfOccNTrackITSTPCCUnfm80)[(bin80Zero + deltaBin) % (nBCinTF / bcGrouping)] += fNTrackITSTPCC * 1;
-          }
-          if constexpr (processMode == kProcessFullOccTableProducer || processMode == kProcessOnlyOccNtrackDet || processMode == kProcessOnlyOccMultExtra) {
-            (*tfOccNTrackITSTPCUnfm80)[(bin80Zero + deltaBin) % (nBCinTF / bcGrouping)] += fNTrackITSTPC * 1;
-          }
-
-          if constexpr (processMode == kProcessFullOccTableProducer || processMode == kProcessOnlyOccMultExtra) {
-            (*tfOccMultNTracksHasITSUnfm80)[(bin80Zero + deltaBin) % (nBCinTF / bcGrouping)] += collision.multNTracksHasITS() * 1;
-            (*tfOccMultNTracksHasTPCUnfm80)[(bin80Zero + deltaBin) % (nBCinTF / bcGrouping)] += collision.multNTracksHasTPC() * 1;
-            (*tfOccMultNTracksHasTOFUnfm80)[(bin80Zero + deltaBin) % (nBCinTF / bcGrouping)] += collision.multNTracksHasTOF() * 1;
-            (*tfOccMultNTracksHasTRDUnfm80)[(bin80Zero + deltaBin) % (nBCinTF / bcGrouping)] += collision.multNTracksHasTRD() * 1;
-            (*tfOccMultNTracksITSOnlyUnfm80)[(bin80Zero + deltaBin) % (nBCinTF / bcGrouping)] += collision.multNTracksITSOnly() * 1;
-            (*tfOccMultNTracksTPCOnlyUnfm80)[(bin80Zero + deltaBin) % (nBCinTF / bcGrouping)] += collision.multNTracksTPCOnly() * 1;
-            (*tfOccMultNTracksITSTPCUnfm80)[(bin80Zero + deltaBin) % (nBCinTF / bcGrouping)] += collision.multNTracksITSTPC() * 1;
-            (*tfOccMultAllTracksTPCOnlyUnfm80)[(bin80Zero + deltaBin) % (nBCinTF / bcGrouping)] += collision.multAllTracksTPCOnly() * 1;
-          }
+        if constexpr (processMode == kProcessFullOccTableProducer || processMode == kProcessOnlyOccPrim || processMode == kProcessOnlyOccT0V0Prim || processMode == kProcessOnlyOccFDDT0V0Prim || processMode == kProcessOnlyOccNtrackDet || processMode == kProcessOnlyOccMultExtra) {
+          occValues[kEstPrim] = fNumContrib;
         }
+        if constexpr (processMode == kProcessFullOccTableProducer || processMode == kProcessOnlyOccT0V0Prim || processMode == kProcessOnlyOccFDDT0V0Prim) {
+          occValues[kEstFV0A] = fMultFV0A;
+          occValues[kEstFV0C] = fMultFV0C;
+          occValues[kEstFT0A] = fMultFT0A;
+          occValues[kEstFT0C] = fMultFT0C;
+        }
+        if constexpr (processMode == kProcessFullOccTableProducer || processMode == kProcessOnlyOccFDDT0V0Prim) {
+          occValues[kEstFDDA] = fMultFDDA;
+          occValues[kEstFDDC] = fMultFDDC;
+        }
+        if constexpr (processMode == kProcessFullOccTableProducer || processMode == kProcessOnlyOccNtrackDet) {
+          occValues[kEstNTrackITS] = fNTrackITS;
+          occValues[kEstNTrackTPC] = fNTrackTPC;
+          occValues[kEstNTrackTRD] = fNTrackTRD;
+          occValues[kEstNTrackTOF] = fNTrackTOF;
+          occValues[kEstNTrackSize] = fNTrackSize;
+          occValues[kEstNTrackTPCA] = fNTrackTPCA;
+          occValues[kEstNTrackTPCC] = fNTrackTPCC;
+          occValues[kEstNTrackITSTPCA] = fNTrackITSTPCA;
+          occValues[kEstNTrackITSTPCC] = fNTrackITSTPCC;
+        }
+        if constexpr (processMode == kProcessFullOccTableProducer || processMode == kProcessOnlyOccNtrackDet || processMode == kProcessOnlyOccMultExtra) {
+          occValues[kEstNTrackITSTPC] = fNTrackITSTPC;
+        }
+        if constexpr (processMode == kProcessFullOccTableProducer || processMode == kProcessOnlyOccMultExtra) {
+          occValues[kEstMultNTracksHasITS] = collision.multNTracksHasITS();
+          occValues[kEstMultNTracksHasTPC] = collision.multNTracksHasTPC();
+          occValues[kEstMultNTracksHasTOF] = collision.multNTracksHasTOF();
+          occValues[kEstMultNTracksHasTRD] = collision.multNTracksHasTRD();
+          occValues[kEstMultNTracksITSOnly] = collision.multNTracksITSOnly();
+          occValues[kEstMultNTracksTPCOnly] = collision.multNTracksTPCOnly();
+          occValues[kEstMultNTracksITSTPC] = collision.multNTracksITSTPC();
+          occValues[kEstMultAllTracksTPCOnly] = collision.multAllTracksTPCOnly();
+        }
+        addToDriftWindow(occDiffUnfm80[tfIDX], bin80Zero, occValues);
       }
       // collision Loop is over
 
+      for (uint i = 0; i < tfCounted; i++) {
+        integrateDriftWindows(occDiffUnfm80[i], i);
+      }
+
       occupancyQA.fill(HIST("h_TF_in_DataFrame"), tfCounted);
 
       std::vector<int64_t> sortedTfIDList = tfIDList;
@@ -1380,6 +1404,13 @@ struct TrackMeanOccTableProducer {
       occRobustMultTableUnfm80.resize(nBCinTF / bcGrouping);
     }
 
+    occNameVectors = {&occPrimUnfm80, &occFV0AUnfm80, &occFV0CUnfm80, &occFT0AUnfm80, &occFT0CUnfm80, &occFDDAUnfm80, &occFDDCUnfm80,
+                      &occNTrackITSUnfm80, &occNTrackTPCUnfm80, &occNTrackTRDUnfm80, &occNTrackTOFUnfm80, &occNTrackSizeUnfm80,
+                      &occNTrackTPCAUnfm80, &occNTrackTPCCUnfm80, &occNTrackITSTPCUnfm80, &occNTrackITSTPCAUnfm80, &occNTrackITSTPCCUnfm80,
+                      &occMultNTracksHasITSUnfm80, &occMultNTracksHasTPCUnfm80, &occMultNTracksHasTOFUnfm80, &occMultNTracksHasTRDUnfm80,
+                      &occMultNTracksITSOnlyUnfm80, &occMultNTracksTPCOnlyUnfm80, &occMultNTracksITSTPCUnfm80, &occMultAllTracksTPCOnlyUnfm80,
+                      &occRobustT0V0PrimUnfm80, &occRobustFDDT0V0PrimUnfm80, &occRobustNtrackDetUnfm80, &occRobustMultTableUnfm80};
+
     const AxisSpec axisQA1 = {500, 0, 50000};
     const AxisSpec axisQA2 = {200, -2, 2};
     const AxisSpec axisQA3 = {200, -20, 20};
@@ -1538,7 +1569,8 @@ struct TrackMeanOccTableProducer {
     kOccRobustT0V0PrimUnfm80,
     kOccRobustFDDT0V0PrimUnfm80,
     kOccRobustNtrackDetUnfm80,
-    kOccRobustMultTableUnfm80
+    kOccRobustMultTableUnfm80,
+    kNOccNames
   };
 
   static constexpr std::string_view OccNames[]{
@@ -1625,9 +1657,40 @@ struct TrackMeanOccTableProducer {
     bcInTF = (bc.globalBC() - bcSOR) % nBCsPerTF;
   }
 
-  float getMeanOccupancy(int bcBegin, int bcEnd, const std::vector<float>& OccVector)
+  // occupancy vectors of the current TF, interleaved as [bin * kNOccNames + occName], and their prefix sums
+  std::array<std::vector<float>*, kNOccNames> occNameVectors;
+  std::vector<float> occBins;
+  std::vector<double> occBinSums; // sum of all bins below, nOccBins + 1 rows
+  int nOccBins = 0;
+
+  // radius weights of the last track window, shared by all the estimators
+  int weightBcBegin = -1;
+  int weightBcEnd = -1;
+  std::vector<float> binWeights;
+  float binWeightSum = 0;
+
+  void updateOccupancyBins()
+  {
+    nOccBins = nBCinTF / bcGrouping;
+    occBins.assign(nOccBins * kNOccNames, 0.f);
+    occBinSums.assign((nOccBins + 1) * kNOccNames, 0.);
+    for (int iOcc = 0; iOcc < kNOccNames; iOcc++) {
+      const auto& occVector = *occNameVectors[iOcc];
+      const int nBins = std::min(nOccBins, static_cast<int>(occVector.size())); // empty for the estimators not built
+      for (int bin = 0; bin < nBins; bin++) {
+        occBins[bin * kNOccNames + iOcc] = occVector[bin];
+      }
+    }
+    for (int bin = 0; bin < nOccBins; bin++) {
+      for (int iOcc = 0; iOcc < kNOccNames; iOcc++) {
+        occBinSums[(bin + 1) * kNOccNames + iOcc] = occBinSums[bin * kNOccNames + iOcc] + occBins[bin * kNOccNames + iOcc];
+      }
+    }
+  }
+
+  // bins beyond the end of the TF are counted as empty
+  float getMeanOccupancy(int bcBegin, int bcEnd, int occName)
   {
-    float sumOfBins = 0;
     int binStart, binEnd;
     if (bcBegin <= bcEnd) {
       binStart = bcBegin;
@@ -1636,53 +1699,67 @@ struct TrackMeanOccTableProducer {
       binStart = bcEnd;
       binEnd = bcBegin;
     }
-    for (int i = binStart; i <= binEnd; i++) {
-      sumOfBins += OccVector[i];
-    }
+    const int sumStart = std::min(binStart, nOccBins);
+    const int sumEnd = std::min(binEnd + 1, nOccBins);
+    double sumOfBins = occBinSums[sumEnd * kNOccNames + occName] - occBinSums[sumStart * kNOccNames + occName];
     float meanOccupancy = sumOfBins / static_cast<double>(binEnd - binStart + 1);
     return meanOccupancy;
   }
 
-  float getWeightedMeanOccupancy(int bcBegin, int bcEnd, const std::vector<float>& OccVector)
+  float getWeightedMeanOccupancy(int bcBegin, int bcEnd, int occName)
   {
-    float sumOfBins = 0;
     int binStart, binEnd;
-    // Assuming linear dependence of R on bins
-    float m;      // slope of the equation
-    float c;      // some constant in linear
-    float x1, x2; //, y1 = 90., y2 = 245.;
-
     if (bcBegin <= bcEnd) {
       binStart = bcBegin;
       binEnd = bcEnd;
-      x1 = static_cast<float>(binStart);
-      x2 = static_cast<float>(binEnd);
     } else {
       binStart = bcEnd;
       binEnd = bcBegin;
-      x1 = static_cast<float>(binEnd);
-      x2 = static_cast<float>(binStart);
-    } //
+    }
 
-    if (x2 == x1) {
-      m = 0;
-    } else {
-      m = (245. - 90.) / (x2 - x1);
+    if (bcBegin != weightBcBegin || bcEnd != weightBcEnd) {
+      weightBcBegin = bcBegin;
+      weightBcEnd = bcEnd;
+      // Assuming linear dependence of R on bins
+      float m; // slope of the equation
+      float c; // some constant in linear
+      float x1, x2; //, y1 = 90., y2 = 245.;
+      if (bcBegin <= bcEnd) {
+        x1 = static_cast<float>(binStart);
+        x2 = static_cast<float>(binEnd);
+      } else {
+        x1 = static_cast<float>(binEnd);
+        x2 = static_cast<float>(binStart);
+      }
+
+      if (x2 == x1) {
+        m = 0;
+      } else {
+        m = (245. - 90.) / (x2 - x1);
+      }
+      c = 245. - m * x2;
+      binWeights.clear();
+      binWeightSum = 0;
+      float wr = 0;
+      float r = 0;
+      for (int i = binStart; i <= binEnd; i++) {
+        r = m * i + c;
+        wr = 125. / r;
+        if (x2 == x1) {
+          wr = 1.0;
+        }
+        binWeights.push_back(wr);
+        binWeightSum += wr;
+      }
     }
-    c = 245. - m * x2;
-    float weightSum = 0;
-    float wr = 0;
-    float r = 0;
+
+    float sumOfBins = 0;
     for (int i = binStart; i <= binEnd; i++) {
-      r = m * i + c;
-      wr = 125. / r;
-      if (x2 == x1) {
-        wr = 1.0;
+      if (i < nOccBins) {
+        sumOfBins += occBins[i * kNOccNames + occName] * binWeights[i - binStart];
       }
-      sumOfBins += OccVector[i] * wr;
-      weightSum += wr;
     }
-    float meanOccupancy = sumOfBins / weightSum;
+    float meanOccupancy = sumOfBins / binWeightSum;
     return meanOccupancy;
   }
 
@@ -2017,6 +2094,7 @@ struct TrackMeanOccTableProducer {
           if constexpr (processMode == kProcessFullOccTableProducer || processMode == kProcessOnlyRobustMultExtra) {
             std::copy(occsList.occRobustMultExtraTableUnfm80().begin(), occsList.occRobustMultExtraTableUnfm80().end(), occRobustMultTableUnfm80.begin());
           }
+          updateOccupancyBins();
         }
 
         // Timebc = TGlobalBC+ΔTdrift
@@ -2060,21 +2138,21 @@ struct TrackMeanOccTableProducer {
 
         if constexpr (qaMode == fillOccRobustT0V0dependentQA) {
           if constexpr (meanTableMode == fillMeanOccTable) {
-            meanOccRobustT0V0PrimUnfm80 = getMeanOccupancy(binBCbegin, binBCend, occRobustT0V0PrimUnfm80);
+            meanOccRobustT0V0PrimUnfm80 = getMeanOccupancy(binBCbegin, binBCend, kOccRobustT0V0PrimUnfm80);
           }
           if constexpr (weightMeanTableMode == fillWeightMeanOccTable) {
-            weightMeanOccRobustT0V0PrimUnfm80 = getWeightedMeanOccupancy(binBCbegin, binBCend, occRobustT0V0PrimUnfm80);
+            weightMeanOccRobustT0V0PrimUnfm80 = getWeightedMeanOccupancy(binBCbegin, binBCend, kOccRobustT0V0PrimUnfm80);
           }
         }
 
         if constexpr (processMode == kProcessFullOccTableProducer || processMode == kProcessOnlyOccPrim) {
           if constexpr (meanTableMode == fillMeanOccTable) {
-            meanOccPrimUnfm80 = getMeanOccupancy(binBCbegin, binBCend, occPrimUnfm80);
+            meanOccPrimUnfm80 = getMeanOccupancy(binBCbegin, binBCend, kOccPrimUnfm80);
             genTmoPrim(meanOccPrimUnfm80);
             fillQAInfo<kMean, kRobustT0V0Prim, kOccPrimUnfm80>(meanOccPrimUnfm80, meanOccRobustT0V0PrimUnfm80);
           }
           if constexpr (weightMeanTableMode == fillWeightMeanOccTable) {
-            weightMeanOccPrimUnfm80 = getWeightedMeanOccupancy(binBCbegin, binBCend, occPrimUnfm80);
+            weightMeanOccPrimUnfm80 = getWeightedMeanOccupancy(binBCbegin, binBCend, kOccPrimUnfm80);
             genTwmoPrim(weightMeanOccPrimUnfm80);
             fillQAInfo<kWeightMean, kRobustT0V0Prim, kOccPrimUnfm80>(weightMeanOccPrimUnfm80, meanOccRobustT0V0PrimUnfm80);
             fillQAInfo<kWeightMean, kWeightRobustT0V0Prim, kOccPrimUnfm80>(weightMeanOccPrimUnfm80, weightMeanOccRobustT0V0PrimUnfm80);
@@ -2083,10 +2161,10 @@ struct TrackMeanOccTableProducer {
 
         if constexpr (processMode == kProcessFullOccTableProducer || processMode == kProcessOnlyOccT0V0) {
           if constexpr (meanTableMode == fillMeanOccTable) {
-            meanOccFV0AUnfm80 = getMeanOccupancy(binBCbegin, binBCend, occFV0AUnfm80);
-            meanOccFV0CUnfm80 = getMeanOccupancy(binBCbegin, binBCend, occFV0CUnfm80);
-            meanOccFT0AUnfm80 = getMeanOccupancy(binBCbegin, binBCend, occFT0AUnfm80);
-            meanOccFT0CUnfm80 = getMeanOccupancy(binBCbegin, binBCend, occFT0CUnfm80);
+            meanOccFV0AUnfm80 = getMeanOccupancy(binBCbegin, binBCend, kOccFV0AUnfm80);
+            meanOccFV0CUnfm80 = getMeanOccupancy(binBCbegin, binBCend, kOccFV0CUnfm80);
+            meanOccFT0AUnfm80 = getMeanOccupancy(binBCbegin, binBCend, kOccFT0AUnfm80);
+            meanOccFT0CUnfm80 = getMeanOccupancy(binBCbegin, binBCend, kOccFT0CUnfm80);
             genTmoT0V0(meanOccFV0AUnfm80,
                        meanOccFV0CUnfm80,
                        meanOccFT0AUnfm80,
@@ -2097,10 +2175,10 @@ struct TrackMeanOccTableProducer {
             fillQAInfo<kMean, kRobustT0V0Prim, kOccFT0CUnfm80>(meanOccFT0CUnfm80, meanOccRobustT0V0PrimUnfm80);
           }
           if constexpr (weightMeanTableMode == fillWeightMeanOccTable) {
-            weightMeanOccFV0AUnfm80 = getWeightedMeanOccupancy(binBCbegin, binBCend, occFV0AUnfm80);
-            weightMeanOccFV0CUnfm80 = getWeightedMeanOccupancy(binBCbegin, binBCend, occFV0CUnfm80);
-            weightMeanOccFT0AUnfm80 = getWeightedMeanOccupancy(binBCbegin, binBCend, occFT0AUnfm80);
-            weightMeanOccFT0CUnfm80 = getWeightedMeanOccupancy(binBCbegin, binBCend, occFT0CUnfm80);
+            weightMeanOccFV0AUnfm80 = getWeightedMeanOccupancy(binBCbegin, binBCend, kOccFV0AUnfm80);
+            weightMeanOccFV0CUnfm80 = getWeightedMeanOccupancy(binBCbegin, binBCend, kOccFV0CUnfm80);
+            weightMeanOccFT0AUnfm80 = getWeightedMeanOccupancy(binBCbegin, binBCend, kOccFT0AUnfm80);
+            weightMeanOccFT0CUnfm80 = getWeightedMeanOccupancy(binBCbegin, binBCend, kOccFT0CUnfm80);
             genTwmoT0V0(weightMeanOccFV0AUnfm80,
                         weightMeanOccFV0CUnfm80,
                         weightMeanOccFT0AUnfm80,
@@ -2119,16 +2197,16 @@ struct TrackMeanOccTableProducer {
 
         if constexpr (processMode == kProcessFullOccTableProducer || processMode == kProcessOnlyOccFDD) {
           if constexpr (meanTableMode == fillMeanOccTable) {
-            meanOccFDDAUnfm80 = getMeanOccupancy(binBCbegin, binBCend, occFDDAUnfm80);
-            meanOccFDDCUnfm80 = getMeanOccupancy(binBCbegin, binBCend, occFDDCUnfm80);
+            meanOccFDDAUnfm80 = getMeanOccupancy(binBCbegin, binBCend, kOccFDDAUnfm80);
+            meanOccFDDCUnfm80 = getMeanOccupancy(binBCbegin, binBCend, kOccFDDCUnfm80);
             genTmoFDD(meanOccFDDAUnfm80,
                       meanOccFDDCUnfm80);
             fillQAInfo<kMean, kRobustT0V0Prim, kOccFDDAUnfm80>(meanOccFDDAUnfm80, meanOccRobustT0V0PrimUnfm80);
             fillQAInfo<kMean, kRobustT0V0Prim, kOccFDDCUnfm80>(meanOccFDDCUnfm80, meanOccRobustT0V0PrimUnfm80);
           }
           if constexpr (weightMeanTableMode == fillWeightMeanOccTable) {
-            weightMeanOccFDDAUnfm80 = getWeightedMeanOccupancy(binBCbegin, binBCend, occFDDAUnfm80);
-            weightMeanOccFDDCUnfm80 = getWeightedMeanOccupancy(binBCbegin, binBCend, occFDDCUnfm80);
+            weightMeanOccFDDAUnfm80 = getWeightedMeanOccupancy(binBCbegin, binBCend, kOccFDDAUnfm80);
+            weightMeanOccFDDCUnfm80 = getWeightedMeanOccupancy(binBCbegin, binBCend, kOccFDDCUnfm80);
             genTwmoFDD(weightMeanOccFDDAUnfm80,
                        weightMeanOccFDDCUnfm80);
             fillQAInfo<kWeightMean, kRobustT0V0Prim, kOccFDDAUnfm80>(weightMeanOccFDDAUnfm80, meanOccRobustT0V0PrimUnfm80);
@@ -2141,16 +2219,16 @@ struct TrackMeanOccTableProducer {
 
         if constexpr (processMode == kProcessFullOccTableProducer || processMode == kProcessOnlyOccNtrackDet) {
           if constexpr (meanTableMode == fillMeanOccTable) {
-            meanOccNTrackITSUnfm80 = getMeanOccupancy(binBCbegin, binBCend, occNTrackITSUnfm80);
-            meanOccNTrackTPCUnfm80 = getMeanOccupancy(binBCbegin, binBCend, occNTrackTPCUnfm80);
-            meanOccNTrackTRDUnfm80 = getMeanOccupancy(binBCbegin, binBCend, occNTrackTRDUnfm80);
-            meanOccNTrackTOFUnfm80 = getMeanOccupancy(binBCbegin, binBCend, occNTrackTOFUnfm80);
-            meanOccNTrackSizeUnfm80 = getMeanOccupancy(binBCbegin, binBCend, occNTrackSizeUnfm80);
-            meanOccNTrackTPCAUnfm80 = getMeanOccupancy(binBCbegin, binBCend, occNTrackTPCAUnfm80);
-            meanOccNTrackTPCCUnfm80 = getMeanOccupancy(binBCbegin, binBCend, occNTrackTPCCUnfm80);
-            meanOccNTrackITSTPCUnfm80 = getMeanOccupancy(binBCbegin, binBCend, occNTrackITSTPCUnfm80);
-            meanOccNTrackITSTPCAUnfm80 = getMeanOccupancy(binBCbegin, binBCend, occNTrackITSTPCAUnfm80);
-            meanOccNTrackITSTPCCUnfm80 = getMeanOccupancy(binBCbegin, binBCend, occNTrackITSTPCCUnfm80);
+            meanOccNTrackITSUnfm80 = getMeanOccupancy(binBCbegin, binBCend, kOccNTrackITSUnfm80);
+            meanOccNTrackTPCUnfm80 = getMeanOccupancy(binBCbegin, binBCend, kOccNTrackTPCUnfm80);
+            meanOccNTrackTRDUnfm80 = getMeanOccupancy(binBCbegin, binBCend, kOccNTrackTRDUnfm80);
+            meanOccNTrackTOFUnfm80 = getMeanOccupancy(binBCbegin, binBCend, kOccNTrackTOFUnfm80);
+            meanOccNTrackSizeUnfm80 = getMeanOccupancy(binBCbegin, binBCend, kOccNTrackSizeUnfm80);
+            meanOccNTrackTPCAUnfm80 = getMeanOccupancy(binBCbegin, binBCend, kOccNTrackTPCAUnfm80);
+            meanOccNTrackTPCCUnfm80 = getMeanOccupancy(binBCbegin, binBCend, kOccNTrackTPCCUnfm80);
+            meanOccNTrackITSTPCUnfm80 = getMeanOccupancy(binBCbegin, binBCend, kOccNTrackITSTPCUnfm80);
+            meanOccNTrackITSTPCAUnfm80 = getMeanOccupancy(binBCbegin, binBCend, kOccNTrackITSTPCAUnfm80);
+            meanOccNTrackITSTPCCUnfm80 = getMeanOccupancy(binBCbegin, binBCend, kOccNTrackITSTPCCUnfm80);
             genTmoNTrackDet(meanOccNTrackITSUnfm80,
                             meanOccNTrackTPCUnfm80,
                             meanOccNTrackTRDUnfm80,
@@ -2173,16 +2251,16 @@ struct TrackMeanOccTableProducer {
             fillQAInfo<kMean, kRobustT0V0Prim, kOccNTrackITSTPCCUnfm80>(meanOccNTrackITSTPCCUnfm80, meanOccRobustT0V0PrimUnfm80);
           }
           if constexpr (weightMeanTableMode == fillWeightMeanOccTable) {
-            weightMeanOccNTrackITSUnfm80 = getWeightedMeanOccupancy(binBCbegin, binBCend, occNTrackITSUnfm80);
-            weightMeanOccNTrackTPCUnfm80 = getWeightedMeanOccupancy(binBCbegin, binBCend, occNTrackTPCUnfm80);
-            weightMeanOccNTrackTRDUnfm80 = getWeightedMeanOccupancy(binBCbegin, binBCend, occNTrackTRDUnfm80);
-            weightMeanOccNTrackTOFUnfm80 = getWeightedMeanOccupancy(binBCbegin, binBCend, occNTrackTOFUnfm80);
-            weightMeanOccNTrackSizeUnfm80 = getWeightedMeanOccupancy(binBCbegin, binBCend, occNTrackSizeUnfm80);
-            weightMeanOccNTrackTPCAUnfm80 = getWeightedMeanOccupancy(binBCbegin, binBCend, occNTrackTPCAUnfm80);
-            weightMeanOccNTrackTPCCUnfm80 = getWeightedMeanOccupancy(binBCbegin, binBCend, occNTrackTPCCUnfm80);
-            weightMeanOccNTrackITSTPCUnfm80 = getWeightedMeanOccupancy(binBCbegin, binBCend, occNTrackITSTPCUnfm80);
-            weightMeanOccNTrackITSTPCAUnfm80 = getWeightedMeanOccupancy(binBCbegin, binBCend, occNTrackITSTPCAUnfm80);
-            weightMeanOccNTrackITSTPCCUnfm80 = getWeightedMeanOccupancy(binBCbegin, binBCend, occNTrackITSTPCCUnfm80);
+            weightMeanOccNTrackITSUnfm80 = getWeightedMeanOccupancy(binBCbegin, binBCend, kOccNTrackITSUnfm80);
+            weightMeanOccNTrackTPCUnfm80 = getWeightedMeanOccupancy(binBCbegin, binBCend, kOccNTrackTPCUnfm80);
+            weightMeanOccNTrackTRDUnfm80 = getWeightedMeanOccupancy(binBCbegin, binBCend, kOccNTrackTRDUnfm80);
+            weightMeanOccNTrackTOFUnfm80 = getWeightedMeanOccupancy(binBCbegin, binBCend, kOccNTrackTOFUnfm80);
+            weightMeanOccNTrackSizeUnfm80 = getWeightedMeanOccupancy(binBCbegin, binBCend, kOccNTrackSizeUnfm80);
+            weightMeanOccNTrackTPCAUnfm80 = getWeightedMeanOccupancy(binBCbegin, binBCend, kOccNTrackTPCAUnfm80);
+            weightMeanOccNTrackTPCCUnfm80 = getWeightedMeanOccupancy(binBCbegin, binBCend, kOccNTrackTPCCUnfm80);
+            weightMeanOccNTrackITSTPCUnfm80 = getWeightedMeanOccupancy(binBCbegin, binBCend, kOccNTrackITSTPCUnfm80);
+            weightMeanOccNTrackITSTPCAUnfm80 = getWeightedMeanOccupancy(binBCbegin, binBCend, kOccNTrackITSTPCAUnfm80);
+            weightMeanOccNTrackITSTPCCUnfm80 = getWeightedMeanOccupancy(binBCbegin, binBCend, kOccNTrackITSTPCCUnfm80);
 
             genTwmoNTrackDet(weightMeanOccNTrackITSUnfm80,
                              weightMeanOccNTrackTPCUnfm80,
@@ -2221,14 +2299,14 @@ struct TrackMeanOccTableProducer {
 
         if constexpr (processMode == kProcessFullOccTableProducer || processMode == kProcessOnlyOccMultExtra) {
           if constexpr (meanTableMode == fillMeanOccTable) {
-            meanOccMultNTracksHasITSUnfm80 = getMeanOccupancy(binBCbegin, binBCend, occMultNTracksHasITSUnfm80);
-            meanOccMultNTracksHasTPCUnfm80 = getMeanOccupancy(binBCbegin, binBCend, occMultNTracksHasTPCUnfm80);
-            meanOccMultNTracksHasTOFUnfm80 = getMeanOccupancy(binBCbegin, binBCend, occMultNTracksHasTOFUnfm80);
-            meanOccMultNTracksHasTRDUnfm80 = getMeanOccupancy(binBCbegin, binBCend, occMultNTracksHasTRDUnfm80);
-            meanOccMultNTracksITSOnlyUnfm80 = getMeanOccupancy(binBCbegin, binBCend, occMultNTracksITSOnlyUnfm80);
-            meanOccMultNTracksTPCOnlyUnfm80 = getMeanOccupancy(binBCbegin, binBCend, occMultNTracksTPCOnlyUnfm80);
-            meanOccMultNTracksITSTPCUnfm80 = getMeanOccupancy(binBCbegin, binBCend, occMultNTracksITSTPCUnfm80);
-            meanOccMultAllTracksTPCOnlyUnfm80 = getMeanOccupancy(binBCbegin, binBCend, occMultAllTracksTPCOnlyUnfm80);
+            meanOccMultNTracksHasITSUnfm80 = getMeanOccupancy(binBCbegin, binBCend, kOccMultNTracksHasITSUnfm80);
+            meanOccMultNTracksHasTPCUnfm80 = getMeanOccupancy(binBCbegin, binBCend, kOccMultNTracksHasTPCUnfm80);
+            meanOccMultNTracksHasTOFUnfm80 = getMeanOccupancy(binBCbegin, binBCend, kOccMultNTracksHasTOFUnfm80);
+            meanOccMultNTracksHasTRDUnfm80 = getMeanOccupancy(binBCbegin, binBCend, kOccMultNTracksHasTRDUnfm80);
+            meanOccMultNTracksITSOnlyUnfm80 = getMeanOccupancy(binBCbegin, binBCend, kOccMultNTracksITSOnlyUnfm80);
+            meanOccMultNTracksTPCOnlyUnfm80 = getMeanOccupancy(binBCbegin, binBCend, kOccMultNTracksTPCOnlyUnfm80);
+            meanOccMultNTracksITSTPCUnfm80 = getMeanOccupancy(binBCbegin, binBCend, kOccMultNTracksITSTPCUnfm80);
+            meanOccMultAllTracksTPCOnlyUnfm80 = getMeanOccupancy(binBCbegin, binBCend, kOccMultAllTracksTPCOnlyUnfm80);
             genTmoMultExtra(meanOccMultNTracksHasITSUnfm80,
                             meanOccMultNTracksHasTPCUnfm80,
                             meanOccMultNTracksHasTOFUnfm80,
@@ -2247,14 +2325,14 @@ struct TrackMeanOccTableProducer {
             fillQAInfo<kMean, kRobustT0V0Prim, kOccMultAllTracksTPCOnlyUnfm80>(meanOccMultAllTracksTPCOnlyUnfm80, meanOccRobustT0V0PrimUnfm80);
           }
           if constexpr (weightMeanTableMode == fillWeightMeanOccTable) {
-            weightMeanOccMultNTracksHasITSUnfm80 = getWeightedMeanOccupancy(binBCbegin, binBCend, occMultNTracksHasITSUnfm80);
-            weightMeanOccMultNTracksHasTPCUnfm80 = getWeightedMeanOccupancy(binBCbegin, binBCend, occMultNTracksHasTPCUnfm80);
-            weightMeanOccMultNTracksHasTOFUnfm80 = getWeightedMeanOccupancy(binBCbegin, binBCend, occMultNTracksHasTOFUnfm80);
-            weightMeanOccMultNTracksHasTRDUnfm80 = getWeightedMeanOccupancy(binBCbegin, binBCend, occMultNTracksHasTRDUnfm80);
-            weightMeanOccMultNTracksITSOnlyUnfm80 = getWeightedMeanOccupancy(binBCbegin, binBCend, occMultNTracksITSOnlyUnfm80);
-            weightMeanOccMultNTracksTPCOnlyUnfm80 = getWeightedMeanOccupancy(binBCbegin, binBCend, occMultNTracksTPCOnlyUnfm80);
-            weightMeanOccMultNTracksITSTPCUnfm80 = getWeightedMeanOccupancy(binBCbegin, binBCend, occMultNTracksITSTPCUnfm80);
-            weightMeanOccMultAllTracksTPCOnlyUnfm80 = getWeightedMeanOccupancy(binBCbegin, binBCend, occMultAllTracksTPCOnlyUnfm80);
+            weightMeanOccMultNTracksHasITSUnfm80 = getWeightedMeanOccupancy(binBCbegin, binBCend, kOccMultNTracksHasITSUnfm80);
+            weightMeanOccMultNTracksHasTPCUnfm80 = getWeightedMeanOccupancy(binBCbegin, binBCend, kOccMultNTracksHasTPCUnfm80);
+            weightMeanOccMultNTracksHasTOFUnfm80 = getWeightedMeanOccupancy(binBCbegin, binBCend, kOccMultNTracksHasTOFUnfm80);
+            weightMeanOccMultNTracksHasTRDUnfm80 = getWeightedMeanOccupancy(binBCbegin, binBCend, kOccMultNTracksHasTRDUnfm80);
+            weightMeanOccMultNTracksITSOnlyUnfm80 = getWeightedMeanOccupancy(binBCbegin, binBCend, kOccMultNTracksITSOnlyUnfm80);
+            weightMeanOccMultNTracksTPCOnlyUnfm80 = getWeightedMeanOccupancy(binBCbegin, binBCend, kOccMultNTracksTPCOnlyUnfm80);
+            weightMeanOccMultNTracksITSTPCUnfm80 = getWeightedMeanOccupancy(binBCbegin, binBCend, kOccMultNTracksITSTPCUnfm80);
+            weightMeanOccMultAllTracksTPCOnlyUnfm80 = getWeightedMeanOccupancy(binBCbegin, binBCend, kOccMultAllTracksTPCOnlyUnfm80);
 
             genTwmoMultExtra(weightMeanOccMultNTracksHasITSUnfm80,
                              weightMeanOccMultNTracksHasTPCUnfm80,
@@ -2287,12 +2365,12 @@ struct TrackMeanOccTableProducer {
 
         if constexpr (processMode == kProcessFullOccTableProducer || processMode == kProcessOnlyRobustT0V0Prim) {
           if constexpr (meanTableMode == fillMeanOccTable) {
-            meanOccRobustT0V0PrimUnfm80 = getMeanOccupancy(binBCbegin, binBCend, occRobustT0V0PrimUnfm80);
+            meanOccRobustT0V0PrimUnfm80 = getMeanOccupancy(binBCbegin, binBCend, kOccRobustT0V0PrimUnfm80);
             genTmoRT0V0Prim(meanOccRobustT0V0PrimUnfm80);
             fillQAInfo<kMean, kRobustT0V0Prim, kOccRobustT0V0PrimUnfm80>(meanOccRobustT0V0PrimUnfm80, meanOccRobustT0V0PrimUnfm80);
           }
           if constexpr (weightMeanTableMode == fillWeightMeanOccTable) {
-            weightMeanOccRobustT0V0PrimUnfm80 = getWeightedMeanOccupancy(binBCbegin, binBCend, occRobustT0V0PrimUnfm80);
+            weightMeanOccRobustT0V0PrimUnfm80 = getWeightedMeanOccupancy(binBCbegin, binBCend, kOccRobustT0V0PrimUnfm80);
             genTwmoRT0V0Prim(weightMeanOccRobustT0V0PrimUnfm80);
             fillQAInfo<kWeightMean, kRobustT0V0Prim, kOccRobustT0V0PrimUnfm80>(weightMeanOccRobustT0V0PrimUnfm80, meanOccRobustT0V0PrimUnfm80);
             fillQAInfo<kWeightMean, kWeightRobustT0V0Prim, kOccRobustT0V0PrimUnfm80>(weightMeanOccRobustT0V0PrimUnfm80, weightMeanOccRobustT0V0PrimUnfm80);
@@ -2301,12 +2379,12 @@ struct TrackMeanOccTableProducer {
 
         if constexpr (processMode == kProcessFullOccTableProducer || processMode == kProcessOnlyRobustFDDT0V0Prim) {
           if constexpr (meanTableMode == fillMeanOccTable) {
-            meanOccRobustFDDT0V0PrimUnfm80 = getMeanOccupancy(binBCbegin, binBCend, occRobustFDDT0V0PrimUnfm80);
+            meanOccRobustFDDT0V0PrimUnfm80 = getMeanOccupancy(binBCbegin, binBCend, kOccRobustFDDT0V0PrimUnfm80);
             genTmoRFDDT0V0Prim(meanOccRobustFDDT0V0PrimUnfm80);
             fillQAInfo<kMean, kRobustT0V0Prim, kOccRobustFDDT0V0PrimUnfm80>(meanOccRobustFDDT0V0PrimUnfm80, meanOccRobustT0V0PrimUnfm80);
           }
           if constexpr (weightMeanTableMode == fillWeightMeanOccTable) {
-            weightMeanOccRobustFDDT0V0PrimUnfm80 = getWeightedMeanOccupancy(binBCbegin, binBCend, occRobustFDDT0V0PrimUnfm80);
+            weightMeanOccRobustFDDT0V0PrimUnfm80 = getWeightedMeanOccupancy(binBCbegin, binBCend, kOccRobustFDDT0V0PrimUnfm80);
             genTwmoRFDDT0V0Pri(weightMeanOccRobustFDDT0V0PrimUnfm80);
             fillQAInfo<kWeightMean, kRobustT0V0Prim, kOccRobustFDDT0V0PrimUnfm80>(weightMeanOccRobustFDDT0V0PrimUnfm80, meanOccRobustT0V0PrimUnfm80);
             fillQAInfo<kWeightMean, kWeightRobustT0V0Prim, kOccRobustFDDT0V0PrimUnfm80>(weightMeanOccRobustFDDT0V0PrimUnfm80, weightMeanOccRobustT0V0PrimUnfm80);
@@ -2315,12 +2393,12 @@ struct TrackMeanOccTableProducer {
 
         if constexpr (processMode == kProcessFullOccTableProducer || processMode == kProcessOnlyRobustNtrackDet) {
           if constexpr (meanTableMode == fillMeanOccTable) {
-            meanOccRobustNtrackDetUnfm80 = getMeanOccupancy(binBCbegin, binBCend, occRobustNtrackDetUnfm80);
+            meanOccRobustNtrackDetUnfm80 = getMeanOccupancy(binBCbegin, binBCend, kOccRobustNtrackDetUnfm80);
             genTmoRNtrackDet(meanOccRobustNtrackDetUnfm80);
             fillQAInfo<kMean, kRobustT0V0Prim, kOccRobustNtrackDetUnfm80>(meanOccRobustNtrackDetUnfm80, meanOccRobustT0V0PrimUnfm80);
           }
           if constexpr (weightMeanTableMode == fillWeightMeanOccTable) {
-            weightMeanOccRobustNtrackDetUnfm80 = getWeightedMeanOccupancy(binBCbegin, binBCend, occRobustNtrackDetUnfm80);
+            weightMeanOccRobustNtrackDetUnfm80 = getWeightedMeanOccupancy(binBCbegin, binBCend, kOccRobustNtrackDetUnfm80);
             genTwmoRNtrackDet(weightMeanOccRobustNtrackDetUnfm80);
             fillQAInfo<kWeightMean, kRobustT0V0Prim, kOccRobustNtrackDetUnfm80>(weightMeanOccRobustNtrackDetUnfm80, meanOccRobustT0V0PrimUnfm80);
             fillQAInfo<kWeightMean, kWeightRobustT0V0Prim, kOccRobustNtrackDetUnfm80>(weightMeanOccRobustNtrackDetUnfm80, weightMeanOccRobustT0V0PrimUnfm80);
@@ -2329,12 +2407,12 @@ struct TrackMeanOccTableProducer {
 
         if constexpr (processMode == kProcessFullOccTableProducer || processMode == kProcessOnlyRobustMultExtra) {
           if constexpr (meanTableMode == fillMeanOccTable) {
-            meanOccRobustMultTableUnfm80 = getMeanOccupancy(binBCbegin, binBCend, occRobustMultTableUnfm80);
+            meanOccRobustMultTableUnfm80 = getMeanOccupancy(binBCbegin, binBCend, kOccRobustMultTableUnfm80);
             genTmoRMultExtra(meanOccRobustMultTableUnfm80);
             fillQAInfo<kMean, kRobustT0V0Prim, kOccRobustMultTableUnfm80>(meanOccRobustMultTableUnfm80, meanOccRobustT0V0PrimUnfm80);
           }
           if constexpr (weightMeanTableMode == fillWeightMeanOccTable) {
-            weightMeanOccRobustMultTableUnfm80 = getWeightedMeanOccupancy(binBCbegin, binBCend, occRobustMultTableUnfm80);
+            weightMeanOccRobustMultTableUnfm80 = getWeightedMeanOccupancy(binBCbegin, binBCend, kOccRobustMultTableUnfm80);
             genTwmoRMultExtra(weightMeanOccRobustMultTableUnfm80);
             fillQAInfo<kWeightMean, kRobustT0V0Prim, kOccRobustMultTableUnfm80>(weightMeanOccRobustMultTableUnfm80, meanOccRobustT0V0PrimUnfm80);
             fillQAInfo<kWeightMean, kWeightRobustT0V0Prim, kOccRobustMultTableUnfm80>(weightMeanOccRobustMultTableUnfm80, weightMeanOccRobustT0V0PrimUnfm80);
@@ -43,11 +43,13 @@
 #include <Framework/RunningWorkflowInfo.h>
 #include <Framework/runDataProcessing.h>
 
-#include <TComplex.h>
+#include <TAxis.h>
 #include <TH3.h>
+#include <TMath.h>
 #include <TProfile3D.h>
 #include <TString.h>
 
+#include <algorithm>
 #include <chrono>
 #include <cmath>
 #include <cstddef>
@@ -187,6 +189,80 @@ struct QVectorsTable {
   std::vector<TProfile3D*> shiftProfileSp{};
   std::vector<TProfile3D*> shiftProfileEse{};
 
+  /// Recentering, twist and rescale constants of one harmonic, flattened per run from the TH3F
+  /// of the CCDB into an array indexed by centrality bin, detector and correction constant.
+  struct QVecCorrections {
+    static constexpr int NConstants = 6; // x0, y0, lambdaPlus, lambdaMinus, aPlus, aMinus
+    int nCentBins = 0;                   // including under- and overflow
+    std::vector<float> constants{};
+
+    void compile(TH3F* hist)
+    {
+      nCentBins = hist->GetNbinsX() + 2;
+      constants.resize(nCentBins * (kTPCAll + 1) * NConstants);
+      for (int iCent = 0; iCent < nCentBins; iCent++) {
+        for (int iDet = 0; iDet < kTPCAll + 1; iDet++) {
+          for (int iConst = 0; iConst < NConstants; iConst++) {
+            constants[(iCent * (kTPCAll + 1) + iDet) * NConstants + iConst] = hist->GetBinContent(iCent, iConst + 1, iDet + 1);
+          }
+        }
+      }
+    }
+
+    // constants for the given centrality and detector, as GetBinContent(centrality + 1, iConst + 1, iDet + 1)
+    const float* get(float centrality, int iDet) const
+    {
+      int iCent = std::min(static_cast<int>(centrality) + 1, nCentBins - 1);
+      return &constants[(iCent * (kTPCAll + 1) + iDet) * NConstants];
+    }
+  };
+
+  /// Shift-correction coefficients of one harmonic, flattened per run from the TProfile3D of the
+  /// CCDB into an array indexed by centrality bin, detector, component and shift order.
+  struct QVecShifts {
+    TAxis centAxis{};
+    int nShifts = 0;
+    std::vector<double> coeffs{};
+
+    void compile(TProfile3D* profile, int nShiftIndex)
+    {
+      centAxis = *profile->GetXaxis();
+      nShifts = nShiftIndex;
+      const int nCentBins = profile->GetNbinsX() + 2;
+      coeffs.resize(nCentBins * (kTPCAll + 1) * 2 * nShifts);
+      for (int iCent = 0; iCent < nCentBins; iCent++) {
+        for (int iDet = 0; iDet < kTPCAll + 1; iDet++) {
+          for (int iComp = 0; iComp < 2; iComp++) {
+            int binY = profile->GetYaxis()->FindFixBin(2 * iDet + iComp);
+            for (int iShift = 1; iShift <= nShifts; iShift++) {
+              int binZ = profile->GetZaxis()->FindFixBin(iShift - 0.5);
+              coeffs[((iCent * (kTPCAll + 1) + iDet) * 2 + iComp) * nShifts + iShift - 1] = profile->GetBinContent(profile->GetBin(iCent, binY, binZ));
+            }
+          }
+        }
+      }
+    }
+
+    // coefficients <cos> (iComp = 0) or <sin> (iComp = 1) of the orders 1..nShifts for the given centrality and detector
+    const double* get(float centrality, int iDet, int iComp) const
+    {
+      return &coeffs[((centAxis.FindFixBin(centrality) * (kTPCAll + 1) + iDet) * 2 + iComp) * nShifts];
+    }
+  };
+
+  std::vector<QVecCorrections> corrsQvecSpFlat{};
+  std::vector<QVecCorrections> corrsQvecEseFlat{};
+  std::vector<QVecShifts> shiftsSp{};
+  std::vector<QVecShifts> shiftsEse{};
+
+  // cos(n phi) and sin(n phi) of the FIT channels for all the harmonics in cfgnMods, [channel * nModes + iMode]
+  static constexpr int NChannelsFT0 = 208;
+  static constexpr int NChannelsFV0 = 48;
+  std::vector<double> cosPhiFT0{};
+  std::vector<double> sinPhiFT0{};
+  std::vector<double> cosPhiFV0{};
+  std::vector<double> sinPhiFV0{};
+
   // Deprecated, will be removed in future after transition time //
   Configurable<bool> cfgUseBPos{"cfgUseBPos", false, "Initial value for using BPos. By default obtained from DataModel."};
   Configurable<bool> cfgUseBNeg{"cfgUseBNeg", false, "Initial value for using BNeg. By default obtained from DataModel."};
@@ -387,6 +463,45 @@ struct QVectorsTable {
     } else {
       fv0RelGainConst = *(objfv0Gain);
     }
+
+    // Flatten the correction constants of this run and tabulate the channel angles with the
+    // offsets of this run, see correctQVec and calcQVecs.
+    corrsQvecSpFlat.resize(corrsQvecSp.size());
+    for (std::size_t i = 0; i < corrsQvecSp.size(); i++) {
+      corrsQvecSpFlat[i].compile(corrsQvecSp[i]);
+    }
+    corrsQvecEseFlat.resize(corrsQvecEse.size());
+    for (std::size_t i = 0; i < corrsQvecEse.size(); i++) {
+      corrsQvecEseFlat[i].compile(corrsQvecEse[i]);
+    }
+    shiftsSp.resize(shiftProfileSp.size());
+    for (std::size_t i = 0; i < shiftProfileSp.size(); i++) {
+      shiftsSp[i].compile(shiftProfileSp[i], nShiftIndex);
+    }
+    shiftsEse.resize(shiftProfileEse.size());
+    for (std::size_t i = 0; i < shiftProfileEse.size(); i++) {
+      shiftsEse[i].compile(shiftProfileEse[i], nShiftIndex);
+    }
+
+    const std::size_t nModes = cfgnMods->size();
+    cosPhiFT0.resize(NChannelsFT0 * nModes);
+    sinPhiFT0.resize(NChannelsFT0 * nModes);
+    for (int iCh = 0; iCh < NChannelsFT0; iCh++) {
+      double phi = helperEP.GetPhiFT0(iCh, ft0geom);
+      for (std::size_t iMode = 0; iMode < nModes; iMode++) {
+        cosPhiFT0[iCh * nModes + iMode] = TMath::Cos(phi * cfgnMods->at(iMode));
+        sinPhiFT0[iCh * nModes + iMode] = TMath::Sin(phi * cfgnMods->at(iMode));
+      }
+    }
+    cosPhiFV0.resize(NChannelsFV0 * nModes);
+    sinPhiFV0.resize(NChannelsFV0 * nModes);
+    for (int iCh = 0; iCh < NChannelsFV0; iCh++) {
+      double phi = helperEP.GetPhiFV0(iCh, fv0geom);
+      for (std::size_t iMode = 0; iMode < nModes; iMode++) {
+        cosPhiFV0[iCh * nModes + iMode] = TMath::Cos(phi * cfgnMods->at(iMode));
+        sinPhiFV0[iCh * nModes + iMode] = TMath::Sin(phi * cfgnMods->at(iMode));
+      }
+    }
   }
 
   template <typename TrackType>
@@ -467,148 +582,116 @@ struct QVectorsTable {
     }
   }
 
-  /// Function to calculate the un-normalized q-vectors
+  /// Function to apply the recentering, twist, rescale and shift corrections to the q-vectors
   /// \param centrality is the collision centrality
   /// \param qVecRe is the vector with the real part of the q-vector for each detector and correction step
   /// \param qVecIm is the vector with the imaginary part of the q-vector for each detector and correction step
-  /// \param histsCorrs is the vector with the histograms with the correction constants for each detector and correction step
+  /// \param corrs are the flattened correction constants of the harmonic
+  /// \param shifts are the flattened shift coefficients of all the harmonics
   /// \param nMode is the modulation of interest
-  void correctQVec(float centrality, std::vector<float>& qVecRe, std::vector<float>& qVecIm, TH3F* histsCorrs, std::vector<TProfile3D*>& shiftProfile, int nMode)
+  void correctQVec(float centrality, std::vector<float>& qVecRe, std::vector<float>& qVecIm, QVecCorrections const& corrs, std::vector<QVecShifts> const& shifts, int nMode)
   {
     int nCorrections = static_cast<int>(kNCorrections);
     if (centrality < cfgMaxCentrality) {
       for (auto i{0u}; i < kTPCAll + 1; i++) {
         int idxDet = i * kNCorrections;
-        helperEP.DoRecenter(qVecRe[idxDet + kRecenter], qVecIm[idxDet + kRecenter],
-                            histsCorrs->GetBinContent(static_cast<int>(centrality) + 1, 1, i + 1), histsCorrs->GetBinContent(static_cast<int>(centrality) + 1, 2, i + 1));
-
-        helperEP.DoRecenter(qVecRe[idxDet + kTwist], qVecIm[idxDet + kTwist],
-                            histsCorrs->GetBinContent(static_cast<int>(centrality) + 1, 1, i + 1), histsCorrs->GetBinContent(static_cast<int>(centrality) + 1, 2, i + 1));
-        helperEP.DoTwist(qVecRe[idxDet + kTwist], qVecIm[idxDet + kTwist],
-                         histsCorrs->GetBinContent(static_cast<int>(centrality) + 1, 3, i + 1), histsCorrs->GetBinContent(static_cast<int>(centrality) + 1, 4, i + 1));
-
-        helperEP.DoRecenter(qVecRe[idxDet + kRescale], qVecIm[idxDet + kRescale],
-                            histsCorrs->GetBinContent(static_cast<int>(centrality) + 1, 1, i + 1), histsCorrs->GetBinContent(static_cast<int>(centrality) + 1, 2, i + 1));
-        helperEP.DoTwist(qVecRe[idxDet + kRescale], qVecIm[idxDet + kRescale],
-                         histsCorrs->GetBinContent(static_cast<int>(centrality) + 1, 3, i + 1), histsCorrs->GetBinContent(static_cast<int>(centrality) + 1, 4, i + 1));
-        helperEP.DoRescale(qVecRe[idxDet + kRescale], qVecIm[idxDet + kRescale],
-                           histsCorrs->GetBinContent(static_cast<int>(centrality) + 1, 5, i + 1), histsCorrs->GetBinContent(static_cast<int>(centrality) + 1, 6, i + 1));
+        const float* c = corrs.get(centrality, i);
+        helperEP.DoRecenter(qVecRe[idxDet + kRecenter], qVecIm[idxDet + kRecenter], c[0], c[1]);
+
+        helperEP.DoRecenter(qVecRe[idxDet + kTwist], qVecIm[idxDet + kTwist], c[0], c[1]);
+        helperEP.DoTwist(qVecRe[idxDet + kTwist], qVecIm[idxDet + kTwist], c[2], c[3]);
+
+        helperEP.DoRecenter(qVecRe[idxDet + kRescale], qVecIm[idxDet + kRescale], c[0], c[1]);
+        helperEP.DoTwist(qVecRe[idxDet + kRescale], qVecIm[idxDet + kRescale], c[2], c[3]);
+        helperEP.DoRescale(qVecRe[idxDet + kRescale], qVecIm[idxDet + kRescale], c[4], c[5]);
       }
       if (cfgShiftCorr) {
-        auto deltaPsiFT0C = 0.0;
-        auto deltaPsiFT0A = 0.0;
-        auto deltaPsiFT0M = 0.0;
-        auto deltaPsiFV0A = 0.0;
-        auto deltaPsiTPCPos = 0.0;
-        auto deltaPsiTPCNeg = 0.0;
-        auto deltaPsiTPCAll = 0.0;
-
-        auto psiDefFT0C = std::atan2(qVecIm[kFT0C * nCorrections + kRescale], qVecRe[kFT0C * nCorrections + kRescale]) / static_cast<float>(nMode);
-        auto psiDefFT0A = std::atan2(qVecIm[kFT0A * nCorrections + kRescale], qVecRe[kFT0A * nCorrections + kRescale]) / static_cast<float>(nMode);
-        auto psiDefFT0M = std::atan2(qVecIm[kFT0M * nCorrections + kRescale], qVecRe[kFT0M * nCorrections + kRescale]) / static_cast<float>(nMode);
-        auto psiDefFV0A = std::atan2(qVecIm[kFV0A * nCorrections + kRescale], qVecRe[kFV0A * nCorrections + kRescale]) / static_cast<float>(nMode);
-        auto psiDefTPCPos = std::atan2(qVecIm[kTPCPos * nCorrections + kRescale], qVecRe[kTPCPos * nCorrections + kRescale]) / static_cast<float>(nMode);
-        auto psiDefTPCNeg = std::atan2(qVecIm[kTPCNeg * nCorrections + kRescale], qVecRe[kTPCNeg * nCorrections + kRescale]) / static_cast<float>(nMode);
-        auto psiDefTPCAll = std::atan2(qVecIm[kTPCAll * nCorrections + kRescale], qVecRe[kTPCAll * nCorrections + kRescale]) / static_cast<float>(nMode);
-
-        for (int iShift = 1; iShift <= nShiftIndex; iShift++) {
-          auto coeffShiftXFT0C = shiftProfile.at(nMode - 2)->GetBinContent(shiftProfile.at(nMode - 2)->FindBin(centrality, 2 * kFT0C, iShift - 0.5));
-          auto coeffShiftYFT0C = shiftProfile.at(nMode - 2)->GetBinContent(shiftProfile.at(nMode - 2)->FindBin(centrality, 2 * kFT0C + 1, iShift - 0.5));
-          auto coeffShiftXFT0A = shiftProfile.at(nMode - 2)->GetBinContent(shiftProfile.at(nMode - 2)->FindBin(centrality, 2 * kFT0A, iShift - 0.5));
-          auto coeffShiftYFT0A = shiftProfile.at(nMode - 2)->GetBinContent(shiftProfile.at(nMode - 2)->FindBin(centrality, 2 * kFT0A + 1, iShift - 0.5));
-          auto coeffShiftXFT0M = shiftProfile.at(nMode - 2)->GetBinContent(shiftProfile.at(nMode - 2)->FindBin(centrality, 2 * kFT0M, iShift - 0.5));
-          auto coeffShiftYFT0M = shiftProfile.at(nMode - 2)->GetBinContent(shiftProfile.at(nMode - 2)->FindBin(centrality, 2 * kFT0M + 1, iShift - 0.5));
-          auto coeffShiftXFV0A = shiftProfile.at(nMode - 2)->GetBinContent(shiftProfile.at(nMode - 2)->FindBin(centrality, 2 * kFV0A, iShift - 0.5));
-          auto coeffShiftYFV0A = shiftProfile.at(nMode - 2)->GetBinContent(shiftProfile.at(nMode - 2)->FindBin(centrality, 2 * kFV0A + 1, iShift - 0.5));
-          auto coeffShiftXTPCPos = shiftProfile.at(nMode - 2)->GetBinContent(shiftProfile.at(nMode - 2)->FindBin(centrality, 2 * kTPCPos, iShift - 0.5));
-          auto coeffShiftYTPCPos = shiftProfile.at(nMode - 2)->GetBinContent(shiftProfile.at(nMode - 2)->FindBin(centrality, 2 * kTPCPos + 1, iShift - 0.5));
-          auto coeffShiftXTPCNeg = shiftProfile.at(nMode - 2)->GetBinContent(shiftProfile.at(nMode - 2)->FindBin(centrality, 2 * kTPCNeg, iShift - 0.5));
-          auto coeffShiftYTPCNeg = shiftProfile.at(nMode - 2)->GetBinContent(shiftProfile.at(nMode - 2)->FindBin(centrality, 2 * kTPCNeg + 1, iShift - 0.5));
-          auto coeffShiftXTPCAll = shiftProfile.at(nMode - 2)->GetBinContent(shiftProfile.at(nMode - 2)->FindBin(centrality, 2 * kTPCAll, iShift - 0.5));
-          auto coeffShiftYTPCAll = shiftProfile.at(nMode - 2)->GetBinContent(shiftProfile.at(nMode - 2)->FindBin(centrality, 2 * kTPCAll + 1, iShift - 0.5));
-
-          deltaPsiFT0C += ((2. / (1.0 * iShift)) * (-coeffShiftXFT0C * std::cos(iShift * static_cast<float>(nMode) * psiDefFT0C) + coeffShiftYFT0C * std::sin(iShift * static_cast<float>(nMode) * psiDefFT0C))) / static_cast<float>(nMode);
-          deltaPsiFT0A += ((2. / (1.0 * iShift)) * (-coeffShiftXFT0A * std::cos(iShift * static_cast<float>(nMode) * psiDefFT0A) + coeffShiftYFT0A * std::sin(iShift * static_cast<float>(nMode) * psiDefFT0A))) / static_cast<float>(nMode);
-          deltaPsiFT0M += ((2. / (1.0 * iShift)) * (-coeffShiftXFT0M * std::cos(iShift * static_cast<float>(nMode) * psiDefFT0M) + coeffShiftYFT0M * std::sin(iShift * static_cast<float>(nMode) * psiDefFT0M))) / static_cast<float>(nMode);
-          deltaPsiFV0A += ((2. / (1.0 * iShift)) * (-coeffShiftXFV0A * std::cos(iShift * static_cast<float>(nMode) * psiDefFV0A) + coeffShiftYFV0A * std::sin(iShift * static_cast<float>(nMode) * psiDefFV0A))) / static_cast<float>(nMode);
-          deltaPsiTPCPos += ((2. / (1.0 * iShift)) * (-coeffShiftXTPCPos * std::cos(iShift * static_cast<float>(nMode) * psiDefTPCPos) + coeffShiftYTPCPos * std::sin(iShift * static_cast<float>(nMode) * psiDefTPCPos))) / static_cast<float>(nMode);
-          deltaPsiTPCNeg += ((2. / (1.0 * iShift)) * (-coeffShiftXTPCNeg * std::cos(iShift * static_cast<float>(nMode) * psiDefTPCNeg) + coeffShiftYTPCNeg * std::sin(iShift * static_cast<float>(nMode) * psiDefTPCNeg))) / static_cast<float>(nMode);
-          deltaPsiTPCAll += ((2. / (1.0 * iShift)) * (-coeffShiftXTPCAll * std::cos(iShift * static_cast<float>(nMode) * psiDefTPCAll) + coeffShiftYTPCAll * std::sin(iShift * static_cast<float>(nMode) * psiDefTPCAll))) / static_cast<float>(nMode);
-        }
+        QVecShifts const& shift = shifts.at(nMode - 2);
+        for (int iDet = 0; iDet < kTPCAll + 1; iDet++) {
+          float& qVecReDet = qVecRe[iDet * nCorrections + kRescale];
+          float& qVecImDet = qVecIm[iDet * nCorrections + kRescale];
+
+          // cos(k n psi) and sin(k n psi) by recurrence from n psi = atan2(Qy, Qx)
+          const double nPsiDef = std::atan2(static_cast<double>(qVecImDet), static_cast<double>(qVecReDet));
+          const double cos1 = std::cos(nPsiDef);
+          const double sin1 = std::sin(nPsiDef);
+          const double* coeffShiftX = shift.get(centrality, iDet, 0);
+          const double* coeffShiftY = shift.get(centrality, iDet, 1);
+          double cosK = cos1;
+          double sinK = sin1;
+          double deltaPsi = 0.0; // multiplied by n
+          for (int iShift = 1; iShift <= nShiftIndex; iShift++) {
+            deltaPsi += (2. / (1.0 * iShift)) * (-coeffShiftX[iShift - 1] * cosK + coeffShiftY[iShift - 1] * sinK);
+            const double cosNext = cosK * cos1 - sinK * sin1;
+            sinK = sinK * cos1 + cosK * sin1;
+            cosK = cosNext;
+          }
 
-        deltaPsiFT0C *= static_cast<float>(nMode);
-        deltaPsiFT0A *= static_cast<float>(nMode);
-        deltaPsiFT0M *= static_cast<float>(nMode);
-        deltaPsiFV0A *= static_cast<float>(nMode);
-        deltaPsiTPCPos *= static_cast<float>(nMode);
-        deltaPsiTPCNeg *= static_cast<float>(nMode);
-        deltaPsiTPCAll *= static_cast<float>(nMode);
-
-        float qVecReShiftedFT0C = qVecRe[kFT0C * nCorrections + kRescale] * std::cos(deltaPsiFT0C) - qVecIm[kFT0C * nCorrections + kRescale] * std::sin(deltaPsiFT0C);
-        float qVecImShiftedFT0C = qVecRe[kFT0C * nCorrections + kRescale] * std::sin(deltaPsiFT0C) + qVecIm[kFT0C * nCorrections + kRescale] * std::cos(deltaPsiFT0C);
-        float qVecReShiftedFT0A = qVecRe[kFT0A * nCorrections + kRescale] * std::cos(deltaPsiFT0A) - qVecIm[kFT0A * nCorrections + kRescale] * std::sin(deltaPsiFT0A);
-        float qVecImShiftedFT0A = qVecRe[kFT0A * nCorrections + kRescale] * std::sin(deltaPsiFT0A) + qVecIm[kFT0A * nCorrections + kRescale] * std::cos(deltaPsiFT0A);
-        float qVecReShiftedFT0M = qVecRe[kFT0M * nCorrections + kRescale] * std::cos(deltaPsiFT0M) - qVecIm[kFT0M * nCorrections + kRescale] * std::sin(deltaPsiFT0M);
-        float qVecImShiftedFT0M = qVecRe[kFT0M * nCorrections + kRescale] * std::sin(deltaPsiFT0M) + qVecIm[kFT0M * nCorrections + kRescale] * std::cos(deltaPsiFT0M);
-        float qVecReShiftedFV0A = qVecRe[kFV0A * nCorrections + kRescale] * std::cos(deltaPsiFV0A) - qVecIm[kFV0A * nCorrections + kRescale] * std::sin(deltaPsiFV0A);
-        float qVecImShiftedFV0A = qVecRe[kFV0A * nCorrections + kRescale] * std::sin(deltaPsiFV0A) + qVecIm[kFV0A * nCorrections + kRescale] * std::cos(deltaPsiFV0A);
-        float qVecReShiftedTPCPos = qVecRe[kTPCPos * nCorrections + kRescale] * std::cos(deltaPsiTPCPos) - qVecIm[kTPCPos * nCorrections + kRescale] * std::sin(deltaPsiTPCPos);
-        float qVecImShiftedTPCPos = qVecRe[kTPCPos * nCorrections + kRescale] * std::sin(deltaPsiTPCPos) + qVecIm[kTPCPos * nCorrections + kRescale] * std::cos(deltaPsiTPCPos);
-        float qVecReShiftedTPCNeg = qVecRe[kTPCNeg * nCorrections + kRescale] * std::cos(deltaPsiTPCNeg) - qVecIm[kTPCNeg * nCorrections + kRescale] * std::sin(deltaPsiTPCNeg);
-        float qVecImShiftedTPCNeg = qVecRe[kTPCNeg * nCorrections + kRescale] * std::sin(deltaPsiTPCNeg) + qVecIm[kTPCNeg * nCorrections + kRescale] * std::cos(deltaPsiTPCNeg);
-        float qVecReShiftedTPCAll = qVecRe[kTPCAll * nCorrections + kRescale] * std::cos(deltaPsiTPCAll) - qVecIm[kTPCAll * nCorrections + kRescale] * std::sin(deltaPsiTPCAll);
-        float qVecImShiftedTPCAll = qVecRe[kTPCAll * nCorrections + kRescale] * std::sin(deltaPsiTPCAll) + qVecIm[kTPCAll * nCorrections + kRescale] * std::cos(deltaPsiTPCAll);
-
-        qVecRe[kFT0C * nCorrections + kRescale] = qVecReShiftedFT0C;
-        qVecIm[kFT0C * nCorrections + kRescale] = qVecImShiftedFT0C;
-        qVecRe[kFT0A * nCorrections + kRescale] = qVecReShiftedFT0A;
-        qVecIm[kFT0A * nCorrections + kRescale] = qVecImShiftedFT0A;
-        qVecRe[kFT0M * nCorrections + kRescale] = qVecReShiftedFT0M;
-        qVecIm[kFT0M * nCorrections + kRescale] = qVecImShiftedFT0M;
-        qVecRe[kFV0A * nCorrections + kRescale] = qVecReShiftedFV0A;
-        qVecIm[kFV0A * nCorrections + kRescale] = qVecImShiftedFV0A;
-        qVecRe[kTPCPos * nCorrections + kRescale] = qVecReShiftedTPCPos;
-        qVecIm[kTPCPos * nCorrections + kRescale] = qVecImShiftedTPCPos;
-        qVecRe[kTPCNeg * nCorrections + kRescale] = qVecReShiftedTPCNeg;
-        qVecIm[kTPCNeg * nCorrections + kRescale] = qVecImShiftedTPCNeg;
-        qVecRe[kTPCAll * nCorrections + kRescale] = qVecReShiftedTPCAll;
-        qVecIm[kTPCAll * nCorrections + kRescale] = qVecImShiftedTPCAll;
+          float qVecReShifted = qVecReDet * std::cos(deltaPsi) - qVecImDet * std::sin(deltaPsi);
+          float qVecImShifted = qVecReDet * std::sin(deltaPsi) + qVecImDet * std::cos(deltaPsi);
+          qVecReDet = qVecReShifted;
+          qVecImDet = qVecImShifted;
+        }
       }
     }
   }
 
-  /// Function to calculate the un-normalized q-vectors
-  /// \param nMode is the harmonic number of the q-vector
+  /// Function to calculate the un-normalized q-vectors of all the harmonics in cfgnMods in one pass
+  /// over the FIT channels and the tracks
   /// \param coll is the collision object
   /// \param tracks are the tracks associated to the collision
-  /// \param qVecRe is the vector with the real part of the q-vector for each detector
-  /// \param qVecIm is the vector with the imaginary part of the q-vector for each detector
-  /// \param qVecAmp is the vector with the amplitude of the signal in each detector
-  /// \param trkTPCPosLabel is the vector with the number of TPC tracks with positive eta
-  /// \param trkTPCNegLabel is the vector with the number of TPC tracks with negative eta
-  /// \param trkTPCAllLabel is the vector with the number of TPC tracks with any eta
-  template <typename Nmode, typename CollType, typename TrackType>
-  void calcQVec(const Nmode nMode, const CollType& coll, const TrackType& tracks, std::vector<float>& qVecRe, std::vector<float>& qVecIm, std::vector<float>& qVecAmp, std::vector<int>& trkTPCPosLabel, std::vector<int>& trkTPCNegLabel, std::vector<int>& trkTPCAllLabel)
+  /// \param qVecRe is the vector with the real part of the q-vector for each harmonic and detector
+  /// \param qVecIm is the vector with the imaginary part of the q-vector for each harmonic and detector
+  /// \param qVecAmp is the vector with the amplitude of the signal in each detector, repeated for each harmonic
+  /// \param trkTPCPosLabel is the vector with the TPC tracks with positive eta, repeated for each harmonic
+  /// \param trkTPCNegLabel is the vector with the TPC tracks with negative eta, repeated for each harmonic
+  /// \param trkTPCAllLabel is the vector with the TPC tracks with any eta, repeated for each harmonic
+  template <typename CollType, typename TrackType>
+  void calcQVecs(const CollType& coll, const TrackType& tracks, std::vector<float>& qVecRe, std::vector<float>& qVecIm, std::vector<float>& qVecAmp, std::vector<int>& trkTPCPosLabel, std::vector<int>& trkTPCNegLabel, std::vector<int>& trkTPCAllLabel)
   {
-    float qVectFT0A[2] = {-999., -999.};
-    float qVectFT0C[2] = {-999., -999.};
-    float qVectFT0M[2] = {-999., -999.};
-    float qVectFV0A[2] = {-999., -999.};
-    float qVectTPCPos[2] = {0., 0.}; // Always computed
-    float qVectTPCNeg[2] = {0., 0.}; // Always computed
-    float qVectTPCAll[2] = {0., 0.}; // Always computed
-
-    TComplex qVecDet(0);
-    TComplex qVecFT0M(0);
+    const std::size_t nModes = cfgnMods->size();
+    const bool useFT0A = useDetector["QvectorFT0As"];
+    const bool useFT0C = useDetector["QvectorFT0Cs"];
+    const bool useFT0M = useDetector["QvectorFT0Ms"];
+    const bool useFV0A = useDetector["QvectorFV0As"];
+    const bool useTPCPos = useDetector["QvectorTPCposs"] || useDetector["QvectorBPoss"];
+    const bool useTPCNeg = useDetector["QvectorTPCnegs"] || useDetector["QvectorBNegs"];
+
+    qVecRe.assign(nModes * kNDetectors, 0.f);
+    qVecIm.assign(nModes * kNDetectors, 0.f);
+    for (std::size_t iMode = 0; iMode < nModes; iMode++) {
+      for (int iDet : {kFT0C, kFT0A, kFT0M, kFV0A}) {
+        qVecRe[iMode * kNDetectors + iDet] = -999.;
+        qVecIm[iMode * kNDetectors + iDet] = -999.;
+      }
+    }
+
+    // Q-vectors of the FIT detectors, summed in double precision as with TComplex
+    std::vector<double> qVecDetRe(nModes), qVecDetIm(nModes);
+    std::vector<double> qVecFT0MRe(nModes, 0.), qVecFT0MIm(nModes, 0.);
     float sumAmplFT0A = 0.;
     float sumAmplFT0C = 0.;
     float sumAmplFT0M = 0.;
     float sumAmplFV0A = 0.;
 
-    if (coll.has_foundFT0() && (useDetector["QvectorFT0As"] || useDetector["QvectorFT0Cs"] || useDetector["QvectorFT0Ms"])) {
+    // add the channel iCh of a FIT detector to the Q-vectors of all the harmonics
+    auto sumChannel = [&](std::vector<double> const& cosPhi, std::vector<double> const& sinPhi, int iCh, float ampl, bool addToFT0M) {
+      for (std::size_t iMode = 0; iMode < nModes; iMode++) {
+        qVecDetRe[iMode] += ampl * cosPhi[iCh * nModes + iMode];
+        qVecDetIm[iMode] += ampl * sinPhi[iCh * nModes + iMode];
+        if (addToFT0M) {
+          qVecFT0MRe[iMode] += ampl * cosPhi[iCh * nModes + iMode];
+          qVecFT0MIm[iMode] += ampl * sinPhi[iCh * nModes + iMode];
+        }
+      }
+    };
+
+    if (coll.has_foundFT0() && (useFT0A || useFT0C || useFT0M)) {
       auto ft0 = coll.foundFT0();
 
-      if (useDetector["QvectorFT0As"]) {
+      if (useFT0A) {
+        std::fill(qVecDetRe.begin(), qVecDetRe.end(), 0.);
+        std::fill(qVecDetIm.begin(), qVecDetIm.end(), 0.);
         for (std::size_t iChA = 0; iChA < ft0.channelA().size(); iChA++) {
           float ampl = ft0.amplitudeA()[iChA];
           int ft0AchId = ft0.channelA()[iChA];
@@ -616,17 +699,21 @@ struct QVectorsTable {
           histosQA.fill(HIST("FT0Amp"), ampl, ft0AchId);
           histosQA.fill(HIST("FT0AmpCor"), ampl / ft0RelGainConst[ft0AchId], ft0AchId);
 
-          helperEP.SumQvectors(0, ft0AchId, ampl / ft0RelGainConst[ft0AchId], nMode, qVecDet, sumAmplFT0A, ft0geom, fv0geom);
-          helperEP.SumQvectors(0, ft0AchId, ampl / ft0RelGainConst[ft0AchId], nMode, qVecFT0M, sumAmplFT0M, ft0geom, fv0geom);
+          sumChannel(cosPhiFT0, sinPhiFT0, ft0AchId, ampl / ft0RelGainConst[ft0AchId], true);
+          sumAmplFT0A += ampl / ft0RelGainConst[ft0AchId];
+          sumAmplFT0M += ampl / ft0RelGainConst[ft0AchId];
         }
         if (sumAmplFT0A > minAmplitude) {
-          qVectFT0A[0] = qVecDet.Re();
-          qVectFT0A[1] = qVecDet.Im();
+          for (std::size_t iMode = 0; iMode < nModes; iMode++) {
+            qVecRe[iMode * kNDetectors + kFT0A] = qVecDetRe[iMode];
+            qVecIm[iMode * kNDetectors + kFT0A] = qVecDetIm[iMode];
+          }
         }
       }
 
-      if (useDetector["QvectorFT0Cs"]) {
-        qVecDet = TComplex(0., 0.);
+      if (useFT0C) {
+        std::fill(qVecDetRe.begin(), qVecDetRe.end(), 0.);
+        std::fill(qVecDetIm.begin(), qVecDetIm.end(), 0.);
         for (std::size_t iChC = 0; iChC < ft0.channelC().size(); iChC++) {
           float ampl = ft0.amplitudeC()[iChC];
           int ft0CchId = ft0.channelC()[iChC] + 96;
@@ -634,23 +721,26 @@ struct QVectorsTable {
           histosQA.fill(HIST("FT0Amp"), ampl, ft0CchId);
           histosQA.fill(HIST("FT0AmpCor"), ampl / ft0RelGainConst[ft0CchId], ft0CchId);
 
-          helperEP.SumQvectors(0, ft0CchId, ampl / ft0RelGainConst[ft0CchId], nMode, qVecDet, sumAmplFT0C, ft0geom, fv0geom);
-          helperEP.SumQvectors(0, ft0CchId, ampl / ft0RelGainConst[ft0CchId], nMode, qVecFT0M, sumAmplFT0M, ft0geom, fv0geom);
+          sumChannel(cosPhiFT0, sinPhiFT0, ft0CchId, ampl / ft0RelGainConst[ft0CchId], true);
+          sumAmplFT0C += ampl / ft0RelGainConst[ft0CchId];
+          sumAmplFT0M += ampl / ft0RelGainConst[ft0CchId];
         }
 
-        if (sumAmplFT0C > minAmplitude) {
-          qVectFT0C[0] = qVecDet.Re();
-          qVectFT0C[1] = qVecDet.Im();
-        }
-        if (sumAmplFT0M > minAmplitude && useDetector["QvectorFT0Ms"]) {
-          qVectFT0M[0] = qVecFT0M.Re();
-          qVectFT0M[1] = qVecFT0M.Im();
+        for (std::size_t iMode = 0; iMode < nModes; iMode++) {
+          if (sumAmplFT0C > minAmplitude) {
+            qVecRe[iMode * kNDetectors + kFT0C] = qVecDetRe[iMode];
+            qVecIm[iMode * kNDetectors + kFT0C] = qVecDetIm[iMode];
+          }
+          if (sumAmplFT0M > minAmplitude && useFT0M) {
+            qVecRe[iMode * kNDetectors + kFT0M] = qVecFT0MRe[iMode];
+            qVecIm[iMode * kNDetectors + kFT0M] = qVecFT0MIm[iMode];
+          }
         }
       }
 
-      qVecDet = TComplex(0., 0.);
-      sumAmplFV0A = 0;
-      if (coll.has_foundFV0() && useDetector["QvectorFV0As"]) {
+      if (coll.has_foundFV0() && useFV0A) {
+        std::fill(qVecDetRe.begin(), qVecDetRe.end(), 0.);
+        std::fill(qVecDetIm.begin(), qVecDetIm.end(), 0.);
         auto fv0 = coll.foundFV0();
 
         for (std::size_t iCh = 0; iCh < fv0.channel().size(); iCh++) {
@@ -659,12 +749,15 @@ struct QVectorsTable {
           histosQA.fill(HIST("FV0Amp"), ampl, fv0AchId);
           histosQA.fill(HIST("FV0AmpCor"), ampl / fv0RelGainConst[fv0AchId], fv0AchId);
 
-          helperEP.SumQvectors(1, fv0AchId, ampl / fv0RelGainConst[fv0AchId], nMode, qVecDet, sumAmplFV0A, ft0geom, fv0geom);
+          sumChannel(cosPhiFV0, sinPhiFV0, fv0AchId, ampl / fv0RelGainConst[fv0AchId], false);
+          sumAmplFV0A += ampl / fv0RelGainConst[fv0AchId];
         }
 
         if (sumAmplFV0A > minAmplitude) {
-          qVectFV0A[0] = qVecDet.Re();
-          qVectFV0A[1] = qVecDet.Im();
+          for (std::size_t iMode = 0; iMode < nModes; iMode++) {
+            qVecRe[iMode * kNDetectors + kFV0A] = qVecDetRe[iMode];
+            qVecIm[iMode * kNDetectors + kFV0A] = qVecDetIm[iMode];
+          }
         }
       }
     }
@@ -672,6 +765,9 @@ struct QVectorsTable {
     int nTrkTPCPos = 0;
     int nTrkTPCNeg = 0;
     int nTrkTPCAll = 0;
+    std::size_t nLabelsPos = trkTPCPosLabel.size();
+    std::size_t nLabelsNeg = trkTPCNegLabel.size();
+    std::size_t nLabelsAll = trkTPCAllLabel.size();
 
     for (auto const& trk : tracks) {
       if (!selTrack(trk)) {
@@ -684,48 +780,48 @@ struct QVectorsTable {
       if (trk.eta() < cfgEtaMin) {
         continue;
       }
-      qVectTPCAll[0] += trk.pt() * std::cos(trk.phi() * nMode);
-      qVectTPCAll[1] += trk.pt() * std::sin(trk.phi() * nMode);
+      int iDetEta = -1;
+      if (std::abs(trk.eta()) >= trackEtaMin) {
+        if (trk.eta() > 0 && useTPCPos) {
+          iDetEta = kTPCPos;
+          trkTPCPosLabel.push_back(trk.globalIndex());
+          nTrkTPCPos++;
+        } else if (trk.eta() < 0 && useTPCNeg) {
+          iDetEta = kTPCNeg;
+          trkTPCNegLabel.push_back(trk.globalIndex());
+          nTrkTPCNeg++;
+        }
+      }
       trkTPCAllLabel.push_back(trk.globalIndex());
       nTrkTPCAll++;
-      if (std::abs(trk.eta()) < trackEtaMin) {
-        continue;
-      }
-      if (trk.eta() > 0 && (useDetector["QvectorTPCposs"] || useDetector["QvectorBPoss"])) {
-        qVectTPCPos[0] += trk.pt() * std::cos(trk.phi() * nMode);
-        qVectTPCPos[1] += trk.pt() * std::sin(trk.phi() * nMode);
-        trkTPCPosLabel.push_back(trk.globalIndex());
-        nTrkTPCPos++;
-      } else if (trk.eta() < 0 && (useDetector["QvectorTPCnegs"] || useDetector["QvectorBNegs"])) {
-        qVectTPCNeg[0] += trk.pt() * std::cos(trk.phi() * nMode);
-        qVectTPCNeg[1] += trk.pt() * std::sin(trk.phi() * nMode);
-        trkTPCNegLabel.push_back(trk.globalIndex());
-        nTrkTPCNeg++;
+      for (std::size_t iMode = 0; iMode < nModes; iMode++) {
+        int nMode = cfgnMods->at(iMode);
+        float cosNPhi = std::cos(trk.phi() * nMode);
+        float sinNPhi = std::sin(trk.phi() * nMode);
+        qVecRe[iMode * kNDetectors + kTPCAll] += trk.pt() * cosNPhi;
+        qVecIm[iMode * kNDetectors + kTPCAll] += trk.pt() * sinNPhi;
+        if (iDetEta >= 0) {
+          qVecRe[iMode * kNDetectors + iDetEta] += trk.pt() * cosNPhi;
+          qVecIm[iMode * kNDetectors + iDetEta] += trk.pt() * sinNPhi;
+        }
       }
     }
 
-    qVecRe.push_back(qVectFT0C[0]);
-    qVecIm.push_back(qVectFT0C[1]);
-    qVecRe.push_back(qVectFT0A[0]);
-    qVecIm.push_back(qVectFT0A[1]);
-    qVecRe.push_back(qVectFT0M[0]);
-    qVecIm.push_back(qVectFT0M[1]);
-    qVecRe.push_back(qVectFV0A[0]);
-    qVecIm.push_back(qVectFV0A[1]);
-    qVecRe.push_back(qVectTPCPos[0]);
-    qVecIm.push_back(qVectTPCPos[1]);
-    qVecRe.push_back(qVectTPCNeg[0]);
-    qVecIm.push_back(qVectTPCNeg[1]);
-    qVecRe.push_back(qVectTPCAll[0]);
-    qVecIm.push_back(qVectTPCAll[1]);
-
-    qVecAmp.push_back(sumAmplFT0C);
-    qVecAmp.push_back(sumAmplFT0A);
-    qVecAmp.push_back(sumAmplFT0M);
-    qVecAmp.push_back(sumAmplFV0A);
-    qVecAmp.push_back(static_cast<float>(nTrkTPCPos));
-    qVecAmp.push_back(static_cast<float>(nTrkTPCNeg));
-    qVecAmp.push_back(static_cast<float>(nTrkTPCAll));
+    // amplitudes and track labels are stored once per harmonic
+    for (std::size_t iMode = 0; iMode < nModes; iMode++) {
+      qVecAmp.push_back(sumAmplFT0C);
+      qVecAmp.push_back(sumAmplFT0A);
+      qVecAmp.push_back(sumAmplFT0M);
+      qVecAmp.push_back(sumAmplFV0A);
+      qVecAmp.push_back(static_cast<float>(nTrkTPCPos));
+      qVecAmp.push_back(static_cast<float>(nTrkTPCNeg));
+      qVecAmp.push_back(static_cast<float>(nTrkTPCAll));
+    }
+    for (std::size_t iMode = 1; iMode < nModes; iMode++) {
+      trkTPCPosLabel.insert(trkTPCPosLabel.end(), trkTPCPosLabel.begin() + nLabelsPos, trkTPCPosLabel.begin() + nLabelsPos + nTrkTPCPos);
+      trkTPCNegLabel.insert(trkTPCNegLabel.end(), trkTPCNegLabel.begin() + nLabelsNeg, trkTPCNegLabel.begin() + nLabelsNeg + nTrkTPCNeg);
+      trkTPCAllLabel.insert(trkTPCAllLabel.end(), trkTPCAllLabel.begin() + nLabelsAll, trkTPCAllLabel.begin() + nLabelsAll + nTrkTPCAll);
+    }
   }
 
   void process(MyCollisions::iterator const& coll, aod::BCsWithTimestamps const&, aod::FT0s const&, aod::FV0As const&, MyTracks const& tracks)
@@ -786,19 +882,22 @@ struct QVectorsTable {
       isCalibrated = false;
     }
 
+    // Raw Q-vectors of all harmonics, no multiplicity normalization and no corrections
+    std::vector<float> qVecReAllModes{};
+    std::vector<float> qVecImAllModes{};
+    calcQVecs(coll, tracks, qVecReAllModes, qVecImAllModes, qVecAmp, trkTPCPosLabel, trkTPCNegLabel, trkTPCAllLabel);
+
     for (std::size_t id = 0; id < cfgnMods->size(); id++) {
       int nMode = cfgnMods->at(id);
 
-      // Raw Q-vectors, no multiplicity normalization and no corrections
-      std::vector<float> qVecReRaw{};
-      std::vector<float> qVecImRaw{};
-      calcQVec(nMode, coll, tracks, qVecReRaw, qVecImRaw, qVecAmp, trkTPCPosLabel, trkTPCNegLabel, trkTPCAllLabel);
+      std::vector<float> qVecReRaw(qVecReAllModes.begin() + id * kNDetectors, qVecReAllModes.begin() + (id + 1) * kNDetectors);
+      std::vector<float> qVecImRaw(qVecImAllModes.begin() + id * kNDetectors, qVecImAllModes.begin() + (id + 1) * kNDetectors);
 
       // Scalar Product Q-vectors, normalization by multiplicity/amplitude
       std::vector<float> nModeQVecReSp{};
       std::vector<float> nModeQVecImSp{};
       normalizeQVec(nModeQVecReSp, nModeQVecImSp, qVecReRaw, qVecImRaw, qVecAmp, MultNorms::kScalarProd);
-      correctQVec(cent, nModeQVecReSp, nModeQVecImSp, corrsQvecSp[id], shiftProfileSp, nMode);
+      correctQVec(cent, nModeQVecReSp, nModeQVecImSp, corrsQvecSpFlat[id], shiftsSp, nMode);
       // Add to summary vector
       qVecReSp.insert(qVecReSp.end(), nModeQVecReSp.begin(), nModeQVecReSp.end());
       qVecImSp.insert(qVecImSp.end(), nModeQVecImSp.begin(), nModeQVecImSp.end());
@@ -828,7 +927,7 @@ struct QVectorsTable {
         std::vector<float> nModeQVecReEse{};
         std::vector<float> nModeQVecImEse{};
         normalizeQVec(nModeQVecReEse, nModeQVecImEse, qVecReRaw, qVecImRaw, qVecAmp, MultNorms::kEsE);
-        correctQVec(cent, nModeQVecReEse, nModeQVecImEse, corrsQvecEse[id], shiftProfileEse, nMode);
+        correctQVec(cent, nModeQVecReEse, nModeQVecImEse, corrsQvecEseFlat[id], shiftsEse, nMode);
         // Add to summary vector
         qVecReEse.insert(qVecReEse.end(), nModeQVecReEse.begin(), nModeQVecReEse.end());
         qVecImEse.insert(qVecImEse.end(), nModeQVecImEse.begin(), nModeQVecImEse.end());
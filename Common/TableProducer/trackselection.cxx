@@ -31,6 +31,8 @@
 #include <Framework/InitContext.h>
 #include <Framework/runDataProcessing.h>
 
+#include <array>
+#include <cstddef>
 #include <cstdint>
 
 using namespace o2;
@@ -144,71 +146,56 @@ struct TrackSelectionTask {
     filtBit5 = getJEGlobalTrackSelectionRun2(); // Jet validation requires reduced set of cuts
   }
 
-  void process(soa::Join<aod::FullTracks, aod::TracksDCA> const& tracks)
+  // tracks gathered column-wise and the selection masks of each selection for the current block
+  TrackSelection::TrackBlock trackBlock;
+  std::array<uint16_t, TrackSelection::TrackBlock::Size> masksGlob{};
+  std::array<uint16_t, TrackSelection::TrackBlock::Size> masksSDD{};
+  std::array<uint16_t, TrackSelection::TrackBlock::Size> masksFB1{};
+  std::array<uint16_t, TrackSelection::TrackBlock::Size> masksFB2{};
+  std::array<uint16_t, TrackSelection::TrackBlock::Size> masksFB3{};
+  std::array<uint16_t, TrackSelection::TrackBlock::Size> masksFB4{};
+  std::array<uint16_t, TrackSelection::TrackBlock::Size> masksFB5{};
+
+  /// Evaluate all the selections on the current block of tracks and fill the tables, in the order of the tracks
+  void processBlock()
   {
-    if (produceTable == 1) {
-      filterTable.reserve(tracks.size());
-    }
-    if (produceFBextendedTable == 1) {
-      filterTableDetail.reserve(tracks.size());
-    }
-    if (produceTable == 0 && produceFBextendedTable == 0) {
+    if (trackBlock.empty()) {
       return;
     }
-    if (isRun3) {
-      for (const auto& track : tracks) {
-
-        if (produceTable == 1) {
-          filterTable((uint8_t)0,
-                      globalTracks.IsSelectedMask(track),
-                      filtBit1.IsSelected(track),
-                      filtBit2.IsSelected(track),
-                      filtBit3.IsSelected(track),
-                      filtBit4.IsSelected(track),
-                      filtBit5.IsSelected(track));
-        }
-        if (produceFBextendedTable == 1) {
-          o2::aod::track::TrackSelectionFlags::flagtype trackflagGlob = globalTracks.IsSelectedMask(track);
-          o2::aod::track::TrackSelectionFlags::flagtype trackflagFB1 = filtBit1.IsSelectedMask(track);
-          o2::aod::track::TrackSelectionFlags::flagtype trackflagFB2 = filtBit2.IsSelectedMask(track);
-          // o2::aod::track::TrackSelectionFlags::flagtype trackflagFB3 = filtBit3.IsSelectedMask(track); // only temporarily commented, will be used
-          // o2::aod::track::TrackSelectionFlags::flagtype trackflagFB4 = filtBit4.IsSelectedMask(track);
-          // o2::aod::track::TrackSelectionFlags::flagtype trackflagFB5 = filtBit5.IsSelectedMask(track);
-
-          filterTableDetail(o2::aod::track::TrackSelectionFlags::checkFlag(trackflagGlob, o2::aod::track::TrackSelectionFlags::kTrackType),
-                            o2::aod::track::TrackSelectionFlags::checkFlag(trackflagGlob, o2::aod::track::TrackSelectionFlags::kPtRange),
-                            o2::aod::track::TrackSelectionFlags::checkFlag(trackflagGlob, o2::aod::track::TrackSelectionFlags::kEtaRange),
-                            o2::aod::track::TrackSelectionFlags::checkFlag(trackflagGlob, o2::aod::track::TrackSelectionFlags::kTPCNCls),
-                            o2::aod::track::TrackSelectionFlags::checkFlag(trackflagGlob, o2::aod::track::TrackSelectionFlags::kTPCCrossedRows),
-                            o2::aod::track::TrackSelectionFlags::checkFlag(trackflagGlob, o2::aod::track::TrackSelectionFlags::kTPCCrossedRowsOverNCls),
-                            o2::aod::track::TrackSelectionFlags::checkFlag(trackflagGlob, o2::aod::track::TrackSelectionFlags::kTPCChi2NDF),
-                            o2::aod::track::TrackSelectionFlags::checkFlag(trackflagGlob, o2::aod::track::TrackSelectionFlags::kTPCRefit),
-                            o2::aod::track::TrackSelectionFlags::checkFlag(trackflagGlob, o2::aod::track::TrackSelectionFlags::kITSNCls),
-                            o2::aod::track::TrackSelectionFlags::checkFlag(trackflagGlob, o2::aod::track::TrackSelectionFlags::kITSChi2NDF),
-                            o2::aod::track::TrackSelectionFlags::checkFlag(trackflagGlob, o2::aod::track::TrackSelectionFlags::kITSRefit),
-                            o2::aod::track::TrackSelectionFlags::checkFlag(trackflagGlob, o2::aod::track::TrackSelectionFlags::kITSHits),
-                            o2::aod::track::TrackSelectionFlags::checkFlag(trackflagGlob, o2::aod::track::TrackSelectionFlags::kGoldenChi2),
-                            o2::aod::track::TrackSelectionFlags::checkFlag(trackflagGlob, o2::aod::track::TrackSelectionFlags::kDCAxy),
-                            o2::aod::track::TrackSelectionFlags::checkFlag(trackflagGlob, o2::aod::track::TrackSelectionFlags::kDCAz),
-                            o2::aod::track::TrackSelectionFlags::checkFlag(trackflagFB1, o2::aod::track::TrackSelectionFlags::kITSHits),
-                            o2::aod::track::TrackSelectionFlags::checkFlag(trackflagFB2, o2::aod::track::TrackSelectionFlags::kITSHits));
-        }
+    const auto isSelected = [](uint16_t mask) { return mask == TrackSelection::AllCutsMask; };
+
+    globalTracks.IsSelectedMask(trackBlock, masksGlob.data());
+    if (produceTable == 1 || (isRun3 && produceFBextendedTable == 1)) {
+      filtBit1.IsSelectedMask(trackBlock, masksFB1.data());
+      filtBit2.IsSelectedMask(trackBlock, masksFB2.data());
+    }
+    if (produceTable == 1) {
+      filtBit3.IsSelectedMask(trackBlock, masksFB3.data());
+      filtBit4.IsSelectedMask(trackBlock, masksFB4.data());
+      filtBit5.IsSelectedMask(trackBlock, masksFB5.data());
+      if (!isRun3) {
+        globalTracksSDD.IsSelectedMask(trackBlock, masksSDD.data());
       }
-      return;
     }
 
-    for (const auto& track : tracks) {
-      o2::aod::track::TrackSelectionFlags::flagtype trackflagGlob = globalTracks.IsSelectedMask(track);
+    for (std::size_t i = 0; i < trackBlock.size(); ++i) {
+      const o2::aod::track::TrackSelectionFlags::flagtype trackflagGlob = masksGlob[i];
       if (produceTable == 1) {
-        filterTable((uint8_t)globalTracksSDD.IsSelected(track),
-                    globalTracks.IsSelectedMask(track),
-                    filtBit1.IsSelected(track),
-                    filtBit2.IsSelected(track),
-                    filtBit3.IsSelected(track),
-                    filtBit4.IsSelected(track),
-                    filtBit5.IsSelected(track));
+        filterTable(static_cast<uint8_t>(isRun3 ? false : isSelected(masksSDD[i])),
+                    trackflagGlob,
+                    isSelected(masksFB1[i]),
+                    isSelected(masksFB2[i]),
+                    isSelected(masksFB3[i]),
+                    isSelected(masksFB4[i]),
+                    isSelected(masksFB5[i]));
       }
       if (produceFBextendedTable == 1) {
+        bool itsHitsFB1 = false;
+        bool itsHitsFB2 = false;
+        if (isRun3) {
+          itsHitsFB1 = o2::aod::track::TrackSelectionFlags::checkFlag(masksFB1[i], o2::aod::track::TrackSelectionFlags::kITSHits);
+          itsHitsFB2 = o2::aod::track::TrackSelectionFlags::checkFlag(masksFB2[i], o2::aod::track::TrackSelectionFlags::kITSHits);
+        }
         filterTableDetail(o2::aod::track::TrackSelectionFlags::checkFlag(trackflagGlob, o2::aod::track::TrackSelectionFlags::kTrackType),
                           o2::aod::track::TrackSelectionFlags::checkFlag(trackflagGlob, o2::aod::track::TrackSelectionFlags::kPtRange),
                           o2::aod::track::TrackSelectionFlags::checkFlag(trackflagGlob, o2::aod::track::TrackSelectionFlags::kEtaRange),
@@ -224,10 +211,33 @@ struct TrackSelectionTask {
                           o2::aod::track::TrackSelectionFlags::checkFlag(trackflagGlob, o2::aod::track::TrackSelectionFlags::kGoldenChi2),
                           o2::aod::track::TrackSelectionFlags::checkFlag(trackflagGlob, o2::aod::track::TrackSelectionFlags::kDCAxy),
                           o2::aod::track::TrackSelectionFlags::checkFlag(trackflagGlob, o2::aod::track::TrackSelectionFlags::kDCAz),
-                          0,
-                          0);
+                          itsHitsFB1,
+                          itsHitsFB2);
+      }
+    }
+    trackBlock.clear();
+  }
+
+  void process(soa::Join<aod::FullTracks, aod::TracksDCA> const& tracks)
+  {
+    if (produceTable == 1) {
+      filterTable.reserve(tracks.size());
+    }
+    if (produceFBextendedTable == 1) {
+      filterTableDetail.reserve(tracks.size());
+    }
+    if (produceTable == 0 && produceFBextendedTable == 0) {
+      return;
+    }
+    // the selections are evaluated column-wise on blocks of tracks, see TrackSelection::IsSelectedMask(TrackBlock const&, ...)
+    trackBlock.clear();
+    for (const auto& track : tracks) {
+      trackBlock.fill(track);
+      if (trackBlock.full()) {
+        processBlock();
       }
     }
+    processBlock();
   }
 };
 
@@ -18,6 +18,7 @@
 
 #include "Common/CCDB/EventSelectionParams.h"
 #include "Common/CCDB/RCTSelectionFlags.h"
+#include "Common/CCDB/RunConditions.h"
 #include "Common/CCDB/TriggerAliases.h"
 #include "Common/Core/TableHelper.h"
 #include "Common/DataModel/EventSelection.h"
@@ -49,6 +50,7 @@
 #include <algorithm>
 #include <bitset>
 #include <cmath>
+#include <cstddef>
 #include <cstdint>
 #include <cstdlib>
 #include <iterator>
@@ -164,13 +166,12 @@ class BcSelectionModule
 
   TriggerAliases* aliases = nullptr;
   EventSelectionParams* par = nullptr;
-  std::map<uint64_t, uint32_t>* mapRCT = nullptr;
-  std::map<int64_t, std::vector<int16_t>> mapInactiveChips; // number of inactive chips vs orbit per layer
-  int64_t prevOrbitForInactiveChips = 0;                    // cached next stored orbit in the inactive chip map
-  int64_t nextOrbitForInactiveChips = 0;                    // cached previous stored orbit in the inactive chip map
-  bool isGoodITSLayer3 = true;                              // default value
-  bool isGoodITSLayer0123 = true;                           // default value
-  bool isGoodITSLayersAll = true;                           // default value
+  o2::aod::rctsel::RunConditions* runConditions = nullptr;   // rct flags and number of inactive chips vs orbit per layer, shared in the device
+  int64_t prevOrbitForInactiveChips = 0;                     // cached previous stored orbit in the inactive chip table
+  int64_t nextOrbitForInactiveChips = 0;                     // cached next stored orbit in the inactive chip table
+  bool isGoodITSLayer3 = true;                               // default value
+  bool isGoodITSLayer0123 = true;                            // default value
+  bool isGoodITSLayersAll = true;                            // default value
 
   template <typename TContext, typename TBcSelOpts, typename THistoRegistry, typename TMetadataInfo>
   void init(TContext& context, TBcSelOpts const& external_bcselopts, THistoRegistry& histos, TMetadataInfo const& metadataInfo)
@@ -255,52 +256,74 @@ class BcSelectionModule
       // Trigger aliases
       aliases = ccdb->template getForTimeStamp<TriggerAliases>("EventSelection/TriggerAliases", ts);
 
-      // prepare map of inactive chips
-      auto itsDeadMap = ccdb->template getForTimeStamp<o2::itsmft::TimeDeadMap>("ITS/Calib/TimeDeadMap", ts);
-      auto itsDeadMapOrbits = itsDeadMap->getEvolvingMapKeys(); // roughly every second, ~350 TFs = 350x32 orbits
-      std::vector<uint16_t> vClosest;                           // temporary vector of inactive chip ids for the current orbit range
-      for (const auto& orbit : itsDeadMapOrbits) {
-        itsDeadMap->getMapAtOrbit(orbit, vClosest);
-        // insert initial (orbit,vector) pair for each layer
-        mapInactiveChips[orbit].resize(o2::itsmft::ChipMappingITS::NLayers, 0);
-
-        // fill map of inactive chips
-        for (size_t iel = 0; iel < vClosest.size(); iel++) {
-          uint16_t w1 = vClosest[iel];
-          bool isLastInSequence = (w1 & 0x8000) == 0;
-          uint16_t w2 = isLastInSequence ? w1 + 1 : vClosest[iel + 1];
-          uint16_t chipId1 = w1 & 0x7FFF;
-          uint16_t chipId2 = w2 & 0x7FFF;
-          for (int chipId = chipId1; chipId < chipId2; chipId++) {
-            auto layer = o2::itsmft::ChipMappingITS::getLayer(chipId);
-            mapInactiveChips[orbit][layer]++;
-          }
-        } // loop over vector of inactive chip ids
-      } // loop over orbits
-
-      // QC info
-      std::map<std::string, std::string> metadata;
-      metadata["run"] = Form("%d", run);
-      metadata["passName"] = strPassName;
-      LOGP(info, "accessing pass-specific rct object for run={} and passName={} from ccdb", run, strPassName);
-      ccdb->setFatalWhenNull(0);
-      mapRCT = ccdb->template getSpecific<std::map<uint64_t, uint32_t>>("RCT/Flags/RunFlags", ts, metadata);
-      if (mapRCT == nullptr) {
-        LOGP(info, "pass-specific rct object missing... trying the latest");
-        metadata.erase("passName");
-        mapRCT = ccdb->template getSpecific<std::map<uint64_t, uint32_t>>("RCT/Flags/RunFlags", ts, metadata);
-      }
-      ccdb->setFatalWhenNull(1);
-      if (mapRCT == nullptr) {
-        LOGP(info, "rct object missing... inserting dummy rct flags");
-        mapRCT = new std::map<uint64_t, uint32_t>;
-        uint32_t dummyValue = 1u << 31; // setting bit 31 to indicate that rct object is missing
-        mapRCT->insert(std::pair<uint64_t, uint32_t>(sorTimestamp, dummyValue));
+      // run conditions are prepared once per run and shared by the users in the device
+      runConditions = &o2::aod::rctsel::RunConditionsService::get(run);
+      prevOrbitForInactiveChips = 0;
+      nextOrbitForInactiveChips = 0;
+      lastTF = -1;
+      if (!runConditions->isFilled) {
+        fillRunConditions(ccdb, run, ts);
       }
     }
     return true;
   }
 
+  //__________________________________________________
+  template <typename TCCDB>
+  void fillRunConditions(TCCDB& ccdb, int run, int64_t ts)
+  {
+    // prepare table of inactive chips
+    auto& inactiveChips = runConditions->inactiveChips;
+    inactiveChips.clear();
+    inactiveChips.setNLayers(o2::itsmft::ChipMappingITS::NLayers);
+    auto itsDeadMap = ccdb->template getForTimeStamp<o2::itsmft::TimeDeadMap>("ITS/Calib/TimeDeadMap", ts);
+    auto itsDeadMapOrbits = itsDeadMap->getEvolvingMapKeys(); // roughly every second, ~350 TFs = 350x32 orbits
+    std::sort(itsDeadMapOrbits.begin(), itsDeadMapOrbits.end());
+    std::vector<uint16_t> vClosest; // temporary vector of inactive chip ids for the current orbit range
+    for (const auto& orbit : itsDeadMapOrbits) {
+      itsDeadMap->getMapAtOrbit(orbit, vClosest);
+      // insert initial entry for each orbit
+      if (inactiveChips.size() == 0 || static_cast<int64_t>(orbit) != inactiveChips.getOrbit(inactiveChips.size() - 1)) {
+        inactiveChips.addOrbit(orbit);
+      }
+
+      // fill table of inactive chips
+      for (size_t iel = 0; iel < vClosest.size(); iel++) {
+        uint16_t w1 = vClosest[iel];
+        bool isLastInSequence = (w1 & 0x8000) == 0;
+        uint16_t w2 = isLastInSequence ? w1 + 1 : vClosest[iel + 1];
+        uint16_t chipId1 = w1 & 0x7FFF;
+        uint16_t chipId2 = w2 & 0x7FFF;
+        for (int chipId = chipId1; chipId < chipId2; chipId++) {
+          inactiveChips.addInactiveChip(o2::itsmft::ChipMappingITS::getLayer(chipId));
+        }
+      } // loop over vector of inactive chip ids
+    } // loop over orbits
+
+    // QC info
+    std::map<std::string, std::string> metadata;
+    metadata["run"] = Form("%d", run);
+    metadata["passName"] = strPassName;
+    LOGP(info, "accessing pass-specific rct object for run={} and passName={} from ccdb", run, strPassName);
+    ccdb->setFatalWhenNull(0);
+    auto mapRCT = ccdb->template getSpecific<std::map<uint64_t, uint32_t>>("RCT/Flags/RunFlags", ts, metadata);
+    if (mapRCT == nullptr) {
+      LOGP(info, "pass-specific rct object missing... trying the latest");
+      metadata.erase("passName");
+      mapRCT = ccdb->template getSpecific<std::map<uint64_t, uint32_t>>("RCT/Flags/RunFlags", ts, metadata);
+    }
+    ccdb->setFatalWhenNull(1);
+    if (mapRCT != nullptr) {
+      runConditions->rctFlags.fill(*mapRCT);
+    } else {
+      LOGP(info, "rct object missing... inserting dummy rct flags");
+      runConditions->rctFlags.clear();
+      uint32_t dummyValue = 1u << 31; // setting bit 31 to indicate that rct object is missing
+      runConditions->rctFlags.add(sorTimestamp, dummyValue);
+    }
+    runConditions->isFilled = true;
+  }
+
   //__________________________________________________
   template <typename TCCDB, typename TBCs, typename TTimestamps, typename TBcSelBuffer, typename TBcSelCursor>
   void processRun2(TCCDB const& ccdb, TBCs const& bcs, TTimestamps const& timestamps, TBcSelBuffer& bcselbuffer, TBcSelCursor& bcsel)
@@ -461,11 +484,8 @@ class BcSelectionModule
       // store rct flags
       uint32_t rct = lastRCT;
       int64_t thisTF = (bc.globalBC() - bcSOR) / nBCsPerTF;
-      if (mapRCT != nullptr && thisTF != lastTF) { // skip for unanchored runs; do it once per TF
-        auto itrct = mapRCT->upper_bound(timestamp);
-        if (itrct != mapRCT->begin())
-          itrct--;
-        rct = itrct->second;
+      if (runConditions != nullptr && thisTF != lastTF) { // do it once per TF
+        rct = runConditions->rctFlags.get(timestamp);
         LOGP(debug, "sor={} eor={} ts={} rct={}", sorTimestamp, eorTimestamp, timestamp, rct);
         lastRCT = rct;
         lastTF = thisTF;
@@ -552,28 +572,27 @@ class BcSelectionModule
 
       // check number of inactive chips and set kIsGoodITSLayer3, kIsGoodITSLayer0123, kIsGoodITSLayersAll flags
       int64_t orbit = globalBC / nBCsPerOrbit;
-      if (mapInactiveChips.size() > 0 && (orbit < prevOrbitForInactiveChips || orbit > nextOrbitForInactiveChips)) {
-        auto it = mapInactiveChips.upper_bound(orbit);
-        bool isEnd = (it == mapInactiveChips.end());
+      const auto* inactiveChips = runConditions != nullptr ? &runConditions->inactiveChips : nullptr;
+      if (inactiveChips != nullptr && inactiveChips->size() > 0 && (orbit < prevOrbitForInactiveChips || orbit > nextOrbitForInactiveChips)) {
+        std::size_t iNext = inactiveChips->upperBound(orbit);
+        bool isEnd = (iNext == inactiveChips->size());
         if (isEnd)
-          it--;
-        nextOrbitForInactiveChips = isEnd ? orbit : it->first; // setting current orbit in case we reached the end of mapInactiveChips
-        auto vNextInactiveChips = it->second;
-        if (it != mapInactiveChips.begin() && !isEnd)
-          it--;
-        prevOrbitForInactiveChips = it->first;
-        auto vPrevInactiveChips = it->second;
+          iNext--;
+        nextOrbitForInactiveChips = isEnd ? orbit : inactiveChips->getOrbit(iNext); // setting current orbit in case we reached the end of the table
+        std::size_t iPrev = (iNext > 0 && !isEnd) ? iNext - 1 : iNext;
+        prevOrbitForInactiveChips = inactiveChips->getOrbit(iPrev);
         LOGP(debug, "orbit: {}, previous orbit: {}, next orbit: {} ", orbit, prevOrbitForInactiveChips, nextOrbitForInactiveChips);
-        LOGP(debug, "next inactive chips: {} {} {} {} {} {} {}", vNextInactiveChips[0], vNextInactiveChips[1], vNextInactiveChips[2], vNextInactiveChips[3], vNextInactiveChips[4], vNextInactiveChips[5], vNextInactiveChips[6]);
-        LOGP(debug, "prev inactive chips: {} {} {} {} {} {} {}", vPrevInactiveChips[0], vPrevInactiveChips[1], vPrevInactiveChips[2], vPrevInactiveChips[3], vPrevInactiveChips[4], vPrevInactiveChips[5], vPrevInactiveChips[6]);
-        isGoodITSLayer3 = vPrevInactiveChips[3] <= bcselOpts.confMaxInactiveChipsPerLayer->at(3) && vNextInactiveChips[3] <= bcselOpts.confMaxInactiveChipsPerLayer->at(3);
+        auto isGoodLayer = [&](int layer) {
+          return inactiveChips->getInactiveChips(layer, iPrev) <= bcselOpts.confMaxInactiveChipsPerLayer->at(layer) && inactiveChips->getInactiveChips(layer, iNext) <= bcselOpts.confMaxInactiveChipsPerLayer->at(layer);
+        };
+        isGoodITSLayer3 = isGoodLayer(3);
         isGoodITSLayer0123 = true;
         for (int i = 0; i < 4; i++) { // o2-linter: disable=magic-number (counting first 4 ITS layers)
-          isGoodITSLayer0123 &= vPrevInactiveChips[i] <= bcselOpts.confMaxInactiveChipsPerLayer->at(i) && vNextInactiveChips[i] <= bcselOpts.confMaxInactiveChipsPerLayer->at(i);
+          isGoodITSLayer0123 &= isGoodLayer(i);
         }
         isGoodITSLayersAll = true;
         for (int i = 0; i < o2::itsmft::ChipMappingITS::NLayers; i++) {
-          isGoodITSLayersAll &= vPrevInactiveChips[i] <= bcselOpts.confMaxInactiveChipsPerLayer->at(i) && vNextInactiveChips[i] <= bcselOpts.confMaxInactiveChipsPerLayer->at(i);
+          isGoodITSLayersAll &= isGoodLayer(i);
         }
       }
 
@@ -615,6 +634,114 @@ class BcSelectionModule
   } // end processRun3
 }; // end BcSelectionModule
 
+// Flat index of the TVX-fired bcs of a dataframe, sorted in globalBC.
+// Replaces per-dataframe std::map<globalBC, ...> lookups: entries are contiguous,
+// and bcs taken out of the matching pool are marked in a bitmap instead of being erased
+class BcIndex
+{
+ public:
+  static constexpr int NotFound = -1;
+
+  void clear()
+  {
+    mGlobalBCs.clear();
+    mBCindices.clear();
+    mVtxZ.clear();
+    mRemoved.clear();
+    mIsSorted = true;
+  }
+
+  void reserve(size_t n)
+  {
+    mGlobalBCs.reserve(n);
+    mBCindices.reserve(n);
+    mVtxZ.reserve(n);
+  }
+
+  // entries are expected in increasing globalBC; a repeated globalBC overwrites the previous entry
+  void add(int64_t globalBC, int32_t bcIndex, float vtxZ)
+  {
+    if (!mGlobalBCs.empty() && globalBC <= mGlobalBCs.back()) {
+      if (globalBC == mGlobalBCs.back()) {
+        mBCindices.back() = bcIndex;
+        mVtxZ.back() = vtxZ;
+        return;
+      }
+      mIsSorted = false;
+    }
+    mGlobalBCs.push_back(globalBC);
+    mBCindices.push_back(bcIndex);
+    mVtxZ.push_back(vtxZ);
+  }
+
+  // to be called once all entries are added
+  void finalize()
+  {
+    if (!mIsSorted) {
+      std::vector<int> order(mGlobalBCs.size());
+      std::iota(order.begin(), order.end(), 0);
+      std::stable_sort(order.begin(), order.end(), [&](int a, int b) { return mGlobalBCs[a] < mGlobalBCs[b]; });
+      std::vector<int64_t> globalBCs;
+      std::vector<int32_t> bcIndices;
+      std::vector<float> vtxZ;
+      for (const auto& i : order) {
+        if (!globalBCs.empty() && globalBCs.back() == mGlobalBCs[i]) { // keep the last one, as std::map::operator[] would
+          bcIndices.back() = mBCindices[i];
+          vtxZ.back() = mVtxZ[i];
+          continue;
+        }
+        globalBCs.push_back(mGlobalBCs[i]);
+        bcIndices.push_back(mBCindices[i]);
+        vtxZ.push_back(mVtxZ[i]);
+      }
+      mGlobalBCs.swap(globalBCs);
+      mBCindices.swap(bcIndices);
+      mVtxZ.swap(vtxZ);
+      mIsSorted = true;
+    }
+    mRemoved.assign((mGlobalBCs.size() + 63) / 64, 0);
+  }
+
+  int size() const { return mGlobalBCs.size(); }
+  bool empty() const { return mGlobalBCs.empty(); }
+  int64_t globalBC(int pos) const { return mGlobalBCs[pos]; }
+  int32_t bcIndex(int pos) const { return mBCindices[pos]; }
+  float vtxZ(int pos) const { return mVtxZ[pos]; }
+
+  // first position with globalBC >= the given one
+  int lowerBound(int64_t globalBC) const
+  {
+    return std::lower_bound(mGlobalBCs.begin(), mGlobalBCs.end(), globalBC) - mGlobalBCs.begin();
+  }
+  // first position with globalBC > the given one
+  int upperBound(int64_t globalBC) const
+  {
+    return std::upper_bound(mGlobalBCs.begin(), mGlobalBCs.end(), globalBC) - mGlobalBCs.begin();
+  }
+  int find(int64_t globalBC) const
+  {
+    int pos = lowerBound(globalBC);
+    return (pos < size() && mGlobalBCs[pos] == globalBC) ? pos : NotFound;
+  }
+
+  // matching pool: entries not yet taken by a collision
+  bool isRemoved(int pos) const { return (mRemoved[pos >> 6] >> (pos & 63)) & 1; }
+  void remove(int64_t globalBC)
+  {
+    int pos = find(globalBC);
+    if (pos != NotFound) {
+      mRemoved[pos >> 6] |= static_cast<uint64_t>(1) << (pos & 63);
+    }
+  }
+
+ private:
+  std::vector<int64_t> mGlobalBCs;
+  std::vector<int32_t> mBCindices;
+  std::vector<float> mVtxZ;
+  std::vector<uint64_t> mRemoved; // tombstone bitmap
+  bool mIsSorted = true;
+};
+
 class EventSelectionModule
 {
  public:
@@ -639,16 +766,17 @@ class EventSelectionModule
   int runListLightIons[11] = {564356, 564359, 564373, 564374, 564387, 564400, 564414, 564430, 564445, 564468, 564472};
   std::vector<float> diffVzParMean;  // parameterization for mean of diff vZ by FT0 vs by tracks
   std::vector<float> diffVzParSigma; // parameterization for stddev of diff vZ by FT0 vs by tracks
+  BcIndex bcIndexTVX;                // TVX-fired bcs of the current dataframe, reused across dataframes
 
-  int32_t findClosest(const int64_t globalBC, const std::map<int64_t, int32_t>& bcs)
+  int32_t findClosest(const int64_t globalBC, const BcIndex& bcs)
   {
-    auto it = bcs.lower_bound(globalBC);
-    int64_t bc1 = it->first;
-    int32_t index1 = it->second;
-    if (it != bcs.begin())
-      --it;
-    int64_t bc2 = it->first;
-    int32_t index2 = it->second;
+    int pos = std::min(bcs.lowerBound(globalBC), bcs.size() - 1);
+    int64_t bc1 = bcs.globalBC(pos);
+    int32_t index1 = bcs.bcIndex(pos);
+    if (pos > 0)
+      --pos;
+    int64_t bc2 = bcs.globalBC(pos);
+    int32_t index2 = bcs.bcIndex(pos);
     int64_t dbc1 = std::abs(bc1 - globalBC);
     int64_t dbc2 = std::abs(bc2 - globalBC);
     return (dbc1 <= dbc2) ? index1 : index2;
@@ -663,7 +791,8 @@ class EventSelectionModule
   }
 
   // helper function to find closest TVX signal in time and in zVtx
-  int64_t findBestGlobalBC(int64_t meanBC, int64_t sigmaBC, int32_t nContrib, float zVtxCol, std::map<int64_t, float>& mapGlobalBcVtxZ)
+  // only the bcs still in the matching pool of bcIndex are considered
+  int64_t findBestGlobalBC(int64_t meanBC, int64_t sigmaBC, int32_t nContrib, float zVtxCol, const BcIndex& bcIndex)
   {
     // protection against
     if (sigmaBC < 1)
@@ -676,16 +805,18 @@ class EventSelectionModule
     float zVtxSigma = 2.7 * std::pow(nContrib, -0.466) + 0.024;
     zVtxSigma += 1.0; // additional uncertainty due to imperfectections of FT0 time calibration
 
-    auto itMin = mapGlobalBcVtxZ.lower_bound(minBC);
-    auto itMax = mapGlobalBcVtxZ.upper_bound(maxBC);
+    int posMin = bcIndex.lowerBound(minBC);
+    int posMax = bcIndex.upperBound(maxBC);
 
     float bestChi2 = 1e+10;
     int64_t bestGlobalBC = 0;
-    for (std::map<int64_t, float>::iterator it = itMin; it != itMax; ++it) {
-      float chi2 = std::pow((it->second - zVtxCol) / zVtxSigma, 2) + std::pow(static_cast<float>(it->first - meanBC) / sigmaBC, 2.);
+    for (int pos = posMin; pos < posMax; pos++) {
+      if (bcIndex.isRemoved(pos))
+        continue;
+      float chi2 = std::pow((bcIndex.vtxZ(pos) - zVtxCol) / zVtxSigma, 2) + std::pow(static_cast<float>(bcIndex.globalBC(pos) - meanBC) / sigmaBC, 2.);
       if (chi2 < bestChi2) {
         bestChi2 = chi2;
-        bestGlobalBC = it->first;
+        bestGlobalBC = bcIndex.globalBC(pos);
       }
     }
 
@@ -898,11 +1029,10 @@ class EventSelectionModule
       return; // don't do anything in case configuration reported not ok
 
     int run = bcs.iteratorAt(0).runNumber();
-    // create maps from globalBC to bc index for TVX-fired bcs
+    // create index from globalBC to bc index and FT0 vertex for TVX-fired bcs
     // to be used for closest TVX searches
-    std::map<int64_t, int32_t> mapGlobalBcWithTVX;
-    std::map<int64_t, int32_t> mapGlobalBcWithOrInFT0;
-    std::map<int64_t, float> mapGlobalBcVtxZ;
+    bcIndexTVX.clear();
+    bcIndexTVX.reserve(bcs.size());
     for (const auto& bc : bcs) {
       int64_t globalBC = bc.globalBC();
       // skip non-colliding bcs for data and anchored runs
@@ -910,19 +1040,15 @@ class EventSelectionModule
         continue;
       }
 
-      if (bc.has_ft0()) {
-        mapGlobalBcWithOrInFT0[globalBC] = bc.globalIndex();
-      }
-
       auto selection = bcselbuffer[bc.globalIndex()].selection;
       if (BITCHECK64(selection, aod::evsel::kIsTriggerTVX)) {
-        mapGlobalBcWithTVX[globalBC] = bc.globalIndex();
-        mapGlobalBcVtxZ[globalBC] = bc.has_ft0() ? bc.ft0().posZ() : 0;
+        bcIndexTVX.add(globalBC, bc.globalIndex(), bc.has_ft0() ? bc.ft0().posZ() : 0);
       }
     }
+    bcIndexTVX.finalize();
 
     // protection against empty FT0 maps
-    if (mapGlobalBcWithTVX.size() == 0) {
+    if (bcIndexTVX.empty()) {
       LOGP(error, "FT0 table is empty or corrupted. Filling evsel table with dummy values");
       for (const auto& col : cols) {
         auto bc = col.template bc_as<soa::Join<aod::BCs, aod::Run3MatchedToBCSparse>>();
@@ -1032,19 +1158,19 @@ class EventSelectionModule
 
         // matched with TOF --> precise time, match to TVX, but keep the nominal foundGlobalBC from pattern
         if (vIsVertexTOFmatched[colIndex]) {
-          std::map<int64_t, int32_t>::iterator it = mapGlobalBcWithTVX.find(foundGlobalBC);
-          if (it != mapGlobalBcWithTVX.end()) {
-            foundBCindex = it->second;                       // TVX at foundGlobalBC is found
-          } else {                                           // check if TVX is in nearby bcs
-            it = mapGlobalBcWithTVX.find(foundGlobalBC + 1); // next bc
-            if (it != mapGlobalBcWithTVX.end()) {
+          int pos = bcIndexTVX.find(foundGlobalBC);
+          if (pos != BcIndex::NotFound) {
+            foundBCindex = bcIndexTVX.bcIndex(pos);  // TVX at foundGlobalBC is found
+          } else {                                   // check if TVX is in nearby bcs
+            pos = bcIndexTVX.find(foundGlobalBC + 1); // next bc
+            if (pos != BcIndex::NotFound) {
               // foundGlobalBC += 1;
-              foundBCindex = it->second;
+              foundBCindex = bcIndexTVX.bcIndex(pos);
             } else {
-              it = mapGlobalBcWithTVX.find(foundGlobalBC - 1); // previous bc
-              if (it != mapGlobalBcWithTVX.end()) {
+              pos = bcIndexTVX.find(foundGlobalBC - 1); // previous bc
+              if (pos != BcIndex::NotFound) {
                 // foundGlobalBC -= 1;
-                foundBCindex = it->second;
+                foundBCindex = bcIndexTVX.bcIndex(pos);
               } else {
                 foundBCindex = bc.globalIndex(); // keep original BC index
               }
@@ -1054,7 +1180,7 @@ class EventSelectionModule
         } else {
           // for non-TOF and low-mult vertices, consider nearby nominal bcs
           int64_t meanBC = globalBC + TMath::Nint(sumHighPtTime / sumHighPtW / bcNS);
-          int64_t bestGlobalBC = findBestGlobalBC(meanBC, evselOpts.confSigmaBCforHighPtTracks, vNcontributors[colIndex], col.posZ(), mapGlobalBcVtxZ);
+          int64_t bestGlobalBC = findBestGlobalBC(meanBC, evselOpts.confSigmaBCforHighPtTracks, vNcontributors[colIndex], col.posZ(), bcIndexTVX);
           if (bestGlobalBC > 0) {
             foundGlobalBC = bestGlobalBC;
             // find closest nominal bc in pattern
@@ -1066,7 +1192,7 @@ class EventSelectionModule
                 break; // the bc in pattern is found
               }
             }
-            foundBCindex = mapGlobalBcWithTVX[bestGlobalBC];
+            foundBCindex = bcIndexTVX.bcIndex(bcIndexTVX.find(bestGlobalBC));
           } else {                           // failed to find a proper TVX with small vZ difference
             foundBCindex = bc.globalIndex(); // keep original BC index
           }
@@ -1081,28 +1207,28 @@ class EventSelectionModule
         // for collisions with TOF tracks:
         // take bc corresponding to TOF track with median time
         int64_t tofGlobalBC = globalBC + TMath::Nint(getMedian(vTrackTimesTOF) / bcNS);
-        std::map<int64_t, int32_t>::iterator it = mapGlobalBcWithTVX.find(tofGlobalBC);
-        if (it != mapGlobalBcWithTVX.end()) {
-          foundGlobalBC = it->first;
-          foundBCindex = it->second;
+        int pos = bcIndexTVX.find(tofGlobalBC);
+        if (pos != BcIndex::NotFound) {
+          foundGlobalBC = bcIndexTVX.globalBC(pos);
+          foundBCindex = bcIndexTVX.bcIndex(pos);
         }
       } else if (nPvTracksTPCnoTOFnoTRD == 0 && nPvTracksTRDnoTOF > 0) {
         // for collisions with TRD tracks but without TOF or ITSTPC-only tracks:
         // take bc corresponding to TRD track with median time
         int64_t trdGlobalBC = globalBC + TMath::Nint(getMedian(vTrackTimesTRDnoTOF) / bcNS);
-        std::map<int64_t, int32_t>::iterator it = mapGlobalBcWithTVX.find(trdGlobalBC);
-        if (it != mapGlobalBcWithTVX.end()) {
-          foundGlobalBC = it->first;
-          foundBCindex = it->second;
+        int pos = bcIndexTVX.find(trdGlobalBC);
+        if (pos != BcIndex::NotFound) {
+          foundGlobalBC = bcIndexTVX.globalBC(pos);
+          foundBCindex = bcIndexTVX.bcIndex(pos);
         }
       } else if (nPvTracksHighPtTPCnoTOFnoTRD > 0) {
         // for collisions with high-pt ITSTPC-nonTOF-nonTRD tracks
         // search in 3*confSigmaBCforHighPtTracks range (3*4 bcs by default)
         int64_t meanBC = globalBC + TMath::Nint(sumHighPtTime / sumHighPtW / bcNS);
-        int64_t bestGlobalBC = findBestGlobalBC(meanBC, evselOpts.confSigmaBCforHighPtTracks, vNcontributors[colIndex], col.posZ(), mapGlobalBcVtxZ);
+        int64_t bestGlobalBC = findBestGlobalBC(meanBC, evselOpts.confSigmaBCforHighPtTracks, vNcontributors[colIndex], col.posZ(), bcIndexTVX);
         if (bestGlobalBC > 0) {
           foundGlobalBC = bestGlobalBC;
-          foundBCindex = mapGlobalBcWithTVX[bestGlobalBC];
+          foundBCindex = bcIndexTVX.bcIndex(bcIndexTVX.find(bestGlobalBC));
         }
       }
 
@@ -1113,18 +1239,23 @@ class EventSelectionModule
 
       // erase found global BC with TVX from the pool of bcs for the next loop over low-pt TPCnoTOFnoTRD collisions
       if (foundBCindex >= 0)
-        mapGlobalBcVtxZ.erase(foundGlobalBC);
+        bcIndexTVX.remove(foundGlobalBC);
     }
     // alternative matching: looking for collisions with the same nominal BC
     if (runLightIons >= 0) {
-      for (uint32_t iCol = 0; iCol < vBCinPatternPerColl.size(); iCol++) {
-        int64_t foundNominalBC = vBCinPatternPerColl[iCol];
-        for (uint32_t jCol = 0; jCol < vBCinPatternPerColl.size(); jCol++) {
-          int64_t foundNominalBC2 = vBCinPatternPerColl[jCol];
-          if (foundNominalBC2 == foundNominalBC) {
-            vCollisionsPileupPerColl[iCol]++;
-          }
+      // group collisions by nominal BC: the pileup counter is the size of the group
+      std::vector<uint32_t> colsByNominalBC(vBCinPatternPerColl.size());
+      std::iota(colsByNominalBC.begin(), colsByNominalBC.end(), 0);
+      std::sort(colsByNominalBC.begin(), colsByNominalBC.end(), [&](uint32_t a, uint32_t b) { return vBCinPatternPerColl[a] < vBCinPatternPerColl[b]; });
+      for (size_t first = 0; first < colsByNominalBC.size();) {
+        size_t last = first + 1;
+        while (last < colsByNominalBC.size() && vBCinPatternPerColl[colsByNominalBC[last]] == vBCinPatternPerColl[colsByNominalBC[first]]) {
+          last++;
+        }
+        for (size_t i = first; i < last; i++) {
+          vCollisionsPileupPerColl[colsByNominalBC[i]] = last - first;
         }
+        first = last;
       }
     } else { // continue standard matching: second loop to match remaining low-pt TPCnoTOFnoTRD collisions
       for (const auto& col : cols) {
@@ -1136,9 +1267,9 @@ class EventSelectionModule
           int64_t globalBC = bc.globalBC();
           int64_t meanBC = globalBC + TMath::Nint(weightedTime / bcNS);
           int64_t sigmaBC = TMath::CeilNint(weightedSigma / bcNS);
-          int64_t bestGlobalBC = findBestGlobalBC(meanBC, sigmaBC, vNcontributors[colIndex], col.posZ(), mapGlobalBcVtxZ);
+          int64_t bestGlobalBC = findBestGlobalBC(meanBC, sigmaBC, vNcontributors[colIndex], col.posZ(), bcIndexTVX);
           vFoundGlobalBC[colIndex] = bestGlobalBC > 0 ? bestGlobalBC : globalBC;
-          vFoundBCindex[colIndex] = bestGlobalBC > 0 ? mapGlobalBcWithTVX[bestGlobalBC] : bc.globalIndex();
+          vFoundBCindex[colIndex] = bestGlobalBC > 0 ? bcIndexTVX.bcIndex(bcIndexTVX.find(bestGlobalBC)) : bc.globalIndex();
         }
         // fill pileup counter
         vCollisionsPerBc[vFoundBCindex[colIndex]]++;
@@ -1396,10 +1527,10 @@ class EventSelectionModule
       if (vIsFullInfoForOccupancy[colIndex] && vCanHaveAssocCollsWithinLastDriftTime[colIndex] && colIndexFirstRejectedByTFborderCut >= 0) {
         int64_t foundGlobalBC = vFoundGlobalBC[colIndex];
         int64_t tfId = (foundGlobalBC - bcSOR) / nBCsPerTF;
-        std::map<int64_t, int32_t>::iterator it = mapGlobalBcWithTVX.find(vFoundGlobalBC[colIndexFirstRejectedByTFborderCut]);
-        while (it != mapGlobalBcWithTVX.end()) {
-          int64_t thisFoundGlobalBC = it->first;
-          int32_t thisFoundBCindex = it->second;
+        int pos = bcIndexTVX.find(vFoundGlobalBC[colIndexFirstRejectedByTFborderCut]);
+        for (; pos != BcIndex::NotFound && pos < bcIndexTVX.size(); pos++) {
+          int64_t thisFoundGlobalBC = bcIndexTVX.globalBC(pos);
+          int32_t thisFoundBCindex = bcIndexTVX.bcIndex(pos);
           auto bc = bcs.iteratorAt(thisFoundBCindex);
           int64_t thisTFid = (bc.globalBC() - bcSOR) / nBCsPerTF;
           if (thisTFid != tfId)
@@ -1422,7 +1553,6 @@ class EventSelectionModule
               sumAmpFT0CInFullTimeWindow += wOccup * multT0C;
             }
           }
-          it++;
         }
       }
 
@@ -36,6 +36,7 @@
 #include <TProfile.h>
 #include <TString.h>
 
+#include <algorithm>
 #include <cmath>
 #include <cstdint>
 #include <cstdlib>
@@ -335,6 +336,93 @@ struct standardConfigurables : o2::framework::ConfigurableGroup {
   o2::framework::Configurable<bool> embedINELgtZEROselection{"embedINELgtZEROselection", false, {"Option to do percentile 100.5 if not INELgtZERO"}};
 };
 
+//__________________________________________________
+// flat copy of a 1D calibration histogram, compiled once per run
+// getValue(x) returns exactly h->GetBinContent(h->FindFixBin(x)), including
+// under- and overflow, without going through TH1/TAxis for every collision:
+// O(1) bin index for uniform binning, binary search on the edges otherwise.
+// Histograms that cannot be flattened (non-monotone edges) are queried directly
+class CalibrationLUT
+{
+ public:
+  // returns false if the histogram could not be flattened
+  bool compile(const TH1* h)
+  {
+    clear();
+    mHist = h;
+    if (h == nullptr || h->GetDimension() != 1) {
+      return false;
+    }
+    const TAxis* axis = h->GetXaxis();
+    mNbins = axis->GetNbins();
+    mXmin = axis->GetXmin();
+    mXmax = axis->GetXmax();
+    mUniform = !axis->IsVariableBinSize();
+    if (!mUniform) {
+      mEdges.resize(mNbins + 1);
+      for (int i = 0; i <= mNbins; i++) {
+        mEdges[i] = axis->GetBinLowEdge(i + 1);
+        if (i > 0 && mEdges[i] < mEdges[i - 1]) {
+          mEdges.clear();
+          return false;
+        }
+      }
+    }
+    mContents.resize(mNbins + 2);
+    for (int i = 0; i <= mNbins + 1; i++) {
+      mContents[i] = h->GetBinContent(i);
+    }
+    return true;
+  }
+
+  void clear()
+  {
+    mHist = nullptr;
+    mNbins = 0;
+    mEdges.clear();
+    mContents.clear();
+  }
+
+  bool isCompiled() const { return !mContents.empty(); }
+
+  int findBin(double x) const
+  {
+    // same conventions as TAxis::FindFixBin (NaN goes to overflow)
+    if (x < mXmin) {
+      return 0;
+    }
+    if (!(x < mXmax)) {
+      return mNbins + 1;
+    }
+    if (mUniform) {
+      return 1 + static_cast<int>(mNbins * (x - mXmin) / (mXmax - mXmin));
+    }
+    // TMath::BinarySearch: first edge equal to x, otherwise last edge below x
+    auto edge = std::lower_bound(mEdges.begin(), mEdges.end(), x);
+    if (edge == mEdges.end() || *edge != x) {
+      --edge;
+    }
+    return 1 + static_cast<int>(edge - mEdges.begin());
+  }
+
+  double getValue(double x) const
+  {
+    if (mContents.empty()) {
+      return mHist->GetBinContent(mHist->FindFixBin(x));
+    }
+    return mContents[findBin(x)];
+  }
+
+ private:
+  const TH1* mHist = nullptr;
+  int mNbins = 0;
+  double mXmin = 0.;
+  double mXmax = 0.;
+  bool mUniform = true;
+  std::vector<double> mEdges;    // variable binning only
+  std::vector<double> mContents; // nbins + under- and overflow
+};
+
 class MultModule
 {
  public:
@@ -382,32 +470,46 @@ class MultModule
     TH1* mhVtxAmpCorrV0A = nullptr;
     TH1* mhVtxAmpCorrV0C = nullptr;
     TH1* mhMultSelCalib = nullptr;
+    CalibrationLUT mVtxAmpCorrV0A;
+    CalibrationLUT mVtxAmpCorrV0C;
+    CalibrationLUT mMultSelCalib;
   } Run2V0MInfo;
   struct TagRun2V0ACalibration {
     bool mCalibrationStored = false;
     TH1* mhVtxAmpCorrV0A = nullptr;
     TH1* mhMultSelCalib = nullptr;
+    CalibrationLUT mVtxAmpCorrV0A;
+    CalibrationLUT mMultSelCalib;
   } Run2V0AInfo;
   struct TagRun2SPDTrackletsCalibration {
     bool mCalibrationStored = false;
     TH1* mhVtxAmpCorr = nullptr;
     TH1* mhMultSelCalib = nullptr;
+    CalibrationLUT mVtxAmpCorr;
+    CalibrationLUT mMultSelCalib;
   } Run2SPDTksInfo;
   struct TagRun2SPDClustersCalibration {
     bool mCalibrationStored = false;
     TH1* mhVtxAmpCorrCL0 = nullptr;
     TH1* mhVtxAmpCorrCL1 = nullptr;
     TH1* mhMultSelCalib = nullptr;
+    CalibrationLUT mVtxAmpCorrCL0;
+    CalibrationLUT mVtxAmpCorrCL1;
+    CalibrationLUT mMultSelCalib;
   } Run2SPDClsInfo;
   struct TagRun2CL0Calibration {
     bool mCalibrationStored = false;
     TH1* mhVtxAmpCorr = nullptr;
     TH1* mhMultSelCalib = nullptr;
+    CalibrationLUT mVtxAmpCorr;
+    CalibrationLUT mMultSelCalib;
   } Run2CL0Info;
   struct TagRun2CL1Calibration {
     bool mCalibrationStored = false;
     TH1* mhVtxAmpCorr = nullptr;
     TH1* mhMultSelCalib = nullptr;
+    CalibrationLUT mVtxAmpCorr;
+    CalibrationLUT mMultSelCalib;
   } Run2CL1Info;
   struct CalibrationInfo {
     std::string name = "";
@@ -415,6 +517,7 @@ class MultModule
     TH1* mhMultSelCalib = nullptr;
     float mMCScalePars[6] = {0.0};
     TFormula* mMCScale = nullptr;
+    CalibrationLUT mMultSelCalib; // flat copy of mhMultSelCalib
     explicit CalibrationInfo(std::string name)
       : name(name),
         mCalibrationStored(false),
@@ -1097,6 +1200,9 @@ class MultModule
               }
             }
             Run2V0MInfo.mCalibrationStored = true;
+            Run2V0MInfo.mVtxAmpCorrV0A.compile(Run2V0MInfo.mhVtxAmpCorrV0A);
+            Run2V0MInfo.mVtxAmpCorrV0C.compile(Run2V0MInfo.mhVtxAmpCorrV0C);
+            Run2V0MInfo.mMultSelCalib.compile(Run2V0MInfo.mhMultSelCalib);
           } else {
             // continue filling with non-valid values (105)
             LOGF(info, "Calibration information from V0M for run %d corrupted, will fill V0M tables with dummy values", bc.runNumber());
@@ -1108,6 +1214,8 @@ class MultModule
           Run2V0AInfo.mhMultSelCalib = getccdb("hMultSelCalib_V0A");
           if ((Run2V0AInfo.mhVtxAmpCorrV0A != nullptr) && (Run2V0AInfo.mhMultSelCalib != nullptr)) {
             Run2V0AInfo.mCalibrationStored = true;
+            Run2V0AInfo.mVtxAmpCorrV0A.compile(Run2V0AInfo.mhVtxAmpCorrV0A);
+            Run2V0AInfo.mMultSelCalib.compile(Run2V0AInfo.mhMultSelCalib);
           } else {
             // continue filling with non-valid values (105)
             LOGF(info, "Calibration information from V0A for run %d corrupted, will fill V0A tables with dummy values", bc.runNumber());
@@ -1119,6 +1227,8 @@ class MultModule
           Run2SPDTksInfo.mhMultSelCalib = getccdb("hMultSelCalib_SPDTracklets");
           if ((Run2SPDTksInfo.mhVtxAmpCorr != nullptr) && (Run2SPDTksInfo.mhMultSelCalib != nullptr)) {
             Run2SPDTksInfo.mCalibrationStored = true;
+            Run2SPDTksInfo.mVtxAmpCorr.compile(Run2SPDTksInfo.mhVtxAmpCorr);
+            Run2SPDTksInfo.mMultSelCalib.compile(Run2SPDTksInfo.mhMultSelCalib);
           } else {
             // continue filling with non-valid values (105)
             LOGF(info, "Calibration information from SPD tracklets for run %d corrupted, will fill SPD tracklets tables with dummy values", bc.runNumber());
@@ -1131,6 +1241,9 @@ class MultModule
           Run2SPDClsInfo.mhMultSelCalib = getccdb("hMultSelCalib_SPDClusters");
           if ((Run2SPDClsInfo.mhVtxAmpCorrCL0 != nullptr) && (Run2SPDClsInfo.mhVtxAmpCorrCL1 != nullptr) && (Run2SPDClsInfo.mhMultSelCalib != nullptr)) {
             Run2SPDClsInfo.mCalibrationStored = true;
+            Run2SPDClsInfo.mVtxAmpCorrCL0.compile(Run2SPDClsInfo.mhVtxAmpCorrCL0);
+            Run2SPDClsInfo.mVtxAmpCorrCL1.compile(Run2SPDClsInfo.mhVtxAmpCorrCL1);
+            Run2SPDClsInfo.mMultSelCalib.compile(Run2SPDClsInfo.mhMultSelCalib);
           } else {
             // continue filling with non-valid values (105)
             LOGF(info, "Calibration information from SPD clusters for run %d corrupted, will fill SPD clusters tables with dummy values", bc.runNumber());
@@ -1142,6 +1255,8 @@ class MultModule
           Run2CL0Info.mhMultSelCalib = getccdb("hMultSelCalib_CL0");
           if ((Run2CL0Info.mhVtxAmpCorr != nullptr) && (Run2CL0Info.mhMultSelCalib != nullptr)) {
             Run2CL0Info.mCalibrationStored = true;
+            Run2CL0Info.mVtxAmpCorr.compile(Run2CL0Info.mhVtxAmpCorr);
+            Run2CL0Info.mMultSelCalib.compile(Run2CL0Info.mhMultSelCalib);
           } else {
             // continue filling with non-valid values (105)
             LOGF(info, "Calibration information from CL0 multiplicity for run %d corrupted, will fill CL0 multiplicity tables with dummy values", bc.runNumber());
@@ -1153,6 +1268,8 @@ class MultModule
           Run2CL1Info.mhMultSelCalib = getccdb("hMultSelCalib_CL1");
           if ((Run2CL1Info.mhVtxAmpCorr != nullptr) && (Run2CL1Info.mhMultSelCalib != nullptr)) {
             Run2CL1Info.mCalibrationStored = true;
+            Run2CL1Info.mVtxAmpCorr.compile(Run2CL1Info.mhVtxAmpCorr);
+            Run2CL1Info.mMultSelCalib.compile(Run2CL1Info.mhMultSelCalib);
           } else {
             // continue filling with non-valid values (105)
             LOGF(info, "Calibration information from CL1 multiplicity for run %d corrupted, will fill CL1 multiplicity tables with dummy values", bc.runNumber());
@@ -1239,6 +1356,7 @@ class MultModule
             }
             estimator.mCalibrationStored = true;
             estimator.isSane();
+            estimator.mMultSelCalib.compile(estimator.mhMultSelCalib);
           } else {
             LOGF(info, "Calibration information from %s for run %d not available, will fill this estimator with invalid values and continue (no crash).", estimator.name.c_str(), bc.runNumber());
           }
@@ -1316,7 +1434,7 @@ class MultModule
             scaledMultiplicity = scaleMC(multiplicity, estimator.mMCScalePars);
             LOGF(debug, "Unscaled %s multiplicity: %f, scaled %s multiplicity: %f", estimator.name.c_str(), multiplicity, estimator.name.c_str(), scaledMultiplicity);
           }
-          percentile = estimator.mhMultSelCalib->GetBinContent(estimator.mhMultSelCalib->FindFixBin(scaledMultiplicity));
+          percentile = estimator.mMultSelCalib.getValue(scaledMultiplicity);
           if (assignOutOfRange)
             percentile = 100.5f;
         }
@@ -1410,10 +1528,10 @@ class MultModule
               v0m = scaleMC(mults[iEv].multFV0A + mults[iEv].multFV0C, Run2V0MInfo.mMCScalePars);
               LOGF(debug, "Unscaled v0m: %f, scaled v0m: %f", mults[iEv].multFV0A + mults[iEv].multFV0C, v0m);
             } else {
-              v0m = mults[iEv].multFV0A * Run2V0MInfo.mhVtxAmpCorrV0A->GetBinContent(Run2V0MInfo.mhVtxAmpCorrV0A->FindFixBin(mults[iEv].posZ)) +
-                    mults[iEv].multFV0C * Run2V0MInfo.mhVtxAmpCorrV0C->GetBinContent(Run2V0MInfo.mhVtxAmpCorrV0C->FindFixBin(mults[iEv].posZ));
+              v0m = mults[iEv].multFV0A * Run2V0MInfo.mVtxAmpCorrV0A.getValue(mults[iEv].posZ) +
+                    mults[iEv].multFV0C * Run2V0MInfo.mVtxAmpCorrV0C.getValue(mults[iEv].posZ);
             }
-            cV0M = Run2V0MInfo.mhMultSelCalib->GetBinContent(Run2V0MInfo.mhMultSelCalib->FindFixBin(v0m));
+            cV0M = Run2V0MInfo.mMultSelCalib.getValue(v0m);
           }
           LOGF(debug, "centRun2V0M=%.0f", cV0M);
           // fill centrality columns
@@ -1422,8 +1540,8 @@ class MultModule
         if (internalOpts.mEnabledTables[kCentRun2V0As]) {
           float cV0A = 105.0f;
           if (Run2V0AInfo.mCalibrationStored) {
-            float v0a = mults[iEv].multFV0A * Run2V0AInfo.mhVtxAmpCorrV0A->GetBinContent(Run2V0AInfo.mhVtxAmpCorrV0A->FindFixBin(mults[iEv].posZ));
-            cV0A = Run2V0AInfo.mhMultSelCalib->GetBinContent(Run2V0AInfo.mhMultSelCalib->FindFixBin(v0a));
+            float v0a = mults[iEv].multFV0A * Run2V0AInfo.mVtxAmpCorrV0A.getValue(mults[iEv].posZ);
+            cV0A = Run2V0AInfo.mMultSelCalib.getValue(v0a);
           }
           LOGF(debug, "centRun2V0A=%.0f", cV0A);
           // fill centrality columns
@@ -1432,8 +1550,8 @@ class MultModule
         if (internalOpts.mEnabledTables[kCentRun2SPDTrks]) {
           float cSPD = 105.0f;
           if (Run2SPDTksInfo.mCalibrationStored) {
-            float spdm = mults[iEv].multTracklets * Run2SPDTksInfo.mhVtxAmpCorr->GetBinContent(Run2SPDTksInfo.mhVtxAmpCorr->FindFixBin(mults[iEv].posZ));
-            cSPD = Run2SPDTksInfo.mhMultSelCalib->GetBinContent(Run2SPDTksInfo.mhMultSelCalib->FindFixBin(spdm));
+            float spdm = mults[iEv].multTracklets * Run2SPDTksInfo.mVtxAmpCorr.getValue(mults[iEv].posZ);
+            cSPD = Run2SPDTksInfo.mMultSelCalib.getValue(spdm);
           }
           LOGF(debug, "centSPDTracklets=%.0f", cSPD);
           cursors.centRun2SPDTracklets(cSPD);
@@ -1441,9 +1559,9 @@ class MultModule
         if (internalOpts.mEnabledTables[kCentRun2SPDClss]) {
           float cSPD = 105.0f;
           if (Run2SPDClsInfo.mCalibrationStored) {
-            float spdm = mults[iEv].spdClustersL0 * Run2SPDClsInfo.mhVtxAmpCorrCL0->GetBinContent(Run2SPDClsInfo.mhVtxAmpCorrCL0->FindFixBin(mults[iEv].posZ)) +
-                         mults[iEv].spdClustersL1 * Run2SPDClsInfo.mhVtxAmpCorrCL1->GetBinContent(Run2SPDClsInfo.mhVtxAmpCorrCL1->FindFixBin(mults[iEv].posZ));
-            cSPD = Run2SPDClsInfo.mhMultSelCalib->GetBinContent(Run2SPDClsInfo.mhMultSelCalib->FindFixBin(spdm));
+            float spdm = mults[iEv].spdClustersL0 * Run2SPDClsInfo.mVtxAmpCorrCL0.getValue(mults[iEv].posZ) +
+                         mults[iEv].spdClustersL1 * Run2SPDClsInfo.mVtxAmpCorrCL1.getValue(mults[iEv].posZ);
+            cSPD = Run2SPDClsInfo.mMultSelCalib.getValue(spdm);
           }
           LOGF(debug, "centSPDClusters=%.0f", cSPD);
           cursors.centRun2SPDClusters(cSPD);
@@ -1451,8 +1569,8 @@ class MultModule
         if (internalOpts.mEnabledTables[kCentRun2CL0s]) {
           float cCL0 = 105.0f;
           if (Run2CL0Info.mCalibrationStored) {
-            float cl0m = mults[iEv].spdClustersL0 * Run2CL0Info.mhVtxAmpCorr->GetBinContent(Run2CL0Info.mhVtxAmpCorr->FindFixBin(mults[iEv].posZ));
-            cCL0 = Run2CL0Info.mhMultSelCalib->GetBinContent(Run2CL0Info.mhMultSelCalib->FindFixBin(cl0m));
+            float cl0m = mults[iEv].spdClustersL0 * Run2CL0Info.mVtxAmpCorr.getValue(mults[iEv].posZ);
+            cCL0 = Run2CL0Info.mMultSelCalib.getValue(cl0m);
           }
           LOGF(debug, "centCL0=%.0f", cCL0);
           cursors.centRun2CL0(cCL0);
@@ -1460,8 +1578,8 @@ class MultModule
         if (internalOpts.mEnabledTables[kCentRun2CL1s]) {
           float cCL1 = 105.0f;
           if (Run2CL1Info.mCalibrationStored) {
-            float cl1m = mults[iEv].spdClustersL1 * Run2CL1Info.mhVtxAmpCorr->GetBinContent(Run2CL1Info.mhVtxAmpCorr->FindFixBin(mults[iEv].posZ));
-            cCL1 = Run2CL1Info.mhMultSelCalib->GetBinContent(Run2CL1Info.mhMultSelCalib->FindFixBin(cl1m));
+            float cl1m = mults[iEv].spdClustersL1 * Run2CL1Info.mVtxAmpCorr.getValue(mults[iEv].posZ);
+            cCL1 = Run2CL1Info.mMultSelCalib.getValue(cl1m);
           }
           LOGF(debug, "centCL1=%.0f", cCL1);
           cursors.centRun2CL1(cCL1);
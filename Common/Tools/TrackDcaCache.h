@@ -0,0 +1,167 @@
+// Copyright 2019-2020 CERN and copyright holders of ALICE O2.
+// See https://alice-o2.web.cern.ch/copyright for details of the copyright holders.
+// All rights not expressly granted are reserved.
+//
+// This software is distributed under the terms of the GNU General Public
+// License v3 (GPL Version 3), copied verbatim in the file "COPYING".
+//
+// In applying this license CERN does not waive the privileges and immunities
+// granted to it by virtue of its status as an Intergovernmental Organization
+// or submit itself to any jurisdiction.
+
+/// \file TrackDcaCache.h
+/// \brief on-demand propagation of IU tracks to the primary vertex with per-track memoisation
+/// \author ALICE
+
+#ifndef COMMON_TOOLS_TRACKDCACACHE_H_
+#define COMMON_TOOLS_TRACKDCACACHE_H_
+
+#include "Common/Core/trackUtilities.h"
+
+#include <CommonConstants/GeomConstants.h>
+#include <DataFormatsCalibration/MeanVertexObject.h>
+#include <DetectorsBase/Propagator.h>
+#include <Framework/AnalysisDataModel.h>
+#include <Framework/Logger.h>
+#include <ReconstructionDataFormats/DCA.h>
+#include <ReconstructionDataFormats/TrackParametrization.h>
+#include <ReconstructionDataFormats/TrackParametrizationWithError.h>
+#include <ReconstructionDataFormats/Vertex.h>
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+//__________________________________________
+// track DCA cache
+//
+// Alternative to subscribing to TracksDCA / TracksDCACov for tasks that only
+// need the DCA of a small, selected fraction of the tracks: the task
+// subscribes to TracksIU (plus TracksCovIU for the DCA uncertainties) and
+// asks the cache for the DCA of the tracks that survive its selections.
+// A track is propagated on its first access only and the result is kept for
+// the rest of the dataframe, so the propagation service does not need to
+// propagate all tracks. The propagation follows the one of the
+// TrackPropagationModule: only TrackIU tracks inside minPropagationRadius
+// are propagated, to their collision or to the mean vertex if they have
+// none, and tracks which are not propagated get a DCA of 999. The settings
+// are copied from the propagation configurables of the task with
+// TrackPropagationModule::configureDcaCache.
+
+namespace o2
+{
+namespace common
+{
+
+struct TrackDca {
+  float dcaXY = 999.f;
+  float dcaZ = 999.f;
+  float sigmaDcaXY2 = 999.f; // only with covariance
+  float sigmaDcaZ2 = 999.f;  // only with covariance
+  bool isPropagated = false;
+};
+
+class TrackDcaCache
+{
+ public:
+  TrackDcaCache()
+  {
+    // constructor
+  }
+
+  // controls behaviour
+  o2::base::Propagator::MatCorrType matCorr = o2::base::Propagator::MatCorrType::USEMatCorrLUT;
+  float minPropagationRadius = o2::constants::geom::XTPCInnerRef + 0.1;
+  float maxStep = 2.f;
+  bool useTrkPid = false; // propagate with the PID hypothesis used in tracking
+  const o2::dataformats::MeanVertexObject* meanVtx = nullptr; // vertex for tracks without collision, not propagated if null
+
+  /// Forgets all cached values, to be called at the beginning of every dataframe
+  /// \param nTracks  size of the track table of the dataframe
+  void reset(std::size_t nTracks)
+  {
+    mSlot.assign(nTracks, -1);
+    mResults.clear();
+    nPropagated = 0;
+  }
+
+  /// Returns the DCA of a track to the primary vertex, propagating it on first access
+  /// \param track  track from a table containing o2::aod::TracksIU, and o2::aod::TracksCovIU for the uncertainties
+  /// \param collisions  collision table the track collision index points to
+  template <typename TTrack, typename TCollisions>
+  TrackDca const& get(TTrack const& track, TCollisions const& collisions)
+  {
+    const auto iTrack = track.globalIndex();
+    if (iTrack < 0 || static_cast<std::size_t>(iTrack) >= mSlot.size()) {
+      LOG(fatal) << "TrackDcaCache: track " << iTrack << " outside of the " << mSlot.size() << " tracks of the dataframe, reset() must be called with the size of the track table";
+    }
+    if (mSlot[iTrack] < 0) {
+      mSlot[iTrack] = static_cast<int32_t>(mResults.size());
+      mResults.push_back(propagate(track, collisions));
+    }
+    return mResults[mSlot[iTrack]];
+  }
+
+  /// Checks whether the DCA of a track has already been computed in this dataframe
+  bool isCached(int64_t iTrack) const { return iTrack >= 0 && static_cast<std::size_t>(iTrack) < mSlot.size() && mSlot[iTrack] >= 0; }
+
+  std::size_t nPropagated = 0; // number of tracks propagated in the current dataframe
+
+ private:
+  std::vector<int32_t> mSlot;       // per track: position in mResults, -1 if not accessed yet
+  std::vector<TrackDca> mResults;   // results of the accessed tracks only
+  o2::dataformats::VertexBase mVtx; // scratch
+  o2::track::TrackParametrization<float> mTrackPar;
+  o2::track::TrackParametrizationWithError<float> mTrackParCov;
+  std::array<float, 2> mDcaInfo{};
+  o2::dataformats::DCA mDcaInfoCov;
+
+  template <typename TTrack, typename TCollisions>
+  TrackDca propagate(TTrack const& track, TCollisions const& collisions)
+  {
+    TrackDca result;
+    if (track.trackType() != o2::aod::track::TrackIU || track.x() >= minPropagationRadius) {
+      return result;
+    }
+    if (track.has_collision()) {
+      auto const& collision = collisions.rawIteratorAt(track.collisionId());
+      mVtx.setPos({collision.posX(), collision.posY(), collision.posZ()});
+      mVtx.setCov(collision.covXX(), collision.covXY(), collision.covYY(), collision.covXZ(), collision.covYZ(), collision.covZZ());
+    } else if (meanVtx != nullptr) {
+      mVtx.setPos({meanVtx->getX(), meanVtx->getY(), meanVtx->getZ()});
+      mVtx.setCov(meanVtx->getSigmaX() * meanVtx->getSigmaX(), 0.0f, meanVtx->getSigmaY() * meanVtx->getSigmaY(), 0.0f, 0.0f, meanVtx->getSigmaZ() * meanVtx->getSigmaZ());
+    } else {
+      return result;
+    }
+    nPropagated++;
+    if constexpr (requires { track.cYY(); }) {
+      mDcaInfoCov.set(999, 999, 999, 999, 999);
+      setTrackParCov(track, mTrackParCov);
+      if (useTrkPid) {
+        mTrackParCov.setPID(track.pidForTracking());
+      }
+      result.isPropagated = o2::base::Propagator::Instance()->propagateToDCABxByBz(mVtx, mTrackParCov, maxStep, matCorr, &mDcaInfoCov);
+      result.dcaXY = mDcaInfoCov.getY();
+      result.dcaZ = mDcaInfoCov.getZ();
+      result.sigmaDcaXY2 = mDcaInfoCov.getSigmaY2();
+      result.sigmaDcaZ2 = mDcaInfoCov.getSigmaZ2();
+    } else {
+      mDcaInfo[0] = 999;
+      mDcaInfo[1] = 999;
+      setTrackPar(track, mTrackPar);
+      if (useTrkPid) {
+        mTrackPar.setPID(track.pidForTracking());
+      }
+      result.isPropagated = o2::base::Propagator::Instance()->propagateToDCABxByBz({mVtx.getX(), mVtx.getY(), mVtx.getZ()}, mTrackPar, maxStep, matCorr, &mDcaInfo);
+      result.dcaXY = mDcaInfo[0];
+      result.dcaZ = mDcaInfo[1];
+    }
+    return result;
+  }
+};
+
+} // namespace common
+} // namespace o2
+
+#endif // COMMON_TOOLS_TRACKDCACACHE_H_
@@ -19,6 +19,7 @@
 #include "Common/Core/TableHelper.h"
 #include "Common/Core/trackUtilities.h"
 #include "Common/DataModel/TrackSelectionTables.h"
+#include "Common/Tools/TrackDcaCache.h"
 #include "Common/Tools/TrackTuner.h"
 
 #include <CommonConstants/GeomConstants.h>
@@ -39,11 +40,16 @@
 #include <TH1.h>
 #include <TH2.h>
 
+#include <algorithm>
 #include <array>
+#include <atomic>
 #include <cmath>
+#include <cstdint>
 #include <cstdlib>
 #include <memory>
 #include <string>
+#include <thread>
+#include <vector>
 
 //__________________________________________
 // track propagation module
@@ -73,6 +79,9 @@ struct TrackPropagationProducts : o2::framework::ProducesGroup {
 struct TrackPropagationConfigurables : o2::framework::ConfigurableGroup {
   std::string prefix = "trackPropagation";
   o2::framework::Configurable<float> minPropagationRadius{"minPropagationDistance", o2::constants::geom::XTPCInnerRef + 0.1, "Only tracks which are at a smaller radius will be propagated, defaults to TPC inner wall"};
+  o2::framework::Configurable<float> minPtForPropagation{"minPtForPropagation", 0.f, "Only tracks with a larger pt at the innermost update are propagated, others keep their IU parameters and a DCA of 999"};
+  o2::framework::Configurable<float> maxEtaForPropagation{"maxEtaForPropagation", 999.f, "Only tracks with a smaller |eta| at the innermost update are propagated, others keep their IU parameters and a DCA of 999"};
+  o2::framework::Configurable<int> nThreads{"nThreads", 1, "number of worker threads propagating the tracks in parallel (1: sequential)"};
   // for TrackTuner only (MC smearing)
   o2::framework::Configurable<bool> useTrackTuner{"useTrackTuner", false, "Apply track tuner corrections to MC"};
   o2::framework::Configurable<bool> useTrkPid{"useTrkPid", false, "use pid in tracking"};
@@ -108,6 +117,17 @@ class TrackPropagationModule
   o2::track::TrackParametrizationWithError<float> mTrackParCov;
   bool autoDetectDcaCalib = false; // track tuner setting
 
+  // parallel propagation: tracks are handed out to the workers in chunks of this size
+  static constexpr std::size_t kPropagationChunkSize = 256;
+
+  // parallel propagation: per-track results, indexed by the row of the track in the table
+  std::vector<uint8_t> propTrackType;
+  std::vector<o2::track::TrackParametrization<float>> propTrackPar;
+  std::vector<o2::track::TrackParametrizationWithError<float>> propTrackParCov;
+  std::vector<std::array<float, 2>> propDcaInfo;
+  std::vector<o2::dataformats::DCA> propDcaInfoCov;
+  bool parallelFallbackReported = false;
+
   template <typename TConfigurableGroup, typename TInitContext, typename THistoRegistry>
   void init(TConfigurableGroup const& cGroup, TrackTuner& trackTunerObj, THistoRegistry& registry, TInitContext& initContext)
   {
@@ -254,6 +274,41 @@ class TrackPropagationModule
       cursors.tunertable.reserve(tracks.size());
     }
 
+    if (useParallelPropagation<isMc>(cGroup)) {
+      propagateTracksParallel(cGroup, ccdbLoader, collisions, tracks);
+
+      // emit the rows in the original order, reading the results of the workers
+      std::size_t iTrack = 0;
+      for (const auto& track : tracks) {
+        o2::aod::track::TrackTypeEnum trackType = (o2::aod::track::TrackTypeEnum)propTrackType[iTrack];
+        if (fillTracksCov) {
+          if constexpr (isMc) { // checking MC and fillCovMat block begins
+            // propagation was attempted and succeeded
+            if (track.trackType() == o2::aod::track::TrackIU && trackType == o2::aod::track::Track && track.has_mcParticle()) {
+              auto mcParticle1 = track.mcParticle();
+              if (mcParticle1.isPhysicalPrimary()) {
+                registry.fill(HIST("hDCAxyVsPtRec"), propDcaInfoCov[iTrack].getY(), propTrackParCov[iTrack].getPt());
+                registry.fill(HIST("hDCAxyVsPtMC"), propDcaInfoCov[iTrack].getY(), mcParticle1.pt());
+                registry.fill(HIST("hDCAzVsPtRec"), propDcaInfoCov[iTrack].getZ(), propTrackParCov[iTrack].getPt());
+                registry.fill(HIST("hDCAzVsPtMC"), propDcaInfoCov[iTrack].getZ(), mcParticle1.pt());
+              }
+            }
+          } // MC and fillCovMat block ends
+        }
+        // the track tuner only acts on MC, which is propagated sequentially
+        if (cGroup.useTrackTuner.value && cGroup.fillTrackTunerTable.value) {
+          cursors.tunertable(-9999.);
+        }
+        if (fillTracksCov) {
+          fillPropagatedTrack(cursors, track.collisionId(), trackType, propTrackParCov[iTrack], propDcaInfoCov[iTrack]);
+        } else {
+          fillPropagatedTrack(cursors, track.collisionId(), trackType, propTrackPar[iTrack], propDcaInfo[iTrack]);
+        }
+        ++iTrack;
+      }
+      return;
+    }
+
     for (const auto& track : tracks) {
       if (fillTracksCov) {
         if (fillTracksDCA || fillTracksDCACov) {
@@ -279,7 +334,7 @@ class TrackPropagationModule
       // std::array<float, 3> trackPxPyPzTuned = {0.0, 0.0, 0.0};
       double q2OverPtNew = -9999.;
       // Only propagate tracks which have passed the innermost wall of the TPC (e.g. skipping loopers etc). Others fill unpropagated.
-      if (track.trackType() == o2::aod::track::TrackIU && track.x() < cGroup.minPropagationRadius.value) {
+      if (track.trackType() == o2::aod::track::TrackIU && track.x() < cGroup.minPropagationRadius.value && (fillTracksCov ? isPropagationRequested(cGroup, mTrackParCov) : isPropagationRequested(cGroup, mTrackPar))) {
         if (fillTracksCov) {
           if constexpr (isMc) { // checking MC and fillCovMat block begins
             // bool hasMcParticle = track.has_mcParticle();
@@ -339,29 +394,194 @@ class TrackPropagationModule
       }
       // LOG(info) <<  " trackPropagation (this value filled in tuner table)--> "  << q2OverPtNew;
       if (fillTracksCov) {
-        cursors.tracksParPropagated(track.collisionId(), trackType, mTrackParCov.getX(), mTrackParCov.getAlpha(), mTrackParCov.getY(), mTrackParCov.getZ(), mTrackParCov.getSnp(), mTrackParCov.getTgl(), mTrackParCov.getQ2Pt());
-        cursors.tracksParExtensionPropagated(mTrackParCov.getPt(), mTrackParCov.getP(), mTrackParCov.getEta(), mTrackParCov.getPhi());
-        // TODO do we keep the rho as 0? Also the sigma's are duplicated information
-        cursors.tracksParCovPropagated(std::sqrt(mTrackParCov.getSigmaY2()), std::sqrt(mTrackParCov.getSigmaZ2()), std::sqrt(mTrackParCov.getSigmaSnp2()),
-                                       std::sqrt(mTrackParCov.getSigmaTgl2()), std::sqrt(mTrackParCov.getSigma1Pt2()), 0, 0, 0, 0, 0, 0, 0, 0, 0, 0);
-        cursors.tracksParCovExtensionPropagated(mTrackParCov.getSigmaY2(), mTrackParCov.getSigmaZY(), mTrackParCov.getSigmaZ2(), mTrackParCov.getSigmaSnpY(),
-                                                mTrackParCov.getSigmaSnpZ(), mTrackParCov.getSigmaSnp2(), mTrackParCov.getSigmaTglY(), mTrackParCov.getSigmaTglZ(), mTrackParCov.getSigmaTglSnp(),
-                                                mTrackParCov.getSigmaTgl2(), mTrackParCov.getSigma1PtY(), mTrackParCov.getSigma1PtZ(), mTrackParCov.getSigma1PtSnp(), mTrackParCov.getSigma1PtTgl(),
-                                                mTrackParCov.getSigma1Pt2());
-        if (fillTracksDCA) {
-          cursors.tracksDCA(mDcaInfoCov.getY(), mDcaInfoCov.getZ());
+        fillPropagatedTrack(cursors, track.collisionId(), trackType, mTrackParCov, mDcaInfoCov);
+      } else {
+        fillPropagatedTrack(cursors, track.collisionId(), trackType, mTrackPar, mDcaInfo);
+      }
+    }
+  }
+
+  // Tracks outside the kinematic range requested with minPtForPropagation and
+  // maxEtaForPropagation are not propagated, which saves the propagation of
+  // most tracks when the consumers only use the DCA of e.g. high-pt tracks.
+  // Tasks which select tracks on other criteria can subscribe to the IU
+  // tables and use TrackDcaCache instead.
+  template <typename TConfigurableGroup, typename TTrackPar>
+  bool isPropagationRequested(TConfigurableGroup const& cGroup, TTrackPar const& trackPar) const
+  {
+    if (cGroup.minPtForPropagation.value > 0.f && trackPar.getPt() < cGroup.minPtForPropagation.value) {
+      return false;
+    }
+    if (cGroup.maxEtaForPropagation.value < 999.f && std::abs(trackPar.getEta()) > cGroup.maxEtaForPropagation.value) {
+      return false;
+    }
+    return true;
+  }
+
+  // configure a TrackDcaCache to propagate the tracks of a task as this module
+  // does: same material correction, radius and PID hypothesis, and the mean
+  // vertex of the CCDB loader for the tracks without collision. To be called
+  // once the CCDB objects of the run are loaded.
+  template <typename TConfigurableGroup, typename TCCDBLoader>
+  void configureDcaCache(TConfigurableGroup const& cGroup, TCCDBLoader const& ccdbLoader, TrackDcaCache& dcaCache) const
+  {
+    dcaCache.matCorr = matCorr;
+    dcaCache.minPropagationRadius = cGroup.minPropagationRadius.value;
+    dcaCache.useTrkPid = cGroup.useTrkPid.value;
+    dcaCache.meanVtx = ccdbLoader.mMeanVtx;
+  }
+
+  // Parallel propagation is used when requested and when it cannot change the
+  // result: the track tuner modifies its own state and histograms per track,
+  // the TGeo material budget needs a navigator per thread and the full field
+  // map caches the last evaluated segment. The material LUT and the fast
+  // field parametrisation of the shared Propagator are only read.
+  template <bool isMc, typename TConfigurableGroup>
+  bool useParallelPropagation(TConfigurableGroup const& cGroup)
+  {
+    if (cGroup.nThreads.value <= 1) {
+      return false;
+    }
+    if constexpr (isMc) {
+      if (cGroup.useTrackTuner.value) {
+        if (!parallelFallbackReported) {
+          LOGF(info, "Track tuner enabled: tracks will be propagated sequentially");
+          parallelFallbackReported = true;
         }
-        if (fillTracksDCACov) {
-          cursors.tracksDCACov(mDcaInfoCov.getSigmaY2(), mDcaInfoCov.getSigmaZ2());
+        return false;
+      }
+    }
+    if (matCorr == o2::base::Propagator::MatCorrType::USEMatCorrTGeo || o2::base::Propagator::Instance()->getFieldFast() == nullptr) {
+      if (!parallelFallbackReported) {
+        LOGF(warning, "Parallel track propagation requires the material LUT and the fast magnetic field: tracks will be propagated sequentially");
+        parallelFallbackReported = true;
+      }
+      return false;
+    }
+    return true;
+  }
+
+  // propagate all tracks with cGroup.nThreads workers. Every worker owns its
+  // vertex and propagates in place in the result buffers, so the operations
+  // per track are the same as in the sequential loop.
+  template <typename TConfigurableGroup, typename TCCDBLoader, typename TCollisions, typename TTracks>
+  void propagateTracksParallel(TConfigurableGroup const& cGroup, TCCDBLoader const& ccdbLoader, TCollisions const& collisions, TTracks const& tracks)
+  {
+    const std::size_t nTracks = tracks.size();
+    propTrackType.resize(nTracks);
+    if (fillTracksCov) {
+      propTrackParCov.resize(nTracks);
+      propDcaInfoCov.resize(nTracks);
+    } else {
+      propTrackPar.resize(nTracks);
+      propDcaInfo.resize(nTracks);
+    }
+
+    const std::size_t nChunks = (nTracks + kPropagationChunkSize - 1) / kPropagationChunkSize;
+    const std::size_t nWorkers = std::min<std::size_t>(cGroup.nThreads.value, nChunks);
+    std::atomic<std::size_t> nextChunk{0};
+    std::vector<std::thread> threads;
+    threads.reserve(nWorkers);
+    for (std::size_t iWorker = 0; iWorker < nWorkers; iWorker++) {
+      threads.emplace_back([&]() {
+        o2::dataformats::VertexBase vtx;
+        for (std::size_t iChunk = nextChunk++; iChunk < nChunks; iChunk = nextChunk++) {
+          const std::size_t last = std::min(nTracks, (iChunk + 1) * kPropagationChunkSize);
+          for (std::size_t iTrack = iChunk * kPropagationChunkSize; iTrack < last; iTrack++) {
+            propagateTrack(cGroup, ccdbLoader, collisions, tracks.rawIteratorAt(iTrack), iTrack, vtx);
+          }
         }
+      });
+    }
+    for (auto& thread : threads) {
+      thread.join();
+    }
+  }
+
+  // propagate one track into the result buffers at position iTrack
+  template <typename TConfigurableGroup, typename TCCDBLoader, typename TCollisions, typename TTrack>
+  void propagateTrack(TConfigurableGroup const& cGroup, TCCDBLoader const& ccdbLoader, TCollisions const& collisions, TTrack const& track, std::size_t iTrack, o2::dataformats::VertexBase& vtx)
+  {
+    if (fillTracksCov) {
+      if (fillTracksDCA || fillTracksDCACov) {
+        propDcaInfoCov[iTrack].set(999, 999, 999, 999, 999);
+      }
+      setTrackParCov(track, propTrackParCov[iTrack]);
+      if (cGroup.useTrkPid.value) {
+        propTrackParCov[iTrack].setPID(track.pidForTracking());
+      }
+    } else {
+      if (fillTracksDCA) {
+        propDcaInfo[iTrack][0] = 999;
+        propDcaInfo[iTrack][1] = 999;
+      }
+      setTrackPar(track, propTrackPar[iTrack]);
+      if (cGroup.useTrkPid.value) {
+        propTrackPar[iTrack].setPID(track.pidForTracking());
+      }
+    }
+    propTrackType[iTrack] = track.trackType();
+    // Only propagate tracks which have passed the innermost wall of the TPC (e.g. skipping loopers etc). Others fill unpropagated.
+    if (track.trackType() != o2::aod::track::TrackIU || track.x() >= cGroup.minPropagationRadius.value) {
+      return;
+    }
+    if (fillTracksCov ? !isPropagationRequested(cGroup, propTrackParCov[iTrack]) : !isPropagationRequested(cGroup, propTrackPar[iTrack])) {
+      return;
+    }
+    bool isPropagationOK = true;
+    if (track.has_collision()) {
+      auto const& collision = collisions.rawIteratorAt(track.collisionId());
+      if (fillTracksCov) {
+        vtx.setPos({collision.posX(), collision.posY(), collision.posZ()});
+        vtx.setCov(collision.covXX(), collision.covXY(), collision.covYY(), collision.covXZ(), collision.covYZ(), collision.covZZ());
+        isPropagationOK = o2::base::Propagator::Instance()->propagateToDCABxByBz(vtx, propTrackParCov[iTrack], 2.f, matCorr, &propDcaInfoCov[iTrack]);
       } else {
-        cursors.tracksParPropagated(track.collisionId(), trackType, mTrackPar.getX(), mTrackPar.getAlpha(), mTrackPar.getY(), mTrackPar.getZ(), mTrackPar.getSnp(), mTrackPar.getTgl(), mTrackPar.getQ2Pt());
-        cursors.tracksParExtensionPropagated(mTrackPar.getPt(), mTrackPar.getP(), mTrackPar.getEta(), mTrackPar.getPhi());
-        if (fillTracksDCA) {
-          cursors.tracksDCA(mDcaInfo[0], mDcaInfo[1]);
-        }
+        isPropagationOK = o2::base::Propagator::Instance()->propagateToDCABxByBz({collision.posX(), collision.posY(), collision.posZ()}, propTrackPar[iTrack], 2.f, matCorr, &propDcaInfo[iTrack]);
+      }
+    } else {
+      if (fillTracksCov) {
+        vtx.setPos({ccdbLoader.mMeanVtx->getX(), ccdbLoader.mMeanVtx->getY(), ccdbLoader.mMeanVtx->getZ()});
+        vtx.setCov(ccdbLoader.mMeanVtx->getSigmaX() * ccdbLoader.mMeanVtx->getSigmaX(), 0.0f, ccdbLoader.mMeanVtx->getSigmaY() * ccdbLoader.mMeanVtx->getSigmaY(), 0.0f, 0.0f, ccdbLoader.mMeanVtx->getSigmaZ() * ccdbLoader.mMeanVtx->getSigmaZ());
+        isPropagationOK = o2::base::Propagator::Instance()->propagateToDCABxByBz(vtx, propTrackParCov[iTrack], 2.f, matCorr, &propDcaInfoCov[iTrack]);
+      } else {
+        isPropagationOK = o2::base::Propagator::Instance()->propagateToDCABxByBz({ccdbLoader.mMeanVtx->getX(), ccdbLoader.mMeanVtx->getY(), ccdbLoader.mMeanVtx->getZ()}, propTrackPar[iTrack], 2.f, matCorr, &propDcaInfo[iTrack]);
       }
     }
+    if (isPropagationOK) {
+      propTrackType[iTrack] = o2::aod::track::Track;
+    }
+  }
+
+  // append the rows of one propagated track with covariance
+  template <typename TOutputGroup>
+  void fillPropagatedTrack(TOutputGroup& cursors, int collisionId, o2::aod::track::TrackTypeEnum trackType, o2::track::TrackParametrizationWithError<float> const& trackParCov, o2::dataformats::DCA const& dcaInfoCov)
+  {
+    cursors.tracksParPropagated(collisionId, trackType, trackParCov.getX(), trackParCov.getAlpha(), trackParCov.getY(), trackParCov.getZ(), trackParCov.getSnp(), trackParCov.getTgl(), trackParCov.getQ2Pt());
+    cursors.tracksParExtensionPropagated(trackParCov.getPt(), trackParCov.getP(), trackParCov.getEta(), trackParCov.getPhi());
+    // TODO do we keep the rho as 0? Also the sigma's are duplicated information
+    cursors.tracksParCovPropagated(std::sqrt(trackParCov.getSigmaY2()), std::sqrt(trackParCov.getSigmaZ2()), std::sqrt(trackParCov.getSigmaSnp2()),
+                                   std::sqrt(trackParCov.getSigmaTgl2()), std::sqrt(trackParCov.getSigma1Pt2()), 0, 0, 0, 0, 0, 0, 0, 0, 0, 0);
+    cursors.tracksParCovExtensionPropagated(trackParCov.getSigmaY2(), trackParCov.getSigmaZY(), trackParCov.getSigmaZ2(), trackParCov.getSigmaSnpY(),
+                                            trackParCov.getSigmaSnpZ(), trackParCov.getSigmaSnp2(), trackParCov.getSigmaTglY(), trackParCov.getSigmaTglZ(), trackParCov.getSigmaTglSnp(),
+                                            trackParCov.getSigmaTgl2(), trackParCov.getSigma1PtY(), trackParCov.getSigma1PtZ(), trackParCov.getSigma1PtSnp(), trackParCov.getSigma1PtTgl(),
+                                            trackParCov.getSigma1Pt2());
+    if (fillTracksDCA) {
+      cursors.tracksDCA(dcaInfoCov.getY(), dcaInfoCov.getZ());
+    }
+    if (fillTracksDCACov) {
+      cursors.tracksDCACov(dcaInfoCov.getSigmaY2(), dcaInfoCov.getSigmaZ2());
+    }
+  }
+
+  // append the rows of one propagated track without covariance
+  template <typename TOutputGroup>
+  void fillPropagatedTrack(TOutputGroup& cursors, int collisionId, o2::aod::track::TrackTypeEnum trackType, o2::track::TrackParametrization<float> const& trackPar, std::array<float, 2> const& dcaInfo)
+  {
+    cursors.tracksParPropagated(collisionId, trackType, trackPar.getX(), trackPar.getAlpha(), trackPar.getY(), trackPar.getZ(), trackPar.getSnp(), trackPar.getTgl(), trackPar.getQ2Pt());
+    cursors.tracksParExtensionPropagated(trackPar.getPt(), trackPar.getP(), trackPar.getEta(), trackPar.getPhi());
+    if (fillTracksDCA) {
+      cursors.tracksDCA(dcaInfo[0], dcaInfo[1]);
+    }
   }
 };
 
@@ -36,6 +36,7 @@
 #include <fmt/format.h>
 
 #include <algorithm>
+#include <cmath>
 #include <cstdint>
 #include <map>
 #include <memory>
@@ -58,6 +59,128 @@ DECLARE_SOA_TABLE(TrackTunerTable, "AOD", "TRACKTUNERTABLE", //!
                   track_tuner::TunedQOverPt);
 } // namespace o2::aod
 
+/// Lookup table replacing the per-track TGraphErrors::Eval of a calibration graph.
+/// The x range of the graph is divided in bins uniform in log(x); each bin stores
+/// the first graph segment it overlaps, so the segment containing x is found with
+/// one logarithm and a short forward walk instead of a scan over all the points.
+/// The interpolation is the linear one of TGraph::Eval on the same two points,
+/// and x is clamped to the graph range as in evalGraph, so the result
+/// is the one of the graph. Graphs with abscissas not strictly increasing or not
+/// positive are evaluated through the graph itself.
+class TrackTunerGraphLUT
+{
+ public:
+  void compile(const TGraphErrors* graph, int nLogBins = 256)
+  {
+    mGraph = graph;
+    mX.clear();
+    mY.clear();
+    mFirstSegment.clear();
+    mUseGraph = true;
+    if (!graph || graph->GetN() < 2) {
+      return;
+    }
+    const int nPoints = graph->GetN();
+    for (int iPoint = 1; iPoint < nPoints; iPoint++) {
+      if (!(graph->GetX()[iPoint] > graph->GetX()[iPoint - 1])) {
+        return;
+      }
+    }
+    if (!(graph->GetX()[0] > 0.)) {
+      return;
+    }
+    mX.assign(graph->GetX(), graph->GetX() + nPoints);
+    mY.assign(graph->GetY(), graph->GetY() + nPoints);
+    mLogXMin = std::log(mX.front());
+    const double logXMax = std::log(mX.back());
+    mInvLogBinWidth = nLogBins / (logXMax - mLogXMin);
+    mFirstSegment.resize(nLogBins);
+    for (int iBin = 0; iBin < nLogBins; iBin++) {
+      const double lowEdge = std::exp(mLogXMin + iBin / mInvLogBinWidth);
+      // last point at or below the bin edge, one more step back against rounding
+      int iSegment = static_cast<int>(std::upper_bound(mX.begin(), mX.end(), lowEdge) - mX.begin()) - 2;
+      mFirstSegment[iBin] = std::clamp(iSegment, 0, nPoints - 2);
+    }
+    mUseGraph = false;
+  }
+
+  /// Evaluates the graph, x being clamped to the graph range
+  static double evalGraph(double x, const TGraphErrors* graph)
+  {
+    if (!graph) {
+      LOG(fatal) << "\t evalGraph fails !\n";
+      return 0.;
+    }
+    int nPoints = graph->GetN();
+    double xMin = graph->GetX()[0];
+    double xMax = graph->GetX()[nPoints - 1];
+    if (x > xMax)
+      return graph->Eval(xMax);
+    if (x < xMin)
+      return graph->Eval(xMin);
+    return graph->Eval(x);
+  }
+
+  double eval(double x) const
+  {
+    if (mUseGraph) {
+      return evalGraph(x, mGraph);
+    }
+    const int nPoints = mX.size();
+    if (x > mX[nPoints - 1]) {
+      x = mX[nPoints - 1];
+    } else if (x < mX[0]) {
+      x = mX[0];
+    } else if (std::isnan(x)) {
+      return mY[0]; // what TGraph::Eval returns
+    }
+    const int nLogBins = mFirstSegment.size();
+    const int iBin = std::clamp(static_cast<int>((std::log(x) - mLogXMin) * mInvLogBinWidth), 0, nLogBins - 1);
+    int low = mFirstSegment[iBin];
+    while (low + 2 < nPoints && mX[low + 1] <= x) {
+      low++;
+    }
+    const int up = low + 1;
+    if (x == mX[low]) {
+      return mY[low];
+    }
+    if (x == mX[up]) {
+      return mY[up];
+    }
+    return mY[up] + (x - mX[up]) * (mY[low] - mY[up]) / (mX[low] - mX[up]);
+  }
+
+ private:
+  const TGraphErrors* mGraph = nullptr;
+  bool mUseGraph = true;
+  std::vector<double> mX;
+  std::vector<double> mY;
+  double mLogXMin = 0.;
+  double mInvLogBinWidth = 0.;
+  std::vector<int> mFirstSegment; // per log(x) bin: first graph segment overlapping the bin
+};
+
+/// Calibration values evaluated for one track
+struct TrackTunerCalibValues {
+  double dcaXYResMC = 0.0; // sd0rpo=0.;
+  double dcaZResMC = 0.0;  // sd0zo =0.;
+
+  double dcaXYResData = 0.0; // sd0rpn=0.;
+  double dcaZResData = 0.0;  // sd0zn =0.;
+
+  double dcaXYMeanMC = 0.0;   // sd0mrpo=0.;
+  double dcaXYMeanData = 0.0; // sd0mrpn=0.;
+
+  double dcaXYPullMC = 1.0;
+  double dcaXYPullData = 1.0;
+
+  double dcaZPullMC = 1.0;
+  double dcaZPullData = 1.0;
+
+  double smearQOverPtMC = -1.;
+  double smearQOverPtData = -1.;
+};
+
 struct TrackTuner : o2::framework::ConfigurableGroup {
 
   std::string prefix = "trackTuner"; // JSON group name
@@ -125,6 +248,23 @@ struct TrackTuner : o2::framework::ConfigurableGroup {
   std::vector<std::unique_ptr<TGraphErrors>> grDcaZPullVsPtPionMC;
   std::vector<std::unique_ptr<TGraphErrors>> grDcaZPullVsPtPionData;
 
+  /// lookup tables of the graphs above used per track, see compileGraphLUTs()
+  struct PhiBinLUTs {
+    TrackTunerGraphLUT dcaXYResMC;
+    TrackTunerGraphLUT dcaXYResData;
+    TrackTunerGraphLUT dcaZResMC;
+    TrackTunerGraphLUT dcaZResData;
+    TrackTunerGraphLUT dcaXYMeanMC;
+    TrackTunerGraphLUT dcaXYMeanData;
+    TrackTunerGraphLUT dcaXYPullMC;
+    TrackTunerGraphLUT dcaXYPullData;
+    TrackTunerGraphLUT dcaZPullMC;
+    TrackTunerGraphLUT dcaZPullData;
+  };
+  std::vector<PhiBinLUTs> lutPhiBins;
+  TrackTunerGraphLUT lutOneOverPtPionMC;
+  TrackTunerGraphLUT lutOneOverPtPionData;
+
   /// @brief Function to initialize the run number to that of the 1st considered bunch crossing (useful only if autoDetectDcaCalib = true)
   void setRunNumber(int n)
   {
@@ -716,84 +856,116 @@ struct TrackTuner : o2::framework::ConfigurableGroup {
     /// if we arrive here, it means that the graphs are all set
     areGraphsConfigured = true;
 
+    compileGraphLUTs();
+
   } // getDcaGraphs() ends here
 
-  template <typename T1, typename T2, typename T3, typename T4, typename H>
-  void tuneTrackParams(T1 const& mcparticle, T2& trackParCov, T3 const& matCorr, T4 dcaInfoCov, H hQA)
+  /// @brief Function to build the lookup tables evaluated per track from the calibration graphs, called by getDcaGraphs()
+  void compileGraphLUTs()
   {
-    /// abort if the calibrations are not loaded
-    if (!areGraphsConfigured) {
-      LOG(fatal) << "[TrackTuner::tuneTrackParams()] Function called, but calibration graphs not configured. Have you called the function TrackTuner::getDcaGraphs()? Aborting...";
+    lutPhiBins.resize(nPhiBins);
+    for (int iPhiBin = 0; iPhiBin < nPhiBins; ++iPhiBin) {
+      lutPhiBins[iPhiBin].dcaXYResMC.compile(grDcaXYResVsPtPionMC[iPhiBin].get());
+      lutPhiBins[iPhiBin].dcaXYResData.compile(grDcaXYResVsPtPionData[iPhiBin].get());
+      lutPhiBins[iPhiBin].dcaZResMC.compile(grDcaZResVsPtPionMC[iPhiBin].get());
+      lutPhiBins[iPhiBin].dcaZResData.compile(grDcaZResVsPtPionData[iPhiBin].get());
+      lutPhiBins[iPhiBin].dcaXYMeanMC.compile(grDcaXYMeanVsPtPionMC[iPhiBin].get());
+      lutPhiBins[iPhiBin].dcaXYMeanData.compile(grDcaXYMeanVsPtPionData[iPhiBin].get());
+      lutPhiBins[iPhiBin].dcaXYPullMC.compile(grDcaXYPullVsPtPionMC[iPhiBin].get());
+      lutPhiBins[iPhiBin].dcaXYPullData.compile(grDcaXYPullVsPtPionData[iPhiBin].get());
+      lutPhiBins[iPhiBin].dcaZPullMC.compile(grDcaZPullVsPtPionMC[iPhiBin].get());
+      lutPhiBins[iPhiBin].dcaZPullData.compile(grDcaZPullVsPtPionData[iPhiBin].get());
     }
+    lutOneOverPtPionMC.compile(grOneOverPtPionMC.get());
+    lutOneOverPtPionData.compile(grOneOverPtPionData.get());
+  }
 
-    double ptMC = mcparticle.pt();
-    double dcaXYResMC = 0.0; // sd0rpo=0.;
-    double dcaZResMC = 0.0;  // sd0zo =0.;
-
-    double dcaXYResData = 0.0; // sd0rpn=0.;
-    double dcaZResData = 0.0;  // sd0zn =0.;
-
-    double dcaXYMeanMC = 0.0;   // sd0mrpo=0.;
-    double dcaXYMeanData = 0.0; // sd0mrpn=0.;
-
-    double dcaXYPullMC = 1.0;
-    double dcaXYPullData = 1.0;
-
-    double dcaZPullMC = 1.0;
-    double dcaZPullData = 1.0;
+  /// @brief Function to evaluate the calibrations for a track with the given MC pt and phi
+  TrackTunerCalibValues getCalibValues(double ptMC, double phiMC) const
+  {
+    TrackTunerCalibValues calib;
 
     // get phibin
-    double phiMC = mcparticle.phi();
     if (phiMC < 0.)
       phiMC += o2::constants::math::TwoPI;                                    // 2 * std::numbers::pi;//
     int phiBin = phiMC / (o2::constants::math::TwoPI + 0.0000001) * nPhiBins; // 0.0000001 just a numerical protection
+    const PhiBinLUTs& luts = lutPhiBins[phiBin];
 
-    dcaXYResMC = evalGraph(ptMC, grDcaXYResVsPtPionMC[phiBin].get());
-    dcaXYResData = evalGraph(ptMC, grDcaXYResVsPtPionData[phiBin].get());
+    calib.dcaXYResMC = luts.dcaXYResMC.eval(ptMC);
+    calib.dcaXYResData = luts.dcaXYResData.eval(ptMC);
 
-    dcaZResMC = evalGraph(ptMC, grDcaZResVsPtPionMC[phiBin].get());
-    dcaZResData = evalGraph(ptMC, grDcaZResVsPtPionData[phiBin].get());
+    calib.dcaZResMC = luts.dcaZResMC.eval(ptMC);
+    calib.dcaZResData = luts.dcaZResData.eval(ptMC);
 
     // Local Q/Pt resolution: either the constant configurable value, or evaluated per-track from graphs
-    double smearQOverPtMC = qOverPtMC;
-    double smearQOverPtData = qOverPtData;
+    calib.smearQOverPtMC = qOverPtMC;
+    calib.smearQOverPtData = qOverPtData;
     if (updateCurvature || updateCurvatureIU) {
-      if ((smearQOverPtMC < 0) || (smearQOverPtData < 0)) {
+      if ((calib.smearQOverPtMC < 0) || (calib.smearQOverPtData < 0)) {
         /// check that input graphs for q/pt smearing are correctly retrieved
         if (!grOneOverPtPionData.get() || !grOneOverPtPionMC.get()) {
           LOG(fatal) << "### q/pt smearing: input graphs not correctly retrieved. Aborting.";
         }
-        smearQOverPtMC = std::max(0.0, evalGraph(ptMC, grOneOverPtPionMC.get()));
-        smearQOverPtData = std::max(0.0, evalGraph(ptMC, grOneOverPtPionData.get()));
+        calib.smearQOverPtMC = std::max(0.0, lutOneOverPtPionMC.eval(ptMC));
+        calib.smearQOverPtData = std::max(0.0, lutOneOverPtPionData.eval(ptMC));
         if (debugInfo) {
           LOG(info) << "### q/pt graph-based smearing: pT=" << ptMC
-                    << " sigma(1/pT)_MC=" << smearQOverPtMC
-                    << " sigma(1/pT)_Data=" << smearQOverPtData
-                    << " ratio(Data/MC)=" << (smearQOverPtMC > 0. ? smearQOverPtData / smearQOverPtMC : -1.);
+                    << " sigma(1/pT)_MC=" << calib.smearQOverPtMC
+                    << " sigma(1/pT)_Data=" << calib.smearQOverPtData
+                    << " ratio(Data/MC)=" << (calib.smearQOverPtMC > 0. ? calib.smearQOverPtData / calib.smearQOverPtMC : -1.);
         }
       } // smearQOverPtMC, smearQOverPtData block ends here
     } // updateCurvature, updateCurvatureIU block ends here
 
     if (updateTrackDCAs) {
 
-      dcaXYMeanMC = evalGraph(ptMC, grDcaXYMeanVsPtPionMC[phiBin].get());
-      dcaXYMeanData = evalGraph(ptMC, grDcaXYMeanVsPtPionData[phiBin].get());
+      calib.dcaXYMeanMC = luts.dcaXYMeanMC.eval(ptMC);
+      calib.dcaXYMeanData = luts.dcaXYMeanData.eval(ptMC);
 
-      dcaXYPullMC = evalGraph(ptMC, grDcaXYPullVsPtPionMC[phiBin].get());
-      dcaXYPullData = evalGraph(ptMC, grDcaXYPullVsPtPionData[phiBin].get());
+      calib.dcaXYPullMC = luts.dcaXYPullMC.eval(ptMC);
+      calib.dcaXYPullData = luts.dcaXYPullData.eval(ptMC);
 
-      dcaZPullMC = evalGraph(ptMC, grDcaZPullVsPtPionMC[phiBin].get());
-      dcaZPullData = evalGraph(ptMC, grDcaZPullVsPtPionData[phiBin].get());
+      calib.dcaZPullMC = luts.dcaZPullMC.eval(ptMC);
+      calib.dcaZPullData = luts.dcaZPullData.eval(ptMC);
     }
     //  Unit conversion, is it required ??
-    dcaXYResMC *= 1.e-4;
-    dcaZResMC *= 1.e-4;
+    calib.dcaXYResMC *= 1.e-4;
+    calib.dcaZResMC *= 1.e-4;
+
+    calib.dcaXYResData *= 1.e-4;
+    calib.dcaZResData *= 1.e-4;
+
+    calib.dcaXYMeanMC *= 1.e-4;
+    calib.dcaXYMeanData *= 1.e-4;
+
+    return calib;
+  }
 
-    dcaXYResData *= 1.e-4;
-    dcaZResData *= 1.e-4;
+  template <typename T1, typename T2, typename T3, typename T4, typename H>
+  void tuneTrackParams(T1 const& mcparticle, T2& trackParCov, T3 const& matCorr, T4 dcaInfoCov, H hQA)
+  {
+    /// abort if the calibrations are not loaded
+    if (!areGraphsConfigured) {
+      LOG(fatal) << "[TrackTuner::tuneTrackParams()] Function called, but calibration graphs not configured. Have you called the function TrackTuner::getDcaGraphs()? Aborting...";
+    }
+    tuneTrackParams(mcparticle, trackParCov, matCorr, dcaInfoCov, hQA, getCalibValues(mcparticle.pt(), mcparticle.phi()));
+  }
 
-    dcaXYMeanMC *= 1.e-4;
-    dcaXYMeanData *= 1.e-4;
+  template <typename T1, typename T2, typename T3, typename T4, typename H>
+  void tuneTrackParams(T1 const& mcparticle, T2& trackParCov, T3 const& matCorr, T4 dcaInfoCov, H hQA, TrackTunerCalibValues const& calib)
+  {
+    const double dcaXYResMC = calib.dcaXYResMC;
+    const double dcaZResMC = calib.dcaZResMC;
+    const double dcaXYResData = calib.dcaXYResData;
+    const double dcaZResData = calib.dcaZResData;
+    const double dcaXYMeanMC = calib.dcaXYMeanMC;
+    const double dcaXYMeanData = calib.dcaXYMeanData;
+    const double dcaXYPullMC = calib.dcaXYPullMC;
+    const double dcaXYPullData = calib.dcaXYPullData;
+    const double dcaZPullMC = calib.dcaZPullMC;
+    const double dcaZPullData = calib.dcaZPullData;
+    const double smearQOverPtMC = calib.smearQOverPtMC;
+    const double smearQOverPtData = calib.smearQOverPtData;
 
     // Apply the smearing
     // ---------------------------------------------
@@ -1170,23 +1342,6 @@ struct TrackTuner : o2::framework::ConfigurableGroup {
   //
   //   return -1;
   // }
-
-  double evalGraph(double x, const TGraphErrors* graph) const
-  {
-
-    if (!graph) {
-      LOG(fatal) << "\t evalGraph fails !\n";
-      return 0.;
-    }
-    int nPoints = graph->GetN();
-    double xMin = graph->GetX()[0];
-    double xMax = graph->GetX()[nPoints - 1];
-    if (x > xMax)
-      return graph->Eval(xMax);
-    if (x < xMin)
-      return graph->Eval(xMin);
-    return graph->Eval(x);
-  }
 };
 
 #endif // COMMON_TOOLS_TRACKTUNER_H_
@@ -27,10 +27,12 @@ BootstrapProfile::BootstrapProfile() : TProfile(),
                                        fNSubs(0),
                                        fMultiRebin(0),
                                        fMultiRebinEdges(0),
-                                       fPresetWeights(0) {}
+                                       fPresetWeights(0),
+                                       fSubAccumulator(0) {}
 BootstrapProfile::~BootstrapProfile()
 {
   delete fListOfEntries;
+  delete fSubAccumulator;
 };
 BootstrapProfile::BootstrapProfile(const char* name, const char* title, Int_t nbinsx, const Double_t* xbins) : TProfile(name, title, nbinsx, xbins),
                                                                                                                fListOfEntries(0),
@@ -38,14 +40,16 @@ BootstrapProfile::BootstrapProfile(const char* name, const char* title, Int_t nb
                                                                                                                fNSubs(0),
                                                                                                                fMultiRebin(0),
                                                                                                                fMultiRebinEdges(0),
-                                                                                                               fPresetWeights(0) {}
+                                                                                                               fPresetWeights(0),
+                                                                                                               fSubAccumulator(0) {}
 BootstrapProfile::BootstrapProfile(const char* name, const char* title, Int_t nbinsx, Double_t xlow, Double_t xup) : TProfile(name, title, nbinsx, xlow, xup),
                                                                                                                      fListOfEntries(0),
                                                                                                                      fProfInitialized(kFALSE),
                                                                                                                      fNSubs(0),
                                                                                                                      fMultiRebin(0),
                                                                                                                      fMultiRebinEdges(0),
-                                                                                                                     fPresetWeights(0) {}
+                                                                                                                     fPresetWeights(0),
+                                                                                                                     fSubAccumulator(0) {}
 void BootstrapProfile::InitializeSubsamples(Int_t nSub)
 {
   if (nSub < 1) {
@@ -63,11 +67,56 @@ void BootstrapProfile::InitializeSubsamples(Int_t nSub)
   }
   fNSubs = nSub;
 }
+void BootstrapProfile::InitializeSubsamples(Int_t nSub, SubsampleAccumulator::Mode mode)
+{
+  if (nSub < 1) {
+    printf("Number of subprofiles has to be > 0!\n");
+    return;
+  }
+  if (fListOfEntries) {
+    delete fListOfEntries;
+    fListOfEntries = 0;
+  }
+  delete fSubAccumulator;
+  fSubAccumulator = new SubsampleAccumulator(Form("%s_SubAcc", GetName()), GetNcells(), nSub, mode);
+  fNSubs = nSub;
+}
+void BootstrapProfile::MaterializeSubsamples()
+{
+  if (!fSubAccumulator || fListOfEntries)
+    return;
+  if (GetNcells() != fSubAccumulator->GetNCells()) {
+    printf("Binning of the main profile changed, cannot create the subprofiles from the subsample storage\n");
+    return;
+  }
+  fListOfEntries = new TList();
+  fListOfEntries->SetOwner(kTRUE);
+  TProfile* dummyPF = reinterpret_cast<TProfile*>(this);
+  for (Int_t i = 0; i < fSubAccumulator->GetNSubsamples(); i++) {
+    TProfile* subpf = new TProfile(*dummyPF); // plain TProfile, a clone would also copy the accumulator
+    subpf->SetName(Form("%s_Subpf%i", dummyPF->GetName(), i));
+    fSubAccumulator->CopyToProfile(i, subpf);
+    fListOfEntries->Add(subpf);
+  }
+  fNSubs = fSubAccumulator->GetNSubsamples();
+}
+void BootstrapProfile::InvalidateSubsamples()
+{
+  if (!fSubAccumulator || !fListOfEntries)
+    return;
+  delete fListOfEntries;
+  fListOfEntries = 0;
+}
 void BootstrapProfile::FillProfile(const Double_t& xv, const Double_t& yv, const Double_t& w, const Double_t& rn)
 {
   TProfile::Fill(xv, yv, w);
   if (!fNSubs)
     return;
+  if (fSubAccumulator) {
+    InvalidateSubsamples();
+    fSubAccumulator->Fill(FindBin(xv), yv, w, rn);
+    return;
+  }
   Int_t targetInd = rn * fNSubs;
   if (targetInd >= fNSubs)
     targetInd = 0;
@@ -79,6 +128,7 @@ void BootstrapProfile::FillProfile(const Double_t& xv, const Double_t& yv, const
 }
 void BootstrapProfile::RebinMulti(Int_t nbins)
 {
+  MaterializeSubsamples();
   this->RebinX(nbins);
   if (!fListOfEntries)
     return;
@@ -92,6 +142,7 @@ TH1* BootstrapProfile::getHist(Int_t ind)
   if (ind < 0) {
     return getHistRebinned(reinterpret_cast<TProfile*>(this)); //((TProfile*)this)->ProjectionX(Form("%s_hist",this->GetName()));
   } else {
+    MaterializeSubsamples();
     if (!fListOfEntries) {
       printf("No subprofiles exist!\n");
       return 0;
@@ -110,6 +161,7 @@ TProfile* BootstrapProfile::getProfile(Int_t ind)
   if (ind < 0) {
     return reinterpret_cast<TProfile*>(this);
   } else {
+    MaterializeSubsamples();
     if (!fListOfEntries) {
       printf("No subprofiles exist!\n");
       return 0;
@@ -129,6 +181,15 @@ Long64_t BootstrapProfile::Merge(TCollection* collist)
   TIter all_PBS(collist);
   while ((l_PBS = reinterpret_cast<BootstrapProfile*>(all_PBS()))) {
     reinterpret_cast<TProfile*>(this)->Add(reinterpret_cast<TProfile*>(l_PBS));
+    if (l_PBS->fSubAccumulator) {
+      if (!fSubAccumulator)
+        fSubAccumulator = reinterpret_cast<SubsampleAccumulator*>(l_PBS->fSubAccumulator->Clone());
+      else
+        fSubAccumulator->Add(l_PBS->fSubAccumulator);
+      fNSubs = fSubAccumulator->GetNSubsamples();
+      InvalidateSubsamples();
+      continue;
+    }
     TList* tarL = l_PBS->fListOfEntries;
     if (!tarL)
       continue;
@@ -206,6 +267,15 @@ TH1* BootstrapProfile::getWeightBasedRebin(Int_t ind)
 void BootstrapProfile::MergeBS(BootstrapProfile* target)
 {
   this->Add(target);
+  if (target->fSubAccumulator) {
+    if (!fSubAccumulator)
+      fSubAccumulator = reinterpret_cast<SubsampleAccumulator*>(target->fSubAccumulator->Clone());
+    else
+      fSubAccumulator->Add(target->fSubAccumulator);
+    fNSubs = fSubAccumulator->GetNSubsamples();
+    InvalidateSubsamples();
+    return;
+  }
   TList* tarL = target->fListOfEntries;
   if (!fListOfEntries) {
     if (!target->fListOfEntries)
@@ -219,6 +289,7 @@ void BootstrapProfile::MergeBS(BootstrapProfile* target)
 }
 TProfile* BootstrapProfile::getSummedProfiles()
 {
+  MaterializeSubsamples();
   if (!fListOfEntries || !fListOfEntries->GetEntries()) {
     printf("No subprofiles initialized for the BootstrapProfile.\n");
     return 0;
@@ -230,6 +301,10 @@ TProfile* BootstrapProfile::getSummedProfiles()
 }
 void BootstrapProfile::OverrideMainWithSub()
 {
+  if (fSubAccumulator && fSubAccumulator->GetMode() == SubsampleAccumulator::kPoisson) {
+    printf("Cannot override the main profile with the sum of Poisson bootstrap subsamples, they are not disjoint.\n");
+    return;
+  }
   TProfile* sum = getSummedProfiles();
   if (!sum)
     return;
@@ -16,6 +16,8 @@
 #ifndef PWGCF_GENERICFRAMEWORK_CORE_BOOTSTRAPPROFILE_H_
 #define PWGCF_GENERICFRAMEWORK_CORE_BOOTSTRAPPROFILE_H_
 
+#include "PWGCF/GenericFramework/Core/SubsampleAccumulator.h"
+
 #include <TCollection.h>
 #include <TH1.h>
 #include <TList.h>
@@ -34,6 +36,7 @@ class BootstrapProfile : public TProfile
   TList* fListOfEntries;
   void MergeBS(BootstrapProfile* target);
   void InitializeSubsamples(Int_t nSub);
+  void InitializeSubsamples(Int_t nSub, SubsampleAccumulator::Mode mode); // flat subsample storage, profiles are created on request
   void FillProfile(const Double_t& xv, const Double_t& yv, const Double_t& w, const Double_t& rn);
   void FillProfile(const Double_t& xv, const Double_t& yv, const Double_t& w);
   Long64_t Merge(TCollection* collist);
@@ -43,24 +46,33 @@ class BootstrapProfile : public TProfile
   TProfile* getProfile(Int_t ind = -1);
   TProfile* getSummedProfiles();
   void OverrideMainWithSub();
-  Int_t getNSubs() { return fListOfEntries->GetEntries(); }
+  Int_t getNSubs() { return fSubAccumulator ? fSubAccumulator->GetNSubsamples() : fListOfEntries->GetEntries(); }
+  SubsampleAccumulator* getSubsampleAccumulator() { return fSubAccumulator; }
   void PresetWeights(BootstrapProfile* targetBS) { fPresetWeights = targetBS; }
   void ResetBin(Int_t nbin)
   {
     ResetBin(reinterpret_cast<TProfile*>(this), nbin);
+    if (fSubAccumulator) {
+      fSubAccumulator->ResetCell(nbin);
+      InvalidateSubsamples();
+      return;
+    }
     for (Int_t i = 0; i < fListOfEntries->GetEntries(); i++)
       ResetBin(reinterpret_cast<TProfile*>(fListOfEntries->At(i)), nbin);
   };
-  ClassDef(BootstrapProfile, 2);
+  ClassDef(BootstrapProfile, 3);
 
  protected:
   TH1* getHistRebinned(TProfile* inpf); // Performs rebinning, if required, and returns a projection of profile
   TH1* getWeightBasedRebin(Int_t ind = -1);
+  void MaterializeSubsamples(); // Creates the subprofiles from the flat subsample storage, if used
+  void InvalidateSubsamples();  // Drops the subprofiles created from the flat subsample storage, after it changed
   Bool_t fProfInitialized;
   Int_t fNSubs;
-  Int_t fMultiRebin;                //! externaly set runtime, no need to store
-  Double_t* fMultiRebinEdges;       //! externaly set runtime, no need to store
-  BootstrapProfile* fPresetWeights; //! BootstrapProfile whose weights we should copy
+  Int_t fMultiRebin;                     //! externaly set runtime, no need to store
+  Double_t* fMultiRebinEdges;            //! externaly set runtime, no need to store
+  BootstrapProfile* fPresetWeights;      //! BootstrapProfile whose weights we should copy
+  SubsampleAccumulator* fSubAccumulator; // Flat subsample storage, replaces fListOfEntries while filling
   void ResetBin(TProfile* tpf, Int_t nbin)
   {
     tpf->SetBinEntries(nbin, 0);
@@ -38,6 +38,7 @@ ClassImp(FlowContainer);
 FlowContainer::FlowContainer() : TNamed("", ""),
                                  fProf(0),
                                  fProfRand(0),
+                                 fSubAccumulator(0),
                                  fNRandom(0),
                                  fIDName("MidV"),
                                  fPtRebin(1),
@@ -51,6 +52,7 @@ FlowContainer::FlowContainer() : TNamed("", ""),
 FlowContainer::FlowContainer(const char* name) : TNamed(name, name),
                                                  fProf(0),
                                                  fProfRand(0),
+                                                 fSubAccumulator(0),
                                                  fNRandom(0),
                                                  fIDName("MidV"),
                                                  fPtRebin(1),
@@ -65,8 +67,9 @@ FlowContainer::~FlowContainer()
 {
   delete fProf;
   delete fProfRand;
+  delete fSubAccumulator;
 };
-void FlowContainer::Initialize(TObjArray* inputList, const o2::framework::AxisSpec axis, int nRandom)
+void FlowContainer::Initialize(TObjArray* inputList, const o2::framework::AxisSpec axis, int nRandom, SubsampleStorage storage)
 {
   std::vector<double> multiBins = axis.binEdges;
   int nMultiBins = axis.nBins.value_or(0);
@@ -88,17 +91,9 @@ void FlowContainer::Initialize(TObjArray* inputList, const o2::framework::AxisSp
   for (int i = 0; i < inputList->GetEntries(); i++)
     fProf->GetYaxis()->SetBinLabel(i + 1, inputList->At(i)->GetName());
   fProf->Sumw2();
-  if (nRandom) {
-    fNRandom = nRandom;
-    fProfRand = new TObjArray();
-    fProfRand->SetOwner(kTRUE);
-    for (int i = 0; i < nRandom; i++) {
-      fProfRand->Add(dynamic_cast<TProfile2D*>(fProf->Clone(Form("%s_Rand_%i", fProf->GetName(), i))));
-      dynamic_cast<TProfile2D*>(fProfRand->At(i))->Sumw2();
-    }
-  }
+  InitializeSubsamples(nRandom, storage);
 };
-void FlowContainer::Initialize(TObjArray* inputList, int nMultiBins, double MultiMin, double MultiMax, int nRandom)
+void FlowContainer::Initialize(TObjArray* inputList, int nMultiBins, double MultiMin, double MultiMax, int nRandom, SubsampleStorage storage)
 {
   if (!inputList) {
     printf("Input list not specified\n");
@@ -113,16 +108,50 @@ void FlowContainer::Initialize(TObjArray* inputList, int nMultiBins, double Mult
   fProf->Sumw2();
   for (int i = 0; i < inputList->GetEntries(); i++)
     fProf->GetYaxis()->SetBinLabel(i + 1, inputList->At(i)->GetName());
-  if (nRandom) {
-    fNRandom = nRandom;
-    fProfRand = new TObjArray();
-    fProfRand->SetOwner(kTRUE);
-    for (int i = 0; i < nRandom; i++) {
-      fProfRand->Add(dynamic_cast<TProfile2D*>(fProf->Clone(Form("%s_Rand_%i", fProf->GetName(), i))));
-      dynamic_cast<TProfile2D*>(fProfRand->At(i))->Sumw2();
-    }
-  }
+  InitializeSubsamples(nRandom, storage);
 };
+void FlowContainer::InitializeSubsamples(int nRandom, SubsampleStorage storage)
+{
+  if (!nRandom)
+    return;
+  fNRandom = nRandom;
+  if (storage != kProfileClones) {
+    // one flat array for all the subsamples, the profiles are only created when requested
+    fSubAccumulator = new SubsampleAccumulator(Form("%s_SubAcc", fProf->GetName()), fProf->GetNcells(), nRandom,
+                                               storage == kFlatPoisson ? SubsampleAccumulator::kPoisson : SubsampleAccumulator::kDisjoint);
+    return;
+  }
+  fProfRand = new TObjArray();
+  fProfRand->SetOwner(kTRUE);
+  for (int i = 0; i < nRandom; i++) {
+    fProfRand->Add(dynamic_cast<TProfile2D*>(fProf->Clone(Form("%s_Rand_%i", fProf->GetName(), i))));
+    dynamic_cast<TProfile2D*>(fProfRand->At(i))->Sumw2();
+  }
+}
+void FlowContainer::MaterializeSubProfiles()
+{
+  if (!fSubAccumulator || fProfRand || !fProf)
+    return;
+  if (fProf->GetNcells() != fSubAccumulator->GetNCells()) {
+    printf("Binning of the main profile changed, cannot create the subprofiles from the subsample storage\n");
+    return;
+  }
+  fProfRand = new TObjArray();
+  fProfRand->SetOwner(kTRUE);
+  for (int i = 0; i < fSubAccumulator->GetNSubsamples(); i++) {
+    TProfile2D* subpf = dynamic_cast<TProfile2D*>(fProf->Clone(Form("%s_Rand_%i", fProf->GetName(), i)));
+    subpf->SetDirectory(0);
+    fSubAccumulator->CopyToProfile(i, subpf);
+    fProfRand->Add(subpf);
+  }
+}
+void FlowContainer::InvalidateSubProfiles()
+{
+  if (!fSubAccumulator || !fProfRand)
+    return;
+  delete fProfRand;
+  fProfRand = 0;
+}
 bool FlowContainer::CreateBinsFromAxis(TAxis* inax)
 {
   if (!inax)
@@ -165,7 +194,10 @@ int FlowContainer::FillProfile(const char* hname, double multi, double corr, dou
     return -1;
   }
   fProf->Fill(multi, yin, corr, w);
-  if (fNRandom) {
+  if (fSubAccumulator) {
+    InvalidateSubProfiles();
+    fSubAccumulator->Fill(fProf->FindBin(multi, yin), corr, w, rn);
+  } else if (fNRandom) {
     double rnind = rn * fNRandom;
     dynamic_cast<TProfile2D*>(fProfRand->At(static_cast<int>(rnind)))->Fill(multi, yin, corr, w);
   }
@@ -223,6 +255,14 @@ Long64_t FlowContainer::Merge(TCollection* collist)
       tpro->Add(spro);
     }
     nmerged++;
+    if (l_FC->fSubAccumulator) {
+      if (!fSubAccumulator)
+        fSubAccumulator = dynamic_cast<SubsampleAccumulator*>(l_FC->fSubAccumulator->Clone());
+      else
+        fSubAccumulator->Add(l_FC->fSubAccumulator);
+      InvalidateSubProfiles();
+      continue;
+    }
     TObjArray* tarr = l_FC->GetSubProfiles();
     if (!tarr)
       continue;
@@ -282,6 +322,14 @@ void FlowContainer::PickAndMerge(TFile* tfi)
   } else {
     tpro->Add(spro);
   }
+  if (lfc->fSubAccumulator) {
+    if (!fSubAccumulator)
+      fSubAccumulator = dynamic_cast<SubsampleAccumulator*>(lfc->fSubAccumulator->Clone());
+    else
+      fSubAccumulator->Add(lfc->fSubAccumulator);
+    InvalidateSubProfiles();
+    return;
+  }
   TObjArray* tarr = lfc->GetSubProfiles();
   if (!tarr) {
     return;
@@ -312,6 +360,11 @@ bool FlowContainer::OverrideBinsWithZero(int xb1, int yb1, int xb2, int yb2)
 }
 bool FlowContainer::OverrideMainWithSub(int ind, bool ExcludeChosen)
 {
+  if (fSubAccumulator && fSubAccumulator->GetMode() == SubsampleAccumulator::kPoisson) {
+    printf("Cannot override main profile with a randomized one. Poisson bootstrap subsamples are not disjoint.\n");
+    return kFALSE;
+  }
+  MaterializeSubProfiles();
   if (!fProfRand) {
     printf("Cannot override main profile with a randomized one. Random profile array does not exist.\n");
     return kFALSE;
@@ -344,6 +397,11 @@ bool FlowContainer::OverrideMainWithSub(int ind, bool ExcludeChosen)
 }
 bool FlowContainer::RandomizeProfile(int nSubsets)
 {
+  if (fSubAccumulator && fSubAccumulator->GetMode() == SubsampleAccumulator::kPoisson) {
+    printf("Cannot randomize profile, Poisson bootstrap subsamples are not disjoint.\n");
+    return kFALSE;
+  }
+  MaterializeSubProfiles();
   if (!fProfRand) {
     printf("Cannot randomize profile, random array does not exist.\n");
     return kFALSE;
@@ -16,6 +16,8 @@
 #ifndef PWGCF_GENERICFRAMEWORK_CORE_FLOWCONTAINER_H_
 #define PWGCF_GENERICFRAMEWORK_CORE_FLOWCONTAINER_H_
 
+#include "PWGCF/GenericFramework/Core/SubsampleAccumulator.h"
+
 #include <Framework/HistogramSpec.h>
 
 #include <TAxis.h>
@@ -40,13 +42,17 @@ class FlowContainer : public TNamed
   enum StatisticsType { kSingleSample,
                         kJackKnife,
                         kBootstrap };
-  void Initialize(TObjArray* inputList, const o2::framework::AxisSpec axis, int nRandomized = 0);
-  void Initialize(TObjArray* inputList, int nMultiBins, double MultiMin, double MultiMax, int nRandomized = 0);
+  enum SubsampleStorage { kProfileClones, // one TProfile2D per subsample
+                          kFlatDisjoint,  // flat storage, each event in one subsample
+                          kFlatPoisson }; // flat storage, each event in all subsamples with Poisson(1) weights, not usable with OverrideMainWithSub and RandomizeProfile
+  void Initialize(TObjArray* inputList, const o2::framework::AxisSpec axis, int nRandomized = 0, SubsampleStorage storage = kProfileClones);
+  void Initialize(TObjArray* inputList, int nMultiBins, double MultiMin, double MultiMax, int nRandomized = 0, SubsampleStorage storage = kProfileClones);
   bool CreateBinsFromAxis(TAxis* inax);
   void SetXAxis(TAxis* inax);
   void SetXAxis();
   void RebinMulti(int rN)
   {
+    MaterializeSubProfiles();
     if (fProf)
       fProf->RebinX(rN);
   };
@@ -61,7 +67,12 @@ class FlowContainer : public TNamed
   bool OverrideMainWithSub(int subind, bool ExcludeChosen);
   bool RandomizeProfile(int nSubsets = 0);
   bool CreateStatisticsProfile(StatisticsType StatType, int arg);
-  TObjArray* GetSubProfiles() { return fProfRand; }
+  TObjArray* GetSubProfiles()
+  {
+    MaterializeSubProfiles();
+    return fProfRand;
+  }
+  SubsampleAccumulator* GetSubsampleAccumulator() { return fSubAccumulator; }
   Long64_t Merge(TCollection* collist);
   void SetIDName(TString newname); //! do not store
   void SetPtRebin(int newval) { fPtRebin = newval; }
@@ -152,8 +163,12 @@ class FlowContainer : public TNamed
   TH1D* GetCN6(TH1D* corrN6, TH1D* corrN4, TH1D* corrN2);
   TH1D* GetCN8(TH1D* corrN8, TH1D* corrN6, TH1D* corrN4, TH1D* corrN2);
   TH1D* ProfToHist(TProfile* inpf);
+  void InitializeSubsamples(int nRandom, SubsampleStorage storage);
+  void MaterializeSubProfiles(); // Creates fProfRand from the flat subsample storage, if used
+  void InvalidateSubProfiles();  // Drops fProfRand created from the flat subsample storage, after it changed
   TProfile2D* fProf;
   TObjArray* fProfRand;
+  SubsampleAccumulator* fSubAccumulator; // Flat subsample storage, replaces fProfRand while filling
   int fNRandom;
   TString fIDName;
   int fPtRebin;             //! do not store
@@ -165,7 +180,7 @@ class FlowContainer : public TNamed
   double* fbinsPt;       //! Do not store; stored in fXAxis
   bool fPropagateErrors; //! do not store
   TProfile* GetRefFlowProfile(const char* order, double m1 = -1, double m2 = -1);
-  ClassDef(FlowContainer, 2);
+  ClassDef(FlowContainer, 3);
 };
 
 #endif // PWGCF_GENERICFRAMEWORK_CORE_FLOWCONTAINER_H_
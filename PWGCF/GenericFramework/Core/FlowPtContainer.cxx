@@ -17,6 +17,7 @@
 
 #include "PWGCF/GenericFramework/Core/BootstrapProfile.h"
 #include "PWGCF/GenericFramework/Core/GFWConfig.h"
+#include "PWGCF/GenericFramework/Core/SubsampleAccumulator.h"
 
 #include <Framework/HistogramSpec.h>
 #include <Framework/Logger.h>
@@ -55,6 +56,7 @@ FlowPtContainer::FlowPtContainer() : fCMTermList(0),
                                      fEventWeight(EventWeight::UnityWeight),
                                      fUseCentralMoments(true),
                                      fUseGap(false),
+                                     fUseFlatSubsamples(false),
                                      sumP(),
                                      insub(),
                                      corrNum(),
@@ -92,6 +94,7 @@ FlowPtContainer::FlowPtContainer(const char* name) : TNamed(name, name),
                                                      fEventWeight(EventWeight::UnityWeight),
                                                      fUseCentralMoments(true),
                                                      fUseGap(false),
+                                                     fUseFlatSubsamples(false),
                                                      sumP(),
                                                      insub(),
                                                      corrNum(),
@@ -119,6 +122,7 @@ FlowPtContainer::FlowPtContainer(const char* name, const char* title) : TNamed(n
                                                                         fEventWeight(EventWeight::UnityWeight),
                                                                         fUseCentralMoments(true),
                                                                         fUseGap(false),
+                                                                        fUseFlatSubsamples(false),
                                                                         sumP(),
                                                                         insub(),
                                                                         corrNum(),
@@ -132,6 +136,13 @@ FlowPtContainer::FlowPtContainer(const char* name, const char* title) : TNamed(n
                                                                         arr(),
                                                                         warr(),
                                                                         subevents() {}
+void FlowPtContainer::initialiseSubsamples(BootstrapProfile* prof, const int& nsub)
+{
+  if (fUseFlatSubsamples)
+    prof->InitializeSubsamples(nsub, SubsampleAccumulator::kDisjoint);
+  else
+    prof->InitializeSubsamples(nsub);
+}
 void FlowPtContainer::initialise(const o2::framework::AxisSpec axis, const int& m, const GFWCorrConfigs& configs, const int& nsub)
 {
   arr.resize(3 * 3 * 3 * 3);
@@ -221,11 +232,11 @@ void FlowPtContainer::initialise(const o2::framework::AxisSpec axis, const int&
 
   if (nsub) {
     for (int i = 0; i < fCorrList->GetEntries(); ++i)
-      dynamic_cast<BootstrapProfile*>(fCorrList->At(i))->InitializeSubsamples(nsub);
+      initialiseSubsamples(dynamic_cast<BootstrapProfile*>(fCorrList->At(i)), nsub);
     for (int i = 0; i < fCMTermList->GetEntries(); ++i)
-      dynamic_cast<BootstrapProfile*>(fCMTermList->At(i))->InitializeSubsamples(nsub);
+      initialiseSubsamples(dynamic_cast<BootstrapProfile*>(fCMTermList->At(i)), nsub);
     for (int i = 0; i < fCovList->GetEntries(); ++i)
-      dynamic_cast<BootstrapProfile*>(fCovList->At(i))->InitializeSubsamples(nsub);
+      initialiseSubsamples(dynamic_cast<BootstrapProfile*>(fCovList->At(i)), nsub);
   }
   LOGF(info, "Container %s initialized with m = %i\n and %i subsamples", this->GetName(), mpar, nsub);
   return;
@@ -310,11 +321,11 @@ void FlowPtContainer::initialise(int nbinsx, double* xbins, const int& m, const
   }
   if (nsub) {
     for (int i = 0; i < fCorrList->GetEntries(); ++i)
-      dynamic_cast<BootstrapProfile*>(fCorrList->At(i))->InitializeSubsamples(nsub);
+      initialiseSubsamples(dynamic_cast<BootstrapProfile*>(fCorrList->At(i)), nsub);
     for (int i = 0; i < fCMTermList->GetEntries(); ++i)
-      dynamic_cast<BootstrapProfile*>(fCMTermList->At(i))->InitializeSubsamples(nsub);
+      initialiseSubsamples(dynamic_cast<BootstrapProfile*>(fCMTermList->At(i)), nsub);
     for (int i = 0; i < fCovList->GetEntries(); ++i)
-      dynamic_cast<BootstrapProfile*>(fCovList->At(i))->InitializeSubsamples(nsub);
+      initialiseSubsamples(dynamic_cast<BootstrapProfile*>(fCovList->At(i)), nsub);
   }
   LOGF(info, "Container %s initialized with m = %i\n", this->GetName(), mpar);
 };
@@ -398,11 +409,11 @@ void FlowPtContainer::initialise(int nbinsx, double xlow, double xhigh, const in
   }
   if (nsub) {
     for (int i = 0; i < fCorrList->GetEntries(); ++i)
-      dynamic_cast<BootstrapProfile*>(fCorrList->At(i))->InitializeSubsamples(nsub);
+      initialiseSubsamples(dynamic_cast<BootstrapProfile*>(fCorrList->At(i)), nsub);
     for (int i = 0; i < fCMTermList->GetEntries(); ++i)
-      dynamic_cast<BootstrapProfile*>(fCMTermList->At(i))->InitializeSubsamples(nsub);
+      initialiseSubsamples(dynamic_cast<BootstrapProfile*>(fCMTermList->At(i)), nsub);
     for (int i = 0; i < fCovList->GetEntries(); ++i)
-      dynamic_cast<BootstrapProfile*>(fCovList->At(i))->InitializeSubsamples(nsub);
+      initialiseSubsamples(dynamic_cast<BootstrapProfile*>(fCovList->At(i)), nsub);
   }
   LOGF(info, "Container %s initialized with m = %i\n", this->GetName(), mpar);
 };
@@ -479,9 +490,9 @@ void FlowPtContainer::initialiseSubevent(const o2::framework::AxisSpec axis, con
 
   if (nsub) {
     for (int i = 0; i < fSubList->GetEntries(); ++i)
-      dynamic_cast<BootstrapProfile*>(fSubList->At(i))->InitializeSubsamples(nsub);
+      initialiseSubsamples(dynamic_cast<BootstrapProfile*>(fSubList->At(i)), nsub);
     for (int i = 0; i < fSubCMList->GetEntries(); ++i)
-      dynamic_cast<BootstrapProfile*>(fSubCMList->At(i))->InitializeSubsamples(nsub);
+      initialiseSubsamples(dynamic_cast<BootstrapProfile*>(fSubCMList->At(i)), nsub);
   }
   LOGF(info, "Container %s initialized Subevents and %i subsamples", this->GetName(), nsub);
 }
@@ -550,9 +561,9 @@ void FlowPtContainer::initialiseSubevent(int nbinsx, double* xbins, const int& m
 
   if (nsub) {
     for (int i = 0; i < fSubList->GetEntries(); ++i)
-      dynamic_cast<BootstrapProfile*>(fSubList->At(i))->InitializeSubsamples(nsub);
+      initialiseSubsamples(dynamic_cast<BootstrapProfile*>(fSubList->At(i)), nsub);
     for (int i = 0; i < fSubCMList->GetEntries(); ++i)
-      dynamic_cast<BootstrapProfile*>(fSubCMList->At(i))->InitializeSubsamples(nsub);
+      initialiseSubsamples(dynamic_cast<BootstrapProfile*>(fSubCMList->At(i)), nsub);
   }
   LOGF(info, "Container %s initialized Subevents and %i subsamples", this->GetName(), nsub);
 }
@@ -619,9 +630,9 @@ void FlowPtContainer::initialiseSubevent(int nbinsx, double xlow, double xhigh,
   }
   if (nsub) {
     for (int i = 0; i < fSubList->GetEntries(); ++i)
-      dynamic_cast<BootstrapProfile*>(fSubList->At(i))->InitializeSubsamples(nsub);
+      initialiseSubsamples(dynamic_cast<BootstrapProfile*>(fSubList->At(i)), nsub);
     for (int i = 0; i < fSubCMList->GetEntries(); ++i)
-      dynamic_cast<BootstrapProfile*>(fSubCMList->At(i))->InitializeSubsamples(nsub);
+      initialiseSubsamples(dynamic_cast<BootstrapProfile*>(fSubCMList->At(i)), nsub);
   }
   LOGF(info, "Container %s initialized Subevents and %i subsamples", this->GetName(), nsub);
 }
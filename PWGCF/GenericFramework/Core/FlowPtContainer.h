@@ -41,6 +41,8 @@ enum EventWeight {
 };
 };
 
+class BootstrapProfile;
+
 class FlowPtContainer : public TNamed
 {
  public:
@@ -119,6 +121,7 @@ class FlowPtContainer : public TNamed
   void setEventWeight(const unsigned int& lWeight) { fEventWeight = lWeight; }
   void setUseCentralMoments(bool newval) { fUseCentralMoments = newval; }
   void setUseGapMethod(bool newval) { fUseGap = newval; }
+  void setUseFlatSubsamples(bool newval) { fUseFlatSubsamples = newval; } // flat disjoint subsample storage of the BootstrapProfiles, set before initialising
   bool usesCentralMoments() { return fUseCentralMoments; }
   bool usesGap() { return fUseGap; }
   void rebinMulti(int nbins);
@@ -166,6 +169,8 @@ class FlowPtContainer : public TNamed
   unsigned int fEventWeight; //!
   bool fUseCentralMoments;
   bool fUseGap;
+  bool fUseFlatSubsamples; //!
+  void initialiseSubsamples(BootstrapProfile* prof, const int& nsub);
   void mergeBSLists(TList* source, TList* target);
   TH1* raiseHistToPower(TH1* inh, double p);
   std::vector<double> sumP;                    //!
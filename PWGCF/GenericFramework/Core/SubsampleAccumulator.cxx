@@ -0,0 +1,142 @@
+// Copyright 2019-2020 CERN and copyright holders of ALICE O2.
+// See https://alice-o2.web.cern.ch/copyright for details of the copyright holders.
+// All rights not expressly granted are reserved.
+//
+// This software is distributed under the terms of the GNU General Public
+// License v3 (GPL Version 3), copied verbatim in the file "COPYING".
+//
+// In applying this license CERN does not waive the privileges and immunities
+// granted to it by virtue of its status as an Intergovernmental Organization
+// or submit itself to any jurisdiction.
+
+#include "SubsampleAccumulator.h"
+
+#include <TCollection.h>
+#include <TNamed.h>
+
+#include <Rtypes.h>
+#include <RtypesCore.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+ClassImp(SubsampleAccumulator);
+
+namespace
+{
+// splitmix64, used to turn the per-event random number into a stream of well-mixed 64-bit integers
+uint64_t splitMix64(uint64_t& state)
+{
+  uint64_t z = (state += 0x9e3779b97f4a7c15ULL);
+  z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+  z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+  return z ^ (z >> 31);
+}
+} // namespace
+
+SubsampleAccumulator::SubsampleAccumulator() : TNamed("", ""),
+                                               fNCells(0),
+                                               fNSubs(0),
+                                               fMode(kDisjoint),
+                                               fData(),
+                                               fEventWeights(),
+                                               fLastRn(-1.) {}
+SubsampleAccumulator::SubsampleAccumulator(const char* name, int nCells, int nSubsamples, Mode mode) : TNamed(name, name),
+                                                                                                        fNCells(nCells),
+                                                                                                        fNSubs(nSubsamples),
+                                                                                                        fMode(mode),
+                                                                                                        fData(static_cast<std::size_t>(nCells) * nSubsamples * kNSums, 0.),
+                                                                                                        fEventWeights(),
+                                                                                                        fLastRn(-1.) {}
+void SubsampleAccumulator::GenerateEventWeights(double rn)
+{
+  // Poisson(1) weights by inversion of the cumulative distribution, one per subsample
+  fEventWeights.resize(fNSubs);
+  uint64_t state;
+  std::memcpy(&state, &rn, sizeof(state));
+  constexpr int MaxWeight = 12; // P(k > 12) ~ 1e-10
+  for (int i = 0; i < fNSubs; i++) {
+    const double u = (splitMix64(state) >> 11) * 0x1.0p-53;
+    double p = std::exp(-1.);
+    double cdf = p;
+    int k = 0;
+    while (u > cdf && k < MaxWeight) {
+      k++;
+      p /= k;
+      cdf += p;
+    }
+    fEventWeights[i] = k;
+  }
+  fLastRn = rn;
+}
+void SubsampleAccumulator::Fill(int cell, double y, double w, double rn)
+{
+  if (cell < 0 || cell >= fNCells || !fNSubs)
+    return;
+  if (fMode == kDisjoint) {
+    int sub = static_cast<int>(rn * fNSubs);
+    if (sub >= fNSubs || sub < 0)
+      sub = 0;
+    double* sums = &fData[index(cell, sub)];
+    sums[kSumW] += w;
+    sums[kSumWY] += w * y;
+    sums[kSumWY2] += w * y * y;
+    sums[kSumW2] += w * w;
+    return;
+  }
+  if (rn != fLastRn)
+    GenerateEventWeights(rn);
+  double* sums = &fData[index(cell, 0)];
+  const double wy = w * y;
+  const double wy2 = wy * y;
+  const double w2 = w * w;
+  for (int i = 0; i < fNSubs; i++) {
+    const double k = fEventWeights[i];
+    sums[i * kNSums + kSumW] += k * w;
+    sums[i * kNSums + kSumWY] += k * wy;
+    sums[i * kNSums + kSumWY2] += k * wy2;
+    sums[i * kNSums + kSumW2] += k * k * w2;
+  }
+}
+void SubsampleAccumulator::Reset()
+{
+  std::fill(fData.begin(), fData.end(), 0.);
+  fLastRn = -1.;
+}
+void SubsampleAccumulator::ResetCell(int cell)
+{
+  if (cell < 0 || cell >= fNCells)
+    return;
+  std::fill_n(fData.begin() + index(cell, 0), static_cast<std::size_t>(fNSubs) * kNSums, 0.);
+}
+bool SubsampleAccumulator::Add(const SubsampleAccumulator* other)
+{
+  if (!other)
+    return kFALSE;
+  if (other->fNCells != fNCells || other->fNSubs != fNSubs || other->fMode != fMode) {
+    printf("SubsampleAccumulator %s: cannot add %s with a different number of bins, subsamples or mode\n", GetName(), other->GetName());
+    return kFALSE;
+  }
+  const double* src = other->fData.data();
+  double* dst = fData.data();
+  const std::size_t n = fData.size();
+  for (std::size_t i = 0; i < n; i++)
+    dst[i] += src[i];
+  return kTRUE;
+}
+Long64_t SubsampleAccumulator::Merge(TCollection* collist)
+{
+  Long64_t nmerged = 0;
+  SubsampleAccumulator* l_SA = 0;
+  TIter all_SA(collist);
+  while ((l_SA = dynamic_cast<SubsampleAccumulator*>(all_SA()))) {
+    if (Add(l_SA))
+      nmerged++;
+  }
+  return nmerged;
+}
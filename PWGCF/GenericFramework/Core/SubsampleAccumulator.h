@@ -0,0 +1,97 @@
+// Copyright 2019-2020 CERN and copyright holders of ALICE O2.
+// See https://alice-o2.web.cern.ch/copyright for details of the copyright holders.
+// All rights not expressly granted are reserved.
+//
+// This software is distributed under the terms of the GNU General Public
+// License v3 (GPL Version 3), copied verbatim in the file "COPYING".
+//
+// In applying this license CERN does not waive the privileges and immunities
+// granted to it by virtue of its status as an Intergovernmental Organization
+// or submit itself to any jurisdiction.
+
+/// \file SubsampleAccumulator.h/.cxx
+/// \brief Flat storage of the per-bin profile sums of all subsamples, used by BootstrapProfile and FlowContainer
+///
+/// For every bin of the host profile and every subsample the sums sum(w), sum(w*y), sum(w*y^2) and sum(w^2)
+/// are stored in one contiguous array, ordered as [bin][subsample][sum], so that one fill touches a single
+/// cache line per subsample instead of a separate ROOT object. Two modes are supported:
+///  - kDisjoint: each event goes to exactly one subsample, selected by a random number in [0, 1)
+///  - kPoisson: each event enters every subsample with a Poisson(1) weight (Poisson bootstrap). The weights are
+///    generated on the fly from the per-event random number, so all the fills of one event share the same weights
+/// Subsample profiles are materialised on request with CopyToProfile(), the hosts drop them whenever the storage changes.
+
+#ifndef PWGCF_GENERICFRAMEWORK_CORE_SUBSAMPLEACCUMULATOR_H_
+#define PWGCF_GENERICFRAMEWORK_CORE_SUBSAMPLEACCUMULATOR_H_
+
+#include <TCollection.h>
+#include <TNamed.h>
+
+#include <Rtypes.h>
+#include <RtypesCore.h>
+
+#include <cstddef>
+#include <vector>
+
+class SubsampleAccumulator : public TNamed
+{
+ public:
+  enum Mode { kDisjoint,
+              kPoisson };
+  enum Sum { kSumW,
+             kSumWY,
+             kSumWY2,
+             kSumW2,
+             kNSums };
+
+  SubsampleAccumulator();
+  SubsampleAccumulator(const char* name, int nCells, int nSubsamples, Mode mode = kDisjoint);
+  ~SubsampleAccumulator() = default;
+
+  int GetNCells() const { return fNCells; }
+  int GetNSubsamples() const { return fNSubs; }
+  Mode GetMode() const { return static_cast<Mode>(fMode); }
+  double GetSum(int cell, int sub, Sum sum) const { return fData[index(cell, sub) + sum]; }
+
+  /// Fill one value in the given (global) bin of the host profile; rn is the per-event random number in [0, 1)
+  void Fill(int cell, double y, double w, double rn);
+  void Reset();
+  void ResetCell(int cell); // Clear the given (global) bin of the host profile in all the subsamples
+  bool Add(const SubsampleAccumulator* other);
+  Long64_t Merge(TCollection* collist);
+
+  /// Set the bin contents of a profile (TProfile, TProfile2D) with the same binning as the host to the given subsample
+  template <typename TProf>
+  void CopyToProfile(int sub, TProf* target) const
+  {
+    target->Reset();
+    double* sumWY2 = target->GetSumw2()->fArray;
+    double* sumW2 = target->GetBinSumw2()->fArray;
+    for (int cell = 0; cell < fNCells; cell++) {
+      const double* sums = &fData[index(cell, sub)];
+      target->fArray[cell] = sums[kSumWY];
+      target->SetBinEntries(cell, sums[kSumW]);
+      if (sumWY2) {
+        sumWY2[cell] = sums[kSumWY2];
+      }
+      if (sumW2) {
+        sumW2[cell] = sums[kSumW2];
+      }
+    }
+    target->ResetStats();
+  }
+
+ private:
+  std::size_t index(int cell, int sub) const { return (static_cast<std::size_t>(cell) * fNSubs + sub) * kNSums; }
+  void GenerateEventWeights(double rn);
+
+  int fNCells;
+  int fNSubs;
+  int fMode;
+  std::vector<double> fData;
+  std::vector<double> fEventWeights; //! Poisson weights of the current event, transient
+  double fLastRn;                    //! random number the event weights were generated for, transient
+
+  ClassDef(SubsampleAccumulator, 1);
+};
+
+#endif // PWGCF_GENERICFRAMEWORK_CORE_SUBSAMPLEACCUMULATOR_H_
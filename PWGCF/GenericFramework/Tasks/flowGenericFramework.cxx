@@ -118,6 +118,7 @@ static constexpr std::array<std::array<double, 2>, 4> LongArrayDouble = {{{{-0.8
 
 struct FlowGenericFramework {
   O2_DEFINE_CONFIGURABLE(cfgNbootstrap, int, 10, "Number of subsamples")
+  O2_DEFINE_CONFIGURABLE(cfgSubsampleStorage, int, 0, "Storage of the subsamples: 0 = one profile per subsample, 1 = flat disjoint subsamples")
   O2_DEFINE_CONFIGURABLE(cfgMpar, int, 8, "Highest order of pt-pt correlations")
   O2_DEFINE_CONFIGURABLE(cfgCentEstimator, int, 0, "0:FT0C; 1:FT0CVariant1; 2:FT0M; 3:FT0A, 4:NTPV, 5:NGlobal, 6:MFT")
   O2_DEFINE_CONFIGURABLE(cfgUseNch, bool, false, "Do correlations as function of Nch")
@@ -845,20 +846,24 @@ struct FlowGenericFramework {
     addConfigObjectsToObjArray(oba, corrconfigsV02);
     addConfigObjectsToObjArray(oba, corrconfigsV0);
 
+    if (cfgSubsampleStorage != FlowContainer::kProfileClones && cfgSubsampleStorage != FlowContainer::kFlatDisjoint) { // the jackknife and the profile randomisation need disjoint subsamples
+      LOGF(fatal, "Subsample storage %d not supported, use 0 (one profile per subsample) or 1 (flat disjoint subsamples)", cfgSubsampleStorage.value);
+    }
     if (doprocessData || doprocessRun2 || doprocessMCReco) {
       fFC->SetName("FlowContainer");
       fFC->SetXAxis(fPtAxis);
-      fFC->Initialize(oba, multAxis, cfgNbootstrap);
+      fFC->Initialize(oba, multAxis, cfgNbootstrap, static_cast<FlowContainer::SubsampleStorage>(cfgSubsampleStorage.value));
     }
     if (doprocessMCGen || doprocessOnTheFly) {
       fFCgen->SetName("FlowContainer_gen");
       fFCgen->SetXAxis(fPtAxis);
-      fFCgen->Initialize(oba, multAxis, cfgNbootstrap);
+      fFCgen->Initialize(oba, multAxis, cfgNbootstrap, static_cast<FlowContainer::SubsampleStorage>(cfgSubsampleStorage.value));
     }
     delete oba;
 
     fFCpt->setUseCentralMoments(cfgUseCentralMoments);
     fFCpt->setUseGapMethod(cfgUseGapMethod);
+    fFCpt->setUseFlatSubsamples(cfgSubsampleStorage == FlowContainer::kFlatDisjoint);
     fFCpt->initialise(multAxis, cfgMpar, gfwMemberCache.configs, cfgNbootstrap);
     fFCpt->initialiseSubevent(multAxis, cfgMpar, gfwMemberCache.etagapsPtPt.size(), cfgNbootstrap);
 
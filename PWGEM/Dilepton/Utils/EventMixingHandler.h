@@ -11,71 +11,236 @@
 
 /// \event mixing handler
 /// \author daiki.sekihata@cern.ch
+///
+/// The tracks of all the collisions are stored in one arena, each collision owning a contiguous slab of it.
+/// Getters return spans into the arena instead of copies. They stay valid until the next call of
+/// AddTrackToEventPool or AddCollisionIdAtLast on the same handler, which may move the slabs.
 
 #ifndef PWGEM_DILEPTON_UTILS_EVENTMIXINGHANDLER_H_
 #define PWGEM_DILEPTON_UTILS_EVENTMIXINGHANDLER_H_
 
-#include <map>
+#include <algorithm>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <span>
+#include <tuple>
+#include <type_traits>
+#include <unordered_map>
+#include <utility>
 #include <vector>
 
 namespace o2::aod::pwgem::dilepton::utils
 {
+/// hash of integral keys and of pairs/tuples of them, e.g. <zbin, centbin, epbin, occbin> or <df index, collision index>
+struct EventMixingKeyHash {
+  template <typename K>
+  std::size_t operator()(K const& key) const
+  {
+    if constexpr (std::is_integral_v<K>) {
+      return std::hash<K>{}(key);
+    } else {
+      std::size_t seed = 0;
+      std::apply([&seed](auto const&... x) { ((seed = combine(seed, std::hash<std::decay_t<decltype(x)>>{}(x))), ...); }, key);
+      return seed;
+    }
+  }
+  static std::size_t combine(std::size_t seed, std::size_t h) { return seed ^ (h + 0x9e3779b97f4a7c15ULL + (seed << 6) + (seed >> 2)); }
+};
+
 template <typename T, typename U, typename V>
 class EventMixingHandler
 {
  public:
-  EventMixingHandler()
+  EventMixingHandler() = default;
+  explicit EventMixingHandler(int ndepth) : fNdepth(ndepth) {}
+  ~EventMixingHandler() = default;
+
+  void SetNdepth(int ndepth) { fNdepth = ndepth; }
+
+  static constexpr std::size_t DefaultMaxNbytes = std::size_t{512} << 20; // per handler, well below the memory of a grid job
+
+  /// Upper limit on the memory of the stored tracks, DefaultMaxNbytes unless set, 0 means no limit. When it is exceeded,
+  /// collisions which are not in any pool are dropped first, then the oldest collisions of the deepest pools.
+  void SetMaxNbytes(std::size_t maxNbytes) { fMaxNbytes = maxNbytes; }
+
+  void ReserveNTracksPerCollision(U /*key_df_collision*/, int ntrack)
   {
-    fNdepth = 0;
-    fMapMixBins.clear();
-    fMap_Tracks_per_collision.clear();
+    ReserveArena(ntrack);
   }
 
-  explicit EventMixingHandler(int ndepth)
+  void AddTrackToEventPool(U key_df_collision, V obj)
   {
-    fNdepth = ndepth;
-    fMapMixBins.clear();
-    fMap_Tracks_per_collision.clear();
+    auto [it, isNew] = fSlabs.try_emplace(key_df_collision);
+    Slab& slab = it->second;
+    if (isNew) {
+      slab.offset = fArena.size();
+      fUnpooled.emplace_back(key_df_collision);
+    } else if (slab.offset + slab.size != fArena.size()) {
+      // tracks of this collision are not at the end of the arena any more, move them there to keep the slab contiguous
+      ReserveArena(slab.size + 1); // no reallocation while the slab is copied from the arena itself
+      const std::size_t offset = fArena.size();
+      for (std::size_t i = 0; i < slab.size; i++) {
+        fArena.emplace_back(fArena[slab.offset + i]);
+      }
+      fNdead += slab.size;
+      slab.offset = offset;
+    }
+    fArena.emplace_back(obj);
+    slab.size++;
+    fNlive++;
+    fLastKey = key_df_collision;
   }
 
-  ~EventMixingHandler()
+  std::span<const U> GetCollisionIdsFromEventPool(T key_bin) const
+  {
+    auto it = fMapMixBins.find(key_bin);
+    return it == fMapMixBins.end() ? std::span<const U>{} : std::span<const U>{it->second};
+  }
+  std::span<const V> GetTracksPerCollision(T key_bin, int index) const { return GetTracksPerCollision(GetCollisionIdsFromEventPool(key_bin)[index]); }
+  std::span<const V> GetTracksPerCollision(U key_df_collision) const
   {
-    fMapMixBins.clear();
-    fMap_Tracks_per_collision.clear();
+    auto it = fSlabs.find(key_df_collision);
+    return it == fSlabs.end() ? std::span<const V>{} : std::span<const V>{fArena.data() + it->second.offset, it->second.size};
   }
 
-  void SetNdepth(int ndepth) { fNdepth = ndepth; }
+  // call this function at the end of collision loop
+  void AddCollisionIdAtLast(T key_bin, U key_df_collision)
+  {
+    auto& pool = fMapMixBins[key_bin];
+    if (!pool.empty() && static_cast<int>(pool.size()) >= fNdepth) {
+      ReleaseCollision(pool.front());
+      pool.erase(pool.begin());
+    }
+    pool.emplace_back(key_df_collision);
+    auto it = fSlabs.find(key_df_collision);
+    if (it != fSlabs.end()) {
+      it->second.nPools++;
+    }
+    while (!fUnpooled.empty()) {
+      auto itFront = fSlabs.find(fUnpooled.front());
+      if (itFront != fSlabs.end() && itFront->second.nPools == 0) {
+        break;
+      }
+      fUnpooled.pop_front();
+    }
+    if (fMaxNbytes > 0) {
+      EnforceMemoryLimit();
+    }
+    Compact();
+  }
+
+  // memory accounting
+  std::size_t GetNtracks() const { return fNlive; }
+  std::size_t GetNcollisions() const { return fSlabs.size(); }
+  std::size_t GetNbytes() const { return fNlive * sizeof(V); }
+  std::size_t GetNbytesAllocated() const { return fArena.capacity() * sizeof(V); }
 
-  void ReserveNTracksPerCollision(U key_df_collision, int ntrack)
+ private:
+  struct Slab {
+    std::size_t offset{0}; // first track of the collision in the arena
+    std::size_t size{0};   // number of tracks of the collision
+    int nPools{0};         // number of pools the collision is in
+  };
+
+  /// Makes room for n more tracks, growing the arena geometrically so that reserving per collision stays amortised O(1)
+  void ReserveArena(std::size_t n)
   {
-    fMap_Tracks_per_collision[key_df_collision].reserve(ntrack);
+    if (fArena.size() + n > fArena.capacity()) {
+      fArena.reserve(std::max(2 * fArena.capacity(), fArena.size() + n));
+    }
   }
 
-  void AddTrackToEventPool(U key_df_collision, V obj)
+  void FreeSlab(typename std::unordered_map<U, Slab, EventMixingKeyHash>::iterator it)
   {
-    fMap_Tracks_per_collision[key_df_collision].emplace_back(obj);
+    fNlive -= it->second.size;
+    fNdead += it->second.size;
+    fSlabs.erase(it);
   }
 
-  std::vector<U> GetCollisionIdsFromEventPool(T key_bin) { return fMapMixBins[key_bin]; }
-  std::vector<V> GetTracksPerCollision(T key_bin, int index) { return fMap_Tracks_per_collision[fMapMixBins[key_bin][index]]; }
-  std::vector<V> GetTracksPerCollision(U key_df_collision) { return fMap_Tracks_per_collision[key_df_collision]; }
+  void ReleaseCollision(U key_df_collision)
+  {
+    auto it = fSlabs.find(key_df_collision);
+    if (it != fSlabs.end() && --it->second.nPools <= 0) {
+      FreeSlab(it);
+    }
+  }
 
-  // call this function at the end of collision loop
-  void AddCollisionIdAtLast(T key_bin, U key_df_collision)
+  void EnforceMemoryLimit()
   {
-    // LOGF(info, "fMapMixBins[key_bin].size() = %d", fMapMixBins[key_bin].size());
-    if (static_cast<int>(fMapMixBins[key_bin].size()) >= fNdepth) {
-      fMap_Tracks_per_collision[fMapMixBins[key_bin][0]].clear();
-      fMap_Tracks_per_collision[fMapMixBins[key_bin][0]].shrink_to_fit();
-      fMapMixBins[key_bin].erase(fMapMixBins[key_bin].begin());
+    // collisions which never made it to a pool, oldest first; the last one may still be filled
+    while (GetNbytes() > fMaxNbytes && !fUnpooled.empty()) {
+      const U key = fUnpooled.front();
+      auto it = fSlabs.find(key);
+      if (it != fSlabs.end() && it->second.nPools == 0) {
+        if (key == fLastKey) {
+          break;
+        }
+        FreeSlab(it);
+      }
+      fUnpooled.pop_front();
+    }
+    // then the oldest collision of the deepest pool
+    while (GetNbytes() > fMaxNbytes) {
+      std::vector<U>* deepest = nullptr;
+      for (auto& [key_bin, pool] : fMapMixBins) {
+        if (!deepest || pool.size() > deepest->size()) {
+          deepest = &pool;
+        }
+      }
+      if (!deepest || deepest->empty()) {
+        break;
+      }
+      ReleaseCollision(deepest->front());
+      deepest->erase(deepest->begin());
     }
-    fMapMixBins[key_bin].emplace_back(key_df_collision);
   }
 
- private:
-  int fNdepth;                                           // depth of event mixing
-  std::map<T, std::vector<U>> fMapMixBins;               // map : e.g. <zbin, centbin, epbin> -> pair<df index, global collision index>
-  std::map<U, std::vector<V>> fMap_Tracks_per_collision; // map : e.g. pair<df index, global collision index> -> track array
+  void Compact()
+  {
+    // rebuild the arena once more than half of it is evicted tracks
+    constexpr std::size_t MinNdeadToCompact = 4096;
+    if (fNdead < MinNdeadToCompact || fNdead < fNlive) {
+      return;
+    }
+    std::vector<V> arena;
+    arena.reserve(fNlive + fNlive / 2);
+    auto copySlab = [&](Slab& slab) {
+      const std::size_t offset = arena.size();
+      arena.insert(arena.end(), fArena.begin() + slab.offset, fArena.begin() + slab.offset + slab.size);
+      slab.offset = offset;
+    };
+    auto itLast = fSlabs.find(fLastKey);
+    for (auto it = fSlabs.begin(); it != fSlabs.end(); ++it) {
+      if (it != itLast) {
+        copySlab(it->second);
+      }
+    }
+    if (itLast != fSlabs.end()) {
+      copySlab(itLast->second); // keep the last filled collision at the end, more tracks may be appended to it
+    }
+    fArena.swap(arena);
+    fNdead = 0;
+    // drop the keys of collisions which are gone or pooled
+    std::deque<U> unpooled;
+    for (const auto& key : fUnpooled) {
+      auto it = fSlabs.find(key);
+      if (it != fSlabs.end() && it->second.nPools == 0) {
+        unpooled.emplace_back(key);
+      }
+    }
+    fUnpooled.swap(unpooled);
+  }
+
+  int fNdepth{0};                                                        // depth of event mixing
+  std::size_t fMaxNbytes{DefaultMaxNbytes};                              // upper limit on the memory of the stored tracks, 0 = no limit
+  std::unordered_map<T, std::vector<U>, EventMixingKeyHash> fMapMixBins; // map : e.g. <zbin, centbin, epbin> -> pair<df index, global collision index>
+  std::unordered_map<U, Slab, EventMixingKeyHash> fSlabs;                // map : e.g. pair<df index, global collision index> -> tracks in the arena
+  std::vector<V> fArena;                                                 // tracks of all the collisions
+  std::deque<U> fUnpooled;                                               // collisions with tracks, in order of creation, not yet in a pool
+  U fLastKey{};                                                          // collision which tracks were added last
+  std::size_t fNlive{0};                                                 // number of tracks of stored collisions
+  std::size_t fNdead{0};                                                 // number of evicted or moved tracks still in the arena
 };
 } // namespace o2::aod::pwgem::dilepton::utils
 #endif // PWGEM_DILEPTON_UTILS_EVENTMIXINGHANDLER_H_
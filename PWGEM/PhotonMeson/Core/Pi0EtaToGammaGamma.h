@@ -29,6 +29,7 @@
 #include "PWGEM/PhotonMeson/Utils/EventHistograms.h"
 #include "PWGEM/PhotonMeson/Utils/NMHistograms.h"
 #include "PWGEM/PhotonMeson/Utils/PairUtilities.h"
+#include "PWGEM/PhotonMeson/Utils/PhotonPairEngine.h"
 // Dilepton headers
 #include "PWGEM/Dilepton/Utils/EventMixingHandler.h"
 
@@ -70,6 +71,7 @@
 #include <string>
 #include <tuple>
 #include <type_traits>
+#include <unordered_set>
 #include <utility>
 #include <vector>
 
@@ -288,7 +290,7 @@ struct Pi0EtaToGammaGamma {
   o2::aod::pwgem::dilepton::utils::EventMixingHandler<std::tuple<int, int, int, int>, std::pair<int, int>, o2::aod::pwgem::photonmeson::utils::EMPhoton>* emh2 = nullptr;
   //---------------------------------------------------------------------------
 
-  std::vector<int> used_photonIds_per_col;                   // <ndf, trackId>
+  std::unordered_set<int64_t> used_photonIds_per_col;        // <ndf, trackId>
   std::vector<std::pair<int, int>> used_dileptonIds_per_col; // <ndf, trackId>
   std::map<std::pair<int, int>, uint64_t> map_mixed_eventId_to_globalBC;
 
@@ -406,6 +408,13 @@ struct Pi0EtaToGammaGamma {
   o2::aod::pwgem::photonmeson::utils::pairutil::V0PhotonClassSelection mPhotonClassSelA{};
   o2::aod::pwgem::photonmeson::utils::pairutil::V0PhotonClassSelection mPhotonClassSelB{};
 
+  o2::aod::pwgem::photonmeson::utils::pairengine::PhotonPairEngine mPairEngine;
+  o2::aod::pwgem::photonmeson::utils::pairengine::PairSelection mPairSelection{};        // rapidity and energy asymmetry cuts
+  o2::aod::pwgem::photonmeson::utils::pairengine::PairSelection mPairSelectionNoAlpha{}; // rapidity cut only, for pairs of different kinds in mixed events
+  o2::aod::pwgem::photonmeson::utils::pairengine::PhotonBuffer mPhotonBuffer1;
+  o2::aod::pwgem::photonmeson::utils::pairengine::PhotonBuffer mPhotonBuffer2;
+  o2::aod::pwgem::photonmeson::utils::pairengine::PhotonBuffer mPoolBuffer;
+
   void init(o2::framework::InitContext&)
   {
     zvtx_bin_edges = std::vector<float>(ConfVtxBins.value.begin(), ConfVtxBins.value.end());
@@ -435,6 +444,7 @@ struct Pi0EtaToGammaGamma {
 
     mPhotonClassSelA = o2::aod::pwgem::photonmeson::utils::pairutil::buildV0PhotonClassSelection(photonclassA);
     mPhotonClassSelB = o2::aod::pwgem::photonmeson::utils::pairutil::buildV0PhotonClassSelection(photonclassB);
+    DefinePairSelection();
     DefineDileptonCut();
     DefineEMCCut();
     DefinePHOSCut();
@@ -503,12 +513,33 @@ struct Pi0EtaToGammaGamma {
     emh2 = nullptr;
 
     used_photonIds_per_col.clear();
-    used_photonIds_per_col.shrink_to_fit();
     used_dileptonIds_per_col.clear();
     used_dileptonIds_per_col.shrink_to_fit();
     map_mixed_eventId_to_globalBC.clear();
   }
 
+  void DefinePairSelection()
+  {
+    mPairSelection.maxY = maxY;
+    switch (static_cast<AlphaMesonCutOption>(cfgAlphaMesonCut.value)) {
+      case AlphaMesonCutOption::Off:
+        mPairSelection.alphaCut = o2::aod::pwgem::photonmeson::utils::pairengine::PairSelection::kOff;
+        break;
+      case AlphaMesonCutOption::SpecificValue:
+        mPairSelection.alphaCut = o2::aod::pwgem::photonmeson::utils::pairengine::PairSelection::kSpecificValue;
+        mPairSelection.alphaMax = cfgAlphaMeson;
+        break;
+      case AlphaMesonCutOption::PTDependent:
+        mPairSelection.alphaCut = o2::aod::pwgem::photonmeson::utils::pairengine::PairSelection::kPtDependent;
+        mPairSelection.alphaA = cfgAlphaMesonA;
+        mPairSelection.alphaB = cfgAlphaMesonB;
+        break;
+      default:
+        LOGF(error, "Invalid option for alpha meson cut. No alpha cut will be applied.");
+    }
+    mPairSelectionNoAlpha.maxY = maxY;
+  }
+
   void DefineEMEventCut()
   {
     fEMEventCut = EMPhotonEventCut("fEMEventCut", "fEMEventCut");
@@ -731,6 +762,42 @@ struct Pi0EtaToGammaGamma {
     }
   }
 
+  /// \brief Fill the buffer with the photons passing the single-photon cuts
+  /// \param photons photons of one collision
+  /// \param buffer output buffer
+  /// \param matchedtracks table of matched global tracks to EMCal clusters (optional)
+  /// \param matchedsecondaries table of matched secondary tracks to EMCal clusters (optional)
+  template <typename TDetectorTag, typename TLegs, bool withLegCounts, typename TPhotons, typename TMatchedTracks, typename TMatchedSecondaries>
+  void gatherPhotons(TPhotons const& photons, o2::aod::pwgem::photonmeson::utils::pairengine::PhotonBuffer& buffer, TMatchedTracks const& matchedTracks, TMatchedSecondaries const& matchedSecondaries)
+  {
+    buffer.clear();
+    for (const auto& g : photons) {
+      if constexpr (std::is_same_v<TDetectorTag, EMCTag>) {
+        // For the EMCal case we need to get the primary and secondary matched tracks
+        auto matchedTracksPerCluster = matchedTracks.sliceByCached(TDetectorTag::perClusterMT(), g.globalIndex(), cache);
+        auto matchedSecondariesPerCluster = matchedSecondaries.sliceByCached(TDetectorTag::perClusterMS(), g.globalIndex(), cache);
+        if (!TDetectorTag::applyCut(*this, g, matchedTracksPerCluster, matchedSecondariesPerCluster)) {
+          continue;
+        }
+      } else {
+        if (!TDetectorTag::applyCut(*this, g)) {
+          continue;
+        }
+      }
+
+      float w = 1.f;
+      if constexpr (requires { g.omegaMBWeight(); }) {
+        w = g.omegaMBWeight();
+      }
+      buffer.add(g.pt(), g.eta(), g.phi(), 0.f, g.e(), w, g.globalIndex());
+      if constexpr (withLegCounts) {
+        auto pos = g.template posTrack_as<TLegs>();
+        auto neg = g.template negTrack_as<TLegs>();
+        buffer.setLegCounts(buffer.size() - 1, o2::aod::pwgem::photonmeson::utils::pairutil::getV0PhotonLegCounts(pos, neg));
+      }
+    }
+  }
+
   /// \brief function to run the photon pairing
   /// \tparam TDetectorTag1 tag for TPhotons1 type to select the proper cut function and arguments
   /// \tparam TDetectorTag2 tag for TPhotons2 type to select the proper cut function and arguments
@@ -751,6 +818,10 @@ struct Pi0EtaToGammaGamma {
   void runPairing(TCollisions const& collisions,
                   TPhotons1 const& photons1, TPhotons2 const& photons2, TLegs const& /*legs*/ = nullptr, TMatchedTracks const& matchedTracks = nullptr, TMatchedSecondaries const& matchedSecondaries = nullptr)
   {
+    constexpr bool IsStrictlyUpper = std::is_same_v<TCombinationPolicy<TPhotons1, TPhotons2>, o2::soa::CombinationsStrictlyUpperIndexPolicy<TPhotons1, TPhotons2>>;
+    constexpr bool IsPCMPCM = std::is_same_v<TDetectorTag1, PCMTag> && std::is_same_v<TDetectorTag2, PCMTag>;
+    static_assert(!IsStrictlyUpper || std::is_same_v<TDetectorTag1, TDetectorTag2>, "strictly upper pairing is only defined for photons of the same kind");
+
     for (const auto& collision : collisions) {
       initCCDB(collision);
       int ndiphoton = 0;
@@ -879,9 +950,8 @@ struct Pi0EtaToGammaGamma {
             fRegistry.fill(HIST("Pair/same/hs"), veeg.M(), veeg.Pt(), weight);
 
             std::pair<int, int> tuple_tmp_id2 = std::make_pair(pos2.trackId(), ele2.trackId());
-            if (std::find(used_photonIds_per_col.begin(), used_photonIds_per_col.end(), g1.globalIndex()) == used_photonIds_per_col.end()) {
+            if (used_photonIds_per_col.insert(g1.globalIndex()).second) {
               emh1->AddTrackToEventPool(key_df_collision, o2::aod::pwgem::photonmeson::utils::EMPhoton(g1.pt(), g1.eta(), g1.phi(), 0));
-              used_photonIds_per_col.emplace_back(g1.globalIndex());
             }
             if (std::find(used_dileptonIds_per_col.begin(), used_dileptonIds_per_col.end(), tuple_tmp_id2) == used_dileptonIds_per_col.end()) {
               emh2->AddTrackToEventPool(key_df_collision, o2::aod::pwgem::photonmeson::utils::EMPhoton(v_ee.Pt(), v_ee.Eta(), v_ee.Phi(), v_ee.M()));
@@ -891,109 +961,36 @@ struct Pi0EtaToGammaGamma {
           } // end of dielectron loop
         } // end of g1 loop
       } else { // PCM-PCM, EMC-EMC, PHOS-PHOS, PCM-EMC and PCM-PHOS.
+        // the single-photon cuts, including the matched-track veto of EMCal clusters, are evaluated once per photon
         auto photons1_per_collision = photons1.sliceByCached(TDetectorTag1::perCollision(), collision.globalIndex(), cache);
-        auto photons2_per_collision = photons2.sliceByCached(TDetectorTag2::perCollision(), collision.globalIndex(), cache);
-
-        for (const auto& [g1, g2] : o2::soa::combinations(TCombinationPolicy(photons1_per_collision, photons2_per_collision))) {
-          if constexpr (std::is_same_v<TDetectorTag1, EMCTag>) {
-            // For the EMCal case we need to get the primary and secondary matched tracks
-            auto matchedTracks1 = matchedTracks.sliceByCached(TDetectorTag1::perClusterMT(), g1.globalIndex(), cache);
-            auto matchedSecondaries1 = matchedSecondaries.sliceByCached(TDetectorTag1::perClusterMS(), g1.globalIndex(), cache);
-
-            if (!TDetectorTag1::applyCut(*this, g1, matchedTracks1, matchedSecondaries1)) {
-              continue;
-            }
-          } else {
-            if (!TDetectorTag1::applyCut(*this, g1) || !TDetectorTag2::applyCut(*this, g2)) {
-              continue;
-            }
-          }
-
-          if constexpr (std::is_same_v<TDetectorTag2, EMCTag>) {
-            auto matchedTracks2 = matchedTracks.sliceByCached(TDetectorTag2::perClusterMT(), g2.globalIndex(), cache);
-            auto matchedSecondaries2 = matchedSecondaries.sliceByCached(TDetectorTag2::perClusterMS(), g2.globalIndex(), cache);
-            if (!TDetectorTag2::applyCut(*this, g2, matchedTracks2, matchedSecondaries2)) {
-              continue;
-            }
-          } else {
-            if (!TDetectorTag2::applyCut(*this, g2)) {
-              continue;
-            }
-          }
-
-          o2::aod::pwgem::photonmeson::utils::pairutil::V0PhotonLegCounts legCounts1{}, legCounts2{};
-          if constexpr (std::is_same_v<TDetectorTag1, PCMTag> && std::is_same_v<TDetectorTag2, PCMTag>) {
-            auto pos1 = g1.template posTrack_as<TLegs>();
-            auto neg1 = g1.template negTrack_as<TLegs>();
-            auto pos2 = g2.template posTrack_as<TLegs>();
-            auto neg2 = g2.template negTrack_as<TLegs>();
-            legCounts1 = o2::aod::pwgem::photonmeson::utils::pairutil::getV0PhotonLegCounts(pos1, neg1);
-            legCounts2 = o2::aod::pwgem::photonmeson::utils::pairutil::getV0PhotonLegCounts(pos2, neg2);
-            if (cfgDoPhotonClassPairCut.value &&
-                !o2::aod::pwgem::photonmeson::utils::pairutil::isPairPhotonClassSelected(legCounts1, legCounts2, mPhotonClassSelA, mPhotonClassSelB)) {
-              continue;
-            }
-          }
-
-          ROOT::Math::PtEtaPhiMVector v1(g1.pt(), g1.eta(), g1.phi(), 0.);
-          ROOT::Math::PtEtaPhiMVector v2(g2.pt(), g2.eta(), g2.phi(), 0.);
-          ROOT::Math::PtEtaPhiMVector v12 = v1 + v2;
-          if (std::fabs(v12.Rapidity()) > maxY) {
-            continue;
-          }
-
-          float alphaMeson = std::fabs(g1.e() - g2.e()) / (g1.e() + g2.e());
-          float alphaCut = 999.f;
-          switch (static_cast<AlphaMesonCutOption>(cfgAlphaMesonCut.value)) {
-            case AlphaMesonCutOption::Off:
-              break;
-            case AlphaMesonCutOption::SpecificValue:
-              alphaCut = cfgAlphaMeson;
-              break;
-            case AlphaMesonCutOption::PTDependent: {
-              alphaCut = cfgAlphaMesonA * std::tanh(cfgAlphaMesonB * v12.pt());
-              break;
-            }
-            default:
-              LOGF(error, "Invalid option for alpha meson cut. No alpha cut will be applied.");
-          }
-          if (alphaMeson > alphaCut) {
-            continue;
-          }
-
-          float wpair = weight;
-
-          if constexpr (requires { g1.omegaMBWeight(); }) {
-            wpair *= g1.omegaMBWeight();
-          }
-          if constexpr (requires { g2.omegaMBWeight(); }) {
-            wpair *= g2.omegaMBWeight();
+        gatherPhotons<TDetectorTag1, TLegs, IsPCMPCM>(photons1_per_collision, mPhotonBuffer1, matchedTracks, matchedSecondaries);
+        if constexpr (!IsStrictlyUpper) {
+          auto photons2_per_collision = photons2.sliceByCached(TDetectorTag2::perCollision(), collision.globalIndex(), cache);
+          gatherPhotons<TDetectorTag2, TLegs, IsPCMPCM>(photons2_per_collision, mPhotonBuffer2, matchedTracks, matchedSecondaries);
+        }
+        auto const& buffer1 = mPhotonBuffer1;
+        auto const& buffer2 = IsStrictlyUpper ? mPhotonBuffer1 : mPhotonBuffer2;
+
+        auto isPairClassSelected = [&](std::size_t i, std::size_t j) {
+          if constexpr (IsPCMPCM) {
+            return !cfgDoPhotonClassPairCut.value || o2::aod::pwgem::photonmeson::utils::pairutil::isPairPhotonClassSelected(buffer1.legCounts[i], buffer2.legCounts[j], mPhotonClassSelA, mPhotonClassSelB);
           }
+          return true;
+        };
+        mPairEngine.process(buffer1, buffer2, IsStrictlyUpper, mPairSelection, isPairClassSelected, [&](std::size_t i, std::size_t j, o2::aod::pwgem::photonmeson::utils::pairengine::PairKinematics const& pair) {
+          fRegistry.fill(HIST("Pair/same/hs"), pair.mass, pair.pt, weight * pair.weight);
 
-          fRegistry.fill(HIST("Pair/same/hs"), v12.M(), v12.Pt(), wpair);
-
-          if (std::find(used_photonIds_per_col.begin(), used_photonIds_per_col.end(), g1.globalIndex()) == used_photonIds_per_col.end()) {
-            auto emphoton1 = o2::aod::pwgem::photonmeson::utils::EMPhoton(g1.pt(), g1.eta(), g1.phi(), 0);
-            if constexpr (std::is_same_v<TDetectorTag1, PCMTag> && std::is_same_v<TDetectorTag2, PCMTag>) {
-              emphoton1.setLegCounts(legCounts1);
-            }
-            emh1->AddTrackToEventPool(key_df_collision, emphoton1);
-            used_photonIds_per_col.emplace_back(g1.globalIndex());
+          if (used_photonIds_per_col.insert(buffer1.globalIndex[i]).second) {
+            emh1->AddTrackToEventPool(key_df_collision, buffer1.toEMPhoton(i));
           }
-          if (std::find(used_photonIds_per_col.begin(), used_photonIds_per_col.end(), g2.globalIndex()) == used_photonIds_per_col.end()) {
-            auto emphoton2 = o2::aod::pwgem::photonmeson::utils::EMPhoton(g2.pt(), g2.eta(), g2.phi(), 0);
-            if constexpr (std::is_same_v<TDetectorTag1, PCMTag> && std::is_same_v<TDetectorTag2, PCMTag>) {
-              emphoton2.setLegCounts(legCounts1);
-            }
-            emh2->AddTrackToEventPool(key_df_collision, emphoton2);
-            used_photonIds_per_col.emplace_back(g2.globalIndex());
+          if (used_photonIds_per_col.insert(buffer2.globalIndex[j]).second) {
+            emh2->AddTrackToEventPool(key_df_collision, buffer2.toEMPhoton(j));
           }
           ndiphoton++;
-        } // end of pairing loop
+        });
       } // end of pairing in same event
 
       used_photonIds_per_col.clear();
-      used_photonIds_per_col.shrink_to_fit();
       used_dileptonIds_per_col.clear();
       used_dileptonIds_per_col.shrink_to_fit();
 
@@ -1009,132 +1006,62 @@ struct Pi0EtaToGammaGamma {
       auto collisionIds1_in_mixing_pool = emh1->GetCollisionIdsFromEventPool(key_bin);
       auto collisionIds2_in_mixing_pool = emh2->GetCollisionIdsFromEventPool(key_bin);
 
-      if constexpr (pairtype == o2::aod::pwgem::photonmeson::photonpair::PairType::kPCMPCM || pairtype == o2::aod::pwgem::photonmeson::photonpair::PairType::kPHOSPHOS || pairtype == o2::aod::pwgem::photonmeson::photonpair::PairType::kEMCEMC) { // same kinds pairing
-        for (const auto& mix_dfId_collisionId : collisionIds1_in_mixing_pool) {
-          int mix_dfId = mix_dfId_collisionId.first;
-          int64_t mix_collisionId = mix_dfId_collisionId.second;
-
-          if (collision.globalIndex() == mix_collisionId && ndf == mix_dfId) { // this never happens. only protection.
-            continue;
-          }
-
-          auto globalBC_mix = map_mixed_eventId_to_globalBC[mix_dfId_collisionId];
-          uint64_t diffBC = std::max(collision.globalBC(), globalBC_mix) - std::min(collision.globalBC(), globalBC_mix);
-          fRegistry.fill(HIST("Pair/mix/hDiffBC"), diffBC);
-          if (diffBC < ndiff_bc_mix) {
-            continue;
-          }
-
-          auto photons1_from_event_pool = emh1->GetTracksPerCollision(mix_dfId_collisionId);
-          // LOGF(info, "Do event mixing: current event (%d, %d), ngamma = %d | event pool (%d, %d), ngamma = %d", ndf, collision.globalIndex(), selected_photons1_in_this_event.size(), mix_dfId, mix_collisionId, photons1_from_event_pool.size());
-
-          for (const auto& g1 : selected_photons1_in_this_event) {
-            for (const auto& g2 : photons1_from_event_pool) {
-              if constexpr (pairtype == o2::aod::pwgem::photonmeson::photonpair::PairType::kPCMPCM) {
-                if (cfgDoPhotonClassPairCut.value) {
-                  if (!g1.hasLegCounts() || !g2.hasLegCounts() ||
-                      !o2::aod::pwgem::photonmeson::utils::pairutil::isPairPhotonClassSelected(g1.legCounts(), g2.legCounts(), mPhotonClassSelA, mPhotonClassSelB)) {
-                    continue;
-                  }
-                }
-              }
-              ROOT::Math::PtEtaPhiMVector v1(g1.pt(), g1.eta(), g1.phi(), 0.);
-              ROOT::Math::PtEtaPhiMVector v2(g2.pt(), g2.eta(), g2.phi(), 0.);
-              ROOT::Math::PtEtaPhiMVector v12 = v1 + v2;
-              if (std::fabs(v12.Rapidity()) > maxY) {
-                continue;
-              }
-              // as photon has mass= 0 e = p
-              float alphaMeson = std::fabs(g1.p() - g2.p()) / (g1.p() + g2.p());
-              float alphaCut = 999.f;
-              switch (static_cast<AlphaMesonCutOption>(cfgAlphaMesonCut.value)) {
-                case AlphaMesonCutOption::Off:
-                  break;
-                case AlphaMesonCutOption::SpecificValue:
-                  alphaCut = cfgAlphaMeson;
-                  break;
-                case AlphaMesonCutOption::PTDependent: {
-                  alphaCut = cfgAlphaMesonA * std::tanh(cfgAlphaMesonB * v12.pt());
-                  break;
-                }
-                default:
-                  LOGF(error, "Invalid option for alpha meson cut. No alpha cut will be applied.");
-              }
-              if (alphaMeson > alphaCut) {
-                continue;
-              }
+      auto fillMixedPair = [&](std::size_t, std::size_t, o2::aod::pwgem::photonmeson::utils::pairengine::PairKinematics const& pair) {
+        fRegistry.fill(HIST("Pair/mix/hs"), pair.mass, pair.pt, weight);
+      };
+      // pairs the photons of the current event with those of the given pool collision, if far enough in time
+      auto mixWithPool = [&](auto const& emh, std::pair<int, int> const& mix_dfId_collisionId, auto const& currentBuffer, auto const& selection, auto&& preselect) {
+        int mix_dfId = mix_dfId_collisionId.first;
+        int64_t mix_collisionId = mix_dfId_collisionId.second;
+
+        if (collision.globalIndex() == mix_collisionId && ndf == mix_dfId) { // this never happens. only protection.
+          return;
+        }
+
+        auto globalBC_mix = map_mixed_eventId_to_globalBC[mix_dfId_collisionId];
+        uint64_t diffBC = std::max(collision.globalBC(), globalBC_mix) - std::min(collision.globalBC(), globalBC_mix);
+        fRegistry.fill(HIST("Pair/mix/hDiffBC"), diffBC);
+        if (diffBC < ndiff_bc_mix) {
+          return;
+        }
+
+        mPoolBuffer.clear();
+        for (const auto& g : emh->GetTracksPerCollision(mix_dfId_collisionId)) {
+          mPoolBuffer.add(g);
+        }
+        mPairEngine.process(currentBuffer, mPoolBuffer, false, selection, preselect, fillMixedPair);
+      };
+
+      mPhotonBuffer1.clear();
+      for (const auto& g : selected_photons1_in_this_event) {
+        mPhotonBuffer1.add(g);
+      }
 
-              fRegistry.fill(HIST("Pair/mix/hs"), v12.M(), v12.Pt(), weight);
+      if constexpr (pairtype == o2::aod::pwgem::photonmeson::photonpair::PairType::kPCMPCM || pairtype == o2::aod::pwgem::photonmeson::photonpair::PairType::kPHOSPHOS || pairtype == o2::aod::pwgem::photonmeson::photonpair::PairType::kEMCEMC) { // same kinds pairing
+        auto isPairClassSelected = [&](std::size_t i, std::size_t j) {
+          if constexpr (pairtype == o2::aod::pwgem::photonmeson::photonpair::PairType::kPCMPCM) {
+            if (cfgDoPhotonClassPairCut.value) {
+              return mPhotonBuffer1.hasLegCounts[i] && mPoolBuffer.hasLegCounts[j] &&
+                     o2::aod::pwgem::photonmeson::utils::pairutil::isPairPhotonClassSelected(mPhotonBuffer1.legCounts[i], mPoolBuffer.legCounts[j], mPhotonClassSelA, mPhotonClassSelB);
             }
           }
+          return true;
+        };
+        for (const auto& mix_dfId_collisionId : collisionIds1_in_mixing_pool) {
+          mixWithPool(emh1, mix_dfId_collisionId, mPhotonBuffer1, mPairSelection, isPairClassSelected);
         } // end of loop over mixed event pool
 
       } else { // [photon1 from event1, photon2 from event2] and [photon1 from event2, photon2 from event1]
+        mPhotonBuffer2.clear();
+        for (const auto& g : selected_photons2_in_this_event) {
+          mPhotonBuffer2.add(g);
+        }
+        auto noPreselection = [](std::size_t, std::size_t) { return true; };
         for (const auto& mix_dfId_collisionId : collisionIds2_in_mixing_pool) {
-          int mix_dfId = mix_dfId_collisionId.first;
-          int64_t mix_collisionId = mix_dfId_collisionId.second;
-
-          if (collision.globalIndex() == mix_collisionId && ndf == mix_dfId) { // this never happens. only protection.
-            continue;
-          }
-
-          auto globalBC_mix = map_mixed_eventId_to_globalBC[mix_dfId_collisionId];
-          uint64_t diffBC = std::max(collision.globalBC(), globalBC_mix) - std::min(collision.globalBC(), globalBC_mix);
-          fRegistry.fill(HIST("Pair/mix/hDiffBC"), diffBC);
-          if (diffBC < ndiff_bc_mix) {
-            continue;
-          }
-
-          auto photons2_from_event_pool = emh2->GetTracksPerCollision(mix_dfId_collisionId);
-          // LOGF(info, "Do event mixing: current event (%d, %d), ngamma = %d | event pool (%d, %d), nll = %d", ndf, collision.globalIndex(), selected_photons1_in_this_event.size(), mix_dfId, mix_collisionId, photons2_from_event_pool.size());
-
-          for (const auto& g1 : selected_photons1_in_this_event) {
-            for (const auto& g2 : photons2_from_event_pool) {
-              ROOT::Math::PtEtaPhiMVector v1(g1.pt(), g1.eta(), g1.phi(), 0.);
-              ROOT::Math::PtEtaPhiMVector v2(g2.pt(), g2.eta(), g2.phi(), 0.);
-              if constexpr (pairtype == o2::aod::pwgem::photonmeson::photonpair::PairType::kPCMDalitzEE) { //[photon from event1, dilepton from event2] and [photon from event2, dilepton from event1]
-                v2.SetM(g2.mass());
-              }
-              ROOT::Math::PtEtaPhiMVector v12 = v1 + v2;
-              if (std::fabs(v12.Rapidity()) > maxY) {
-                continue;
-              }
-              fRegistry.fill(HIST("Pair/mix/hs"), v12.M(), v12.Pt(), weight);
-            }
-          }
+          mixWithPool(emh2, mix_dfId_collisionId, mPhotonBuffer1, mPairSelectionNoAlpha, noPreselection);
         } // end of loop over mixed event pool
         for (const auto& mix_dfId_collisionId : collisionIds1_in_mixing_pool) {
-          int mix_dfId = mix_dfId_collisionId.first;
-          int64_t mix_collisionId = mix_dfId_collisionId.second;
-
-          if (collision.globalIndex() == mix_collisionId && ndf == mix_dfId) { // this never happens. only protection.
-            continue;
-          }
-
-          auto globalBC_mix = map_mixed_eventId_to_globalBC[mix_dfId_collisionId];
-          uint64_t diffBC = std::max(collision.globalBC(), globalBC_mix) - std::min(collision.globalBC(), globalBC_mix);
-          fRegistry.fill(HIST("Pair/mix/hDiffBC"), diffBC);
-          if (diffBC < ndiff_bc_mix) {
-            continue;
-          }
-
-          auto photons1_from_event_pool = emh1->GetTracksPerCollision(mix_dfId_collisionId);
-          // LOGF(info, "Do event mixing: current event (%d, %d), nll = %d | event pool (%d, %d), ngamma = %d", ndf, collision.globalIndex(), selected_photons2_in_this_event.size(), mix_dfId, mix_collisionId, photons1_from_event_pool.size());
-
-          for (const auto& g1 : selected_photons2_in_this_event) {
-            for (const auto& g2 : photons1_from_event_pool) {
-              ROOT::Math::PtEtaPhiMVector v1(g1.pt(), g1.eta(), g1.phi(), 0.);
-              ROOT::Math::PtEtaPhiMVector v2(g2.pt(), g2.eta(), g2.phi(), 0.);
-              if constexpr (pairtype == o2::aod::pwgem::photonmeson::photonpair::PairType::kPCMDalitzEE) { //[photon from event1, dilepton from event2] and [photon from event2, dilepton from event1]
-                v1.SetM(g1.mass());
-              }
-              ROOT::Math::PtEtaPhiMVector v12 = v1 + v2;
-              if (std::fabs(v12.Rapidity()) > maxY) {
-                continue;
-              }
-              fRegistry.fill(HIST("Pair/mix/hs"), v12.M(), v12.Pt(), weight);
-            }
-          }
+          mixWithPool(emh1, mix_dfId_collisionId, mPhotonBuffer2, mPairSelectionNoAlpha, noPreselection);
         } // end of loop over mixed event pool
       }
 
@@ -0,0 +1,240 @@
+// Copyright 2019-2020 CERN and copyright holders of ALICE O2.
+// See https://alice-o2.web.cern.ch/copyright for details of the copyright holders.
+// All rights not expressly granted are reserved.
+//
+// This software is distributed under the terms of the GNU General Public
+// License v3 (GPL Version 3), copied verbatim in the file "COPYING".
+//
+// In applying this license CERN does not waive the privileges and immunities
+// granted to it by virtue of its status as an Intergovernmental Organization
+// or submit itself to any jurisdiction.
+
+/// \brief pairing engine for two-photon analyses, shared by same-event and mixed-event pairing.
+///
+/// The photons of one event which passed the single-photon selection (including the matched-track veto of EMCal
+/// clusters) are gathered once into a PhotonBuffer, a structure of arrays with the 4-momenta. The engine then
+/// evaluates the pair kinematics (mass, pT, rapidity, opening angle, energy asymmetry) and the pair cuts for blocks
+/// of pairs, the indices of the pairs of a block being collected first so that the kinematics loop does not depend
+/// on the pair preselection, and hands the accepted pairs back in pair order.
+
+#ifndef PWGEM_PHOTONMESON_UTILS_PHOTONPAIRENGINE_H_
+#define PWGEM_PHOTONMESON_UTILS_PHOTONPAIRENGINE_H_
+
+#include "PWGEM/PhotonMeson/Utils/EMPhoton.h"
+#include "PWGEM/PhotonMeson/Utils/PairUtilities.h"
+
+#include <array>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace o2::aod::pwgem::photonmeson::utils::pairengine
+{
+/// photons of one event as structure of arrays
+struct PhotonBuffer {
+  std::vector<double> px, py, pz, e; // 4-momentum, computed as ROOT::Math::PtEtaPhiMVector does
+  std::vector<float> pt, eta, phi, mass;
+  std::vector<float> eAsym;  // energy used in the energy asymmetry of the pair
+  std::vector<float> weight; // per-photon weight
+  std::vector<int64_t> globalIndex;
+  std::vector<o2::aod::pwgem::photonmeson::utils::pairutil::V0PhotonLegCounts> legCounts;
+  std::vector<uint8_t> hasLegCounts;
+
+  std::size_t size() const { return px.size(); }
+  bool empty() const { return px.empty(); }
+
+  void clear()
+  {
+    px.clear();
+    py.clear();
+    pz.clear();
+    e.clear();
+    pt.clear();
+    eta.clear();
+    phi.clear();
+    mass.clear();
+    eAsym.clear();
+    weight.clear();
+    globalIndex.clear();
+    legCounts.clear();
+    hasLegCounts.clear();
+  }
+
+  void add(float ptIn, float etaIn, float phiIn, float massIn, float eAsymIn, float weightIn = 1.f, int64_t globalIndexIn = -1)
+  {
+    const double ptD = ptIn;
+    const double pxD = ptD * std::cos(static_cast<double>(phiIn));
+    const double pyD = ptD * std::sin(static_cast<double>(phiIn));
+    const double pzD = ptD * std::sinh(static_cast<double>(etaIn));
+    const double massD = massIn;
+    px.emplace_back(pxD);
+    py.emplace_back(pyD);
+    pz.emplace_back(pzD);
+    e.emplace_back(std::sqrt(pxD * pxD + pyD * pyD + pzD * pzD + massD * massD));
+    pt.emplace_back(ptIn);
+    eta.emplace_back(etaIn);
+    phi.emplace_back(phiIn);
+    mass.emplace_back(massIn);
+    eAsym.emplace_back(eAsymIn);
+    weight.emplace_back(weightIn);
+    globalIndex.emplace_back(globalIndexIn);
+    legCounts.emplace_back();
+    hasLegCounts.emplace_back(0);
+  }
+
+  void add(EMPhoton const& g)
+  {
+    // as photon has mass = 0, e = p
+    add(g.pt(), g.eta(), g.phi(), g.mass(), g.p());
+    if (g.hasLegCounts()) {
+      setLegCounts(size() - 1, g.legCounts());
+    }
+  }
+
+  void setLegCounts(std::size_t i, o2::aod::pwgem::photonmeson::utils::pairutil::V0PhotonLegCounts const& c)
+  {
+    legCounts[i] = c;
+    hasLegCounts[i] = 1;
+  }
+
+  EMPhoton toEMPhoton(std::size_t i) const
+  {
+    EMPhoton g(pt[i], eta[i], phi[i], 0);
+    if (hasLegCounts[i]) {
+      g.setLegCounts(legCounts[i]);
+    }
+    return g;
+  }
+};
+
+/// kinematics of one accepted pair, passed to the fill function
+struct PairKinematics {
+  float mass;
+  float pt;
+  float rapidity;
+  float cosOpeningAngle;
+  float alpha;
+  float weight; // product of the photon weights
+};
+
+/// pair cuts, the options of the energy asymmetry cut follow AlphaMesonCutOption of Pi0EtaToGammaGamma
+struct PairSelection {
+  enum AlphaCut : int {
+    kOff = 0,
+    kSpecificValue = 1,
+    kPtDependent = 2
+  };
+  float maxY{1e+10f};
+  int alphaCut{kOff};
+  float alphaMax{999.f};
+  float alphaA{0.f};
+  float alphaB{0.f};
+};
+
+class PhotonPairEngine
+{
+ public:
+  static constexpr std::size_t BlockSize = 256;
+
+  /// Loop over the pairs (i, j) of photons i in b1 and j in b2, in the order of o2::soa::combinations:
+  /// i < j if strictlyUpper (b1 and b2 being the same buffer), all the pairs otherwise.
+  /// preselect(i, j) is evaluated while gathering the pairs, fill(i, j, PairKinematics) is called for each accepted pair.
+  template <typename TPreselect, typename TFill>
+  void process(PhotonBuffer const& b1, PhotonBuffer const& b2, bool strictlyUpper, PairSelection const& sel, TPreselect&& preselect, TFill&& fill)
+  {
+    const std::size_t n1 = b1.size();
+    const std::size_t n2 = b2.size();
+    std::size_t n = 0;
+    for (std::size_t i = 0; i < n1; i++) {
+      for (std::size_t j = strictlyUpper ? i + 1 : 0; j < n2; j++) {
+        if (!preselect(i, j)) {
+          continue;
+        }
+        mI1[n] = static_cast<uint32_t>(i);
+        mI2[n] = static_cast<uint32_t>(j);
+        if (++n == BlockSize) {
+          computeBlock(b1, b2, n, sel);
+          flushBlock(n, fill);
+          n = 0;
+        }
+      }
+    }
+    if (n > 0) {
+      computeBlock(b1, b2, n, sel);
+      flushBlock(n, fill);
+    }
+  }
+
+  template <typename TFill>
+  void process(PhotonBuffer const& b1, PhotonBuffer const& b2, bool strictlyUpper, PairSelection const& sel, TFill&& fill)
+  {
+    process(b1, b2, strictlyUpper, sel, [](std::size_t, std::size_t) { return true; }, fill);
+  }
+
+ private:
+  void computeBlock(PhotonBuffer const& b1, PhotonBuffer const& b2, std::size_t n, PairSelection const& sel)
+  {
+    const double* px1 = b1.px.data();
+    const double* py1 = b1.py.data();
+    const double* pz1 = b1.pz.data();
+    const double* e1 = b1.e.data();
+    const double* px2 = b2.px.data();
+    const double* py2 = b2.py.data();
+    const double* pz2 = b2.pz.data();
+    const double* e2 = b2.e.data();
+    const float* ea1 = b1.eAsym.data();
+    const float* ea2 = b2.eAsym.data();
+    const float* w1 = b1.weight.data();
+    const float* w2 = b2.weight.data();
+    for (std::size_t k = 0; k < n; k++) {
+      const uint32_t i = mI1[k];
+      const uint32_t j = mI2[k];
+      const double px = px1[i] + px2[j];
+      const double py = py1[i] + py2[j];
+      const double pz = pz1[i] + pz2[j];
+      const double e = e1[i] + e2[j];
+      const double pt2 = px * px + py * py;
+      const double m2 = e * e - pt2 - pz * pz;
+      const double p1 = std::sqrt(px1[i] * px1[i] + py1[i] * py1[i] + pz1[i] * pz1[i]);
+      const double p2 = std::sqrt(px2[j] * px2[j] + py2[j] * py2[j] + pz2[j] * pz2[j]);
+      mMass[k] = static_cast<float>(m2 >= 0. ? std::sqrt(m2) : -std::sqrt(-m2));
+      mPt[k] = static_cast<float>(std::sqrt(pt2));
+      mRapidity[k] = static_cast<float>(0.5 * std::log((e + pz) / (e - pz)));
+      mCosOpeningAngle[k] = static_cast<float>((px1[i] * px2[j] + py1[i] * py2[j] + pz1[i] * pz2[j]) / (p1 * p2));
+      mAlpha[k] = std::fabs(ea1[i] - ea2[j]) / (ea1[i] + ea2[j]);
+      mWeight[k] = w1[i] * w2[j];
+    }
+    float alphaMax = 999.f;
+    if (sel.alphaCut == PairSelection::kSpecificValue) {
+      alphaMax = sel.alphaMax;
+    }
+    for (std::size_t k = 0; k < n; k++) {
+      const float alphaCut = sel.alphaCut == PairSelection::kPtDependent ? sel.alphaA * std::tanh(sel.alphaB * mPt[k]) : alphaMax;
+      mAccepted[k] = !(std::fabs(mRapidity[k]) > sel.maxY) & !(mAlpha[k] > alphaCut);
+    }
+  }
+
+  template <typename TFill>
+  void flushBlock(std::size_t n, TFill&& fill)
+  {
+    for (std::size_t k = 0; k < n; k++) {
+      if (mAccepted[k]) {
+        fill(mI1[k], mI2[k], PairKinematics{mMass[k], mPt[k], mRapidity[k], mCosOpeningAngle[k], mAlpha[k], mWeight[k]});
+      }
+    }
+  }
+
+  std::array<uint32_t, BlockSize> mI1{};
+  std::array<uint32_t, BlockSize> mI2{};
+  std::array<float, BlockSize> mMass{};
+  std::array<float, BlockSize> mPt{};
+  std::array<float, BlockSize> mRapidity{};
+  std::array<float, BlockSize> mCosOpeningAngle{};
+  std::array<float, BlockSize> mAlpha{};
+  std::array<float, BlockSize> mWeight{};
+  std::array<uint8_t, BlockSize> mAccepted{};
+};
+} // namespace o2::aod::pwgem::photonmeson::utils::pairengine
+
+#endif // PWGEM_PHOTONMESON_UTILS_PHOTONPAIRENGINE_H_
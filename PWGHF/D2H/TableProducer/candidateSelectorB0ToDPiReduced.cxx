@@ -22,6 +22,7 @@
 #include "PWGHF/DataModel/CandidateSelectionTables.h"
 #include "PWGHF/Utils/utilsPid.h"
 
+#include "Common/Core/CCDBNodeCache.h"
 #include "Common/Core/TrackSelectorPID.h"
 
 #include <CCDB/CcdbApi.h>
@@ -92,6 +93,7 @@ struct HfCandidateSelectorB0ToDPiReduced {
   Configurable<std::vector<std::string>> onnxFileNames{"onnxFileNames", std::vector<std::string>{"ModelHandler_onnx_B0ToDPi.onnx"}, "ONNX file names for each pT bin (if not from CCDB full path)"};
   Configurable<int64_t> timestampCCDB{"timestampCCDB", -1, "timestamp of the ONNX file for ML model used to query in CCDB"};
   Configurable<bool> loadModelsFromCCDB{"loadModelsFromCCDB", false, "Flag to enable or disable the loading of models from CCDB"};
+  Configurable<bool> useCCDBNodeCache{"useCCDBNodeCache", false, "Load the models from CCDB through the cache shared by the devices of the node"};
   // variable that will store the value of selectionFlagD (defined in dataCreatorDplusPiReduced.cxx)
   int mySelectionFlagD = -1;
 
@@ -99,6 +101,7 @@ struct HfCandidateSelectorB0ToDPiReduced {
   float outputMlNotPreselected = -1.;
   std::vector<float> outputMl;
   o2::ccdb::CcdbApi ccdbApi;
+  o2::common::core::CCDBNodeCache ccdbNodeCache;
 
   TrackSelectorPi selectorPion;
 
@@ -146,7 +149,13 @@ struct HfCandidateSelectorB0ToDPiReduced {
       hfMlResponse.configure(binsPtB0Ml, cutsB0Ml, cutDirB0Ml, nClassesB0Ml);
       if (loadModelsFromCCDB) {
         ccdbApi.init(ccdbUrl);
-        hfMlResponse.setModelPathsCCDB(onnxFileNames, ccdbApi, modelPathsCCDB, timestampCCDB);
+        if (useCCDBNodeCache) {
+          ccdbNodeCache.init(&ccdbApi);
+          hfMlResponse.setModelPathsCCDB(onnxFileNames, ccdbNodeCache, modelPathsCCDB, timestampCCDB);
+          ccdbNodeCache.printStats();
+        } else {
+          hfMlResponse.setModelPathsCCDB(onnxFileNames, ccdbApi, modelPathsCCDB, timestampCCDB);
+        }
       } else {
         hfMlResponse.setModelPathsLocal(onnxFileNames);
       }
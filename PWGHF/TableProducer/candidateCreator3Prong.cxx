@@ -152,6 +152,15 @@ struct HfCandidateCreator3Prong {
   int runNumber{0};
   double bz{0.};
 
+  // daughter KFParticles under the p, pi, K hypotheses, converted once per track
+  enum KfHypothesis : int {
+    KfProton = 0,
+    KfPion,
+    KfKaon,
+    NKfHypotheses
+  };
+  KFDaughterBlock<NKfHypotheses> kfDaughters;
+
   constexpr static float CentiToMicro{10000.f}; // from cm to µm
   constexpr static float UndefValueFloat{-999.f};
 
@@ -468,9 +477,11 @@ struct HfCandidateCreator3Prong {
   template <bool DoPvRefit, bool ApplyUpcSel, o2::hf_centrality::CentralityEstimator CentEstimator, typename Coll, typename Cand, typename BCsType>
   void runCreator3ProngWithKFParticle(Coll const&,
                                       Cand const& rowsTrackIndexProng3,
-                                      TracksWCovExtraPidPiKaPrLightNuclei const&,
+                                      TracksWCovExtraPidPiKaPrLightNuclei const& tracks,
                                       BCsType const& bcs)
   {
+    static constexpr std::array<int, NKfHypotheses> KfPdgCodes{kProton, kPiPlus, kKPlus};
+    kfDaughters.reset(tracks.size());
     for (const auto& rowTrackIndexProng3 : rowsTrackIndexProng3) {
       /// reject candidates in collisions not satisfying the event selections
       auto collision = rowTrackIndexProng3.template collision_as<Coll>();
@@ -522,17 +533,21 @@ struct HfCandidateCreator3Prong {
       registry.fill(HIST("hCovPVXZ"), covMatrixPV[3]);
       registry.fill(HIST("hCovPVZZ"), covMatrixPV[5]);
 
-      KFPTrack const kfpTrack0 = createKFPTrackFromTrack(track0);
-      KFPTrack const kfpTrack1 = createKFPTrackFromTrack(track1);
-      KFPTrack const kfpTrack2 = createKFPTrackFromTrack(track2);
+      // tracks shared by several candidates are converted only once
+      const int lane0 = kfDaughters.addTrack(track0, KfPdgCodes);
+      const int lane1 = kfDaughters.addTrack(track1, KfPdgCodes);
+      const int lane2 = kfDaughters.addTrack(track2, KfPdgCodes);
+      if (kfDaughters.laneStatus(lane0) != KFStatus::Ok || kfDaughters.laneStatus(lane1) != KFStatus::Ok || kfDaughters.laneStatus(lane2) != KFStatus::Ok) {
+        continue;
+      }
 
-      KFParticle const kfFirstProton(kfpTrack0, kProton);
-      KFParticle const kfFirstPion(kfpTrack0, kPiPlus);
-      KFParticle const kfFirstKaon(kfpTrack0, kKPlus);
-      KFParticle const kfSecondKaon(kfpTrack1, kKPlus);
-      KFParticle const kfThirdProton(kfpTrack2, kProton);
-      KFParticle const kfThirdPion(kfpTrack2, kPiPlus);
-      KFParticle const kfThirdKaon(kfpTrack2, kKPlus);
+      KFParticle const& kfFirstProton = kfDaughters.particle(lane0, KfProton);
+      KFParticle const& kfFirstPion = kfDaughters.particle(lane0, KfPion);
+      KFParticle const& kfFirstKaon = kfDaughters.particle(lane0, KfKaon);
+      KFParticle const& kfSecondKaon = kfDaughters.particle(lane1, KfKaon);
+      KFParticle const& kfThirdProton = kfDaughters.particle(lane2, KfProton);
+      KFParticle const& kfThirdPion = kfDaughters.particle(lane2, KfPion);
+      KFParticle const& kfThirdKaon = kfDaughters.particle(lane2, KfKaon);
 
       float impactParameter0XY = 0., errImpactParameter0XY = 0., impactParameter1XY = 0., errImpactParameter1XY = 0., impactParameter2XY = 0., errImpactParameter2XY = 0.;
       if (!kfFirstProton.GetDistanceFromVertexXY(kfpV, impactParameter0XY, errImpactParameter0XY)) {
@@ -573,31 +588,18 @@ struct HfCandidateCreator3Prong {
       const float chi2geoFirstThird = kfCalculateChi2geoBetweenParticles(kfFirstProton, kfThirdPion);
       const float chi2geoFirstSecond = kfCalculateChi2geoBetweenParticles(kfFirstProton, kfSecondKaon);
 
-      // Λc± → p± K∓ π±,  Ξc± → p± K∓ π±
-      KFParticle kfCandPKPi;
-      const KFParticle* kfDaughtersPKPi[3] = {&kfFirstProton, &kfSecondKaon, &kfThirdPion};
-      kfCandPKPi.SetConstructMethod(2);
-      kfCandPKPi.Construct(kfDaughtersPKPi, 3);
-      KFParticle kfCandPiKP;
-      const KFParticle* kfDaughtersPiKP[3] = {&kfFirstPion, &kfSecondKaon, &kfThirdProton};
-      kfCandPiKP.SetConstructMethod(2);
-      kfCandPiKP.Construct(kfDaughtersPiKP, 3);
-
-      // D± → π± K∓ π±
-      KFParticle kfCandPiKPi;
-      const KFParticle* kfDaughtersPiKPi[3] = {&kfFirstPion, &kfSecondKaon, &kfThirdPion};
-      kfCandPiKPi.SetConstructMethod(2);
-      kfCandPiKPi.Construct(kfDaughtersPiKPi, 3);
-
-      // Ds± → K± K∓ π±
-      KFParticle kfCandKKPi;
-      const KFParticle* kfDaughtersKKPi[3] = {&kfFirstKaon, &kfSecondKaon, &kfThirdPion};
-      kfCandKKPi.SetConstructMethod(2);
-      kfCandKKPi.Construct(kfDaughtersKKPi, 3);
-      KFParticle kfCandPiKK;
-      const KFParticle* kfDaughtersPiKK[3] = {&kfFirstPion, &kfSecondKaon, &kfThirdKaon};
-      kfCandPiKK.SetConstructMethod(2);
-      kfCandPiKK.Construct(kfDaughtersPiKK, 3);
+      // Λc± → p± K∓ π±,  Ξc± → p± K∓ π±,  D± → π± K∓ π±,  Ds± → K± K∓ π±
+      std::array<KFParticle, 5> kfCands3;
+      std::array<KFStatus, 5> kfCands3Status;
+      if (!kfConstructEach(std::array{std::array<const KFParticle*, 3>{&kfFirstProton, &kfSecondKaon, &kfThirdPion},
+                                      std::array<const KFParticle*, 3>{&kfFirstPion, &kfSecondKaon, &kfThirdProton},
+                                      std::array<const KFParticle*, 3>{&kfFirstPion, &kfSecondKaon, &kfThirdPion},
+                                      std::array<const KFParticle*, 3>{&kfFirstKaon, &kfSecondKaon, &kfThirdPion},
+                                      std::array<const KFParticle*, 3>{&kfFirstPion, &kfSecondKaon, &kfThirdKaon}},
+                           2, kfCands3, kfCands3Status)) {
+        continue;
+      }
+      auto& [kfCandPKPi, kfCandPiKP, kfCandPiKPi, kfCandKKPi, kfCandPiKK] = kfCands3;
 
       const float chi2topo = kfCalculateChi2ToPrimaryVertex(kfCandPKPi, kfpV);
 
@@ -608,15 +610,14 @@ struct HfCandidateCreator3Prong {
         }
       }
 
-      KFParticle kfPairKPi;
-      const KFParticle* kfDaughtersKPi[3] = {&kfSecondKaon, &kfThirdPion};
-      kfPairKPi.SetConstructMethod(2);
-      kfPairKPi.Construct(kfDaughtersKPi, 2);
-
-      KFParticle kfPairPiK;
-      const KFParticle* kfDaughtersPiK[3] = {&kfFirstPion, &kfSecondKaon};
-      kfPairPiK.SetConstructMethod(2);
-      kfPairPiK.Construct(kfDaughtersPiK, 2);
+      std::array<KFParticle, 2> kfPairs;
+      std::array<KFStatus, 2> kfPairsStatus;
+      if (!kfConstructEach(std::array{std::array<const KFParticle*, 2>{&kfSecondKaon, &kfThirdPion},
+                                      std::array<const KFParticle*, 2>{&kfFirstPion, &kfSecondKaon}},
+                           2, kfPairs, kfPairsStatus)) {
+        continue;
+      }
+      const auto& [kfPairKPi, kfPairPiK] = kfPairs;
 
       const float massPKPi = kfCandPKPi.GetMass();
       const float massPiKP = kfCandPiKP.GetMass();
@@ -1011,7 +1012,9 @@ struct HfCandidateCreator3ProngExpressions {
 
   constexpr static std::size_t NDaughtersResonant{2u};
 
-  HfEventSelectionMc hfEvSelMc; // mc event selection and monitoring
+  HfEventSelectionMc hfEvSelMc;                           // mc event selection and monitoring
+  HfMcDecayClassifier mcDecayClassifier;                  // decays of the MC particles into the correlated background channels
+  std::vector<HfMcDecayClassifier::Decay> candidateDecays; // decays the current candidate can match
 
   using BCsInfo = soa::Join<aod::BCs, aod::Timestamps, aod::BcSels>;
   using McCollisionsNoCents = soa::Join<aod::Collisions, aod::EvSels, aod::McCollisionLabels>;
@@ -1070,6 +1073,13 @@ struct HfCandidateCreator3ProngExpressions {
     const std::array<int, NDaughtersResonant> arrPdgDaugResonantDToPhiPi{daughtersDsResonant.at(DecayChannelResonant::DsToPhiPi)};                    // Ds± → φ π± and D± → φ π±
     const std::array<int, NDaughtersResonant> arrPdgDaugResonantDToKstar0K{daughtersDsResonant.at(DecayChannelResonant::DsToKstar0K)};                // Ds± → anti-K*(892)0 K± and D± → anti-K*(892)0 K±
 
+    constexpr int DepthMainMax = 2; // Depth for final state matching
+    constexpr int DepthResoMax = 1; // Depth for resonant decay matching
+    if (matchCorrelatedBackground) {
+      // D0 resonant decays are active for D*
+      mcDecayClassifier.build(mcParticles, pdgMothersCorrelBkg.value, [](int pdgMother) { return pdgMother == Pdg::kDStar ? DepthMainMax + 1 : DepthMainMax; });
+    }
+
     // Match reconstructed candidates.
     // Spawned table can be used directly
     for (const auto& candidate : *rowCandidateProng3) {
@@ -1101,17 +1111,23 @@ struct HfCandidateCreator3ProngExpressions {
       }
 
       if (matchCorrelatedBackground) {
-        indexRec = -1;                  // Index of the matched reconstructed candidate
-        constexpr int DepthMainMax = 2; // Depth for final state matching
-        constexpr int DepthResoMax = 1; // Depth for resonant decay matching
+        indexRec = -1; // Index of the matched reconstructed candidate
 
-        for (const auto& pdgMother : pdgMothersCorrelBkg.value) {
+        // only the decays the first prong belongs to can be matched
+        candidateDecays.clear();
+        if (arrayDaughters[0].has_mcParticle()) {
+          mcDecayClassifier.getCandidateDecays(mcParticles, arrayDaughters[0].mcParticle(), matchKinkedDecayTopology, matchInteractionsWithMaterial, candidateDecays);
+        }
+
+        for (const auto& [pdgMother, finalStates] : mcDecayClassifier.getChannelsPerMother()) {
           int depthMainMax = DepthMainMax;
           if (pdgMother == Pdg::kDStar) {
             depthMainMax = DepthMainMax + 1; // D0 resonant decays are active
           }
-          auto finalStates = getDecayChannelsMain(pdgMother);
           for (const auto& [channelMain, finalState] : finalStates) {
+            if (!HfMcDecayClassifier::hasDecay(candidateDecays, pdgMother, channelMain)) {
+              continue;
+            }
             std::array<int, 3> const arrPdgDaughtersMain3Prongs = std::array{finalState[0], finalState[1], finalState[2]};
             if (finalState.size() > 3) { // o2-linter: disable=magic-number (partially reconstructed decays with 4 or 5 final state particles)
               if (matchKinkedDecayTopology && matchInteractionsWithMaterial) {
@@ -84,9 +84,11 @@
 #include <iterator> // std::distance
 #include <numeric>
 #include <optional>
-#include <string>  // std::string
+#include <string> // std::string
+#include <thread>
 #include <utility> // std::forward
-#include <vector>  // std::vector
+#include <variant>
+#include <vector> // std::vector
 
 using namespace o2;
 using namespace o2::analysis;
@@ -1414,6 +1416,7 @@ struct HfTrackIndexSkimCreator {
     Configurable<double> maxDZIni{"maxDZIni", 4., "reject (if>0) PCA candidate if tracks DZ exceeds threshold"};
     Configurable<double> minParamChange{"minParamChange", 1.e-3, "stop iterations if largest change of any X is smaller than this"};
     Configurable<double> minRelChi2Change{"minRelChi2Change", 0.9, "stop iterations if chi2/chi2old > this"};
+    Configurable<int> nThreadsVertexing{"nThreadsVertexing", 1, "number of worker threads processing the collisions in parallel (1: sequential, PV refit and ML for HF filters not supported)"};
     // CCDB
     Configurable<std::string> ccdbUrl{"ccdbUrl", "http://alice-ccdb.cern.ch", "url of the ccdb repository"};
     Configurable<std::string> ccdbPathLut{"ccdbPathLut", "GLO/Param/MatLUT", "Path for LUT parametrization"};
@@ -1481,9 +1484,17 @@ struct HfTrackIndexSkimCreator {
     Configurable<LabeledArray<double>> thresholdMlScoreXicToPiKP{"thresholdMlScoreXicToPiKP", {hf_cuts_bdt_multiclass::Cuts[0], hf_cuts_bdt_multiclass::NBinsPt, hf_cuts_bdt_multiclass::NCutBdtScores, hf_cuts_bdt_multiclass::labelsPt, hf_cuts_bdt_multiclass::labelsCutBdt}, "Threshold values for Ml output scores of Xic+ candidates"};
   } config;
 
+  /// Vertex fitters owned by a worker thread of the collision-parallel mode
+  struct VertexingWorker {
+    o2::vertexing::DCAFitterN<2> df2; // 2-prong vertex fitter
+    o2::vertexing::DCAFitterN<3> df3; // 3-prong vertex fitter
+  };
+
   SliceCache cache;
   o2::vertexing::DCAFitterN<2> df2; // 2-prong vertex fitter
   o2::vertexing::DCAFitterN<3> df3; // 3-prong vertex fitter
+  std::vector<VertexingWorker> vertexingWorkers{}; // worker fitters for the collision-parallel mode
+  bool parallelFallbackReported{false};            // the sequential fallback of the collision-parallel mode has been reported
   // Needed for PV refitting
   Service<o2::ccdb::BasicCCDBManager> ccdb{};
   o2::base::MatLayerCylSet* lut{};
@@ -1506,6 +1517,61 @@ struct HfTrackIndexSkimCreator {
   std::array<LabeledArray<double>, kN3ProngDecays> cut3Prong{};
   std::array<std::vector<double>, kN3ProngDecays> binsPt3Prong{};
 
+  /// Table and histogram outputs of a 2-prong candidate
+  struct Prong2Output {
+    int64_t collisionId{-1};
+    std::array<int64_t, 2> trackIds{};
+    uint isSelected{0};
+    std::vector<float> mlScores{};
+    std::array<float, 3> pvRefitCoord{};
+    std::array<float, 6> pvRefitCovMatrix{};
+    std::array<uint8_t, kN2ProngDecays> cutStatus{};
+    std::array<double, 3> secondaryVertex{};
+    std::array<std::array<float, 3>, 2> pVecProngs{};
+    std::array<int, kN2ProngDecays + 1> whichHypo{};
+  };
+
+  /// Table and histogram outputs of a 3-prong candidate
+  struct Prong3Output {
+    int64_t collisionId{-1};
+    std::array<int64_t, 3> trackIds{};
+    uint isSelected{0};
+    std::array<std::vector<float>, kN3ProngDecaysUsedMlForHfFilters> mlScores{};
+    std::array<float, 3> pvRefitCoord{};
+    std::array<float, 6> pvRefitCovMatrix{};
+    std::array<uint8_t, kN3ProngDecays> cutStatus{};
+    std::array<double, 3> secondaryVertex{};
+    std::array<std::array<float, 3>, 3> pVecProngs{};
+    std::array<int, kN3ProngDecays> whichHypo{};
+  };
+
+  /// Table and histogram outputs of a D* candidate, the D0 index is the one of the last D0 filled
+  struct DstarOutput {
+    int64_t collisionId{-1};
+    int64_t softPionId{-1};
+    uint8_t isSelected{0};
+    uint8_t cutStatus{0};
+    float deltaMass{-1.f};
+    std::array<float, 3> pvRefitCoord{};
+    std::array<float, 6> pvRefitCovMatrix{};
+  };
+
+  /// Histogram outputs of a collision
+  struct CollisionOutput {
+    int nTracks{0};
+    int nCand2{0};
+    int nCand3{0};
+  };
+
+  /// Output of the combinatorics of one collision
+  /// The table and histogram fills are executed immediately in the sequential mode,
+  /// while their values are recorded by the worker threads and filled in collision order in the collision-parallel mode
+  struct OutputSink {
+    bool isDeferred{false};
+    int lastFilledD0{-1}; // index to be filled in table for D* mesons
+    std::vector<std::variant<Prong2Output, Prong3Output, DstarOutput, CollisionOutput>> outputs{}; // recorded outputs (only in deferred mode)
+  };
+
   // ML response
   o2::analysis::MlResponse<float> hfMlResponse2Prongs;                               // only D0
   std::array<o2::analysis::MlResponse<float>, kN3ProngDecays> hfMlResponse3Prongs{}; // D+, Lc, Ds, Xic
@@ -1531,6 +1597,31 @@ struct HfTrackIndexSkimCreator {
   Partition<FilteredTrackAssocSel> positiveSoftPions = aod::hf_sel_track::isPositive == true && ((aod::hf_sel_track::isSelProng & static_cast<uint32_t>(BIT(CandidateType::CandDstar))) != 0u);
   Partition<FilteredTrackAssocSel> negativeSoftPions = aod::hf_sel_track::isPositive == false && ((aod::hf_sel_track::isSelProng & static_cast<uint32_t>(BIT(CandidateType::CandDstar))) != 0u);
 
+  using GroupedTrackIndices = decltype(positiveFor2And3Prongs->sliceByCached(aod::track::collisionId, 0, cache));
+  /// Track indices of a collision used in the 2-prong and 3-prong combinatorics
+  /// The soft pions are sliced only if needed by a D* candidate in the sequential mode,
+  /// while all the slices are done before the workers start in the collision-parallel mode, since the SliceCache is not thread-safe
+  struct CollisionTrackIndices {
+    GroupedTrackIndices pos;                           // positive tracks for 2-prongs and 3-prongs
+    GroupedTrackIndices neg;                           // negative tracks for 2-prongs and 3-prongs
+    std::optional<GroupedTrackIndices> softPionsPos{}; // positive soft pions for D*
+    std::optional<GroupedTrackIndices> softPionsNeg{}; // negative soft pions for D*
+  };
+
+  /// Slices the track indices of a collision
+  /// \param collisionId is the index of the collision
+  /// \param sliceSoftPions is true to slice also the soft pions
+  CollisionTrackIndices sliceTrackIndices(int64_t collisionId, bool sliceSoftPions)
+  {
+    CollisionTrackIndices trackIndices{positiveFor2And3Prongs->sliceByCached(aod::track::collisionId, collisionId, cache),
+                                       negativeFor2And3Prongs->sliceByCached(aod::track::collisionId, collisionId, cache)};
+    if (sliceSoftPions) {
+      trackIndices.softPionsPos.emplace(positiveSoftPions->sliceByCached(aod::track::collisionId, collisionId, cache));
+      trackIndices.softPionsNeg.emplace(negativeSoftPions->sliceByCached(aod::track::collisionId, collisionId, cache));
+    }
+    return trackIndices;
+  }
+
   // QA of PV refit
   ConfigurableAxis axisPvRefitDeltaX{"axisPvRefitDeltaX", {1000, -0.5f, 0.5f}, "DeltaX binning PV refit"};
   ConfigurableAxis axisPvRefitDeltaY{"axisPvRefitDeltaY", {1000, -0.5f, 0.5f}, "DeltaY binning PV refit"};
@@ -1584,21 +1675,21 @@ struct HfTrackIndexSkimCreator {
     cut3Prong = {config.cutsDplusToPiKPi, config.cutsLcToPKPi, config.cutsDsToKKPi, config.cutsXicToPKPi, config.cutsCdToDeKPi, config.cutsCtToTrKPi, config.cutsChToHeKPi, config.cutsCaToAlKPi};
     binsPt3Prong = {config.binsPtDplusToPiKPi, config.binsPtLcToPKPi, config.binsPtDsToKKPi, config.binsPtXicToPKPi, config.binsPtCdToDeKPi, config.binsPtCtToTrKPi, config.binsPtChToHeKPi, config.binsPtCaToAlKPi};
 
-    df2.setPropagateToPCA(config.propagateToPCA);
-    df2.setMaxR(config.maxR);
-    df2.setMaxDZIni(config.maxDZIni);
-    df2.setMinParamChange(config.minParamChange);
-    df2.setMinRelChi2Change(config.minRelChi2Change);
-    df2.setUseAbsDCA(config.useAbsDCA);
-    df2.setWeightedFinalPCA(config.useWeightedFinalPCA);
+    configureVertexFitter(df2);
+    configureVertexFitter(df3);
 
-    df3.setPropagateToPCA(config.propagateToPCA);
-    df3.setMaxR(config.maxR);
-    df3.setMaxDZIni(config.maxDZIni);
-    df3.setMinParamChange(config.minParamChange);
-    df3.setMinRelChi2Change(config.minRelChi2Change);
-    df3.setUseAbsDCA(config.useAbsDCA);
-    df3.setWeightedFinalPCA(config.useWeightedFinalPCA);
+    if (config.nThreadsVertexing > 1) {
+      if (doprocess2And3ProngsWithPvRefit || doprocess2And3ProngsWithPvRefitWithPidForHfFiltersBdt || config.applyMlForHfFilters) {
+        LOGP(warning, "Collision-parallel vertexing not supported with PV refit or ML for HF filters, the collisions will be processed sequentially");
+      } else {
+        vertexingWorkers.resize(config.nThreadsVertexing);
+        for (auto& worker : vertexingWorkers) {
+          configureVertexFitter(worker.df2);
+          configureVertexFitter(worker.df3);
+        }
+        LOGP(info, "Collision-parallel vertexing enabled with {} worker threads", config.nThreadsVertexing.value);
+      }
+    }
 
     ccdb->setURL(config.ccdbUrl);
     ccdb->setCaching(true);
@@ -1732,6 +1823,20 @@ struct HfTrackIndexSkimCreator {
     }
   }
 
+  /// Configures a vertex fitter with the settings from the configurables
+  /// \param fitter is the DCAFitterN to configure
+  template <typename TFitter>
+  void configureVertexFitter(TFitter& fitter)
+  {
+    fitter.setPropagateToPCA(config.propagateToPCA);
+    fitter.setMaxR(config.maxR);
+    fitter.setMaxDZIni(config.maxDZIni);
+    fitter.setMinParamChange(config.minParamChange);
+    fitter.setMinRelChi2Change(config.minRelChi2Change);
+    fitter.setUseAbsDCA(config.useAbsDCA);
+    fitter.setWeightedFinalPCA(config.useWeightedFinalPCA);
+  }
+
   /// Method to perform selections for 2-prong candidates before vertex reconstruction
   /// \param pVecTrack0 is the momentum array of the first daughter track
   /// \param pVecTrack1 is the momentum array of the second daughter track
@@ -2327,390 +2432,472 @@ struct HfTrackIndexSkimCreator {
     }
     */
 
+    if constexpr (!DoPvRefit) {
+      if (!vertexingWorkers.empty() && run2And3ProngsParallel<UsePidForHfFiltersBdt>(collisions, bcWithTimeStamps, tracks)) {
+        return;
+      }
+    }
+
+    OutputSink sink{};
     for (const auto& collision : collisions) {
+      // set the magnetic field from CCDB
+      const auto bc = collision.bc_as<o2::aod::BCsWithTimestamps>();
+      initCCDB(bc, runNumber, ccdb, config.isRun2 ? config.ccdbPathGrp : config.ccdbPathGrpMag, lut, config.isRun2);
+      df2.setBz(o2::base::Propagator::Instance()->getNominalBz());
+      df3.setBz(o2::base::Propagator::Instance()->getNominalBz());
 
-      /// retrieve PV contributors for the current collision
-      std::vector<int64_t> vecPvContributorGlobId{};
-      std::vector<o2::track::TrackParCov> vecPvContributorTrackParCov{};
-      std::vector<bool> vecPvRefitContributorUsed{};
-      if constexpr (DoPvRefit) {
-        auto groupedTracksUnfiltered = tracks.sliceBy(tracksPerCollision, collision.globalIndex());
-        const int nTrk = groupedTracksUnfiltered.size();
-        int nContrib = 0;
-        int nNonContrib = 0;
-        for (const auto& trackUnfiltered : groupedTracksUnfiltered) {
-          if (!trackUnfiltered.isPVContributor()) {
-            /// the track did not contribute to fit the primary vertex
-            nNonContrib++;
-            continue;
-          }
-          vecPvContributorGlobId.push_back(trackUnfiltered.globalIndex());
-          vecPvContributorTrackParCov.push_back(getTrackParCov(trackUnfiltered));
-          nContrib++;
-          if (config.debugPvRefit) {
-            LOG(info) << "---> a contributor! stuff saved";
-            LOG(info) << "vec_contrib size: " << vecPvContributorTrackParCov.size() << ", nContrib: " << nContrib;
+      auto trackIndices = sliceTrackIndices(collision.globalIndex(), false);
+      run2And3ProngsCollision<DoPvRefit, UsePidForHfFiltersBdt>(collision, bcWithTimeStamps, tracks, trackIndices, df2, df3, sink);
+    }
+  } /// end of run2And3Prongs function
+
+  /// Forwards the outputs of a candidate or collision to the tables and histograms, or records them in the collision-parallel mode
+  /// \param sink is the output sink of the collision
+  /// \param output is the output to be filled
+  template <bool DoPvRefit, typename TOutput>
+  void emitOutput(OutputSink& sink, TOutput&& output)
+  {
+    if (sink.isDeferred) {
+      sink.outputs.emplace_back(std::forward<TOutput>(output));
+    } else {
+      fillOutput<DoPvRefit>(sink, output);
+    }
+  }
+
+  /// Fills the outputs recorded in the collision-parallel mode, where PV refit is not supported
+  /// \param sink is the output sink of the collision
+  void flushOutputs(OutputSink& sink)
+  {
+    for (const auto& output : sink.outputs) {
+      std::visit([&](const auto& recordedOutput) { fillOutput<false>(sink, recordedOutput); }, output);
+    }
+    sink.outputs.clear();
+  }
+
+  /// Fills the tables and histograms of a 2-prong candidate
+  /// \param sink is the output sink of the collision, it keeps the index of the last D0 filled for the D* mesons
+  /// \param output is the 2-prong candidate
+  template <bool DoPvRefit>
+  void fillOutput(OutputSink& sink, const Prong2Output& output)
+  {
+    // fill table row
+    rowTrackIndexProng2(output.collisionId, output.trackIds[0], output.trackIds[1], output.isSelected);
+    if (config.applyMlForHfFilters) {
+      rowTrackIndexMlScoreProng2(output.mlScores);
+    }
+    if (TESTBIT(output.isSelected, hf_cand_2prong::DecayType::D0ToPiK)) {
+      sink.lastFilledD0 = rowTrackIndexProng2.lastIndex();
+    }
+
+    if constexpr (DoPvRefit) {
+      // fill table row with coordinates of PV refit
+      rowProng2PVrefit(output.pvRefitCoord[0], output.pvRefitCoord[1], output.pvRefitCoord[2],
+                       output.pvRefitCovMatrix[0], output.pvRefitCovMatrix[1], output.pvRefitCovMatrix[2], output.pvRefitCovMatrix[3], output.pvRefitCovMatrix[4], output.pvRefitCovMatrix[5]);
+    }
+
+    if (config.debug) {
+      rowProng2CutStatus(output.cutStatus[0], output.cutStatus[1], output.cutStatus[2]); // FIXME when we can do this by looping over kN2ProngDecays
+    }
+
+    // fill histograms
+    if (config.fillHistograms) {
+      registry.fill(HIST("hVtx2ProngX"), output.secondaryVertex[0]);
+      registry.fill(HIST("hVtx2ProngY"), output.secondaryVertex[1]);
+      registry.fill(HIST("hVtx2ProngZ"), output.secondaryVertex[2]);
+      for (int iDecay2P = 0; iDecay2P < kN2ProngDecays; iDecay2P++) {
+        if (TESTBIT(output.isSelected, iDecay2P)) {
+          if (TESTBIT(output.whichHypo[iDecay2P], 0)) {
+            const auto mass2Prong = RecoDecay::m(output.pVecProngs, arrMass2Prong[iDecay2P][0]);
+            switch (iDecay2P) {
+              case hf_cand_2prong::DecayType::D0ToPiK:
+                registry.fill(HIST("hMassD0ToPiK"), mass2Prong);
+                break;
+              case hf_cand_2prong::DecayType::JpsiToEE:
+                registry.fill(HIST("hMassJpsiToEE"), mass2Prong);
+                break;
+              case hf_cand_2prong::DecayType::JpsiToMuMu:
+                registry.fill(HIST("hMassJpsiToMuMu"), mass2Prong);
+                break;
+            }
           }
-        }
-        if (config.debugPvRefit) {
-          LOG(info) << "===> nTrk: " << nTrk << ",   nContrib: " << nContrib << ",   nNonContrib: " << nNonContrib;
-          if (static_cast<uint16_t>(vecPvContributorTrackParCov.size()) != collision.numContrib() || static_cast<uint16_t>(nContrib != collision.numContrib())) {
-            LOG(info) << "!!! Some problem here !!! vecPvContributorTrackParCov.size()= " << vecPvContributorTrackParCov.size() << ", nContrib=" << nContrib << ", collision.numContrib()" << collision.numContrib();
+          if (TESTBIT(output.whichHypo[iDecay2P], 1)) {
+            const auto mass2Prong = RecoDecay::m(output.pVecProngs, arrMass2Prong[iDecay2P][1]);
+            if (iDecay2P == hf_cand_2prong::DecayType::D0ToPiK) {
+              registry.fill(HIST("hMassD0ToPiK"), mass2Prong);
+            }
           }
         }
-        vecPvRefitContributorUsed = std::vector<bool>(vecPvContributorGlobId.size(), true);
       }
+    }
+  }
 
-      // auto centrality = collision.centV0M(); //FIXME add centrality when option for variations to the process function appears
+  /// Fills the tables and histograms of a 3-prong candidate
+  /// \param output is the 3-prong candidate
+  template <bool DoPvRefit>
+  void fillOutput(OutputSink&, const Prong3Output& output)
+  {
+    // fill table row
+    rowTrackIndexProng3(output.collisionId, output.trackIds[0], output.trackIds[1], output.trackIds[2], output.isSelected);
+    if (config.applyMlForHfFilters) {
+      rowTrackIndexMlScoreProng3(output.mlScores[0], output.mlScores[1], output.mlScores[2], output.mlScores[3]);
+    }
+    if constexpr (DoPvRefit) {
+      // fill table row of coordinates of PV refit
+      rowProng3PVrefit(output.pvRefitCoord[0], output.pvRefitCoord[1], output.pvRefitCoord[2],
+                       output.pvRefitCovMatrix[0], output.pvRefitCovMatrix[1], output.pvRefitCovMatrix[2], output.pvRefitCovMatrix[3], output.pvRefitCovMatrix[4], output.pvRefitCovMatrix[5]);
+    }
 
-      const auto n2ProngBit = BIT(kN2ProngDecays) - 1; // bit value for 2-prong candidates where each candidate is one bit and they are all set to 1
-      const auto n3ProngBit = BIT(kN3ProngDecays) - 1; // bit value for 3-prong candidates where each candidate is one bit and they are all set to 1
+    if (config.debug) {
+      rowProng3CutStatus(output.cutStatus[0], output.cutStatus[1], output.cutStatus[2], output.cutStatus[3]); // FIXME when we can do this by looping over kN3ProngDecays
+    }
 
-      std::array<std::vector<bool>, kN2ProngDecays> cutStatus2Prong{};
-      std::array<std::vector<bool>, kN3ProngDecays> cutStatus3Prong{};
-      uint8_t nCutStatus2ProngBit[kN2ProngDecays]; // bit value for selection status for each 2-prong candidate where each selection is one bit and they are all set to 1
-      uint8_t nCutStatus3ProngBit[kN3ProngDecays]; // bit value for selection status for each 3-prong candidate where each selection is one bit and they are all set to 1
+    // fill histograms
+    if (config.fillHistograms) {
+      registry.fill(HIST("hVtx3ProngX"), output.secondaryVertex[0]);
+      registry.fill(HIST("hVtx3ProngY"), output.secondaryVertex[1]);
+      registry.fill(HIST("hVtx3ProngZ"), output.secondaryVertex[2]);
+      for (int iDecay3P = 0; iDecay3P < kN3ProngDecays; iDecay3P++) {
+        if (TESTBIT(output.isSelected, iDecay3P)) {
+          if (TESTBIT(output.whichHypo[iDecay3P], 0)) {
+            const auto mass3Prong = RecoDecay::m(output.pVecProngs, arrMass3Prong[iDecay3P][0]);
+            switch (iDecay3P) {
+              case hf_cand_3prong::DecayType::DplusToPiKPi:
+                registry.fill(HIST("hMassDPlusToPiKPi"), mass3Prong);
+                break;
+              case hf_cand_3prong::DecayType::DsToKKPi:
+                registry.fill(HIST("hMassDsToKKPi"), mass3Prong);
+                break;
+              case hf_cand_3prong::DecayType::LcToPKPi:
+                registry.fill(HIST("hMassLcToPKPi"), mass3Prong);
+                break;
+              case hf_cand_3prong::DecayType::XicToPKPi:
+                registry.fill(HIST("hMassXicToPKPi"), mass3Prong);
+                break;
+              case hf_cand_3prong::DecayType::CdToDeKPi:
+                registry.fill(HIST("hMassCdToDeKPi"), mass3Prong);
+                break;
+              case hf_cand_3prong::DecayType::CtToTrKPi:
+                registry.fill(HIST("hMassCtToTrKPi"), mass3Prong);
+                break;
+              case hf_cand_3prong::DecayType::ChToHeKPi:
+                registry.fill(HIST("hMassChToHeKPi"), mass3Prong);
+                break;
+              case hf_cand_3prong::DecayType::CaToAlKPi:
+                registry.fill(HIST("hMassCaToAlKPi"), mass3Prong);
+                break;
+            }
+          }
+          if (TESTBIT(output.whichHypo[iDecay3P], 1)) {
+            const auto mass3Prong = RecoDecay::m(output.pVecProngs, arrMass3Prong[iDecay3P][1]);
+            switch (iDecay3P) {
+              case hf_cand_3prong::DecayType::DsToKKPi:
+                registry.fill(HIST("hMassDsToKKPi"), mass3Prong);
+                break;
+              case hf_cand_3prong::DecayType::LcToPKPi:
+                registry.fill(HIST("hMassLcToPKPi"), mass3Prong);
+                break;
+              case hf_cand_3prong::DecayType::XicToPKPi:
+                registry.fill(HIST("hMassXicToPKPi"), mass3Prong);
+                break;
+              case hf_cand_3prong::DecayType::CdToDeKPi:
+                registry.fill(HIST("hMassCdToDeKPi"), mass3Prong);
+                break;
+              case hf_cand_3prong::DecayType::CtToTrKPi:
+                registry.fill(HIST("hMassCtToTrKPi"), mass3Prong);
+                break;
+              case hf_cand_3prong::DecayType::ChToHeKPi:
+                registry.fill(HIST("hMassChToHeKPi"), mass3Prong);
+                break;
+              case hf_cand_3prong::DecayType::CaToAlKPi:
+                registry.fill(HIST("hMassCaToAlKPi"), mass3Prong);
+                break;
+            }
+          }
+        }
+      }
+    }
+  }
 
-      for (int iDecay2P = 0; iDecay2P < kN2ProngDecays; iDecay2P++) {
-        nCutStatus2ProngBit[iDecay2P] = BIT(kNCuts2Prong[iDecay2P]) - 1;
-        cutStatus2Prong[iDecay2P] = std::vector<bool>(kNCuts2Prong[iDecay2P], true);
+  /// Fills the tables and histograms of a D* candidate
+  /// \param sink is the output sink of the collision, it keeps the index of the last D0 filled
+  /// \param output is the D* candidate
+  template <bool DoPvRefit>
+  void fillOutput(OutputSink& sink, const DstarOutput& output)
+  {
+    if (output.isSelected) {
+      rowTrackIndexDstar(output.collisionId, output.softPionId, sink.lastFilledD0);
+      if (config.fillHistograms) {
+        registry.fill(HIST("hMassDstarToD0Pi"), output.deltaMass);
       }
-      for (int iDecay3P = 0; iDecay3P < kN3ProngDecays; iDecay3P++) {
-        nCutStatus3ProngBit[iDecay3P] = BIT(kNCuts3Prong[iDecay3P]) - 1;
-        cutStatus3Prong[iDecay3P] = std::vector<bool>(kNCuts3Prong[iDecay3P], true);
+      if constexpr (DoPvRefit) {
+        // fill table row with coordinates of PV refit (same as 2-prong because we do not remove the soft pion)
+        rowDstarPVrefit(output.pvRefitCoord[0], output.pvRefitCoord[1], output.pvRefitCoord[2],
+                        output.pvRefitCovMatrix[0], output.pvRefitCovMatrix[1], output.pvRefitCovMatrix[2], output.pvRefitCovMatrix[3], output.pvRefitCovMatrix[4], output.pvRefitCovMatrix[5]);
       }
+    }
+    if (config.debug) {
+      rowDstarCutStatus(output.cutStatus);
+    }
+  }
 
-      int whichHypo2Prong[kN2ProngDecays + 1]; // we also put D0 for D* in the last slot
-      int whichHypo3Prong[kN3ProngDecays];
+  /// Fills the histograms of the number of candidates of a collision
+  /// \param output is the number of tracks and candidates of the collision
+  template <bool>
+  void fillOutput(OutputSink&, const CollisionOutput& output)
+  {
+    registry.fill(HIST("hNTracks"), output.nTracks);
+    registry.fill(HIST("hNCand2Prong"), output.nCand2);
+    registry.fill(HIST("hNCand3Prong"), output.nCand3);
+    registry.fill(HIST("hNCand2ProngVsNTracks"), output.nTracks, output.nCand2);
+    registry.fill(HIST("hNCand3ProngVsNTracks"), output.nTracks, output.nCand3);
+  }
 
-      // set the magnetic field from CCDB
+  /// Collision-parallel version of run2And3Prongs
+  /// The collisions are split in contiguous chunks processed by worker threads, each with its own vertex fitters.
+  /// The table and histogram fills are recorded per collision and replayed in collision order, so that the output is identical to the sequential one.
+  /// PV refit and ML for HF filters are not supported in this mode
+  /// The shared Propagator is thread-safe only with the material LUT (or no material correction) and the fast magnetic field,
+  /// otherwise nothing is processed and false is returned, so that the collisions are processed sequentially
+  template <bool UsePidForHfFiltersBdt, typename TTracks>
+  bool run2And3ProngsParallel(SelectedCollisions const& collisions,
+                              aod::BCsWithTimestamps const& bcWithTimeStamps,
+                              TTracks const& tracks)
+  {
+    std::vector<SelectedCollisions::iterator> selectedCollisions{};
+    std::vector<CollisionTrackIndices> collisionTrackIndices{};
+    selectedCollisions.reserve(collisions.size());
+    collisionTrackIndices.reserve(collisions.size());
+    for (const auto& collision : collisions) {
+      // set the magnetic field from CCDB and slice the track indices, serially and before the workers start
       const auto bc = collision.bc_as<o2::aod::BCsWithTimestamps>();
       initCCDB(bc, runNumber, ccdb, config.isRun2 ? config.ccdbPathGrp : config.ccdbPathGrpMag, lut, config.isRun2);
-      df2.setBz(o2::base::Propagator::Instance()->getNominalBz());
-      df3.setBz(o2::base::Propagator::Instance()->getNominalBz());
-
-      // used to calculate number of candidiates per event
-      auto nCand2 = rowTrackIndexProng2.lastIndex();
-      auto nCand3 = rowTrackIndexProng3.lastIndex();
-
-      // if there isn't at least a positive and a negative track, continue immediately
-      // if (tracksPos.size() < 1 || tracksNeg.size() < 1) {
-      //  return;
-      //}
-
-      const auto thisCollId = collision.globalIndex();
+      selectedCollisions.push_back(collision);
+      collisionTrackIndices.push_back(sliceTrackIndices(collision.globalIndex(), config.doDstar));
+    }
+    if (selectedCollisions.empty()) {
+      return true;
+    }
+    // material correction actually used by the worker fitters and by the re-propagation of the tracks
+    bool useTGeo = noMatCorr == o2::base::Propagator::MatCorrType::USEMatCorrTGeo;
+    for (const auto& worker : vertexingWorkers) {
+      useTGeo = useTGeo || worker.df2.getMatCorrType() == o2::base::Propagator::MatCorrType::USEMatCorrTGeo || worker.df3.getMatCorrType() == o2::base::Propagator::MatCorrType::USEMatCorrTGeo;
+    }
+    if (useTGeo || o2::base::Propagator::Instance()->getFieldFast() == nullptr) {
+      if (!parallelFallbackReported) {
+        LOGP(warning, "Collision-parallel vertexing requires the material LUT and the fast magnetic field, the collisions will be processed sequentially");
+        parallelFallbackReported = true;
+      }
+      return false;
+    }
 
-      // first loop over positive tracks
-      const auto groupedTrackIndicesPos1 = positiveFor2And3Prongs->sliceByCached(aod::track::collisionId, collision.globalIndex(), cache);
-      const auto groupedTrackIndicesNeg1 = negativeFor2And3Prongs->sliceByCached(aod::track::collisionId, collision.globalIndex(), cache);
-      std::optional<decltype(positiveSoftPions->sliceByCached(aod::track::collisionId, 0, cache))> groupedTrackIndicesSoftPionsPos;
-      std::optional<decltype(negativeSoftPions->sliceByCached(aod::track::collisionId, 0, cache))> groupedTrackIndicesSoftPionsNeg;
-      int lastFilledD0 = -1; // index to be filled in table for D* mesons
-      for (auto trackIndexPos1 = groupedTrackIndicesPos1.begin(); trackIndexPos1 != groupedTrackIndicesPos1.end(); ++trackIndexPos1) {
-        const auto trackPos1 = trackIndexPos1.template track_as<TTracks>();
+    const auto bz = o2::base::Propagator::Instance()->getNominalBz();
+    for (auto& worker : vertexingWorkers) {
+      worker.df2.setBz(bz);
+      worker.df3.setBz(bz);
+    }
 
-        // retrieve the selection flag that corresponds to this collision
-        const auto isSelProngPos1 = trackIndexPos1.isSelProng();
-        const bool sel2ProngStatusPos = TESTBIT(isSelProngPos1, CandidateType::Cand2Prong);
-        const bool sel3ProngStatusPos1 = TESTBIT(isSelProngPos1, CandidateType::Cand3Prong);
-
-        auto trackParVarPos1 = getTrackParCov(trackPos1);
-        std::array pVecTrackPos1{trackPos1.pVector()};
-        std::array dcaInfoPos1{trackPos1.dcaXY(), trackPos1.dcaZ()};
-        if (thisCollId != trackPos1.collisionId()) { // this is not the "default" collision for this track, we have to re-propagate it
-          o2::base::Propagator::Instance()->propagateToDCABxByBz({collision.posX(), collision.posY(), collision.posZ()}, trackParVarPos1, 2.f, noMatCorr, &dcaInfoPos1);
-          getPxPyPz(trackParVarPos1, pVecTrackPos1);
+    const auto nCollisions = selectedCollisions.size();
+    const auto nWorkers = std::min(vertexingWorkers.size(), nCollisions);
+    const auto nCollisionsPerWorker = (nCollisions + nWorkers - 1) / nWorkers;
+    std::vector<OutputSink> sinks(nCollisions);
+    std::vector<std::thread> threads{};
+    threads.reserve(nWorkers);
+    for (std::size_t iWorker = 0; iWorker < nWorkers; ++iWorker) {
+      threads.emplace_back([&, iWorker]() {
+        auto& worker = vertexingWorkers[iWorker];
+        const auto iCollisionEnd = std::min(nCollisions, (iWorker + 1) * nCollisionsPerWorker);
+        for (auto iCollision = iWorker * nCollisionsPerWorker; iCollision < iCollisionEnd; ++iCollision) {
+          sinks[iCollision].isDeferred = true;
+          run2And3ProngsCollision<false, UsePidForHfFiltersBdt>(selectedCollisions[iCollision], bcWithTimeStamps, tracks, collisionTrackIndices[iCollision], worker.df2, worker.df3, sinks[iCollision]);
         }
+      });
+    }
+    for (auto& thread : threads) {
+      thread.join();
+    }
 
-        // first loop over negative tracks
-        for (auto trackIndexNeg1 = groupedTrackIndicesNeg1.begin(); trackIndexNeg1 != groupedTrackIndicesNeg1.end(); ++trackIndexNeg1) {
-          const auto trackNeg1 = trackIndexNeg1.template track_as<TTracks>();
-
-          // retrieve the selection flag that corresponds to this collision
-          const auto isSelProngNeg1 = trackIndexNeg1.isSelProng();
-          const bool sel2ProngStatusNeg = TESTBIT(isSelProngNeg1, CandidateType::Cand2Prong);
-          const bool sel3ProngStatusNeg1 = TESTBIT(isSelProngNeg1, CandidateType::Cand3Prong);
-
-          auto trackParVarNeg1 = getTrackParCov(trackNeg1);
-          std::array pVecTrackNeg1{trackNeg1.pVector()};
-          std::array dcaInfoNeg1{trackNeg1.dcaXY(), trackNeg1.dcaZ()};
-          if (thisCollId != trackNeg1.collisionId()) { // this is not the "default" collision for this track, we have to re-propagate it
-            o2::base::Propagator::Instance()->propagateToDCABxByBz({collision.posX(), collision.posY(), collision.posZ()}, trackParVarNeg1, 2.f, noMatCorr, &dcaInfoNeg1);
-            getPxPyPz(trackParVarNeg1, pVecTrackNeg1);
-          }
+    // merge the outputs in collision order
+    for (auto& sink : sinks) {
+      flushOutputs(sink);
+    }
+    return true;
+  }
 
-          uint isSelected2ProngCand = n2ProngBit; // bitmap for checking status of two-prong candidates (1 is true, 0 is rejected)
+  /// 2-prong and 3-prong combinatorics of a single collision
+  /// \param collision is the collision
+  /// \param bcWithTimeStamps is the table of bunch crossings with timestamps, for the PV refit
+  /// \param tracks are the tracks
+  /// \param trackIndices are the track indices of the collision, the missing soft pion slices are added if needed
+  /// \param fitter2 is the 2-prong vertex fitter
+  /// \param fitter3 is the 3-prong vertex fitter
+  /// \param sink is the output sink for table and histogram fills
+  template <bool DoPvRefit, bool UsePidForHfFiltersBdt, typename TTracks>
+  void run2And3ProngsCollision(SelectedCollisions::iterator const& collision,
+                               aod::BCsWithTimestamps const& bcWithTimeStamps,
+                               TTracks const& tracks,
+                               CollisionTrackIndices& trackIndices,
+                               o2::vertexing::DCAFitterN<2>& fitter2,
+                               o2::vertexing::DCAFitterN<3>& fitter3,
+                               OutputSink& sink)
+  {
+    /// retrieve PV contributors for the current collision
+    std::vector<int64_t> vecPvContributorGlobId{};
+    std::vector<o2::track::TrackParCov> vecPvContributorTrackParCov{};
+    std::vector<bool> vecPvRefitContributorUsed{};
+    if constexpr (DoPvRefit) {
+      auto groupedTracksUnfiltered = tracks.sliceBy(tracksPerCollision, collision.globalIndex());
+      const int nTrk = groupedTracksUnfiltered.size();
+      int nContrib = 0;
+      int nNonContrib = 0;
+      for (const auto& trackUnfiltered : groupedTracksUnfiltered) {
+        if (!trackUnfiltered.isPVContributor()) {
+          /// the track did not contribute to fit the primary vertex
+          nNonContrib++;
+          continue;
+        }
+        vecPvContributorGlobId.push_back(trackUnfiltered.globalIndex());
+        vecPvContributorTrackParCov.push_back(getTrackParCov(trackUnfiltered));
+        nContrib++;
+        if (config.debugPvRefit) {
+          LOG(info) << "---> a contributor! stuff saved";
+          LOG(info) << "vec_contrib size: " << vecPvContributorTrackParCov.size() << ", nContrib: " << nContrib;
+        }
+      }
+      if (config.debugPvRefit) {
+        LOG(info) << "===> nTrk: " << nTrk << ",   nContrib: " << nContrib << ",   nNonContrib: " << nNonContrib;
+        if (static_cast<uint16_t>(vecPvContributorTrackParCov.size()) != collision.numContrib() || static_cast<uint16_t>(nContrib != collision.numContrib())) {
+          LOG(info) << "!!! Some problem here !!! vecPvContributorTrackParCov.size()= " << vecPvContributorTrackParCov.size() << ", nContrib=" << nContrib << ", collision.numContrib()" << collision.numContrib();
+        }
+      }
+      vecPvRefitContributorUsed = std::vector<bool>(vecPvContributorGlobId.size(), true);
+    }
 
-          if (config.debug) {
-            for (int iDecay2P = 0; iDecay2P < kN2ProngDecays; iDecay2P++) {
-              for (int iCut = 0; iCut < kNCuts2Prong[iDecay2P]; iCut++) {
-                cutStatus2Prong[iDecay2P][iCut] = true;
-              }
-            }
-          }
+    // auto centrality = collision.centV0M(); //FIXME add centrality when option for variations to the process function appears
 
-          // initialise PV refit coordinates and cov matrix for 2-prongs already here for D*
-          std::array pvRefitCoord2Prong = {collision.posX(), collision.posY(), collision.posZ()}; /// initialize to the original PV
-          std::array pvRefitCovMatrix2Prong = getPrimaryVertex(collision).getCov();               /// initialize to the original PV
+    const auto n2ProngBit = BIT(kN2ProngDecays) - 1; // bit value for 2-prong candidates where each candidate is one bit and they are all set to 1
+    const auto n3ProngBit = BIT(kN3ProngDecays) - 1; // bit value for 3-prong candidates where each candidate is one bit and they are all set to 1
 
-          // 2-prong vertex reconstruction
-          float pt2Prong{-1.};
-          bool is2ProngCandidateGoodFor3Prong{sel3ProngStatusPos1 && sel3ProngStatusNeg1};
-          int nVtxFrom2ProngFitter = 0;
-          if (sel2ProngStatusPos && sel2ProngStatusNeg) {
+    std::array<std::vector<bool>, kN2ProngDecays> cutStatus2Prong{};
+    std::array<std::vector<bool>, kN3ProngDecays> cutStatus3Prong{};
+    uint8_t nCutStatus2ProngBit[kN2ProngDecays]; // bit value for selection status for each 2-prong candidate where each selection is one bit and they are all set to 1
+    uint8_t nCutStatus3ProngBit[kN3ProngDecays]; // bit value for selection status for each 3-prong candidate where each selection is one bit and they are all set to 1
 
-            // 2-prong preselections
-            // TODO: in case of PV refit, the single-track DCA is calculated wrt two different PV vertices (only 1 track excluded)
-            applyPreselection2Prong(pVecTrackPos1, pVecTrackNeg1, dcaInfoPos1[0], dcaInfoNeg1[0], cutStatus2Prong, whichHypo2Prong, isSelected2ProngCand, pt2Prong);
+    for (int iDecay2P = 0; iDecay2P < kN2ProngDecays; iDecay2P++) {
+      nCutStatus2ProngBit[iDecay2P] = BIT(kNCuts2Prong[iDecay2P]) - 1;
+      cutStatus2Prong[iDecay2P] = std::vector<bool>(kNCuts2Prong[iDecay2P], true);
+    }
+    for (int iDecay3P = 0; iDecay3P < kN3ProngDecays; iDecay3P++) {
+      nCutStatus3ProngBit[iDecay3P] = BIT(kNCuts3Prong[iDecay3P]) - 1;
+      cutStatus3Prong[iDecay3P] = std::vector<bool>(kNCuts3Prong[iDecay3P], true);
+    }
 
-            if (isSelected2ProngCand > 0) {
-              // secondary vertex reconstruction and further 2-prong selections
-              try {
-                nVtxFrom2ProngFitter = df2.process(trackParVarPos1, trackParVarNeg1);
-              } catch (...) {
-              }
+    int whichHypo2Prong[kN2ProngDecays + 1]; // we also put D0 for D* in the last slot
+    int whichHypo3Prong[kN3ProngDecays];
 
-              if (nVtxFrom2ProngFitter > 0) { // should it be this or > 0 or are they equivalent
-                // get secondary vertex
-                const auto& secondaryVertex2 = df2.getPCACandidate();
-                // get track momenta
-                std::array<float, 3> pvec0{};
-                std::array<float, 3> pvec1{};
-                df2.getTrack(0).getPxPyPzGlo(pvec0);
-                df2.getTrack(1).getPxPyPzGlo(pvec1);
-
-                /// PV refit excluding the candidate daughters, if contributors
-                if constexpr (DoPvRefit) {
-                  if (config.fillHistograms) {
-                    registry.fill(HIST("PvRefit/verticesPerCandidate"), 1);
-                  }
-                  int nCandContr = 2;
-                  auto trackFirstIt = std::find(vecPvContributorGlobId.begin(), vecPvContributorGlobId.end(), trackPos1.globalIndex());
-                  auto trackSecondIt = std::find(vecPvContributorGlobId.begin(), vecPvContributorGlobId.end(), trackNeg1.globalIndex());
-                  bool isTrackFirstContr = true;
-                  bool isTrackSecondContr = true;
-                  if (trackFirstIt == vecPvContributorGlobId.end()) {
-                    /// This track did not contribute to the original PV refit
-                    if (config.debugPvRefit) {
-                      LOG(info) << "--- [2 Prong] trackPos1 with globalIndex " << trackPos1.globalIndex() << " was not a PV contributor";
-                    }
-                    nCandContr--;
-                    isTrackFirstContr = false;
-                  }
-                  if (trackSecondIt == vecPvContributorGlobId.end()) {
-                    /// This track did not contribute to the original PV refit
-                    if (config.debugPvRefit) {
-                      LOG(info) << "--- [2 Prong] trackNeg1 with globalIndex " << trackNeg1.globalIndex() << " was not a PV contributor";
-                    }
-                    nCandContr--;
-                    isTrackSecondContr = false;
-                  }
-                  if (nCandContr == 2) { // o2-linter: disable="magic-number" (see comment below)
-                    /// Both the daughter tracks were used for the original PV refit, let's refit it after excluding them
-                    if (config.debugPvRefit) {
-                      LOG(info) << "### [2 Prong] Calling performPvRefitCandProngs for HF 2 prong candidate";
-                    }
-                    performPvRefitCandProngs(collision, bcWithTimeStamps, vecPvContributorGlobId, vecPvContributorTrackParCov, {trackPos1.globalIndex(), trackNeg1.globalIndex()}, pvRefitCoord2Prong, pvRefitCovMatrix2Prong);
-                  } else if (nCandContr == 1) {
-                    /// Only one daughter was a contributor, let's use then the PV recalculated by excluding only it
-                    if (config.debugPvRefit) {
-                      LOG(info) << "####### [2 Prong] nCandContr==" << nCandContr << " ---> just 1 contributor!";
-                    }
-                    if (config.fillHistograms) {
-                      registry.fill(HIST("PvRefit/verticesPerCandidate"), 5);
-                    }
-                    if (isTrackFirstContr && !isTrackSecondContr) {
-                      /// the first daughter is contributor, the second is not
-                      pvRefitCoord2Prong = {trackPos1.pvRefitX(), trackPos1.pvRefitY(), trackPos1.pvRefitZ()};
-                      pvRefitCovMatrix2Prong = {trackPos1.pvRefitSigmaX2(), trackPos1.pvRefitSigmaXY(), trackPos1.pvRefitSigmaY2(), trackPos1.pvRefitSigmaXZ(), trackPos1.pvRefitSigmaYZ(), trackPos1.pvRefitSigmaZ2()};
-                    } else if (!isTrackFirstContr && isTrackSecondContr) {
-                      ///  the second daughter is contributor, the first is not
-                      pvRefitCoord2Prong = {trackNeg1.pvRefitX(), trackNeg1.pvRefitY(), trackNeg1.pvRefitZ()};
-                      pvRefitCovMatrix2Prong = {trackNeg1.pvRefitSigmaX2(), trackNeg1.pvRefitSigmaXY(), trackNeg1.pvRefitSigmaY2(), trackNeg1.pvRefitSigmaXZ(), trackNeg1.pvRefitSigmaYZ(), trackNeg1.pvRefitSigmaZ2()};
-                    }
-                  } else {
-                    /// 0 contributors among the HF candidate daughters
-                    if (config.fillHistograms) {
-                      registry.fill(HIST("PvRefit/verticesPerCandidate"), 6);
-                    }
-                    if (config.debugPvRefit) {
-                      LOG(info) << "####### [2 Prong] nCandContr==" << nCandContr << " ---> some of the candidate daughters did not contribute to the original PV fit, PV refit not redone";
-                    }
-                  }
-                }
+    // used to calculate number of candidiates per event
+    int nCand2{0};
+    int nCand3{0};
 
-                const auto pVecCandProng2 = RecoDecay::pVec(pvec0, pvec1);
-                // 2-prong selections after secondary vertex
-                std::array pvCoord2Prong = {collision.posX(), collision.posY(), collision.posZ()};
-                if constexpr (DoPvRefit) {
-                  pvCoord2Prong[0] = pvRefitCoord2Prong[0];
-                  pvCoord2Prong[1] = pvRefitCoord2Prong[1];
-                  pvCoord2Prong[2] = pvRefitCoord2Prong[2];
-                }
-                applySelection2Prong(pVecCandProng2, secondaryVertex2, pvCoord2Prong, cutStatus2Prong, isSelected2ProngCand);
-                if (is2ProngCandidateGoodFor3Prong && config.do3Prong) {
-                  is2ProngCandidateGoodFor3Prong = isTwoTrackVertexSelectedFor3Prongs(secondaryVertex2, pvCoord2Prong, df2);
-                }
+    // if there isn't at least a positive and a negative track, continue immediately
+    // if (tracksPos.size() < 1 || tracksNeg.size() < 1) {
+    //  return;
+    //}
 
-                std::vector<float> mlScoresD0{};
-                if (config.applyMlForHfFilters) {
-                  const auto trackParVarPcaPos1 = df2.getTrack(0);
-                  const auto trackParVarPcaNeg1 = df2.getTrack(1);
-                  const std::vector<float> inputFeatures{trackParVarPcaPos1.getPt(), dcaInfoPos1[0], dcaInfoPos1[1], trackParVarPcaNeg1.getPt(), dcaInfoNeg1[0], dcaInfoNeg1[1]};
-                  applyMlSelectionForHfFilters2Prong(inputFeatures, mlScoresD0, isSelected2ProngCand);
-                }
+    const auto thisCollId = collision.globalIndex();
 
-                if (isSelected2ProngCand > 0) {
-                  // fill table row
-                  rowTrackIndexProng2(thisCollId, trackPos1.globalIndex(), trackNeg1.globalIndex(), isSelected2ProngCand);
-                  if (config.applyMlForHfFilters) {
-                    rowTrackIndexMlScoreProng2(mlScoresD0);
-                  }
-                  if (TESTBIT(isSelected2ProngCand, hf_cand_2prong::DecayType::D0ToPiK)) {
-                    lastFilledD0 = rowTrackIndexProng2.lastIndex();
-                  }
+    // first loop over positive tracks
+    const auto& groupedTrackIndicesPos1 = trackIndices.pos;
+    const auto& groupedTrackIndicesNeg1 = trackIndices.neg;
+    auto& groupedTrackIndicesSoftPionsPos = trackIndices.softPionsPos;
+    auto& groupedTrackIndicesSoftPionsNeg = trackIndices.softPionsNeg;
+    sink.lastFilledD0 = -1; // index to be filled in table for D* mesons
+    for (auto trackIndexPos1 = groupedTrackIndicesPos1.begin(); trackIndexPos1 != groupedTrackIndicesPos1.end(); ++trackIndexPos1) {
+      const auto trackPos1 = trackIndexPos1.template track_as<TTracks>();
+
+      // retrieve the selection flag that corresponds to this collision
+      const auto isSelProngPos1 = trackIndexPos1.isSelProng();
+      const bool sel2ProngStatusPos = TESTBIT(isSelProngPos1, CandidateType::Cand2Prong);
+      const bool sel3ProngStatusPos1 = TESTBIT(isSelProngPos1, CandidateType::Cand3Prong);
+
+      auto trackParVarPos1 = getTrackParCov(trackPos1);
+      std::array pVecTrackPos1{trackPos1.pVector()};
+      std::array dcaInfoPos1{trackPos1.dcaXY(), trackPos1.dcaZ()};
+      if (thisCollId != trackPos1.collisionId()) { // this is not the "default" collision for this track, we have to re-propagate it
+        o2::base::Propagator::Instance()->propagateToDCABxByBz({collision.posX(), collision.posY(), collision.posZ()}, trackParVarPos1, 2.f, noMatCorr, &dcaInfoPos1);
+        getPxPyPz(trackParVarPos1, pVecTrackPos1);
+      }
 
-                  if constexpr (DoPvRefit) {
-                    // fill table row with coordinates of PV refit
-                    rowProng2PVrefit(pvRefitCoord2Prong[0], pvRefitCoord2Prong[1], pvRefitCoord2Prong[2],
-                                     pvRefitCovMatrix2Prong[0], pvRefitCovMatrix2Prong[1], pvRefitCovMatrix2Prong[2], pvRefitCovMatrix2Prong[3], pvRefitCovMatrix2Prong[4], pvRefitCovMatrix2Prong[5]);
-                  }
+      // first loop over negative tracks
+      for (auto trackIndexNeg1 = groupedTrackIndicesNeg1.begin(); trackIndexNeg1 != groupedTrackIndicesNeg1.end(); ++trackIndexNeg1) {
+        const auto trackNeg1 = trackIndexNeg1.template track_as<TTracks>();
 
-                  if (config.debug) {
-                    uint8_t prong2CutStatus[kN2ProngDecays];
-                    for (int iDecay2P = 0; iDecay2P < kN2ProngDecays; iDecay2P++) {
-                      prong2CutStatus[iDecay2P] = nCutStatus2ProngBit[iDecay2P];
-                      for (int iCut = 0; iCut < kNCuts2Prong[iDecay2P]; iCut++) {
-                        if (!cutStatus2Prong[iDecay2P][iCut]) {
-                          CLRBIT(prong2CutStatus[iDecay2P], iCut);
-                        }
-                      }
-                    }
-                    rowProng2CutStatus(prong2CutStatus[0], prong2CutStatus[1], prong2CutStatus[2]); // FIXME when we can do this by looping over kN2ProngDecays
-                  }
+        // retrieve the selection flag that corresponds to this collision
+        const auto isSelProngNeg1 = trackIndexNeg1.isSelProng();
+        const bool sel2ProngStatusNeg = TESTBIT(isSelProngNeg1, CandidateType::Cand2Prong);
+        const bool sel3ProngStatusNeg1 = TESTBIT(isSelProngNeg1, CandidateType::Cand3Prong);
+
+        auto trackParVarNeg1 = getTrackParCov(trackNeg1);
+        std::array pVecTrackNeg1{trackNeg1.pVector()};
+        std::array dcaInfoNeg1{trackNeg1.dcaXY(), trackNeg1.dcaZ()};
+        if (thisCollId != trackNeg1.collisionId()) { // this is not the "default" collision for this track, we have to re-propagate it
+          o2::base::Propagator::Instance()->propagateToDCABxByBz({collision.posX(), collision.posY(), collision.posZ()}, trackParVarNeg1, 2.f, noMatCorr, &dcaInfoNeg1);
+          getPxPyPz(trackParVarNeg1, pVecTrackNeg1);
+        }
 
-                  // fill histograms
-                  if (config.fillHistograms) {
-                    registry.fill(HIST("hVtx2ProngX"), secondaryVertex2[0]);
-                    registry.fill(HIST("hVtx2ProngY"), secondaryVertex2[1]);
-                    registry.fill(HIST("hVtx2ProngZ"), secondaryVertex2[2]);
-                    const std::array arrMom{pvec0, pvec1};
-                    for (int iDecay2P = 0; iDecay2P < kN2ProngDecays; iDecay2P++) {
-                      if (TESTBIT(isSelected2ProngCand, iDecay2P)) {
-                        if (TESTBIT(whichHypo2Prong[iDecay2P], 0)) {
-                          const auto mass2Prong = RecoDecay::m(arrMom, arrMass2Prong[iDecay2P][0]);
-                          switch (iDecay2P) {
-                            case hf_cand_2prong::DecayType::D0ToPiK:
-                              registry.fill(HIST("hMassD0ToPiK"), mass2Prong);
-                              break;
-                            case hf_cand_2prong::DecayType::JpsiToEE:
-                              registry.fill(HIST("hMassJpsiToEE"), mass2Prong);
-                              break;
-                            case hf_cand_2prong::DecayType::JpsiToMuMu:
-                              registry.fill(HIST("hMassJpsiToMuMu"), mass2Prong);
-                              break;
-                          }
-                        }
-                        if (TESTBIT(whichHypo2Prong[iDecay2P], 1)) {
-                          const auto mass2Prong = RecoDecay::m(arrMom, arrMass2Prong[iDecay2P][1]);
-                          if (iDecay2P == hf_cand_2prong::DecayType::D0ToPiK) {
-                            registry.fill(HIST("hMassD0ToPiK"), mass2Prong);
-                          }
-                        }
-                      }
-                    }
-                  }
-                }
-              } else {
-                isSelected2ProngCand = 0; // reset to 0 not to use the D0 to build a D* meson
-              }
-            } else {
-              isSelected2ProngCand = 0; // reset to 0 not to use the D0 to build a D* meson
-            }
-          }
+        uint isSelected2ProngCand = n2ProngBit; // bitmap for checking status of two-prong candidates (1 is true, 0 is rejected)
 
-          // if the cut on the decay length of 3-prongs computed with the first two tracks is enabled and the vertex was not computed for the D0, we compute it now
-          if (config.do3Prong && is2ProngCandidateGoodFor3Prong && (config.minTwoTrackDecayLengthFor3Prongs > 0.f || config.maxTwoTrackChi2PcaFor3Prongs < 1.e9f) && nVtxFrom2ProngFitter == 0) { // o2-linter: disable="magic-number" (default maxTwoTrackChi2PcaFor3Prongs is 1.e10)
-            try {
-              nVtxFrom2ProngFitter = df2.process(trackParVarPos1, trackParVarNeg1);
-            } catch (...) {
-            }
-            if (nVtxFrom2ProngFitter > 0) {
-              const auto& secondaryVertex2 = df2.getPCACandidate();
-              const std::array pvCoord2Prong{collision.posX(), collision.posY(), collision.posZ()};
-              is2ProngCandidateGoodFor3Prong = isTwoTrackVertexSelectedFor3Prongs(secondaryVertex2, pvCoord2Prong, df2);
-            } else {
-              is2ProngCandidateGoodFor3Prong = false;
+        if (config.debug) {
+          for (int iDecay2P = 0; iDecay2P < kN2ProngDecays; iDecay2P++) {
+            for (int iCut = 0; iCut < kNCuts2Prong[iDecay2P]; iCut++) {
+              cutStatus2Prong[iDecay2P][iCut] = true;
             }
           }
+        }
 
-          if (config.do3Prong && is2ProngCandidateGoodFor3Prong) { // if 3 prongs are enabled and the first 2 tracks are selected for the 3-prong channels
-            // second loop over positive tracks
-            for (auto trackIndexPos2 = trackIndexPos1 + 1; trackIndexPos2 != groupedTrackIndicesPos1.end(); ++trackIndexPos2) {
-
-              uint isSelected3ProngCand = n3ProngBit;
-              if (!TESTBIT(trackIndexPos2.isSelProng(), CandidateType::Cand3Prong)) { // continue immediately
-                if (!config.debug) {
-                  continue;
-                }
-                isSelected3ProngCand = 0;
-              }
-
-              if (config.applyKaonPidIn3Prongs && !TESTBIT(trackIndexNeg1.isIdentifiedPid(), ChannelKaonPid)) { // continue immediately if kaon PID enabled and opposite-sign track not a kaon
-                if (!config.debug) {
-                  continue;
-                }
-                isSelected3ProngCand = 0;
-              }
-
-              const auto trackPos2 = trackIndexPos2.template track_as<TTracks>();
+        // initialise PV refit coordinates and cov matrix for 2-prongs already here for D*
+        std::array pvRefitCoord2Prong = {collision.posX(), collision.posY(), collision.posZ()}; /// initialize to the original PV
+        std::array pvRefitCovMatrix2Prong = getPrimaryVertex(collision).getCov();               /// initialize to the original PV
 
-              auto trackParVarPos2 = getTrackParCov(trackPos2);
-              std::array dcaInfoPos2{trackPos2.dcaXY(), trackPos2.dcaZ()};
+        // 2-prong vertex reconstruction
+        float pt2Prong{-1.};
+        bool is2ProngCandidateGoodFor3Prong{sel3ProngStatusPos1 && sel3ProngStatusNeg1};
+        int nVtxFrom2ProngFitter = 0;
+        if (sel2ProngStatusPos && sel2ProngStatusNeg) {
 
-              // preselection of 3-prong candidates
-              if (isSelected3ProngCand) {
-                std::array pVecTrackPos2{trackPos2.pVector()};
-                if (thisCollId != trackPos2.collisionId()) { // this is not the "default" collision for this track and we still did not re-propagate it, we have to re-propagate it
-                  o2::base::Propagator::Instance()->propagateToDCABxByBz({collision.posX(), collision.posY(), collision.posZ()}, trackParVarPos2, 2.f, noMatCorr, &dcaInfoPos2);
-                  getPxPyPz(trackParVarPos2, pVecTrackPos2);
-                }
+          // 2-prong preselections
+          // TODO: in case of PV refit, the single-track DCA is calculated wrt two different PV vertices (only 1 track excluded)
+          applyPreselection2Prong(pVecTrackPos1, pVecTrackNeg1, dcaInfoPos1[0], dcaInfoNeg1[0], cutStatus2Prong, whichHypo2Prong, isSelected2ProngCand, pt2Prong);
 
-                if (config.debug) {
-                  for (int iDecay3P = 0; iDecay3P < kN3ProngDecays; iDecay3P++) {
-                    for (int iCut = 0; iCut < kNCuts3Prong[iDecay3P]; iCut++) {
-                      cutStatus3Prong[iDecay3P][iCut] = true;
-                    }
-                  }
-                }
+          if (isSelected2ProngCand > 0) {
+            // secondary vertex reconstruction and further 2-prong selections
+            try {
+              nVtxFrom2ProngFitter = fitter2.process(trackParVarPos1, trackParVarNeg1);
+            } catch (...) {
+            }
 
-                // 3-prong preselections
-                const auto isIdentifiedPidTrackPos1 = trackIndexPos1.isIdentifiedPid();
-                const auto isIdentifiedPidTrackPos2 = trackIndexPos2.isIdentifiedPid();
-                applyPreselection3Prong(pVecTrackPos1, pVecTrackNeg1, pVecTrackPos2, isIdentifiedPidTrackPos1, isIdentifiedPidTrackPos2, cutStatus3Prong, whichHypo3Prong, isSelected3ProngCand);
-                if (!config.debug && isSelected3ProngCand == 0) {
-                  continue;
-                }
-              }
+            if (nVtxFrom2ProngFitter > 0) { // should it be this or > 0 or are they equivalent
+              // get secondary vertex
+              const auto& secondaryVertex2 = fitter2.getPCACandidate();
+              // get track momenta
+              std::array<float, 3> pvec0{};
+              std::array<float, 3> pvec1{};
+              fitter2.getTrack(0).getPxPyPzGlo(pvec0);
+              fitter2.getTrack(1).getPxPyPzGlo(pvec1);
 
               /// PV refit excluding the candidate daughters, if contributors
-              std::array pvRefitCoord3Prong2Pos1Neg{collision.posX(), collision.posY(), collision.posZ()}; /// initialize to the original PV
-              std::array pvRefitCovMatrix3Prong2Pos1Neg{getPrimaryVertex(collision).getCov()};             /// initialize to the original PV
               if constexpr (DoPvRefit) {
                 if (config.fillHistograms) {
                   registry.fill(HIST("PvRefit/verticesPerCandidate"), 1);
                 }
-                int nCandContr = 3;
+                int nCandContr = 2;
                 auto trackFirstIt = std::find(vecPvContributorGlobId.begin(), vecPvContributorGlobId.end(), trackPos1.globalIndex());
                 auto trackSecondIt = std::find(vecPvContributorGlobId.begin(), vecPvContributorGlobId.end(), trackNeg1.globalIndex());
-                auto trackThirdIt = std::find(vecPvContributorGlobId.begin(), vecPvContributorGlobId.end(), trackPos2.globalIndex());
                 bool isTrackFirstContr = true;
                 bool isTrackSecondContr = true;
-                bool isTrackThirdContr = true;
                 if (trackFirstIt == vecPvContributorGlobId.end()) {
                   /// This track did not contribute to the original PV refit
                   if (config.debugPvRefit) {
-                    LOG(info) << "--- [3 prong] trackPos1 with globalIndex " << trackPos1.globalIndex() << " was not a PV contributor";
+                    LOG(info) << "--- [2 Prong] trackPos1 with globalIndex " << trackPos1.globalIndex() << " was not a PV contributor";
                   }
                   nCandContr--;
                   isTrackFirstContr = false;
@@ -2718,58 +2905,33 @@ struct HfTrackIndexSkimCreator {
                 if (trackSecondIt == vecPvContributorGlobId.end()) {
                   /// This track did not contribute to the original PV refit
                   if (config.debugPvRefit) {
-                    LOG(info) << "--- [3 prong] trackNeg1 with globalIndex " << trackNeg1.globalIndex() << " was not a PV contributor";
+                    LOG(info) << "--- [2 Prong] trackNeg1 with globalIndex " << trackNeg1.globalIndex() << " was not a PV contributor";
                   }
                   nCandContr--;
                   isTrackSecondContr = false;
                 }
-                if (trackThirdIt == vecPvContributorGlobId.end()) {
-                  /// This track did not contribute to the original PV refit
+                if (nCandContr == 2) { // o2-linter: disable="magic-number" (see comment below)
+                  /// Both the daughter tracks were used for the original PV refit, let's refit it after excluding them
                   if (config.debugPvRefit) {
-                    LOG(info) << "--- [3 prong] trackPos2 with globalIndex " << trackPos2.globalIndex() << " was not a PV contributor";
+                    LOG(info) << "### [2 Prong] Calling performPvRefitCandProngs for HF 2 prong candidate";
                   }
-                  nCandContr--;
-                  isTrackThirdContr = false;
-                }
-
-                // Fill a vector with global ID of candidate daughters that are contributors
-                std::vector<int64_t> vecCandPvContributorGlobId = {};
-                if (isTrackFirstContr) {
-                  vecCandPvContributorGlobId.push_back(trackPos1.globalIndex());
-                }
-                if (isTrackSecondContr) {
-                  vecCandPvContributorGlobId.push_back(trackNeg1.globalIndex());
-                }
-                if (isTrackThirdContr) {
-                  vecCandPvContributorGlobId.push_back(trackPos2.globalIndex());
-                }
-
-                if (nCandContr == 3 || nCandContr == 2) { // o2-linter: disable="magic-number" (see comment below)
-                  /// At least two of the daughter tracks were used for the original PV refit, let's refit it after excluding them
-                  if (config.debugPvRefit) {
-                    LOG(info) << "### [3 prong] Calling performPvRefitCandProngs for HF 3 prong candidate, removing " << nCandContr << " daughters";
-                  }
-                  performPvRefitCandProngs(collision, bcWithTimeStamps, vecPvContributorGlobId, vecPvContributorTrackParCov, vecCandPvContributorGlobId, pvRefitCoord3Prong2Pos1Neg, pvRefitCovMatrix3Prong2Pos1Neg);
+                  performPvRefitCandProngs(collision, bcWithTimeStamps, vecPvContributorGlobId, vecPvContributorTrackParCov, {trackPos1.globalIndex(), trackNeg1.globalIndex()}, pvRefitCoord2Prong, pvRefitCovMatrix2Prong);
                 } else if (nCandContr == 1) {
                   /// Only one daughter was a contributor, let's use then the PV recalculated by excluding only it
                   if (config.debugPvRefit) {
-                    LOG(info) << "####### [3 Prong] nCandContr==" << nCandContr << " ---> just 1 contributor!";
+                    LOG(info) << "####### [2 Prong] nCandContr==" << nCandContr << " ---> just 1 contributor!";
                   }
                   if (config.fillHistograms) {
                     registry.fill(HIST("PvRefit/verticesPerCandidate"), 5);
                   }
-                  if (isTrackFirstContr && !isTrackSecondContr && !isTrackThirdContr) {
-                    /// the first daughter is contributor, the second and the third are not
-                    pvRefitCoord3Prong2Pos1Neg = {trackPos1.pvRefitX(), trackPos1.pvRefitY(), trackPos1.pvRefitZ()};
-                    pvRefitCovMatrix3Prong2Pos1Neg = {trackPos1.pvRefitSigmaX2(), trackPos1.pvRefitSigmaXY(), trackPos1.pvRefitSigmaY2(), trackPos1.pvRefitSigmaXZ(), trackPos1.pvRefitSigmaYZ(), trackPos1.pvRefitSigmaZ2()};
-                  } else if (!isTrackFirstContr && isTrackSecondContr && !isTrackThirdContr) {
-                    /// the second daughter is contributor, the first and the third are not
-                    pvRefitCoord3Prong2Pos1Neg = {trackNeg1.pvRefitX(), trackNeg1.pvRefitY(), trackNeg1.pvRefitZ()};
-                    pvRefitCovMatrix3Prong2Pos1Neg = {trackNeg1.pvRefitSigmaX2(), trackNeg1.pvRefitSigmaXY(), trackNeg1.pvRefitSigmaY2(), trackNeg1.pvRefitSigmaXZ(), trackNeg1.pvRefitSigmaYZ(), trackNeg1.pvRefitSigmaZ2()};
-                  } else if (!isTrackFirstContr && !isTrackSecondContr && isTrackThirdContr) {
-                    /// the third daughter is contributor, the first and the second are not
-                    pvRefitCoord3Prong2Pos1Neg = {trackPos2.pvRefitX(), trackPos2.pvRefitY(), trackPos2.pvRefitZ()};
-                    pvRefitCovMatrix3Prong2Pos1Neg = {trackPos2.pvRefitSigmaX2(), trackPos2.pvRefitSigmaXY(), trackPos2.pvRefitSigmaY2(), trackPos2.pvRefitSigmaXZ(), trackPos2.pvRefitSigmaYZ(), trackPos2.pvRefitSigmaZ2()};
+                  if (isTrackFirstContr && !isTrackSecondContr) {
+                    /// the first daughter is contributor, the second is not
+                    pvRefitCoord2Prong = {trackPos1.pvRefitX(), trackPos1.pvRefitY(), trackPos1.pvRefitZ()};
+                    pvRefitCovMatrix2Prong = {trackPos1.pvRefitSigmaX2(), trackPos1.pvRefitSigmaXY(), trackPos1.pvRefitSigmaY2(), trackPos1.pvRefitSigmaXZ(), trackPos1.pvRefitSigmaYZ(), trackPos1.pvRefitSigmaZ2()};
+                  } else if (!isTrackFirstContr && isTrackSecondContr) {
+                    ///  the second daughter is contributor, the first is not
+                    pvRefitCoord2Prong = {trackNeg1.pvRefitX(), trackNeg1.pvRefitY(), trackNeg1.pvRefitZ()};
+                    pvRefitCovMatrix2Prong = {trackNeg1.pvRefitSigmaX2(), trackNeg1.pvRefitSigmaXY(), trackNeg1.pvRefitSigmaY2(), trackNeg1.pvRefitSigmaXZ(), trackNeg1.pvRefitSigmaYZ(), trackNeg1.pvRefitSigmaZ2()};
                   }
                 } else {
                   /// 0 contributors among the HF candidate daughters
@@ -2777,522 +2939,577 @@ struct HfTrackIndexSkimCreator {
                     registry.fill(HIST("PvRefit/verticesPerCandidate"), 6);
                   }
                   if (config.debugPvRefit) {
-                    LOG(info) << "####### [3 prong] nCandContr==" << nCandContr << " ---> some of the candidate daughters did not contribute to the original PV fit, PV refit not redone";
+                    LOG(info) << "####### [2 Prong] nCandContr==" << nCandContr << " ---> some of the candidate daughters did not contribute to the original PV fit, PV refit not redone";
                   }
                 }
               }
 
-              // reconstruct the 3-prong secondary vertex
-              int nVtxFrom3ProngFitter = 0;
-              try {
-                nVtxFrom3ProngFitter = df3.process(trackParVarPos1, trackParVarNeg1, trackParVarPos2);
-              } catch (...) {
-                continue;
+              const auto pVecCandProng2 = RecoDecay::pVec(pvec0, pvec1);
+              // 2-prong selections after secondary vertex
+              std::array pvCoord2Prong = {collision.posX(), collision.posY(), collision.posZ()};
+              if constexpr (DoPvRefit) {
+                pvCoord2Prong[0] = pvRefitCoord2Prong[0];
+                pvCoord2Prong[1] = pvRefitCoord2Prong[1];
+                pvCoord2Prong[2] = pvRefitCoord2Prong[2];
               }
-
-              if (nVtxFrom3ProngFitter == 0) {
-                continue;
+              applySelection2Prong(pVecCandProng2, secondaryVertex2, pvCoord2Prong, cutStatus2Prong, isSelected2ProngCand);
+              if (is2ProngCandidateGoodFor3Prong && config.do3Prong) {
+                is2ProngCandidateGoodFor3Prong = isTwoTrackVertexSelectedFor3Prongs(secondaryVertex2, pvCoord2Prong, fitter2);
               }
-              // get secondary vertex
-              const auto& secondaryVertex3 = df3.getPCACandidate();
-              // get track momenta
-              std::array<float, 3> pvec0{};
-              std::array<float, 3> pvec1{};
-              std::array<float, 3> pvec2{};
-              const auto trackParVarPcaPos1 = df3.getTrack(0);
-              const auto trackParVarPcaNeg1 = df3.getTrack(1);
-              const auto trackParVarPcaPos2 = df3.getTrack(2);
-              trackParVarPcaPos1.getPxPyPzGlo(pvec0);
-              trackParVarPcaNeg1.getPxPyPzGlo(pvec1);
-              trackParVarPcaPos2.getPxPyPzGlo(pvec2);
-              const auto pVecCandProng3Pos = RecoDecay::pVec(pvec0, pvec1, pvec2);
-
-              // 3-prong selections after secondary vertex
-              applySelection3Prong(pVecCandProng3Pos, secondaryVertex3, pvRefitCoord3Prong2Pos1Neg, cutStatus3Prong, isSelected3ProngCand);
-
-              std::array<std::vector<float>, kN3ProngDecaysUsedMlForHfFilters> mlScores3Prongs;
+
+              std::vector<float> mlScoresD0{};
               if (config.applyMlForHfFilters) {
-                const std::vector<float> inputFeatures{trackParVarPcaPos1.getPt(), dcaInfoPos1[0], dcaInfoPos1[1], trackParVarPcaNeg1.getPt(), dcaInfoNeg1[0], dcaInfoNeg1[1], trackParVarPcaPos2.getPt(), dcaInfoPos2[0], dcaInfoPos2[1]};
-                std::vector<float> inputFeaturesLcPid{};
-                if constexpr (UsePidForHfFiltersBdt) {
-                  inputFeaturesLcPid.push_back(trackPos1.tpcNSigmaPr());
-                  inputFeaturesLcPid.push_back(trackPos2.tpcNSigmaPr());
-                  inputFeaturesLcPid.push_back(trackPos1.tpcNSigmaPi());
-                  inputFeaturesLcPid.push_back(trackPos2.tpcNSigmaPi());
-                  inputFeaturesLcPid.push_back(trackNeg1.tpcNSigmaKa());
+                const auto trackParVarPcaPos1 = fitter2.getTrack(0);
+                const auto trackParVarPcaNeg1 = fitter2.getTrack(1);
+                const std::vector<float> inputFeatures{trackParVarPcaPos1.getPt(), dcaInfoPos1[0], dcaInfoPos1[1], trackParVarPcaNeg1.getPt(), dcaInfoNeg1[0], dcaInfoNeg1[1]};
+                applyMlSelectionForHfFilters2Prong(inputFeatures, mlScoresD0, isSelected2ProngCand);
+              }
+
+              if (isSelected2ProngCand > 0) {
+                ++nCand2;
+                uint8_t prong2CutStatus[kN2ProngDecays]{};
+                if (config.debug) {
+                  for (int iDecay2P = 0; iDecay2P < kN2ProngDecays; iDecay2P++) {
+                    prong2CutStatus[iDecay2P] = nCutStatus2ProngBit[iDecay2P];
+                    for (int iCut = 0; iCut < kNCuts2Prong[iDecay2P]; iCut++) {
+                      if (!cutStatus2Prong[iDecay2P][iCut]) {
+                        CLRBIT(prong2CutStatus[iDecay2P], iCut);
+                      }
+                    }
+                  }
                 }
-                applyMlSelectionForHfFilters3Prong<UsePidForHfFiltersBdt>(inputFeatures, inputFeaturesLcPid, mlScores3Prongs, isSelected3ProngCand);
+                const auto indexPos1 = trackPos1.globalIndex();
+                const auto indexNeg1 = trackNeg1.globalIndex();
+                const std::array arrMom{pvec0, pvec1};
+
+                emitOutput<DoPvRefit>(sink, Prong2Output{.collisionId = thisCollId,
+                                                           .trackIds = {indexPos1, indexNeg1},
+                                                           .isSelected = isSelected2ProngCand,
+                                                           .mlScores = std::move(mlScoresD0),
+                                                           .pvRefitCoord = pvRefitCoord2Prong,
+                                                           .pvRefitCovMatrix = pvRefitCovMatrix2Prong,
+                                                           .cutStatus = std::to_array(prong2CutStatus),
+                                                           .secondaryVertex = {secondaryVertex2[0], secondaryVertex2[1], secondaryVertex2[2]},
+                                                           .pVecProngs = arrMom,
+                                                           .whichHypo = std::to_array(whichHypo2Prong)});
               }
+            } else {
+              isSelected2ProngCand = 0; // reset to 0 not to use the D0 to build a D* meson
+            }
+          } else {
+            isSelected2ProngCand = 0; // reset to 0 not to use the D0 to build a D* meson
+          }
+        }
 
-              if (!config.debug && isSelected3ProngCand == 0) {
+        // if the cut on the decay length of 3-prongs computed with the first two tracks is enabled and the vertex was not computed for the D0, we compute it now
+        if (config.do3Prong && is2ProngCandidateGoodFor3Prong && (config.minTwoTrackDecayLengthFor3Prongs > 0.f || config.maxTwoTrackChi2PcaFor3Prongs < 1.e9f) && nVtxFrom2ProngFitter == 0) { // o2-linter: disable="magic-number" (default maxTwoTrackChi2PcaFor3Prongs is 1.e10)
+          try {
+            nVtxFrom2ProngFitter = fitter2.process(trackParVarPos1, trackParVarNeg1);
+          } catch (...) {
+          }
+          if (nVtxFrom2ProngFitter > 0) {
+            const auto& secondaryVertex2 = fitter2.getPCACandidate();
+            const std::array pvCoord2Prong{collision.posX(), collision.posY(), collision.posZ()};
+            is2ProngCandidateGoodFor3Prong = isTwoTrackVertexSelectedFor3Prongs(secondaryVertex2, pvCoord2Prong, fitter2);
+          } else {
+            is2ProngCandidateGoodFor3Prong = false;
+          }
+        }
+
+        if (config.do3Prong && is2ProngCandidateGoodFor3Prong) { // if 3 prongs are enabled and the first 2 tracks are selected for the 3-prong channels
+          // second loop over positive tracks
+          for (auto trackIndexPos2 = trackIndexPos1 + 1; trackIndexPos2 != groupedTrackIndicesPos1.end(); ++trackIndexPos2) {
+
+            uint isSelected3ProngCand = n3ProngBit;
+            if (!TESTBIT(trackIndexPos2.isSelProng(), CandidateType::Cand3Prong)) { // continue immediately
+              if (!config.debug) {
                 continue;
               }
+              isSelected3ProngCand = 0;
+            }
 
-              // fill table row
-              rowTrackIndexProng3(thisCollId, trackPos1.globalIndex(), trackNeg1.globalIndex(), trackPos2.globalIndex(), isSelected3ProngCand);
-              if (config.applyMlForHfFilters) {
-                rowTrackIndexMlScoreProng3(mlScores3Prongs[0], mlScores3Prongs[1], mlScores3Prongs[2], mlScores3Prongs[3]);
+            if (config.applyKaonPidIn3Prongs && !TESTBIT(trackIndexNeg1.isIdentifiedPid(), ChannelKaonPid)) { // continue immediately if kaon PID enabled and opposite-sign track not a kaon
+              if (!config.debug) {
+                continue;
               }
-              if constexpr (DoPvRefit) {
-                // fill table row of coordinates of PV refit
-                rowProng3PVrefit(pvRefitCoord3Prong2Pos1Neg[0], pvRefitCoord3Prong2Pos1Neg[1], pvRefitCoord3Prong2Pos1Neg[2],
-                                 pvRefitCovMatrix3Prong2Pos1Neg[0], pvRefitCovMatrix3Prong2Pos1Neg[1], pvRefitCovMatrix3Prong2Pos1Neg[2], pvRefitCovMatrix3Prong2Pos1Neg[3], pvRefitCovMatrix3Prong2Pos1Neg[4], pvRefitCovMatrix3Prong2Pos1Neg[5]);
+              isSelected3ProngCand = 0;
+            }
+
+            const auto trackPos2 = trackIndexPos2.template track_as<TTracks>();
+
+            auto trackParVarPos2 = getTrackParCov(trackPos2);
+            std::array dcaInfoPos2{trackPos2.dcaXY(), trackPos2.dcaZ()};
+
+            // preselection of 3-prong candidates
+            if (isSelected3ProngCand) {
+              std::array pVecTrackPos2{trackPos2.pVector()};
+              if (thisCollId != trackPos2.collisionId()) { // this is not the "default" collision for this track and we still did not re-propagate it, we have to re-propagate it
+                o2::base::Propagator::Instance()->propagateToDCABxByBz({collision.posX(), collision.posY(), collision.posZ()}, trackParVarPos2, 2.f, noMatCorr, &dcaInfoPos2);
+                getPxPyPz(trackParVarPos2, pVecTrackPos2);
               }
 
               if (config.debug) {
-                uint8_t prong3CutStatus[kN3ProngDecays];
                 for (int iDecay3P = 0; iDecay3P < kN3ProngDecays; iDecay3P++) {
-                  prong3CutStatus[iDecay3P] = nCutStatus3ProngBit[iDecay3P];
                   for (int iCut = 0; iCut < kNCuts3Prong[iDecay3P]; iCut++) {
-                    if (!cutStatus3Prong[iDecay3P][iCut]) {
-                      CLRBIT(prong3CutStatus[iDecay3P], iCut);
-                    }
+                    cutStatus3Prong[iDecay3P][iCut] = true;
                   }
                 }
-                rowProng3CutStatus(prong3CutStatus[0], prong3CutStatus[1], prong3CutStatus[2], prong3CutStatus[3]); // FIXME when we can do this by looping over kN3ProngDecays
               }
 
-              // fill histograms
-              if (config.fillHistograms) {
-                registry.fill(HIST("hVtx3ProngX"), secondaryVertex3[0]);
-                registry.fill(HIST("hVtx3ProngY"), secondaryVertex3[1]);
-                registry.fill(HIST("hVtx3ProngZ"), secondaryVertex3[2]);
-                const std::array arr3Mom{pvec0, pvec1, pvec2};
-                for (int iDecay3P = 0; iDecay3P < kN3ProngDecays; iDecay3P++) {
-                  if (TESTBIT(isSelected3ProngCand, iDecay3P)) {
-                    if (TESTBIT(whichHypo3Prong[iDecay3P], 0)) {
-                      const auto mass3Prong = RecoDecay::m(arr3Mom, arrMass3Prong[iDecay3P][0]);
-                      switch (iDecay3P) {
-                        case hf_cand_3prong::DecayType::DplusToPiKPi:
-                          registry.fill(HIST("hMassDPlusToPiKPi"), mass3Prong);
-                          break;
-                        case hf_cand_3prong::DecayType::DsToKKPi:
-                          registry.fill(HIST("hMassDsToKKPi"), mass3Prong);
-                          break;
-                        case hf_cand_3prong::DecayType::LcToPKPi:
-                          registry.fill(HIST("hMassLcToPKPi"), mass3Prong);
-                          break;
-                        case hf_cand_3prong::DecayType::XicToPKPi:
-                          registry.fill(HIST("hMassXicToPKPi"), mass3Prong);
-                          break;
-                        case hf_cand_3prong::DecayType::CdToDeKPi:
-                          registry.fill(HIST("hMassCdToDeKPi"), mass3Prong);
-                          break;
-                        case hf_cand_3prong::DecayType::CtToTrKPi:
-                          registry.fill(HIST("hMassCtToTrKPi"), mass3Prong);
-                          break;
-                        case hf_cand_3prong::DecayType::ChToHeKPi:
-                          registry.fill(HIST("hMassChToHeKPi"), mass3Prong);
-                          break;
-                        case hf_cand_3prong::DecayType::CaToAlKPi:
-                          registry.fill(HIST("hMassCaToAlKPi"), mass3Prong);
-                          break;
-                      }
-                    }
-                    if (TESTBIT(whichHypo3Prong[iDecay3P], 1)) {
-                      const auto mass3Prong = RecoDecay::m(arr3Mom, arrMass3Prong[iDecay3P][1]);
-                      switch (iDecay3P) {
-                        case hf_cand_3prong::DecayType::DsToKKPi:
-                          registry.fill(HIST("hMassDsToKKPi"), mass3Prong);
-                          break;
-                        case hf_cand_3prong::DecayType::LcToPKPi:
-                          registry.fill(HIST("hMassLcToPKPi"), mass3Prong);
-                          break;
-                        case hf_cand_3prong::DecayType::XicToPKPi:
-                          registry.fill(HIST("hMassXicToPKPi"), mass3Prong);
-                          break;
-                        case hf_cand_3prong::DecayType::CdToDeKPi:
-                          registry.fill(HIST("hMassCdToDeKPi"), mass3Prong);
-                          break;
-                        case hf_cand_3prong::DecayType::CtToTrKPi:
-                          registry.fill(HIST("hMassCtToTrKPi"), mass3Prong);
-                          break;
-                        case hf_cand_3prong::DecayType::ChToHeKPi:
-                          registry.fill(HIST("hMassChToHeKPi"), mass3Prong);
-                          break;
-                        case hf_cand_3prong::DecayType::CaToAlKPi:
-                          registry.fill(HIST("hMassCaToAlKPi"), mass3Prong);
-                          break;
-                      }
-                    }
-                  }
-                }
+              // 3-prong preselections
+              const auto isIdentifiedPidTrackPos1 = trackIndexPos1.isIdentifiedPid();
+              const auto isIdentifiedPidTrackPos2 = trackIndexPos2.isIdentifiedPid();
+              applyPreselection3Prong(pVecTrackPos1, pVecTrackNeg1, pVecTrackPos2, isIdentifiedPidTrackPos1, isIdentifiedPidTrackPos2, cutStatus3Prong, whichHypo3Prong, isSelected3ProngCand);
+              if (!config.debug && isSelected3ProngCand == 0) {
+                continue;
               }
             }
 
-            // second loop over negative tracks
-            for (auto trackIndexNeg2 = trackIndexNeg1 + 1; trackIndexNeg2 != groupedTrackIndicesNeg1.end(); ++trackIndexNeg2) {
-
-              int isSelected3ProngCand = n3ProngBit;
-              if (!TESTBIT(trackIndexNeg2.isSelProng(), CandidateType::Cand3Prong)) { // continue immediately
-                if (!config.debug) {
-                  continue;
-                }
-                isSelected3ProngCand = 0;
+            /// PV refit excluding the candidate daughters, if contributors
+            std::array pvRefitCoord3Prong2Pos1Neg{collision.posX(), collision.posY(), collision.posZ()}; /// initialize to the original PV
+            std::array pvRefitCovMatrix3Prong2Pos1Neg{getPrimaryVertex(collision).getCov()};             /// initialize to the original PV
+            if constexpr (DoPvRefit) {
+              if (config.fillHistograms) {
+                registry.fill(HIST("PvRefit/verticesPerCandidate"), 1);
               }
-
-              if (config.applyKaonPidIn3Prongs && !TESTBIT(trackIndexPos1.isIdentifiedPid(), ChannelKaonPid)) { // continue immediately if kaon PID enabled and opposite-sign track not a kaon
-                if (!config.debug) {
-                  continue;
+              int nCandContr = 3;
+              auto trackFirstIt = std::find(vecPvContributorGlobId.begin(), vecPvContributorGlobId.end(), trackPos1.globalIndex());
+              auto trackSecondIt = std::find(vecPvContributorGlobId.begin(), vecPvContributorGlobId.end(), trackNeg1.globalIndex());
+              auto trackThirdIt = std::find(vecPvContributorGlobId.begin(), vecPvContributorGlobId.end(), trackPos2.globalIndex());
+              bool isTrackFirstContr = true;
+              bool isTrackSecondContr = true;
+              bool isTrackThirdContr = true;
+              if (trackFirstIt == vecPvContributorGlobId.end()) {
+                /// This track did not contribute to the original PV refit
+                if (config.debugPvRefit) {
+                  LOG(info) << "--- [3 prong] trackPos1 with globalIndex " << trackPos1.globalIndex() << " was not a PV contributor";
                 }
-                isSelected3ProngCand = 0;
+                nCandContr--;
+                isTrackFirstContr = false;
               }
-
-              auto trackNeg2 = trackIndexNeg2.template track_as<TTracks>();
-              auto trackParVarNeg2 = getTrackParCov(trackNeg2);
-              std::array dcaInfoNeg2{trackNeg2.dcaXY(), trackNeg2.dcaZ()};
-
-              // preselection of 3-prong candidates
-              if (isSelected3ProngCand) {
-                std::array pVecTrackNeg2{trackNeg2.pVector()};
-                if (thisCollId != trackNeg2.collisionId()) { // this is not the "default" collision for this track and we still did not re-propagate it, we have to re-propagate it
-                  o2::base::Propagator::Instance()->propagateToDCABxByBz({collision.posX(), collision.posY(), collision.posZ()}, trackParVarNeg2, 2.f, noMatCorr, &dcaInfoNeg2);
-                  getPxPyPz(trackParVarNeg2, pVecTrackNeg2);
+              if (trackSecondIt == vecPvContributorGlobId.end()) {
+                /// This track did not contribute to the original PV refit
+                if (config.debugPvRefit) {
+                  LOG(info) << "--- [3 prong] trackNeg1 with globalIndex " << trackNeg1.globalIndex() << " was not a PV contributor";
                 }
-
-                if (config.debug) {
-                  for (int iDecay3P = 0; iDecay3P < kN3ProngDecays; iDecay3P++) {
-                    for (int iCut = 0; iCut < kNCuts3Prong[iDecay3P]; iCut++) {
-                      cutStatus3Prong[iDecay3P][iCut] = true;
-                    }
-                  }
+                nCandContr--;
+                isTrackSecondContr = false;
+              }
+              if (trackThirdIt == vecPvContributorGlobId.end()) {
+                /// This track did not contribute to the original PV refit
+                if (config.debugPvRefit) {
+                  LOG(info) << "--- [3 prong] trackPos2 with globalIndex " << trackPos2.globalIndex() << " was not a PV contributor";
                 }
+                nCandContr--;
+                isTrackThirdContr = false;
+              }
 
-                // 3-prong preselections
-                int8_t const isIdentifiedPidTrackNeg1 = trackIndexNeg1.isIdentifiedPid();
-                int8_t const isIdentifiedPidTrackNeg2 = trackIndexNeg2.isIdentifiedPid();
-                applyPreselection3Prong(pVecTrackNeg1, pVecTrackPos1, pVecTrackNeg2, isIdentifiedPidTrackNeg1, isIdentifiedPidTrackNeg2, cutStatus3Prong, whichHypo3Prong, isSelected3ProngCand);
-                if (!config.debug && isSelected3ProngCand == 0) {
-                  continue;
-                }
+              // Fill a vector with global ID of candidate daughters that are contributors
+              std::vector<int64_t> vecCandPvContributorGlobId = {};
+              if (isTrackFirstContr) {
+                vecCandPvContributorGlobId.push_back(trackPos1.globalIndex());
+              }
+              if (isTrackSecondContr) {
+                vecCandPvContributorGlobId.push_back(trackNeg1.globalIndex());
+              }
+              if (isTrackThirdContr) {
+                vecCandPvContributorGlobId.push_back(trackPos2.globalIndex());
               }
 
-              /// PV refit excluding the candidate daughters, if contributors
-              std::array pvRefitCoord3Prong1Pos2Neg{collision.posX(), collision.posY(), collision.posZ()}; /// initialize to the original PV
-              std::array pvRefitCovMatrix3Prong1Pos2Neg{getPrimaryVertex(collision).getCov()};             /// initialize to the original PV
-              if constexpr (DoPvRefit) {
-                if (config.fillHistograms) {
-                  registry.fill(HIST("PvRefit/verticesPerCandidate"), 1);
+              if (nCandContr == 3 || nCandContr == 2) { // o2-linter: disable="magic-number" (see comment below)
+                /// At least two of the daughter tracks were used for the original PV refit, let's refit it after excluding them
+                if (config.debugPvRefit) {
+                  LOG(info) << "### [3 prong] Calling performPvRefitCandProngs for HF 3 prong candidate, removing " << nCandContr << " daughters";
                 }
-                int nCandContr = 3;
-                auto trackFirstIt = std::find(vecPvContributorGlobId.begin(), vecPvContributorGlobId.end(), trackPos1.globalIndex());
-                auto trackSecondIt = std::find(vecPvContributorGlobId.begin(), vecPvContributorGlobId.end(), trackNeg1.globalIndex());
-                auto trackThirdIt = std::find(vecPvContributorGlobId.begin(), vecPvContributorGlobId.end(), trackNeg2.globalIndex());
-                bool isTrackFirstContr = true;
-                bool isTrackSecondContr = true;
-                bool isTrackThirdContr = true;
-                if (trackFirstIt == vecPvContributorGlobId.end()) {
-                  /// This track did not contribute to the original PV refit
-                  if (config.debugPvRefit) {
-                    LOG(info) << "--- [3 prong] trackPos1 with globalIndex " << trackPos1.globalIndex() << " was not a PV contributor";
-                  }
-                  nCandContr--;
-                  isTrackFirstContr = false;
+                performPvRefitCandProngs(collision, bcWithTimeStamps, vecPvContributorGlobId, vecPvContributorTrackParCov, vecCandPvContributorGlobId, pvRefitCoord3Prong2Pos1Neg, pvRefitCovMatrix3Prong2Pos1Neg);
+              } else if (nCandContr == 1) {
+                /// Only one daughter was a contributor, let's use then the PV recalculated by excluding only it
+                if (config.debugPvRefit) {
+                  LOG(info) << "####### [3 Prong] nCandContr==" << nCandContr << " ---> just 1 contributor!";
                 }
-                if (trackSecondIt == vecPvContributorGlobId.end()) {
-                  /// This track did not contribute to the original PV refit
-                  if (config.debugPvRefit) {
-                    LOG(info) << "--- [3 prong] trackNeg1 with globalIndex " << trackNeg1.globalIndex() << " was not a PV contributor";
-                  }
-                  nCandContr--;
-                  isTrackSecondContr = false;
-                }
-                if (trackThirdIt == vecPvContributorGlobId.end()) {
-                  /// This track did not contribute to the original PV refit
-                  if (config.debugPvRefit) {
-                    LOG(info) << "--- [3 prong] trackNeg2 with globalIndex " << trackNeg2.globalIndex() << " was not a PV contributor";
-                  }
-                  nCandContr--;
-                  isTrackThirdContr = false;
+                if (config.fillHistograms) {
+                  registry.fill(HIST("PvRefit/verticesPerCandidate"), 5);
                 }
-
-                // Fill a vector with global ID of candidate daughters that are contributors
-                std::vector<int64_t> vecCandPvContributorGlobId = {};
-                if (isTrackFirstContr) {
-                  vecCandPvContributorGlobId.push_back(trackPos1.globalIndex());
+                if (isTrackFirstContr && !isTrackSecondContr && !isTrackThirdContr) {
+                  /// the first daughter is contributor, the second and the third are not
+                  pvRefitCoord3Prong2Pos1Neg = {trackPos1.pvRefitX(), trackPos1.pvRefitY(), trackPos1.pvRefitZ()};
+                  pvRefitCovMatrix3Prong2Pos1Neg = {trackPos1.pvRefitSigmaX2(), trackPos1.pvRefitSigmaXY(), trackPos1.pvRefitSigmaY2(), trackPos1.pvRefitSigmaXZ(), trackPos1.pvRefitSigmaYZ(), trackPos1.pvRefitSigmaZ2()};
+                } else if (!isTrackFirstContr && isTrackSecondContr && !isTrackThirdContr) {
+                  /// the second daughter is contributor, the first and the third are not
+                  pvRefitCoord3Prong2Pos1Neg = {trackNeg1.pvRefitX(), trackNeg1.pvRefitY(), trackNeg1.pvRefitZ()};
+                  pvRefitCovMatrix3Prong2Pos1Neg = {trackNeg1.pvRefitSigmaX2(), trackNeg1.pvRefitSigmaXY(), trackNeg1.pvRefitSigmaY2(), trackNeg1.pvRefitSigmaXZ(), trackNeg1.pvRefitSigmaYZ(), trackNeg1.pvRefitSigmaZ2()};
+                } else if (!isTrackFirstContr && !isTrackSecondContr && isTrackThirdContr) {
+                  /// the third daughter is contributor, the first and the second are not
+                  pvRefitCoord3Prong2Pos1Neg = {trackPos2.pvRefitX(), trackPos2.pvRefitY(), trackPos2.pvRefitZ()};
+                  pvRefitCovMatrix3Prong2Pos1Neg = {trackPos2.pvRefitSigmaX2(), trackPos2.pvRefitSigmaXY(), trackPos2.pvRefitSigmaY2(), trackPos2.pvRefitSigmaXZ(), trackPos2.pvRefitSigmaYZ(), trackPos2.pvRefitSigmaZ2()};
                 }
-                if (isTrackSecondContr) {
-                  vecCandPvContributorGlobId.push_back(trackNeg1.globalIndex());
+              } else {
+                /// 0 contributors among the HF candidate daughters
+                if (config.fillHistograms) {
+                  registry.fill(HIST("PvRefit/verticesPerCandidate"), 6);
                 }
-                if (isTrackThirdContr) {
-                  vecCandPvContributorGlobId.push_back(trackNeg2.globalIndex());
+                if (config.debugPvRefit) {
+                  LOG(info) << "####### [3 prong] nCandContr==" << nCandContr << " ---> some of the candidate daughters did not contribute to the original PV fit, PV refit not redone";
                 }
+              }
+            }
 
-                if (nCandContr == 3 || nCandContr == 2) { // o2-linter: disable="magic-number" (see comment below)
-                  /// At least two of the daughter tracks were used for the original PV refit, let's refit it after excluding them
-                  if (config.debugPvRefit) {
-                    LOG(info) << "### [3 prong] Calling performPvRefitCandProngs for HF 3 prong candidate, removing " << nCandContr << " daughters";
-                  }
-                  performPvRefitCandProngs(collision, bcWithTimeStamps, vecPvContributorGlobId, vecPvContributorTrackParCov, vecCandPvContributorGlobId, pvRefitCoord3Prong1Pos2Neg, pvRefitCovMatrix3Prong1Pos2Neg);
-                } else if (nCandContr == 1) {
-                  /// Only one daughter was a contributor, let's use then the PV recalculated by excluding only it
-                  if (config.debugPvRefit) {
-                    LOG(info) << "####### [3 Prong] nCandContr==" << nCandContr << " ---> just 1 contributor!";
-                  }
-                  if (config.fillHistograms) {
-                    registry.fill(HIST("PvRefit/verticesPerCandidate"), 5);
-                  }
-                  if (isTrackFirstContr && !isTrackSecondContr && !isTrackThirdContr) {
-                    /// the first daughter is contributor, the second and the third are not
-                    pvRefitCoord3Prong1Pos2Neg = {trackPos1.pvRefitX(), trackPos1.pvRefitY(), trackPos1.pvRefitZ()};
-                    pvRefitCovMatrix3Prong1Pos2Neg = {trackPos1.pvRefitSigmaX2(), trackPos1.pvRefitSigmaXY(), trackPos1.pvRefitSigmaY2(), trackPos1.pvRefitSigmaXZ(), trackPos1.pvRefitSigmaYZ(), trackPos1.pvRefitSigmaZ2()};
-                  } else if (!isTrackFirstContr && isTrackSecondContr && !isTrackThirdContr) {
-                    /// the second daughter is contributor, the first and the third are not
-                    pvRefitCoord3Prong1Pos2Neg = {trackNeg1.pvRefitX(), trackNeg1.pvRefitY(), trackNeg1.pvRefitZ()};
-                    pvRefitCovMatrix3Prong1Pos2Neg = {trackNeg1.pvRefitSigmaX2(), trackNeg1.pvRefitSigmaXY(), trackNeg1.pvRefitSigmaY2(), trackNeg1.pvRefitSigmaXZ(), trackNeg1.pvRefitSigmaYZ(), trackNeg1.pvRefitSigmaZ2()};
-                  } else if (!isTrackFirstContr && !isTrackSecondContr && isTrackThirdContr) {
-                    /// the third daughter is contributor, the first and the second are not
-                    pvRefitCoord3Prong1Pos2Neg = {trackNeg2.pvRefitX(), trackNeg2.pvRefitY(), trackNeg2.pvRefitZ()};
-                    pvRefitCovMatrix3Prong1Pos2Neg = {trackNeg2.pvRefitSigmaX2(), trackNeg2.pvRefitSigmaXY(), trackNeg2.pvRefitSigmaY2(), trackNeg2.pvRefitSigmaXZ(), trackNeg2.pvRefitSigmaYZ(), trackNeg2.pvRefitSigmaZ2()};
-                  }
-                } else {
-                  /// 0 contributors among the HF candidate daughters
-                  if (config.fillHistograms) {
-                    registry.fill(HIST("PvRefit/verticesPerCandidate"), 6);
-                  }
-                  if (config.debugPvRefit) {
-                    LOG(info) << "####### [3 prong] nCandContr==" << nCandContr << " ---> some of the candidate daughters did not contribute to the original PV fit, PV refit not redone";
+            // reconstruct the 3-prong secondary vertex
+            int nVtxFrom3ProngFitter = 0;
+            try {
+              nVtxFrom3ProngFitter = fitter3.process(trackParVarPos1, trackParVarNeg1, trackParVarPos2);
+            } catch (...) {
+              continue;
+            }
+
+            if (nVtxFrom3ProngFitter == 0) {
+              continue;
+            }
+            // get secondary vertex
+            const auto& secondaryVertex3 = fitter3.getPCACandidate();
+            // get track momenta
+            std::array<float, 3> pvec0{};
+            std::array<float, 3> pvec1{};
+            std::array<float, 3> pvec2{};
+            const auto trackParVarPcaPos1 = fitter3.getTrack(0);
+            const auto trackParVarPcaNeg1 = fitter3.getTrack(1);
+            const auto trackParVarPcaPos2 = fitter3.getTrack(2);
+            trackParVarPcaPos1.getPxPyPzGlo(pvec0);
+            trackParVarPcaNeg1.getPxPyPzGlo(pvec1);
+            trackParVarPcaPos2.getPxPyPzGlo(pvec2);
+            const auto pVecCandProng3Pos = RecoDecay::pVec(pvec0, pvec1, pvec2);
+
+            // 3-prong selections after secondary vertex
+            applySelection3Prong(pVecCandProng3Pos, secondaryVertex3, pvRefitCoord3Prong2Pos1Neg, cutStatus3Prong, isSelected3ProngCand);
+
+            std::array<std::vector<float>, kN3ProngDecaysUsedMlForHfFilters> mlScores3Prongs;
+            if (config.applyMlForHfFilters) {
+              const std::vector<float> inputFeatures{trackParVarPcaPos1.getPt(), dcaInfoPos1[0], dcaInfoPos1[1], trackParVarPcaNeg1.getPt(), dcaInfoNeg1[0], dcaInfoNeg1[1], trackParVarPcaPos2.getPt(), dcaInfoPos2[0], dcaInfoPos2[1]};
+              std::vector<float> inputFeaturesLcPid{};
+              if constexpr (UsePidForHfFiltersBdt) {
+                inputFeaturesLcPid.push_back(trackPos1.tpcNSigmaPr());
+                inputFeaturesLcPid.push_back(trackPos2.tpcNSigmaPr());
+                inputFeaturesLcPid.push_back(trackPos1.tpcNSigmaPi());
+                inputFeaturesLcPid.push_back(trackPos2.tpcNSigmaPi());
+                inputFeaturesLcPid.push_back(trackNeg1.tpcNSigmaKa());
+              }
+              applyMlSelectionForHfFilters3Prong<UsePidForHfFiltersBdt>(inputFeatures, inputFeaturesLcPid, mlScores3Prongs, isSelected3ProngCand);
+            }
+
+            if (!config.debug && isSelected3ProngCand == 0) {
+              continue;
+            }
+
+            ++nCand3;
+            uint8_t prong3CutStatus[kN3ProngDecays]{};
+            if (config.debug) {
+              for (int iDecay3P = 0; iDecay3P < kN3ProngDecays; iDecay3P++) {
+                prong3CutStatus[iDecay3P] = nCutStatus3ProngBit[iDecay3P];
+                for (int iCut = 0; iCut < kNCuts3Prong[iDecay3P]; iCut++) {
+                  if (!cutStatus3Prong[iDecay3P][iCut]) {
+                    CLRBIT(prong3CutStatus[iDecay3P], iCut);
                   }
                 }
               }
+            }
+            const auto indexPos1 = trackPos1.globalIndex();
+            const auto indexNeg1 = trackNeg1.globalIndex();
+            const auto indexPos2 = trackPos2.globalIndex();
+
+            emitOutput<DoPvRefit>(sink, Prong3Output{.collisionId = thisCollId,
+                                                       .trackIds = {indexPos1, indexNeg1, indexPos2},
+                                                       .isSelected = isSelected3ProngCand,
+                                                       .mlScores = std::move(mlScores3Prongs),
+                                                       .pvRefitCoord = pvRefitCoord3Prong2Pos1Neg,
+                                                       .pvRefitCovMatrix = pvRefitCovMatrix3Prong2Pos1Neg,
+                                                       .cutStatus = std::to_array(prong3CutStatus),
+                                                       .secondaryVertex = {secondaryVertex3[0], secondaryVertex3[1], secondaryVertex3[2]},
+                                                       .pVecProngs = {pvec0, pvec1, pvec2},
+                                                       .whichHypo = std::to_array(whichHypo3Prong)});
+          }
 
-              // reconstruct the 3-prong secondary vertex
-              int nVtxFrom3ProngFitterSecondLoop = 0;
-              try {
-                nVtxFrom3ProngFitterSecondLoop = df3.process(trackParVarNeg1, trackParVarPos1, trackParVarNeg2);
-              } catch (...) {
+          // second loop over negative tracks
+          for (auto trackIndexNeg2 = trackIndexNeg1 + 1; trackIndexNeg2 != groupedTrackIndicesNeg1.end(); ++trackIndexNeg2) {
+
+            int isSelected3ProngCand = n3ProngBit;
+            if (!TESTBIT(trackIndexNeg2.isSelProng(), CandidateType::Cand3Prong)) { // continue immediately
+              if (!config.debug) {
                 continue;
               }
+              isSelected3ProngCand = 0;
+            }
 
-              if (nVtxFrom3ProngFitterSecondLoop == 0) {
+            if (config.applyKaonPidIn3Prongs && !TESTBIT(trackIndexPos1.isIdentifiedPid(), ChannelKaonPid)) { // continue immediately if kaon PID enabled and opposite-sign track not a kaon
+              if (!config.debug) {
                 continue;
               }
-              // get secondary vertex
-              const auto& secondaryVertex3 = df3.getPCACandidate();
-              // get track momenta
-              std::array<float, 3> pvec0{};
-              std::array<float, 3> pvec1{};
-              std::array<float, 3> pvec2{};
-              const auto trackParVarPcaNeg1 = df3.getTrack(0);
-              const auto trackParVarPcaPos1 = df3.getTrack(1);
-              const auto trackParVarPcaNeg2 = df3.getTrack(2);
-              trackParVarPcaNeg1.getPxPyPzGlo(pvec0);
-              trackParVarPcaPos1.getPxPyPzGlo(pvec1);
-              trackParVarPcaNeg2.getPxPyPzGlo(pvec2);
+              isSelected3ProngCand = 0;
+            }
 
-              const auto pVecCandProng3Neg = RecoDecay::pVec(pvec0, pvec1, pvec2);
+            auto trackNeg2 = trackIndexNeg2.template track_as<TTracks>();
+            auto trackParVarNeg2 = getTrackParCov(trackNeg2);
+            std::array dcaInfoNeg2{trackNeg2.dcaXY(), trackNeg2.dcaZ()};
 
-              // 3-prong selections after secondary vertex
-              applySelection3Prong(pVecCandProng3Neg, secondaryVertex3, pvRefitCoord3Prong1Pos2Neg, cutStatus3Prong, isSelected3ProngCand);
+            // preselection of 3-prong candidates
+            if (isSelected3ProngCand) {
+              std::array pVecTrackNeg2{trackNeg2.pVector()};
+              if (thisCollId != trackNeg2.collisionId()) { // this is not the "default" collision for this track and we still did not re-propagate it, we have to re-propagate it
+                o2::base::Propagator::Instance()->propagateToDCABxByBz({collision.posX(), collision.posY(), collision.posZ()}, trackParVarNeg2, 2.f, noMatCorr, &dcaInfoNeg2);
+                getPxPyPz(trackParVarNeg2, pVecTrackNeg2);
+              }
 
-              std::array<std::vector<float>, kN3ProngDecaysUsedMlForHfFilters> mlScores3Prongs{};
-              if (config.applyMlForHfFilters) {
-                const std::vector<float> inputFeatures{trackParVarPcaNeg1.getPt(), dcaInfoNeg1[0], dcaInfoNeg1[1], trackParVarPcaPos1.getPt(), dcaInfoPos1[0], dcaInfoPos1[1], trackParVarPcaNeg2.getPt(), dcaInfoNeg2[0], dcaInfoNeg2[1]};
-                std::vector<float> inputFeaturesLcPid{};
-                if constexpr (UsePidForHfFiltersBdt) {
-                  inputFeaturesLcPid.push_back(trackNeg1.tpcNSigmaPr());
-                  inputFeaturesLcPid.push_back(trackNeg2.tpcNSigmaPr());
-                  inputFeaturesLcPid.push_back(trackNeg1.tpcNSigmaPi());
-                  inputFeaturesLcPid.push_back(trackNeg2.tpcNSigmaPi());
-                  inputFeaturesLcPid.push_back(trackPos1.tpcNSigmaKa());
+              if (config.debug) {
+                for (int iDecay3P = 0; iDecay3P < kN3ProngDecays; iDecay3P++) {
+                  for (int iCut = 0; iCut < kNCuts3Prong[iDecay3P]; iCut++) {
+                    cutStatus3Prong[iDecay3P][iCut] = true;
+                  }
                 }
-                applyMlSelectionForHfFilters3Prong<UsePidForHfFiltersBdt>(inputFeatures, inputFeaturesLcPid, mlScores3Prongs, isSelected3ProngCand);
               }
 
+              // 3-prong preselections
+              int8_t const isIdentifiedPidTrackNeg1 = trackIndexNeg1.isIdentifiedPid();
+              int8_t const isIdentifiedPidTrackNeg2 = trackIndexNeg2.isIdentifiedPid();
+              applyPreselection3Prong(pVecTrackNeg1, pVecTrackPos1, pVecTrackNeg2, isIdentifiedPidTrackNeg1, isIdentifiedPidTrackNeg2, cutStatus3Prong, whichHypo3Prong, isSelected3ProngCand);
               if (!config.debug && isSelected3ProngCand == 0) {
                 continue;
               }
+            }
 
-              // fill table row
-              rowTrackIndexProng3(thisCollId, trackNeg1.globalIndex(), trackPos1.globalIndex(), trackNeg2.globalIndex(), isSelected3ProngCand);
-              if (config.applyMlForHfFilters) {
-                rowTrackIndexMlScoreProng3(mlScores3Prongs[0], mlScores3Prongs[1], mlScores3Prongs[2], mlScores3Prongs[3]);
+            /// PV refit excluding the candidate daughters, if contributors
+            std::array pvRefitCoord3Prong1Pos2Neg{collision.posX(), collision.posY(), collision.posZ()}; /// initialize to the original PV
+            std::array pvRefitCovMatrix3Prong1Pos2Neg{getPrimaryVertex(collision).getCov()};             /// initialize to the original PV
+            if constexpr (DoPvRefit) {
+              if (config.fillHistograms) {
+                registry.fill(HIST("PvRefit/verticesPerCandidate"), 1);
               }
-              if constexpr (DoPvRefit) {
-                // fill table row of coordinates of PV refit
-                rowProng3PVrefit(pvRefitCoord3Prong1Pos2Neg[0], pvRefitCoord3Prong1Pos2Neg[1], pvRefitCoord3Prong1Pos2Neg[2],
-                                 pvRefitCovMatrix3Prong1Pos2Neg[0], pvRefitCovMatrix3Prong1Pos2Neg[1], pvRefitCovMatrix3Prong1Pos2Neg[2], pvRefitCovMatrix3Prong1Pos2Neg[3], pvRefitCovMatrix3Prong1Pos2Neg[4], pvRefitCovMatrix3Prong1Pos2Neg[5]);
+              int nCandContr = 3;
+              auto trackFirstIt = std::find(vecPvContributorGlobId.begin(), vecPvContributorGlobId.end(), trackPos1.globalIndex());
+              auto trackSecondIt = std::find(vecPvContributorGlobId.begin(), vecPvContributorGlobId.end(), trackNeg1.globalIndex());
+              auto trackThirdIt = std::find(vecPvContributorGlobId.begin(), vecPvContributorGlobId.end(), trackNeg2.globalIndex());
+              bool isTrackFirstContr = true;
+              bool isTrackSecondContr = true;
+              bool isTrackThirdContr = true;
+              if (trackFirstIt == vecPvContributorGlobId.end()) {
+                /// This track did not contribute to the original PV refit
+                if (config.debugPvRefit) {
+                  LOG(info) << "--- [3 prong] trackPos1 with globalIndex " << trackPos1.globalIndex() << " was not a PV contributor";
+                }
+                nCandContr--;
+                isTrackFirstContr = false;
               }
-
-              if (config.debug) {
-                int prong3CutStatus[kN3ProngDecays];
-                for (int iDecay3P = 0; iDecay3P < kN3ProngDecays; iDecay3P++) {
-                  prong3CutStatus[iDecay3P] = nCutStatus3ProngBit[iDecay3P];
-                  for (int iCut = 0; iCut < kNCuts3Prong[iDecay3P]; iCut++) {
-                    if (!cutStatus3Prong[iDecay3P][iCut]) {
-                      CLRBIT(prong3CutStatus[iDecay3P], iCut);
-                    }
-                  }
+              if (trackSecondIt == vecPvContributorGlobId.end()) {
+                /// This track did not contribute to the original PV refit
+                if (config.debugPvRefit) {
+                  LOG(info) << "--- [3 prong] trackNeg1 with globalIndex " << trackNeg1.globalIndex() << " was not a PV contributor";
                 }
-                rowProng3CutStatus(prong3CutStatus[0], prong3CutStatus[1], prong3CutStatus[2], prong3CutStatus[3]); // FIXME when we can do this by looping over kN3ProngDecays
+                nCandContr--;
+                isTrackSecondContr = false;
               }
-
-              // fill histograms
-              if (config.fillHistograms) {
-                registry.fill(HIST("hVtx3ProngX"), secondaryVertex3[0]);
-                registry.fill(HIST("hVtx3ProngY"), secondaryVertex3[1]);
-                registry.fill(HIST("hVtx3ProngZ"), secondaryVertex3[2]);
-                const std::array arr3Mom{pvec0, pvec1, pvec2};
-                for (int iDecay3P = 0; iDecay3P < kN3ProngDecays; iDecay3P++) {
-                  if (TESTBIT(isSelected3ProngCand, iDecay3P)) {
-                    if (TESTBIT(whichHypo3Prong[iDecay3P], 0)) {
-                      const auto mass3Prong = RecoDecay::m(arr3Mom, arrMass3Prong[iDecay3P][0]);
-                      switch (iDecay3P) {
-                        case hf_cand_3prong::DecayType::DplusToPiKPi:
-                          registry.fill(HIST("hMassDPlusToPiKPi"), mass3Prong);
-                          break;
-                        case hf_cand_3prong::DecayType::DsToKKPi:
-                          registry.fill(HIST("hMassDsToKKPi"), mass3Prong);
-                          break;
-                        case hf_cand_3prong::DecayType::LcToPKPi:
-                          registry.fill(HIST("hMassLcToPKPi"), mass3Prong);
-                          break;
-                        case hf_cand_3prong::DecayType::XicToPKPi:
-                          registry.fill(HIST("hMassXicToPKPi"), mass3Prong);
-                          break;
-                        case hf_cand_3prong::DecayType::CdToDeKPi:
-                          registry.fill(HIST("hMassCdToDeKPi"), mass3Prong);
-                          break;
-                        case hf_cand_3prong::DecayType::CtToTrKPi:
-                          registry.fill(HIST("hMassCtToTrKPi"), mass3Prong);
-                          break;
-                        case hf_cand_3prong::DecayType::ChToHeKPi:
-                          registry.fill(HIST("hMassChToHeKPi"), mass3Prong);
-                          break;
-                        case hf_cand_3prong::DecayType::CaToAlKPi:
-                          registry.fill(HIST("hMassCaToAlKPi"), mass3Prong);
-                          break;
-                      }
-                    }
-                    if (TESTBIT(whichHypo3Prong[iDecay3P], 1)) {
-                      const auto mass3Prong = RecoDecay::m(arr3Mom, arrMass3Prong[iDecay3P][1]);
-                      switch (iDecay3P) {
-                        case hf_cand_3prong::DecayType::DsToKKPi:
-                          registry.fill(HIST("hMassDsToKKPi"), mass3Prong);
-                          break;
-                        case hf_cand_3prong::DecayType::LcToPKPi:
-                          registry.fill(HIST("hMassLcToPKPi"), mass3Prong);
-                          break;
-                        case hf_cand_3prong::DecayType::XicToPKPi:
-                          registry.fill(HIST("hMassXicToPKPi"), mass3Prong);
-                          break;
-                        case hf_cand_3prong::DecayType::CdToDeKPi:
-                          registry.fill(HIST("hMassCdToDeKPi"), mass3Prong);
-                          break;
-                        case hf_cand_3prong::DecayType::CtToTrKPi:
-                          registry.fill(HIST("hMassCtToTrKPi"), mass3Prong);
-                          break;
-                        case hf_cand_3prong::DecayType::ChToHeKPi:
-                          registry.fill(HIST("hMassChToHeKPi"), mass3Prong);
-                          break;
-                        case hf_cand_3prong::DecayType::CaToAlKPi:
-                          registry.fill(HIST("hMassCaToAlKPi"), mass3Prong);
-                          break;
-                      }
-                    }
-                  }
+              if (trackThirdIt == vecPvContributorGlobId.end()) {
+                /// This track did not contribute to the original PV refit
+                if (config.debugPvRefit) {
+                  LOG(info) << "--- [3 prong] trackNeg2 with globalIndex " << trackNeg2.globalIndex() << " was not a PV contributor";
                 }
+                nCandContr--;
+                isTrackThirdContr = false;
               }
-            }
-          }
 
-          if (config.doDstar && TESTBIT(isSelected2ProngCand, hf_cand_2prong::DecayType::D0ToPiK) && (pt2Prong + config.ptTolerance) * 1.2 > config.binsPtDstarToD0Pi->at(0) && whichHypo2Prong[kN2ProngDecays] != 0) { // o2-linter: disable="magic-number" (see comment below)
-                                                                                                                                                                                                                        // if D* enabled and pt of the D0 is larger than the minimum of the D* one within 20% (D* and D0 momenta are very similar, always within 20% according to PYTHIA8)
-            // second loop over positive tracks
-            if (TESTBIT(whichHypo2Prong[kN2ProngDecays], 0) && (!config.applyKaonPidIn3Prongs || TESTBIT(trackIndexNeg1.isIdentifiedPid(), ChannelKaonPid))) { // only for D0 candidates; moreover if kaon PID enabled, apply to the negative track
-              if (!groupedTrackIndicesSoftPionsPos) {
-                groupedTrackIndicesSoftPionsPos.emplace(positiveSoftPions->sliceByCached(aod::track::collisionId, collision.globalIndex(), cache));
+              // Fill a vector with global ID of candidate daughters that are contributors
+              std::vector<int64_t> vecCandPvContributorGlobId = {};
+              if (isTrackFirstContr) {
+                vecCandPvContributorGlobId.push_back(trackPos1.globalIndex());
               }
-              for (auto trackIndexPos2 = groupedTrackIndicesSoftPionsPos->begin(); trackIndexPos2 != groupedTrackIndicesSoftPionsPos->end(); ++trackIndexPos2) {
-                if (trackIndexPos2 == trackIndexPos1) {
-                  continue;
+              if (isTrackSecondContr) {
+                vecCandPvContributorGlobId.push_back(trackNeg1.globalIndex());
+              }
+              if (isTrackThirdContr) {
+                vecCandPvContributorGlobId.push_back(trackNeg2.globalIndex());
+              }
+
+              if (nCandContr == 3 || nCandContr == 2) { // o2-linter: disable="magic-number" (see comment below)
+                /// At least two of the daughter tracks were used for the original PV refit, let's refit it after excluding them
+                if (config.debugPvRefit) {
+                  LOG(info) << "### [3 prong] Calling performPvRefitCandProngs for HF 3 prong candidate, removing " << nCandContr << " daughters";
                 }
-                auto trackPos2 = trackIndexPos2.template track_as<TTracks>();
-                std::array pVecTrackPos2{trackPos2.pVector()};
-                if (thisCollId != trackPos2.collisionId()) { // this is not the "default" collision for this track, we have to re-propagate it
-                  auto trackParVarPos2 = getTrackParCov(trackPos2);
-                  std::array dcaInfoPos2{trackPos2.dcaXY(), trackPos2.dcaZ()};
-                  o2::base::Propagator::Instance()->propagateToDCABxByBz({collision.posX(), collision.posY(), collision.posZ()}, trackParVarPos2, 2.f, noMatCorr, &dcaInfoPos2);
-                  getPxPyPz(trackParVarPos2, pVecTrackPos2);
+                performPvRefitCandProngs(collision, bcWithTimeStamps, vecPvContributorGlobId, vecPvContributorTrackParCov, vecCandPvContributorGlobId, pvRefitCoord3Prong1Pos2Neg, pvRefitCovMatrix3Prong1Pos2Neg);
+              } else if (nCandContr == 1) {
+                /// Only one daughter was a contributor, let's use then the PV recalculated by excluding only it
+                if (config.debugPvRefit) {
+                  LOG(info) << "####### [3 Prong] nCandContr==" << nCandContr << " ---> just 1 contributor!";
                 }
-
-                uint8_t isSelectedDstar{0};
-                uint8_t cutStatus{BIT(kNCutsDstar) - 1};
-                float deltaMass{-1.};
-                isSelectedDstar = applySelectionDstar(pVecTrackPos1, pVecTrackNeg1, pVecTrackPos2, cutStatus, deltaMass); // we do not compute the D* decay vertex at this stage because we are not interested in applying topological selections
-                if (isSelectedDstar) {
-                  rowTrackIndexDstar(thisCollId, trackPos2.globalIndex(), lastFilledD0);
-                  if (config.fillHistograms) {
-                    registry.fill(HIST("hMassDstarToD0Pi"), deltaMass);
-                  }
-                  if constexpr (DoPvRefit) {
-                    // fill table row with coordinates of PV refit (same as 2-prong because we do not remove the soft pion)
-                    rowDstarPVrefit(pvRefitCoord2Prong[0], pvRefitCoord2Prong[1], pvRefitCoord2Prong[2],
-                                    pvRefitCovMatrix2Prong[0], pvRefitCovMatrix2Prong[1], pvRefitCovMatrix2Prong[2], pvRefitCovMatrix2Prong[3], pvRefitCovMatrix2Prong[4], pvRefitCovMatrix2Prong[5]);
-                  }
+                if (config.fillHistograms) {
+                  registry.fill(HIST("PvRefit/verticesPerCandidate"), 5);
                 }
-                if (config.debug) {
-                  rowDstarCutStatus(cutStatus);
+                if (isTrackFirstContr && !isTrackSecondContr && !isTrackThirdContr) {
+                  /// the first daughter is contributor, the second and the third are not
+                  pvRefitCoord3Prong1Pos2Neg = {trackPos1.pvRefitX(), trackPos1.pvRefitY(), trackPos1.pvRefitZ()};
+                  pvRefitCovMatrix3Prong1Pos2Neg = {trackPos1.pvRefitSigmaX2(), trackPos1.pvRefitSigmaXY(), trackPos1.pvRefitSigmaY2(), trackPos1.pvRefitSigmaXZ(), trackPos1.pvRefitSigmaYZ(), trackPos1.pvRefitSigmaZ2()};
+                } else if (!isTrackFirstContr && isTrackSecondContr && !isTrackThirdContr) {
+                  /// the second daughter is contributor, the first and the third are not
+                  pvRefitCoord3Prong1Pos2Neg = {trackNeg1.pvRefitX(), trackNeg1.pvRefitY(), trackNeg1.pvRefitZ()};
+                  pvRefitCovMatrix3Prong1Pos2Neg = {trackNeg1.pvRefitSigmaX2(), trackNeg1.pvRefitSigmaXY(), trackNeg1.pvRefitSigmaY2(), trackNeg1.pvRefitSigmaXZ(), trackNeg1.pvRefitSigmaYZ(), trackNeg1.pvRefitSigmaZ2()};
+                } else if (!isTrackFirstContr && !isTrackSecondContr && isTrackThirdContr) {
+                  /// the third daughter is contributor, the first and the second are not
+                  pvRefitCoord3Prong1Pos2Neg = {trackNeg2.pvRefitX(), trackNeg2.pvRefitY(), trackNeg2.pvRefitZ()};
+                  pvRefitCovMatrix3Prong1Pos2Neg = {trackNeg2.pvRefitSigmaX2(), trackNeg2.pvRefitSigmaXY(), trackNeg2.pvRefitSigmaY2(), trackNeg2.pvRefitSigmaXZ(), trackNeg2.pvRefitSigmaYZ(), trackNeg2.pvRefitSigmaZ2()};
+                }
+              } else {
+                /// 0 contributors among the HF candidate daughters
+                if (config.fillHistograms) {
+                  registry.fill(HIST("PvRefit/verticesPerCandidate"), 6);
+                }
+                if (config.debugPvRefit) {
+                  LOG(info) << "####### [3 prong] nCandContr==" << nCandContr << " ---> some of the candidate daughters did not contribute to the original PV fit, PV refit not redone";
                 }
               }
             }
 
-            // second loop over negative tracks
-            if (TESTBIT(whichHypo2Prong[kN2ProngDecays], 1) && (!config.applyKaonPidIn3Prongs || TESTBIT(trackIndexPos1.isIdentifiedPid(), ChannelKaonPid))) { // only for D0bar candidates; moreover if kaon PID enabled, apply to the positive track
-              if (!groupedTrackIndicesSoftPionsNeg) {
-                groupedTrackIndicesSoftPionsNeg.emplace(negativeSoftPions->sliceByCached(aod::track::collisionId, collision.globalIndex(), cache));
+            // reconstruct the 3-prong secondary vertex
+            int nVtxFrom3ProngFitterSecondLoop = 0;
+            try {
+              nVtxFrom3ProngFitterSecondLoop = fitter3.process(trackParVarNeg1, trackParVarPos1, trackParVarNeg2);
+            } catch (...) {
+              continue;
+            }
+
+            if (nVtxFrom3ProngFitterSecondLoop == 0) {
+              continue;
+            }
+            // get secondary vertex
+            const auto& secondaryVertex3 = fitter3.getPCACandidate();
+            // get track momenta
+            std::array<float, 3> pvec0{};
+            std::array<float, 3> pvec1{};
+            std::array<float, 3> pvec2{};
+            const auto trackParVarPcaNeg1 = fitter3.getTrack(0);
+            const auto trackParVarPcaPos1 = fitter3.getTrack(1);
+            const auto trackParVarPcaNeg2 = fitter3.getTrack(2);
+            trackParVarPcaNeg1.getPxPyPzGlo(pvec0);
+            trackParVarPcaPos1.getPxPyPzGlo(pvec1);
+            trackParVarPcaNeg2.getPxPyPzGlo(pvec2);
+
+            const auto pVecCandProng3Neg = RecoDecay::pVec(pvec0, pvec1, pvec2);
+
+            // 3-prong selections after secondary vertex
+            applySelection3Prong(pVecCandProng3Neg, secondaryVertex3, pvRefitCoord3Prong1Pos2Neg, cutStatus3Prong, isSelected3ProngCand);
+
+            std::array<std::vector<float>, kN3ProngDecaysUsedMlForHfFilters> mlScores3Prongs{};
+            if (config.applyMlForHfFilters) {
+              const std::vector<float> inputFeatures{trackParVarPcaNeg1.getPt(), dcaInfoNeg1[0], dcaInfoNeg1[1], trackParVarPcaPos1.getPt(), dcaInfoPos1[0], dcaInfoPos1[1], trackParVarPcaNeg2.getPt(), dcaInfoNeg2[0], dcaInfoNeg2[1]};
+              std::vector<float> inputFeaturesLcPid{};
+              if constexpr (UsePidForHfFiltersBdt) {
+                inputFeaturesLcPid.push_back(trackNeg1.tpcNSigmaPr());
+                inputFeaturesLcPid.push_back(trackNeg2.tpcNSigmaPr());
+                inputFeaturesLcPid.push_back(trackNeg1.tpcNSigmaPi());
+                inputFeaturesLcPid.push_back(trackNeg2.tpcNSigmaPi());
+                inputFeaturesLcPid.push_back(trackPos1.tpcNSigmaKa());
               }
-              for (auto trackIndexNeg2 = groupedTrackIndicesSoftPionsNeg->begin(); trackIndexNeg2 != groupedTrackIndicesSoftPionsNeg->end(); ++trackIndexNeg2) {
-                if (trackIndexNeg1 == trackIndexNeg2) {
-                  continue;
-                }
-                auto trackNeg2 = trackIndexNeg2.template track_as<TTracks>();
-                std::array pVecTrackNeg2{trackNeg2.pVector()};
-                if (thisCollId != trackNeg2.collisionId()) { // this is not the "default" collision for this track, we have to re-propagate it
-                  auto trackParVarNeg2 = getTrackParCov(trackNeg2);
-                  std::array dcaInfoNeg2{trackNeg2.dcaXY(), trackNeg2.dcaZ()};
-                  o2::base::Propagator::Instance()->propagateToDCABxByBz({collision.posX(), collision.posY(), collision.posZ()}, trackParVarNeg2, 2.f, noMatCorr, &dcaInfoNeg2);
-                  getPxPyPz(trackParVarNeg2, pVecTrackNeg2);
-                }
+              applyMlSelectionForHfFilters3Prong<UsePidForHfFiltersBdt>(inputFeatures, inputFeaturesLcPid, mlScores3Prongs, isSelected3ProngCand);
+            }
 
-                uint8_t isSelectedDstar{0};
-                uint8_t cutStatus{BIT(kNCutsDstar) - 1};
-                float deltaMass{-1.};
-                isSelectedDstar = applySelectionDstar(pVecTrackNeg1, pVecTrackPos1, pVecTrackNeg2, cutStatus, deltaMass); // we do not compute the D* decay vertex at this stage because we are not interested in applying topological selections
-                if (isSelectedDstar) {
-                  rowTrackIndexDstar(thisCollId, trackNeg2.globalIndex(), lastFilledD0);
-                  if (config.fillHistograms) {
-                    registry.fill(HIST("hMassDstarToD0Pi"), deltaMass);
-                  }
-                  if constexpr (DoPvRefit) {
-                    // fill table row with coordinates of PV refit (same as 2-prong because we do not remove the soft pion)
-                    rowDstarPVrefit(pvRefitCoord2Prong[0], pvRefitCoord2Prong[1], pvRefitCoord2Prong[2],
-                                    pvRefitCovMatrix2Prong[0], pvRefitCovMatrix2Prong[1], pvRefitCovMatrix2Prong[2], pvRefitCovMatrix2Prong[3], pvRefitCovMatrix2Prong[4], pvRefitCovMatrix2Prong[5]);
+            if (!config.debug && isSelected3ProngCand == 0) {
+              continue;
+            }
+
+            ++nCand3;
+            uint8_t prong3CutStatus[kN3ProngDecays]{};
+            if (config.debug) {
+              int prong3CutStatus[kN3ProngDecays];
+              for (int iDecay3P = 0; iDecay3P < kN3ProngDecays; iDecay3P++) {
+                prong3CutStatus[iDecay3P] = nCutStatus3ProngBit[iDecay3P];
+                for (int iCut = 0; iCut < kNCuts3Prong[iDecay3P]; iCut++) {
+                  if (!cutStatus3Prong[iDecay3P][iCut]) {
+                    CLRBIT(prong3CutStatus[iDecay3P], iCut);
                   }
                 }
-                if (config.debug) {
-                  rowDstarCutStatus(cutStatus);
-                }
               }
             }
-          } // end of D*
+            const auto indexNeg1 = trackNeg1.globalIndex();
+            const auto indexPos1 = trackPos1.globalIndex();
+            const auto indexNeg2 = trackNeg2.globalIndex();
+
+            emitOutput<DoPvRefit>(sink, Prong3Output{.collisionId = thisCollId,
+                                                       .trackIds = {indexNeg1, indexPos1, indexNeg2},
+                                                       .isSelected = static_cast<uint>(isSelected3ProngCand),
+                                                       .mlScores = std::move(mlScores3Prongs),
+                                                       .pvRefitCoord = pvRefitCoord3Prong1Pos2Neg,
+                                                       .pvRefitCovMatrix = pvRefitCovMatrix3Prong1Pos2Neg,
+                                                       .cutStatus = std::to_array(prong3CutStatus),
+                                                       .secondaryVertex = {secondaryVertex3[0], secondaryVertex3[1], secondaryVertex3[2]},
+                                                       .pVecProngs = {pvec0, pvec1, pvec2},
+                                                       .whichHypo = std::to_array(whichHypo3Prong)});
+          }
         }
-      }
 
-      const int nTracks = 0;
-      // auto nTracks = trackIndicesPerCollision.lastIndex() - trackIndicesPerCollision.firstIndex(); // number of tracks passing 2 and 3 prong selection in this collision
-      nCand2 = rowTrackIndexProng2.lastIndex() - nCand2; // number of 2-prong candidates in this collision
-      nCand3 = rowTrackIndexProng3.lastIndex() - nCand3; // number of 3-prong candidates in this collision
+        if (config.doDstar && TESTBIT(isSelected2ProngCand, hf_cand_2prong::DecayType::D0ToPiK) && (pt2Prong + config.ptTolerance) * 1.2 > config.binsPtDstarToD0Pi->at(0) && whichHypo2Prong[kN2ProngDecays] != 0) { // o2-linter: disable="magic-number" (see comment below)
+                                                                                                                                                                                                                      // if D* enabled and pt of the D0 is larger than the minimum of the D* one within 20% (D* and D0 momenta are very similar, always within 20% according to PYTHIA8)
+          // second loop over positive tracks
+          if (TESTBIT(whichHypo2Prong[kN2ProngDecays], 0) && (!config.applyKaonPidIn3Prongs || TESTBIT(trackIndexNeg1.isIdentifiedPid(), ChannelKaonPid))) { // only for D0 candidates; moreover if kaon PID enabled, apply to the negative track
+            if (!groupedTrackIndicesSoftPionsPos) {
+              groupedTrackIndicesSoftPionsPos.emplace(positiveSoftPions->sliceByCached(aod::track::collisionId, collision.globalIndex(), cache));
+            }
+            for (auto trackIndexPos2 = groupedTrackIndicesSoftPionsPos->begin(); trackIndexPos2 != groupedTrackIndicesSoftPionsPos->end(); ++trackIndexPos2) {
+              if (trackIndexPos2 == trackIndexPos1) {
+                continue;
+              }
+              auto trackPos2 = trackIndexPos2.template track_as<TTracks>();
+              std::array pVecTrackPos2{trackPos2.pVector()};
+              if (thisCollId != trackPos2.collisionId()) { // this is not the "default" collision for this track, we have to re-propagate it
+                auto trackParVarPos2 = getTrackParCov(trackPos2);
+                std::array dcaInfoPos2{trackPos2.dcaXY(), trackPos2.dcaZ()};
+                o2::base::Propagator::Instance()->propagateToDCABxByBz({collision.posX(), collision.posY(), collision.posZ()}, trackParVarPos2, 2.f, noMatCorr, &dcaInfoPos2);
+                getPxPyPz(trackParVarPos2, pVecTrackPos2);
+              }
+
+              uint8_t isSelectedDstar{0};
+              uint8_t cutStatus{BIT(kNCutsDstar) - 1};
+              float deltaMass{-1.};
+              isSelectedDstar = applySelectionDstar(pVecTrackPos1, pVecTrackNeg1, pVecTrackPos2, cutStatus, deltaMass); // we do not compute the D* decay vertex at this stage because we are not interested in applying topological selections
+              if (isSelectedDstar || config.debug) {
+                const auto indexPos2 = trackPos2.globalIndex();
+                emitOutput<DoPvRefit>(sink, DstarOutput{.collisionId = thisCollId, .softPionId = indexPos2, .isSelected = isSelectedDstar, .cutStatus = cutStatus, .deltaMass = deltaMass, .pvRefitCoord = pvRefitCoord2Prong, .pvRefitCovMatrix = pvRefitCovMatrix2Prong});
+              }
+            }
+          }
 
-      if (config.fillHistograms) {
-        registry.fill(HIST("hNTracks"), nTracks);
-        registry.fill(HIST("hNCand2Prong"), nCand2);
-        registry.fill(HIST("hNCand3Prong"), nCand3);
-        registry.fill(HIST("hNCand2ProngVsNTracks"), nTracks, nCand2);
-        registry.fill(HIST("hNCand3ProngVsNTracks"), nTracks, nCand3);
+          // second loop over negative tracks
+          if (TESTBIT(whichHypo2Prong[kN2ProngDecays], 1) && (!config.applyKaonPidIn3Prongs || TESTBIT(trackIndexPos1.isIdentifiedPid(), ChannelKaonPid))) { // only for D0bar candidates; moreover if kaon PID enabled, apply to the positive track
+            if (!groupedTrackIndicesSoftPionsNeg) {
+              groupedTrackIndicesSoftPionsNeg.emplace(negativeSoftPions->sliceByCached(aod::track::collisionId, collision.globalIndex(), cache));
+            }
+            for (auto trackIndexNeg2 = groupedTrackIndicesSoftPionsNeg->begin(); trackIndexNeg2 != groupedTrackIndicesSoftPionsNeg->end(); ++trackIndexNeg2) {
+              if (trackIndexNeg1 == trackIndexNeg2) {
+                continue;
+              }
+              auto trackNeg2 = trackIndexNeg2.template track_as<TTracks>();
+              std::array pVecTrackNeg2{trackNeg2.pVector()};
+              if (thisCollId != trackNeg2.collisionId()) { // this is not the "default" collision for this track, we have to re-propagate it
+                auto trackParVarNeg2 = getTrackParCov(trackNeg2);
+                std::array dcaInfoNeg2{trackNeg2.dcaXY(), trackNeg2.dcaZ()};
+                o2::base::Propagator::Instance()->propagateToDCABxByBz({collision.posX(), collision.posY(), collision.posZ()}, trackParVarNeg2, 2.f, noMatCorr, &dcaInfoNeg2);
+                getPxPyPz(trackParVarNeg2, pVecTrackNeg2);
+              }
+
+              uint8_t isSelectedDstar{0};
+              uint8_t cutStatus{BIT(kNCutsDstar) - 1};
+              float deltaMass{-1.};
+              isSelectedDstar = applySelectionDstar(pVecTrackNeg1, pVecTrackPos1, pVecTrackNeg2, cutStatus, deltaMass); // we do not compute the D* decay vertex at this stage because we are not interested in applying topological selections
+              if (isSelectedDstar || config.debug) {
+                const auto indexNeg2 = trackNeg2.globalIndex();
+                emitOutput<DoPvRefit>(sink, DstarOutput{.collisionId = thisCollId, .softPionId = indexNeg2, .isSelected = isSelectedDstar, .cutStatus = cutStatus, .deltaMass = deltaMass, .pvRefitCoord = pvRefitCoord2Prong, .pvRefitCovMatrix = pvRefitCovMatrix2Prong});
+              }
+            }
+          }
+        } // end of D*
       }
     }
-  } /// end of run2And3Prongs function
+
+    const int nTracks = 0;
+    // auto nTracks = trackIndicesPerCollision.lastIndex() - trackIndicesPerCollision.firstIndex(); // number of tracks passing 2 and 3 prong selection in this collision
+    if (config.fillHistograms) {
+      emitOutput<DoPvRefit>(sink, CollisionOutput{nTracks, nCand2, nCand3});
+    }
+  } /// end of run2And3ProngsCollision function
 
   void processNo2And3Prongs(SelectedCollisions const&)
   {
@@ -18,6 +18,8 @@
 
 #include "PWGHF/Core/DecayChannels.h"
 
+#include "Common/Core/RecoDecay.h"
+
 #include <CommonConstants/PhysicsConstants.h>
 #include <Framework/Logger.h>
 
@@ -26,7 +28,9 @@
 #include <array>
 #include <cstddef>
 #include <cstdint>
+#include <cstdlib>
 #include <unordered_map>
+#include <utility>
 #include <vector>
 
 namespace o2::hf_decay
@@ -329,6 +333,171 @@ inline void flipPdgSign(const int pdgMother, const int pdgToFlip, std::array<int
     }
   }
 }
+namespace hf_cand_3prong
+{
+/// Decays of the MC particles of one dataframe into the main 3-prong channels of DecayChannels.h.
+/// The MC particles are classified once: for each mother species, every channel is tested on each particle of that
+/// species, and the decays which can be matched by a reconstructed candidate are stored for each of their final-state
+/// daughters. A candidate then only has to be tested against the decays its first prong belongs to, instead of
+/// against all the channels of all the mother species, so the matching time does not depend on the number of channels.
+class HfMcDecayClassifier
+{
+ public:
+  /// decay of a mother particle in a main channel
+  struct Decay {
+    int pdgMother;            // PDG code of the mother species (positive)
+    DecayChannelMain channel; // main decay channel
+  };
+
+  /// Classify the MC particles of the dataframe
+  /// \param particlesMC table with MC particles
+  /// \param pdgMothers PDG codes of the mother species
+  /// \param depthMax function returning the maximum depth of the final-state search for a mother species
+  template <typename T, typename D>
+  void build(T const& particlesMC, std::vector<int> const& pdgMothers, D&& depthMax)
+  {
+    decaysOffsets.assign(particlesMC.size() + 1, 0);
+    decays.clear();
+    channelsPerMother.clear();
+    for (const auto& pdgMother : pdgMothers) {
+      channelsPerMother.emplace_back(pdgMother, getDecayChannelsMain(pdgMother));
+    }
+
+    // decays of each particle, with the index of one of its final-state daughters
+    std::vector<std::pair<int, Decay>> decaysByDaughter;
+    std::vector<int> arrAllDaughtersIndex;
+    for (const auto& particle : particlesMC) {
+      const int pdgParticle = particle.pdgCode();
+      for (const auto& [pdgMother, channels] : channelsPerMother) {
+        if (std::abs(pdgParticle) != pdgMother || !particle.has_daughters()) {
+          continue;
+        }
+        const int depth = depthMax(pdgMother);
+        const int8_t sgn = pdgParticle == pdgMother ? 1 : -1;
+        for (const auto& [channel, finalState] : channels) {
+          const std::array<int, 3> arrPdgDaughters3Prongs{finalState[0], finalState[1], finalState[2]};
+          arrAllDaughtersIndex.clear();
+          RecoDecay::getDaughters(particle, &arrAllDaughtersIndex, arrPdgDaughters3Prongs, depth);
+          if (!isChannelCompatible(particlesMC, particle, pdgMother, sgn, finalState, arrAllDaughtersIndex, depth)) {
+            continue;
+          }
+          for (const auto& indexDaughter : arrAllDaughtersIndex) {
+            decaysByDaughter.emplace_back(indexDaughter - particlesMC.offset(), Decay{pdgMother, channel});
+          }
+        }
+      }
+    }
+
+    // decays grouped by daughter
+    for (const auto& [iDaughter, decay] : decaysByDaughter) {
+      decaysOffsets[iDaughter + 1]++;
+    }
+    for (std::size_t i = 1; i < decaysOffsets.size(); i++) {
+      decaysOffsets[i] += decaysOffsets[i - 1];
+    }
+    decays.resize(decaysByDaughter.size());
+    std::vector<uint32_t> fill(decaysOffsets.begin(), decaysOffsets.end() - 1);
+    for (const auto& [iDaughter, decay] : decaysByDaughter) {
+      decays[fill[iDaughter]++] = decay;
+    }
+  }
+
+  /// Mother species and their channels, in the order in which they were given
+  std::vector<std::pair<int, std::unordered_map<DecayChannelMain, const std::vector<int>>>> const& getChannelsPerMother() const { return channelsPerMother; }
+
+  /// Collect the decays which a candidate with the given first prong can match
+  /// The particles the prong can be replaced with by the matching (mother in case of decay in flight or of
+  /// interaction with material) are included.
+  /// \param particlesMC table with MC particles
+  /// \param particle MC particle of the first prong
+  /// \param acceptTrackDecay  the prong may be the product of a π → μ or K → π decay
+  /// \param acceptTrackIntWithMaterial  the prong may come from an interaction with material
+  /// \param candidateDecays decays the candidate can match, filled by the function
+  template <typename T, typename P>
+  void getCandidateDecays(T const& particlesMC, P const& particle, bool acceptTrackDecay, bool acceptTrackIntWithMaterial, std::vector<Decay>& candidateDecays) const
+  {
+    candidateDecays.clear();
+    auto particleI = particle;
+    while (true) {
+      const auto iParticle = static_cast<std::size_t>(particleI.globalIndex() - particlesMC.offset());
+      if (iParticle + 1 < decaysOffsets.size()) {
+        candidateDecays.insert(candidateDecays.end(), decays.begin() + decaysOffsets[iParticle], decays.begin() + decaysOffsets[iParticle + 1]);
+      }
+      if (!(acceptTrackDecay || acceptTrackIntWithMaterial) || !particleI.has_mothers()) {
+        break;
+      }
+      auto motherI = particleI.template mothers_first_as<T>();
+      const int pdgI = std::abs(particleI.pdgCode());
+      const int pdgMotherI = std::abs(motherI.pdgCode());
+      const bool isTrackDecay = acceptTrackDecay && ((pdgI == PDG_t::kMuonMinus && pdgMotherI == PDG_t::kPiPlus) || (pdgI == PDG_t::kPiPlus && pdgMotherI == PDG_t::kKPlus));
+      const bool isIntWithMaterial = acceptTrackIntWithMaterial && pdgI == pdgMotherI;
+      if (!isTrackDecay && !isIntWithMaterial) {
+        break;
+      }
+      particleI = motherI;
+    }
+  }
+
+  /// Whether a decay of the given mother species in the given channel is among the candidate decays
+  static bool hasDecay(std::vector<Decay> const& candidateDecays, int pdgMother, DecayChannelMain channel)
+  {
+    for (const auto& decay : candidateDecays) {
+      if (decay.pdgMother == pdgMother && decay.channel == channel) {
+        return true;
+      }
+    }
+    return false;
+  }
+
+ private:
+  /// Necessary conditions for RecoDecay::getMatchedMCRec to match a candidate to this mother in this channel
+  template <typename T, typename P>
+  static bool isChannelCompatible(T const& particlesMC, P const& particle, int pdgMother, int8_t sgn, std::vector<int> const& finalState,
+                                  std::vector<int> const& arrAllDaughtersIndex, int depth)
+  {
+    constexpr std::size_t NProngs{3u};
+    if (finalState.size() == NProngs) {
+      // fully reconstructed decay: the prongs are all the final daughters
+      if (particle.daughtersIds().back() - particle.daughtersIds().front() + 1 > static_cast<int>(NProngs) || arrAllDaughtersIndex.size() != NProngs) {
+        return false;
+      }
+      std::array<int, NProngs> arrPdgExpected{finalState[0], finalState[1], finalState[2]};
+      for (const auto& indexDaughter : arrAllDaughtersIndex) {
+        const int pdgDaughter = particlesMC.rawIteratorAt(indexDaughter - particlesMC.offset()).pdgCode();
+        bool isPdgFound = false;
+        for (auto& pdgExpected : arrPdgExpected) { // o2-linter: disable=const-ref-in-for-loop (found entries are removed)
+          if (pdgDaughter == sgn * pdgExpected) {
+            pdgExpected = 0;
+            isPdgFound = true;
+            break;
+          }
+        }
+        if (!isPdgFound) {
+          return false;
+        }
+      }
+      return true;
+    }
+    // partially reconstructed decay: the complete generated decay must match
+    if (finalState.size() == NProngs + 1) {
+      std::array<int, NProngs + 1> arrPdgDaughters{finalState[0], finalState[1], finalState[2], finalState[3]};
+      flipPdgSign(particle.pdgCode(), +PDG_t::kPi0, arrPdgDaughters);
+      return RecoDecay::isMatchedMCGen(particlesMC, particle, pdgMother, arrPdgDaughters, true, nullptr, depth);
+    }
+    if (finalState.size() == NProngs + 2) {
+      std::array<int, NProngs + 2> arrPdgDaughters{finalState[0], finalState[1], finalState[2], finalState[3], finalState[4]};
+      flipPdgSign(particle.pdgCode(), +PDG_t::kPi0, arrPdgDaughters);
+      return RecoDecay::isMatchedMCGen(particlesMC, particle, pdgMother, arrPdgDaughters, true, nullptr, depth);
+    }
+    return false;
+  }
+
+  std::vector<std::pair<int, std::unordered_map<DecayChannelMain, const std::vector<int>>>> channelsPerMother; // channels of each mother species
+  std::vector<uint32_t> decaysOffsets;                                                                          // first decay of each MC particle
+  std::vector<Decay> decays;                                                                                    // decays grouped by final-state daughter
+};
+} // namespace hf_cand_3prong
+
 /// Get resonant channel for c-deuteron
 /// resonances are not stored in the particle stack for c-deuteron, but tagged with specific status codes
 /// \tparam particle is the c-deuteron
@@ -29,16 +29,229 @@
 namespace tmemcutilities
 {
 
+/// Matches of all the clusters in compressed sparse row layout:
+/// the matches of cluster i are the entries [matchOffset[i], matchOffset[i + 1]) of the flat arrays, ordered by distance.
 struct MatchResult {
-  std::vector<std::vector<int>> matchIndexTrack;
-  std::vector<std::vector<float>> matchDeltaPhi;
-  std::vector<std::vector<float>> matchDeltaEta;
+  std::vector<int> matchOffset;
+  std::vector<int> matchIndexTrack;
+  std::vector<float> matchDeltaPhi;
+  std::vector<float> matchDeltaEta;
+
+  std::size_t nClusters() const { return matchOffset.empty() ? 0 : matchOffset.size() - 1; }
+  int beginMatches(std::size_t iCluster) const { return matchOffset[iCluster]; }
+  int endMatches(std::size_t iCluster) const { return matchOffset[iCluster + 1]; }
+  void clear()
+  {
+    matchOffset.clear();
+    matchIndexTrack.clear();
+    matchDeltaPhi.clear();
+    matchDeltaEta.clear();
+  }
+};
+
+/**
+ * Uniform (eta, phi) grid of tracks for the cluster-track matching.
+ *
+ * The grid covers the EMCal+DCal eta acceptance, limited to the range of the tracks, and the full azimuth with
+ * wraparound. Tracks outside of the eta range are stored in the edge cells. Cells are at least as large as the
+ * matching distance, so that a query only visits the 3x3 neighbourhood of the cluster cell.
+ * The grid is built with a counting sort in O(N) and keeps the tracks of one cell contiguous.
+ */
+class MatchingGrid
+{
+ public:
+  static constexpr float MaxEtaAcceptance = 0.8f; // EMCal+DCal |eta| < 0.7 with a margin
+  static constexpr int MaxCellsEta = 64;
+  static constexpr int MaxCellsPhi = 128;
+
+  void build(std::span<const float> trackPhi, std::span<const float> trackEta, float cellSize)
+  {
+    const std::size_t nTracks = trackEta.size();
+    float etaMin = MaxEtaAcceptance, etaMax = -MaxEtaAcceptance;
+    for (std::size_t i = 0; i < nTracks; i++) {
+      etaMin = std::min(etaMin, trackEta[i]);
+      etaMax = std::max(etaMax, trackEta[i]);
+    }
+    mEtaMin = std::max(etaMin, -MaxEtaAcceptance);
+    const float etaRange = std::max(std::min(etaMax, MaxEtaAcceptance) - mEtaMin, 1.e-3f);
+    cellSize = std::max(cellSize, 1.e-3f);
+    mNEta = std::clamp(static_cast<int>(etaRange / cellSize), 1, MaxCellsEta);
+    mNPhi = std::clamp(static_cast<int>(TwoPi / cellSize), 1, MaxCellsPhi);
+    mInvCellEta = mNEta / etaRange;
+    mInvCellPhi = mNPhi / TwoPi;
+
+    // counting sort of the tracks by cell
+    mCellOffset.assign(mNEta * mNPhi + 1, 0);
+    mTrackCell.resize(nTracks);
+    for (std::size_t i = 0; i < nTracks; i++) {
+      mTrackCell[i] = cell(etaBin(trackEta[i]), phiBin(trackPhi[i]));
+      mCellOffset[mTrackCell[i] + 1]++;
+    }
+    for (int c = 0; c < mNEta * mNPhi; c++) {
+      mCellOffset[c + 1] += mCellOffset[c];
+    }
+    mIndex.resize(nTracks);
+    mEta.resize(nTracks);
+    mPhi.resize(nTracks);
+    mFill.assign(mCellOffset.begin(), mCellOffset.end() - 1);
+    for (std::size_t i = 0; i < nTracks; i++) {
+      const int pos = mFill[mTrackCell[i]]++;
+      mIndex[pos] = static_cast<int>(i);
+      mEta[pos] = trackEta[i];
+      mPhi[pos] = trackPhi[i];
+    }
+  }
+
+  /**
+   * Find up to maxNumberMatches tracks closest to the point with a distance below maxDistance.
+   * The distance is computed with the azimuthal difference wrapped into [-pi, pi).
+   *
+   * @returns the number of matches, stored by increasing distance in index, deltaPhi (track - point) and deltaEta (track - point)
+   */
+  int findNearest(float eta, float phi, double maxDistance, int maxNumberMatches, int* index, float* deltaPhi, float* deltaEta, float* distance) const
+  {
+    if (mIndex.empty() || maxNumberMatches <= 0) {
+      return 0;
+    }
+    const int rangeEta = static_cast<int>(std::ceil(maxDistance * mInvCellEta));
+    const int rangePhi = static_cast<int>(std::ceil(maxDistance * mInvCellPhi));
+    const int nColumnsPhi = std::min(2 * rangePhi + 1, mNPhi); // each azimuthal column is visited once, also when the range wraps around
+    const int iEta = etaBin(eta);
+    const int iPhi = phiBin(phi);
+    int nFound = 0;
+    for (int jEta = std::max(iEta - rangeEta, 0); jEta <= std::min(iEta + rangeEta, mNEta - 1); jEta++) {
+      for (int k = 0; k < nColumnsPhi; k++) {
+        const int c = cell(jEta, ((iPhi - rangePhi + k) % mNPhi + mNPhi) % mNPhi);
+        for (int pos = mCellOffset[c]; pos < mCellOffset[c + 1]; pos++) {
+          const float dEta = mEta[pos] - eta;
+          float dPhi = mPhi[pos] - phi;
+          if (dPhi >= Pi) {
+            dPhi -= TwoPi;
+          } else if (dPhi < -Pi) {
+            dPhi += TwoPi;
+          }
+          // same arithmetic as TKDTree::Distance
+          const float dist = static_cast<float>(std::sqrt(static_cast<double>(dEta * dEta) + static_cast<double>(dPhi * dPhi)));
+          if (!(dist < maxDistance) || (nFound == maxNumberMatches && !(dist < distance[nFound - 1]))) {
+            continue;
+          }
+          // insertion into the list of the closest tracks, sorted by distance and by track index for equal distances
+          int insertPos = nFound < maxNumberMatches ? nFound++ : nFound - 1;
+          while (insertPos > 0 && (distance[insertPos - 1] > dist || (distance[insertPos - 1] == dist && index[insertPos - 1] > mIndex[pos]))) {
+            distance[insertPos] = distance[insertPos - 1];
+            index[insertPos] = index[insertPos - 1];
+            deltaPhi[insertPos] = deltaPhi[insertPos - 1];
+            deltaEta[insertPos] = deltaEta[insertPos - 1];
+            insertPos--;
+          }
+          distance[insertPos] = dist;
+          index[insertPos] = mIndex[pos];
+          deltaPhi[insertPos] = dPhi;
+          deltaEta[insertPos] = dEta;
+        }
+      }
+    }
+    return nFound;
+  }
+
+ private:
+  static constexpr float Pi = 3.14159265358979323846f;
+  static constexpr float TwoPi = 2.f * Pi;
+
+  int etaBin(float eta) const { return std::clamp(static_cast<int>(std::floor((eta - mEtaMin) * mInvCellEta)), 0, mNEta - 1); }
+  int phiBin(float phi) const
+  {
+    float phiWrapped = std::fmod(phi, TwoPi);
+    if (phiWrapped < 0.f) {
+      phiWrapped += TwoPi;
+    }
+    return std::min(static_cast<int>(phiWrapped * mInvCellPhi), mNPhi - 1);
+  }
+  int cell(int iEta, int iPhi) const { return iEta * mNPhi + iPhi; }
+
+  float mEtaMin = 0.f;
+  float mInvCellEta = 1.f;
+  float mInvCellPhi = 1.f;
+  int mNEta = 1;
+  int mNPhi = 1;
+  std::vector<int> mCellOffset; // tracks of cell c are [mCellOffset[c], mCellOffset[c + 1])
+  std::vector<int> mFill;
+  std::vector<int> mTrackCell;
+  std::vector<int> mIndex; // track index, ordered by cell
+  std::vector<float> mEta;
+  std::vector<float> mPhi;
 };
 
 /**
  * Match clusters and tracks.
  *
  * Match cluster with tracks, where maxNumberMatches are considered in dR=maxMatchingDistance.
+ * The tracks are sorted into a MatchingGrid, which is queried for each cluster.
+ * Clusters without a match get an empty range in the result.
+ *
+ * @param clusterPhi cluster collection phi.
+ * @param clusterEta cluster collection eta.
+ * @param trackPhi track collection phi.
+ * @param trackEta track collection eta.
+ * @param maxMatchingDistance Maximum matching distance.
+ * @param maxNumberMatches Maximum number of matches (e.g. 5 closest).
+ * @param grid grid reused between calls to avoid reallocations (optional).
+ *
+ * @returns cluster to track matches
+ */
+inline MatchResult matchTracksToCluster(
+  std::span<float> clusterPhi,
+  std::span<float> clusterEta,
+  std::span<float> trackPhi,
+  std::span<float> trackEta,
+  double maxMatchingDistance,
+  int maxNumberMatches,
+  MatchingGrid* grid = nullptr)
+{
+  const std::size_t nClusters = clusterEta.size();
+  const std::size_t nTracks = trackEta.size();
+  MatchResult result;
+
+  if (nClusters == 0 || nTracks == 0) {
+    // There are no jets, so nothing to be done.
+    return result;
+  }
+  // Input sizes must match
+  if (clusterPhi.size() != clusterEta.size()) {
+    throw std::invalid_argument("cluster collection eta and phi sizes don't match. Check the inputs.");
+  }
+  if (trackPhi.size() != trackEta.size()) {
+    throw std::invalid_argument("track collection eta and phi sizes don't match. Check the inputs.");
+  }
+
+  MatchingGrid localGrid;
+  if (!grid) {
+    grid = &localGrid;
+  }
+  grid->build(trackPhi, trackEta, maxMatchingDistance);
+
+  constexpr int MaxMatches = 50;
+  maxNumberMatches = std::min(maxNumberMatches, MaxMatches);
+  int index[MaxMatches];
+  float deltaPhi[MaxMatches];
+  float deltaEta[MaxMatches];
+  float distance[MaxMatches];
+  result.matchOffset.reserve(nClusters + 1);
+  result.matchOffset.push_back(0);
+  for (std::size_t iCluster = 0; iCluster < nClusters; iCluster++) {
+    const int nFound = grid->findNearest(clusterEta[iCluster], clusterPhi[iCluster], maxMatchingDistance, maxNumberMatches, index, deltaPhi, deltaEta, distance);
+    result.matchIndexTrack.insert(result.matchIndexTrack.end(), index, index + nFound);
+    result.matchDeltaPhi.insert(result.matchDeltaPhi.end(), deltaPhi, deltaPhi + nFound);
+    result.matchDeltaEta.insert(result.matchDeltaEta.end(), deltaEta, deltaEta + nFound);
+    result.matchOffset.push_back(result.matchIndexTrack.size());
+  }
+  return result;
+}
+
+/**
+ * Match clusters and tracks with a KD-tree of the tracks, reference implementation of matchTracksToCluster.
+ *
+ * Match cluster with tracks, where maxNumberMatches are considered in dR=maxMatchingDistance.
  * If no unique match was found for a jet, an index of -1 is stored.
  * The same map is created for clusters matched to tracks e.g. for electron analyses.
  *
@@ -51,7 +264,7 @@ struct MatchResult {
  *
  * @returns (cluster to track index map, track to cluster index map)
  */
-MatchResult matchTracksToCluster(
+inline MatchResult matchTracksToClusterKDTree(
   std::span<float> clusterPhi,
   std::span<float> clusterEta,
   std::span<float> trackPhi,
@@ -75,9 +288,8 @@ MatchResult matchTracksToCluster(
     throw std::invalid_argument("track collection eta and phi sizes don't match. Check the inputs.");
   }
 
-  result.matchIndexTrack.resize(nClusters);
-  result.matchDeltaPhi.resize(nClusters);
-  result.matchDeltaEta.resize(nClusters);
+  result.matchOffset.reserve(nClusters + 1);
+  result.matchOffset.push_back(0);
 
   // Build the KD-trees using vectors
   // We build two trees:
@@ -98,19 +310,15 @@ MatchResult matchTracksToCluster(
     std::fill_n(distance, 50, std::numeric_limits<float>::max());
     treeTrack.FindNearestNeighbors(point, maxNumberMatches, index, distance);
 
-    // allocate enough memory
-    result.matchIndexTrack[iCluster].reserve(maxNumberMatches);
-    result.matchDeltaPhi[iCluster].reserve(maxNumberMatches);
-    result.matchDeltaEta[iCluster].reserve(maxNumberMatches);
-
     // test whether indices are matching:
     for (int m = 0; m < maxNumberMatches; m++) {
       if (index[m] >= 0 && distance[m] < maxMatchingDistance) {
-        result.matchIndexTrack[iCluster].push_back(index[m]);
-        result.matchDeltaPhi[iCluster].push_back(trackPhi[index[m]] - clusterPhi[iCluster]);
-        result.matchDeltaEta[iCluster].push_back(trackEta[index[m]] - clusterEta[iCluster]);
+        result.matchIndexTrack.push_back(index[m]);
+        result.matchDeltaPhi.push_back(trackPhi[index[m]] - clusterPhi[iCluster]);
+        result.matchDeltaEta.push_back(trackEta[index[m]] - clusterEta[iCluster]);
       }
     }
+    result.matchOffset.push_back(result.matchIndexTrack.size());
   }
   return result;
 }
@@ -59,6 +59,8 @@
 
 #include <sys/types.h>
 
+#include <algorithm>
+#include <atomic>
 #include <cmath>
 #include <cstddef>
 #include <cstdint>
@@ -68,6 +70,7 @@
 #include <span>
 #include <sstream>
 #include <string>
+#include <thread>
 #include <tuple>
 #include <unordered_map>
 #include <utility>
@@ -142,6 +145,7 @@ struct EmcalCorrectionTask {
   Configurable<bool> applySoftwareTriggerSelection{"applySoftwareTriggerSelection", false, "Apply software trigger selection"};
   Configurable<std::string> softwareTriggerSelection{"softwareTriggerSelection", "fGammaHighPtEMCAL,fGammaHighPtDCAL", "Default: fGammaHighPtEMCAL,fGammaHighPtDCAL"};
   Configurable<bool> storePerDFInfo{"storePerDFInfo", false, "store addition information per DF."};
+  Configurable<int> nThreadsClusterizer{"nThreadsClusterizer", 1, "number of worker threads running the clusterizers on the BCs of a DF in processFull (1: sequential)"};
   ConfigurableAxis thConfigAxisClusters{"thConfigAxisClusters", {1000, 0.5f, 1000.5f}, ""};
   ConfigurableAxis thConfigAxisCells{"thConfigAxisCells", {1000, 0.5f, 1000.5f}, ""};
   // cross talk emulation configs
@@ -174,8 +178,29 @@ struct EmcalCorrectionTask {
   // Cluster Eta and Phi used for track matching later
   std::vector<float> mClusterPhi;
   std::vector<float> mClusterEta;
+  // Track grid for the matching, kept to reuse its memory
+  MatchingGrid mMatchingGrid;
 
   std::vector<o2::aod::EMCALClusterDefinition> mClusterDefinitions;
+
+  // BC-parallel clusterization
+  /// Clusterizers and cluster factory owned by one worker thread
+  struct ClusterizerWorker {
+    std::vector<std::unique_ptr<o2::emcal::Clusterizer<o2::emcal::Cell>>> clusterizers;
+    o2::emcal::ClusterFactory<o2::emcal::Cell> clusterFactory;
+  };
+  /// Calibrated cells of one BC, converted once and shared by all the cluster definitions, and the clusters found per definition
+  struct BCClusterizerInput {
+    int64_t bcIndex = -1;
+    int nCollisions = 0;
+    std::vector<o2::emcal::Cell> cells;
+    std::vector<int64_t> cellIndices;
+    std::vector<std::vector<o2::emcal::AnalysisCluster>> clusters; // per cluster definition
+    std::vector<std::vector<float>> clusterPhi;
+    std::vector<std::vector<float>> clusterEta;
+  };
+  std::vector<ClusterizerWorker> mClusterizerWorkers;
+  std::vector<BCClusterizerInput> mBCBatch;
   // QA
   o2::framework::HistogramRegistry mHistManager{"EMCALCorrectionTaskQAHistograms"};
 
@@ -206,6 +231,7 @@ struct EmcalCorrectionTask {
   static constexpr uint MaxAmbClusterPerDFPerClusterizer = 300'000;         // memory footprint: 19.5 MB per clusterizer
   static constexpr uint MaxCellsPerClusterPerDFPerClusterizer = 300'000;    // memory footprint: 4.8 MB per clusterizer
   static constexpr uint MaxCellsPerAmbClusterPerDFPerClusterizer = 450'000; // memory footprint: 7.2 MB per clusterizer
+  static constexpr size_t MaxBCsPerClusterizerBatch = 1024;                 // BCs clustered in parallel before their clusters are written
 
   // cluster size
   size_t nCluster = 0;
@@ -259,15 +285,9 @@ struct EmcalCorrectionTask {
         mClusterDefinitions.push_back(clusDef);
       }
     }
-    mClusterFactories.setGeometry(geometry);
-    mClusterFactories.SetECALogWeight(logWeight);
-    mClusterFactories.setExoticCellFraction(exoticCellFraction);
-    mClusterFactories.setExoticCellDiffTime(exoticCellDiffTime);
-    mClusterFactories.setExoticCellMinAmplitude(exoticCellMinAmplitude);
-    mClusterFactories.setExoticCellInCrossMinAmplitude(exoticCellInCrossMinAmplitude);
-    mClusterFactories.setUseWeightExotic(useWeightExotic);
+    configureClusterFactory(mClusterFactories);
     for (const auto& clusterDefinition : mClusterDefinitions) {
-      mClusterizers.emplace_back(std::make_unique<o2::emcal::Clusterizer<o2::emcal::Cell>>(clusterDefinition.timeDiff, clusterDefinition.timeMin, clusterDefinition.timeMax, clusterDefinition.gradientCut, clusterDefinition.doGradientCut, clusterDefinition.seedEnergy, clusterDefinition.minCellEnergy));
+      mClusterizers.emplace_back(makeClusterizer(clusterDefinition));
       LOG(info) << "Cluster definition initialized: " << clusterDefinition.toString();
       LOG(info) << "timeMin: " << clusterDefinition.timeMin;
       LOG(info) << "timeMax: " << clusterDefinition.timeMax;
@@ -285,6 +305,23 @@ struct EmcalCorrectionTask {
       LOG(error) << "No cluster definitions specified!";
     }
 
+    if (nThreadsClusterizer > 1 && doprocessFull) {
+      mClusterizerWorkers.resize(nThreadsClusterizer);
+      for (auto& worker : mClusterizerWorkers) {
+        configureClusterFactory(worker.clusterFactory);
+        for (const auto& clusterDefinition : mClusterDefinitions) {
+          worker.clusterizers.emplace_back(makeClusterizer(clusterDefinition));
+          worker.clusterizers.back()->setGeometry(geometry);
+        }
+      }
+      // the super module matrices are created lazily by the geometry, create them before the workers share it
+      for (int iSM = 0; iSM < geometry->GetNumberOfSuperModules(); iSM++) {
+        geometry->GetMatrixForSuperModule(iSM);
+      }
+      mBCBatch.reserve(MaxBCsPerClusterizerBatch);
+      LOG(info) << "BC-parallel clusterization enabled with " << nThreadsClusterizer.value << " worker threads";
+    }
+
     // 500 clusters per event is a good upper limit
     mClusterPhi.reserve(500 * mClusterizers.size());
     mClusterEta.reserve(500 * mClusterizers.size());
@@ -420,10 +457,13 @@ struct EmcalCorrectionTask {
   void processFull(BcEvSels const& bcs, CollEventSels const& collisions, MyGlobTracks const& tracks, FilteredCells const& cells)
   {
     LOG(debug) << "Starting process full.";
-    clusters.reserve(MaxClusterPerDFPerClusterizer * mClusterizers.size());
-    clustersAmbiguous.reserve(MaxAmbClusterPerDFPerClusterizer * mClusterizers.size());
-    clustercells.reserve(MaxCellsPerClusterPerDFPerClusterizer * mClusterizers.size());
-    clustercellsambiguous.reserve(MaxCellsPerAmbClusterPerDFPerClusterizer * mClusterizers.size());
+    const bool isParallel = !mClusterizerWorkers.empty();
+    if (!isParallel) { // the parallel mode reserves the exact number of rows for each batch of BCs
+      clusters.reserve(MaxClusterPerDFPerClusterizer * mClusterizers.size());
+      clustersAmbiguous.reserve(MaxAmbClusterPerDFPerClusterizer * mClusterizers.size());
+      clustercells.reserve(MaxCellsPerClusterPerDFPerClusterizer * mClusterizers.size());
+      clustercellsambiguous.reserve(MaxCellsPerAmbClusterPerDFPerClusterizer * mClusterizers.size());
+    }
 
     int previousCollisionId = 0; // Collision ID of the last unique BC. Needed to skip unordered collisions to ensure ordered collisionIds in the cluster table
     int nBCsProcessed = 0;
@@ -500,51 +540,27 @@ struct EmcalCorrectionTask {
 
       fillQAHistogram(cellsBC);
 
+      if (isParallel) {
+        // collect the BC, the clusterizers run on batches of BCs in parallel
+        auto& input = mBCBatch.emplace_back();
+        input.bcIndex = bc.globalIndex();
+        input.nCollisions = collisionsInFoundBC.size();
+        input.cells = std::move(cellsBC);
+        input.cellIndices = std::move(cellIndicesBC);
+        if (mBCBatch.size() == MaxBCsPerClusterizerBatch) {
+          runClusterizerBatch(bcs, collisions, tracks, previousCollisionId);
+        }
+        nBCsProcessed++;
+        continue;
+      }
+
       LOG(debug) << "Converted cells. Contains: " << cellsBC.size() << ". Originally " << cellsInBC.size() << ". About to run clusterizer.";
       //  this is a test
       //  Run the clusterizers
       LOG(debug) << "Running clusterizers";
       for (size_t iClusterizer = 0; iClusterizer < mClusterizers.size(); iClusterizer++) {
         cellsToCluster(iClusterizer, cellsBC);
-
-        if (collisionsInFoundBC.size() == 1) {
-          // dummy loop to get the first collision
-          for (const auto& col : collisionsInFoundBC) {
-            if (previousCollisionId > col.globalIndex()) {
-              mHistManager.fill(HIST("hBCMatchErrors"), 1);
-              continue;
-            }
-            previousCollisionId = col.globalIndex();
-            if (col.foundBCId() == bc.globalIndex()) {
-              mHistManager.fill(HIST("hBCMatchErrors"), 0); // CollisionID ordered and foundBC matches -> Fill as healthy
-              mHistManager.fill(HIST("hCollisionTimeReso"), col.collisionTimeRes());
-              mHistManager.fill(HIST("hCollPerBC"), 1);
-              mHistManager.fill(HIST("hCollisionType"), 1);
-              math_utils::Point3D<float> vertexPos = {col.posX(), col.posY(), col.posZ()};
-
-              MatchResult indexMapPair;
-              std::vector<int64_t> trackGlobalIndex;
-              doTrackMatching<CollEventSels::filtered_iterator>(col, tracks, indexMapPair, trackGlobalIndex);
-
-              // Store the clusters in the table where a matching collision could
-              // be identified.
-              fillClusterTable<CollEventSels::filtered_iterator>(col, vertexPos, iClusterizer, cellIndicesBC, &indexMapPair, &trackGlobalIndex);
-            } else {
-              mHistManager.fill(HIST("hBCMatchErrors"), 2);
-            }
-          }
-        } else { // ambiguous
-          // LOG(warning) << "No vertex found for event. Assuming (0,0,0).";
-          bool hasCollision = false;
-          mHistManager.fill(HIST("hCollPerBC"), collisionsInFoundBC.size());
-          if (collisionsInFoundBC.size() == 0) {
-            mHistManager.fill(HIST("hCollisionType"), 0);
-          } else {
-            hasCollision = true;
-            mHistManager.fill(HIST("hCollisionType"), 2);
-          }
-          fillAmbigousClusterTable<BcEvSels::iterator>(bc, iClusterizer, cellIndicesBC, hasCollision);
-        }
+        fillClustersOfBC(bc, collisionsInFoundBC, tracks, iClusterizer, cellIndicesBC, previousCollisionId);
 
         mClusterPhi.clear();
         mClusterEta.clear();
@@ -553,6 +569,9 @@ struct EmcalCorrectionTask {
       LOG(debug) << "Done with process BC.";
       nBCsProcessed++;
     } // end of bc loop
+    if (!mBCBatch.empty()) {
+      runClusterizerBatch(bcs, collisions, tracks, previousCollisionId);
+    }
 
     // Loop through all collisions and fill emcalcollisionmatch with a boolean stating, whether the collision was ambiguous (not the only collision in its BC)
     // NOTE: we can not do zorro selection here since emcalcollisionmatch needs to alway be filled to be joinable with collision table
@@ -1264,40 +1283,173 @@ struct EmcalCorrectionTask {
   }
   PROCESS_SWITCH(EmcalCorrectionTask, processStandalone, "run stand alone analysis", false);
 
-  void cellsToCluster(size_t iClusterizer, const gsl::span<o2::emcal::Cell> cellsBC, gsl::span<const o2::emcal::CellLabel> cellLabels = {})
+  std::unique_ptr<o2::emcal::Clusterizer<o2::emcal::Cell>> makeClusterizer(o2::aod::EMCALClusterDefinition const& clusterDefinition) const
+  {
+    return std::make_unique<o2::emcal::Clusterizer<o2::emcal::Cell>>(clusterDefinition.timeDiff, clusterDefinition.timeMin, clusterDefinition.timeMax, clusterDefinition.gradientCut, clusterDefinition.doGradientCut, clusterDefinition.seedEnergy, clusterDefinition.minCellEnergy);
+  }
+
+  void configureClusterFactory(o2::emcal::ClusterFactory<o2::emcal::Cell>& clusterFactory)
+  {
+    clusterFactory.setGeometry(geometry);
+    clusterFactory.SetECALogWeight(logWeight);
+    clusterFactory.setExoticCellFraction(exoticCellFraction);
+    clusterFactory.setExoticCellDiffTime(exoticCellDiffTime);
+    clusterFactory.setExoticCellMinAmplitude(exoticCellMinAmplitude);
+    clusterFactory.setExoticCellInCrossMinAmplitude(exoticCellInCrossMinAmplitude);
+    clusterFactory.setUseWeightExotic(useWeightExotic);
+  }
+
+  /// Cluster the BCs collected in mBCBatch and write their clusters in BC order.
+  /// The BCs are distributed dynamically over the worker threads, each with its own clusterizers and cluster factory.
+  /// Track matching and table filling stay in the calling thread, so the output is identical to the sequential one.
+  void runClusterizerBatch(BcEvSels const& bcs, CollEventSels const& collisions, MyGlobTracks const& tracks, int& previousCollisionId)
+  {
+    const size_t nBCs = mBCBatch.size();
+    const size_t nClusterizers = mClusterizers.size();
+    const size_t nWorkers = std::min(mClusterizerWorkers.size(), nBCs);
+    std::atomic<size_t> nextBC{0};
+    std::vector<std::thread> threads;
+    threads.reserve(nWorkers);
+    for (size_t iWorker = 0; iWorker < nWorkers; iWorker++) {
+      threads.emplace_back([&, iWorker]() {
+        auto& worker = mClusterizerWorkers[iWorker];
+        std::vector<o2::emcal::ClusterLabel> clusterLabels;
+        for (size_t iBC = nextBC++; iBC < nBCs; iBC = nextBC++) {
+          auto& input = mBCBatch[iBC];
+          input.clusters.resize(nClusterizers);
+          input.clusterPhi.resize(nClusterizers);
+          input.clusterEta.resize(nClusterizers);
+          for (size_t iClusterizer = 0; iClusterizer < nClusterizers; iClusterizer++) {
+            buildClusters(*worker.clusterizers[iClusterizer], worker.clusterFactory, input.cells, {}, input.clusters[iClusterizer], clusterLabels, input.clusterPhi[iClusterizer], input.clusterEta[iClusterizer]);
+          }
+        }
+      });
+    }
+    for (auto& thread : threads) {
+      thread.join();
+    }
+
+    // reserve exactly the rows needed by this batch
+    size_t nClustersBatch = 0, nClustersAmbBatch = 0, nCellsBatch = 0, nCellsAmbBatch = 0;
+    for (const auto& input : mBCBatch) {
+      const bool isAmbiguous = input.nCollisions != 1;
+      for (const auto& clustersOfDefinition : input.clusters) {
+        (isAmbiguous ? nClustersAmbBatch : nClustersBatch) += clustersOfDefinition.size();
+        for (const auto& cluster : clustersOfDefinition) {
+          (isAmbiguous ? nCellsAmbBatch : nCellsBatch) += cluster.getNCells();
+        }
+      }
+    }
+    clusters.reserve(nClustersBatch);
+    clustersAmbiguous.reserve(nClustersAmbBatch);
+    clustercells.reserve(nCellsBatch);
+    clustercellsambiguous.reserve(nCellsAmbBatch);
+
+    // merge in BC order
+    mClusterLabels.clear();
+    for (auto& input : mBCBatch) {
+      const auto& bc = bcs.iteratorAt(input.bcIndex);
+      auto collisionsInFoundBC = collisions.sliceBy(collisionsPerFoundBC, bc.globalIndex());
+      for (size_t iClusterizer = 0; iClusterizer < nClusterizers; iClusterizer++) {
+        mAnalysisClusters.swap(input.clusters[iClusterizer]);
+        mClusterPhi.swap(input.clusterPhi[iClusterizer]);
+        mClusterEta.swap(input.clusterEta[iClusterizer]);
+        mHistManager.fill(HIST("hNCluster"), mAnalysisClusters.size());
+        fillClustersOfBC(bc, collisionsInFoundBC, tracks, iClusterizer, input.cellIndices, previousCollisionId);
+
+        mClusterPhi.clear();
+        mClusterEta.clear();
+      }
+    }
+    mAnalysisClusters.clear();
+    mBCBatch.clear();
+  }
+
+  /// Write the clusters of one BC found with the given clusterizer, either matched to the only collision of the BC or as ambiguous clusters
+  template <typename CollisionsInBC>
+  void fillClustersOfBC(BcEvSels::iterator const& bc, CollisionsInBC const& collisionsInFoundBC, MyGlobTracks const& tracks, size_t iClusterizer, const gsl::span<int64_t> cellIndicesBC, int& previousCollisionId)
+  {
+    if (collisionsInFoundBC.size() == 1) {
+      // dummy loop to get the first collision
+      for (const auto& col : collisionsInFoundBC) {
+        if (previousCollisionId > col.globalIndex()) {
+          mHistManager.fill(HIST("hBCMatchErrors"), 1);
+          continue;
+        }
+        previousCollisionId = col.globalIndex();
+        if (col.foundBCId() == bc.globalIndex()) {
+          mHistManager.fill(HIST("hBCMatchErrors"), 0); // CollisionID ordered and foundBC matches -> Fill as healthy
+          mHistManager.fill(HIST("hCollisionTimeReso"), col.collisionTimeRes());
+          mHistManager.fill(HIST("hCollPerBC"), 1);
+          mHistManager.fill(HIST("hCollisionType"), 1);
+          math_utils::Point3D<float> vertexPos = {col.posX(), col.posY(), col.posZ()};
+
+          MatchResult indexMapPair;
+          std::vector<int64_t> trackGlobalIndex;
+          doTrackMatching<CollEventSels::filtered_iterator>(col, tracks, indexMapPair, trackGlobalIndex);
+
+          // Store the clusters in the table where a matching collision could
+          // be identified.
+          fillClusterTable<CollEventSels::filtered_iterator>(col, vertexPos, iClusterizer, cellIndicesBC, &indexMapPair, &trackGlobalIndex);
+        } else {
+          mHistManager.fill(HIST("hBCMatchErrors"), 2);
+        }
+      }
+    } else { // ambiguous
+      // LOG(warning) << "No vertex found for event. Assuming (0,0,0).";
+      bool hasCollision = false;
+      mHistManager.fill(HIST("hCollPerBC"), collisionsInFoundBC.size());
+      if (collisionsInFoundBC.size() == 0) {
+        mHistManager.fill(HIST("hCollisionType"), 0);
+      } else {
+        hasCollision = true;
+        mHistManager.fill(HIST("hCollisionType"), 2);
+      }
+      fillAmbigousClusterTable<BcEvSels::iterator>(bc, iClusterizer, cellIndicesBC, hasCollision);
+    }
+  }
+
+  /// Run one clusterizer on the cells of a BC and convert the found clusters to analysis clusters
+  static void buildClusters(o2::emcal::Clusterizer<o2::emcal::Cell>& clusterizer, o2::emcal::ClusterFactory<o2::emcal::Cell>& clusterFactory, const gsl::span<o2::emcal::Cell> cellsBC, gsl::span<const o2::emcal::CellLabel> cellLabels,
+                            std::vector<o2::emcal::AnalysisCluster>& analysisClusters, std::vector<o2::emcal::ClusterLabel>& clusterLabels, std::vector<float>& clusterPhi, std::vector<float>& clusterEta)
   {
-    mClusterizers.at(iClusterizer)->findClusters(cellsBC);
+    clusterizer.findClusters(cellsBC);
 
-    auto emcalClusters = mClusterizers.at(iClusterizer)->getFoundClusters();
-    auto emcalClustersInputIndices = mClusterizers.at(iClusterizer)->getFoundClustersInputIndices();
+    auto emcalClusters = clusterizer.getFoundClusters();
+    auto emcalClustersInputIndices = clusterizer.getFoundClustersInputIndices();
     LOG(debug) << "Retrieved results. About to setup cluster factory.";
 
     // Convert to analysis clusters.
     // First, the cluster factory requires cluster and cell information in order
     // to build the clusters.
-    mAnalysisClusters.clear();
-    mClusterLabels.clear();
-    mClusterFactories.reset();
-    // in preparation for future O2 changes
-    // mClusterFactories.setClusterizerSettings(mClusterDefinitions.at(iClusterizer).minCellEnergy, mClusterDefinitions.at(iClusterizer).timeMin, mClusterDefinitions.at(iClusterizer).timeMax, mClusterDefinitions.at(iClusterizer).recalcShowerShape5x5);
+    analysisClusters.clear();
+    clusterLabels.clear();
+    clusterFactory.reset();
     if (cellLabels.empty()) {
-      mClusterFactories.setContainer(*emcalClusters, cellsBC, *emcalClustersInputIndices);
+      clusterFactory.setContainer(*emcalClusters, cellsBC, *emcalClustersInputIndices);
     } else {
-      mClusterFactories.setContainer(*emcalClusters, cellsBC, *emcalClustersInputIndices, cellLabels);
+      clusterFactory.setContainer(*emcalClusters, cellsBC, *emcalClustersInputIndices, cellLabels);
     }
 
     LOG(debug) << "Cluster factory set up.";
     // Convert to analysis clusters.
-    for (int icl = 0; icl < mClusterFactories.getNumberOfClusters(); icl++) {
+    for (int icl = 0; icl < clusterFactory.getNumberOfClusters(); icl++) {
       o2::emcal::ClusterLabel clusterLabel;
-      auto analysisCluster = mClusterFactories.buildCluster(icl, &clusterLabel);
-      mAnalysisClusters.emplace_back(analysisCluster);
-      mClusterLabels.push_back(clusterLabel);
+      auto analysisCluster = clusterFactory.buildCluster(icl, &clusterLabel);
+      analysisClusters.emplace_back(analysisCluster);
+      clusterLabels.push_back(clusterLabel);
       auto pos = analysisCluster.getGlobalPosition();
-      mClusterPhi.emplace_back(RecoDecay::constrainAngle(pos.Phi()));
-      mClusterEta.emplace_back(pos.Eta());
+      clusterPhi.emplace_back(RecoDecay::constrainAngle(pos.Phi()));
+      clusterEta.emplace_back(pos.Eta());
       LOG(debug) << "Cluster " << icl << ": E: " << analysisCluster.E() << ", NCells " << analysisCluster.getNCells();
     }
+  }
+
+  void cellsToCluster(size_t iClusterizer, const gsl::span<o2::emcal::Cell> cellsBC, gsl::span<const o2::emcal::CellLabel> cellLabels = {})
+  {
+    // in preparation for future O2 changes
+    // mClusterFactories.setClusterizerSettings(mClusterDefinitions.at(iClusterizer).minCellEnergy, mClusterDefinitions.at(iClusterizer).timeMin, mClusterDefinitions.at(iClusterizer).timeMax, mClusterDefinitions.at(iClusterizer).recalcShowerShape5x5);
+    buildClusters(*mClusterizers.at(iClusterizer), mClusterFactories, cellsBC, cellLabels, mAnalysisClusters, mClusterLabels, mClusterPhi, mClusterEta);
     mHistManager.fill(HIST("hNCluster"), mAnalysisClusters.size());
     LOG(debug) << "Converted to analysis clusters.";
   }
@@ -1365,23 +1517,23 @@ struct EmcalCorrectionTask {
         mHistManager.fill(HIST("hClusterFCrossSigmaShortE"), cluster.E(), cluster.getFCross(), cluster.getM20());
       }
       if (indexMapPair && trackGlobalIndex) {
-        if (iCluster < indexMapPair->matchIndexTrack.size() && indexMapPair->matchIndexTrack.size() > 0) {
-          for (unsigned int iTrack = 0; iTrack < indexMapPair->matchIndexTrack[iCluster].size(); iTrack++) {
-            if (indexMapPair->matchIndexTrack[iCluster][iTrack] >= 0) {
-              LOG(debug) << "Found track " << (*trackGlobalIndex)[indexMapPair->matchIndexTrack[iCluster][iTrack]] << " in cluster " << cluster.getID();
-              matchedTracks(clusters.lastIndex(), (*trackGlobalIndex)[indexMapPair->matchIndexTrack[iCluster][iTrack]], indexMapPair->matchDeltaPhi[iCluster][iTrack], indexMapPair->matchDeltaEta[iCluster][iTrack]);
-              mHistManager.fill(HIST("hMatchedPrimaryTracks"), indexMapPair->matchDeltaEta[iCluster][iTrack], indexMapPair->matchDeltaPhi[iCluster][iTrack]);
+        if (iCluster < indexMapPair->nClusters()) {
+          for (int iMatch = indexMapPair->beginMatches(iCluster); iMatch < indexMapPair->endMatches(iCluster); iMatch++) {
+            if (indexMapPair->matchIndexTrack[iMatch] >= 0) {
+              LOG(debug) << "Found track " << (*trackGlobalIndex)[indexMapPair->matchIndexTrack[iMatch]] << " in cluster " << cluster.getID();
+              matchedTracks(clusters.lastIndex(), (*trackGlobalIndex)[indexMapPair->matchIndexTrack[iMatch]], indexMapPair->matchDeltaPhi[iMatch], indexMapPair->matchDeltaEta[iMatch]);
+              mHistManager.fill(HIST("hMatchedPrimaryTracks"), indexMapPair->matchDeltaEta[iMatch], indexMapPair->matchDeltaPhi[iMatch]);
             }
           }
         }
       }
       if (indexMapPairSecondaries && secondariesGlobalIndex) {
-        if (iCluster < indexMapPairSecondaries->matchIndexTrack.size() && indexMapPairSecondaries->matchIndexTrack.size() > 0) {
-          for (unsigned int iTrack = 0; iTrack < indexMapPairSecondaries->matchIndexTrack[iCluster].size(); iTrack++) {
-            if (indexMapPairSecondaries->matchIndexTrack[iCluster][iTrack] >= 0) {
-              LOG(debug) << "Found secondary track " << (*secondariesGlobalIndex)[indexMapPairSecondaries->matchIndexTrack[iCluster][iTrack]] << " in cluster " << cluster.getID();
-              matchedSecondaries(clusters.lastIndex(), (*secondariesGlobalIndex)[indexMapPairSecondaries->matchIndexTrack[iCluster][iTrack]], indexMapPairSecondaries->matchDeltaPhi[iCluster][iTrack], indexMapPairSecondaries->matchDeltaEta[iCluster][iTrack]);
-              mHistManager.fill(HIST("hMatchedSecondaries"), indexMapPairSecondaries->matchDeltaEta[iCluster][iTrack], indexMapPairSecondaries->matchDeltaPhi[iCluster][iTrack]);
+        if (iCluster < indexMapPairSecondaries->nClusters()) {
+          for (int iMatch = indexMapPairSecondaries->beginMatches(iCluster); iMatch < indexMapPairSecondaries->endMatches(iCluster); iMatch++) {
+            if (indexMapPairSecondaries->matchIndexTrack[iMatch] >= 0) {
+              LOG(debug) << "Found secondary track " << (*secondariesGlobalIndex)[indexMapPairSecondaries->matchIndexTrack[iMatch]] << " in cluster " << cluster.getID();
+              matchedSecondaries(clusters.lastIndex(), (*secondariesGlobalIndex)[indexMapPairSecondaries->matchIndexTrack[iMatch]], indexMapPairSecondaries->matchDeltaPhi[iMatch], indexMapPairSecondaries->matchDeltaEta[iMatch]);
+              mHistManager.fill(HIST("hMatchedSecondaries"), indexMapPairSecondaries->matchDeltaEta[iMatch], indexMapPairSecondaries->matchDeltaPhi[iMatch]);
             }
           }
         }
@@ -1451,7 +1603,7 @@ struct EmcalCorrectionTask {
     trackGlobalIndex.reserve(nTracksInCol);
     fillTrackInfo<decltype(groupedTracks)>(groupedTracks, trackPhi, trackEta, trackGlobalIndex);
 
-    indexMapPair = matchTracksToCluster(mClusterPhi, mClusterEta, trackPhi, trackEta, maxMatchingDistance, MaxMatchesPerCluster);
+    indexMapPair = matchTracksToCluster(mClusterPhi, mClusterEta, trackPhi, trackEta, maxMatchingDistance, MaxMatchesPerCluster, &mMatchingGrid);
   }
 
   template <typename Collision>
@@ -1487,7 +1639,7 @@ struct EmcalCorrectionTask {
       trackEta.emplace_back(trackEtaEmcal);
       trackGlobalIndex.emplace_back(track.globalIndex());
     }
-    indexMapPair = matchTracksToCluster(mClusterPhi, mClusterEta, trackPhi, trackEta, maxMatchingDistance, MaxMatchesPerCluster);
+    indexMapPair = matchTracksToCluster(mClusterPhi, mClusterEta, trackPhi, trackEta, maxMatchingDistance, MaxMatchesPerCluster, &mMatchingGrid);
   }
 
   template <typename Tracks>
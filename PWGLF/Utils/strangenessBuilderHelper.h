@@ -35,10 +35,14 @@
 
 #include <array>
 #include <cmath>
+#include <cstddef>
 #include <cstdint>
 #include <cstdlib>
+#include <functional>
 #include <numeric>
 #include <stdexcept>
+#include <unordered_map>
+#include <utility>
 #include <vector>
 
 namespace o2
@@ -235,6 +239,40 @@ struct cascadeCandidate {
   float covariance[21];
 };
 
+//__________________________________________
+// V0 fit cache: V0s fitted while building cascades, so that a V0 shared by
+// several bachelor combinations is fitted only once. The key holds the
+// daughters, the collision (i.e. the PV used) and the fit mode, which
+// encodes all the options the V0 fit depends on
+struct v0FitCacheKey {
+  int positiveTrack = -1;
+  int negativeTrack = -1;
+  int collisionId = -1;
+  int fitMode = 0;
+
+  bool operator==(v0FitCacheKey const& other) const = default;
+};
+
+struct v0FitCacheKeyHash {
+  std::size_t operator()(v0FitCacheKey const& key) const
+  {
+    std::size_t seed = 0;
+    for (const int value : {key.positiveTrack, key.negativeTrack, key.collisionId, key.fitMode}) {
+      seed ^= std::hash<int>{}(value) + 0x9e3779b97f4a7c15ULL + (seed << 6) + (seed >> 2);
+    }
+    return seed;
+  }
+};
+
+// V0 part of the KF cascade fit
+struct kfV0Fit {
+  o2::track::TrackParCov positiveTrackParCov; // possibly updated by the DCA fitter pre-minimisation
+  o2::track::TrackParCov negativeTrackParCov;
+  float v0DaughterDCA = 1000.0f; // only set with DCA fitter pre-minimisation
+  float kfMLambda = 0.0f;        // before the mass constraint
+  KFParticle kfV0;               // transported to the decay vertex
+};
+
 //__________________________________________
 // builder helper class
 class strangenessBuilderHelper
@@ -550,20 +588,21 @@ class strangenessBuilderHelper
     //__________________________________________
     //*>~<* do V0 with KF
     // create KFParticle objects from trackParCovs
-    KFParticle kfpPos = createKFParticleFromTrackParCov(positiveTrackParam, positiveTrackParam.getCharge(), o2::constants::physics::MassElectron);
-    KFParticle kfpNeg = createKFParticleFromTrackParCov(negativeTrackParam, negativeTrackParam.getCharge(), o2::constants::physics::MassElectron);
+    KFParticle kfpPos, kfpNeg;
+    if (kfCreateFromTrackParCov(kfpPos, positiveTrackParam, positiveTrackParam.getCharge(), o2::constants::physics::MassElectron) != KFStatus::Ok ||
+        kfCreateFromTrackParCov(kfpNeg, negativeTrackParam, negativeTrackParam.getCharge(), o2::constants::physics::MassElectron) != KFStatus::Ok) {
+      v0 = {};
+      return false;
+    }
 
     KFParticle kfpPos_DecayVtx = kfpPos;
     KFParticle kfpNeg_DecayVtx = kfpNeg;
-    const KFParticle* V0Daughters[2] = {&kfpPos, &kfpNeg};
 
     // construct V0
     KFParticle KFV0;
     KFV0.SetConstructMethod(kfConstructMethod);
-    try {
-      KFV0.Construct(V0Daughters, 2);
-    } catch (std::runtime_error& e) {
-      LOG(debug) << "Failed to construct cascade V0 from daughter tracks: " << e.what();
+    if (kfConstruct(KFV0, std::array<const KFParticle*, 2>{&kfpPos, &kfpNeg}) != KFStatus::Ok) {
+      LOG(debug) << "Failed to construct V0 from daughter tracks";
       v0 = {};
       return false;
     }
@@ -670,10 +709,29 @@ class strangenessBuilderHelper
                              bool processCovariances = false)
   {
     // no special treatment of positive and negative tracks when building V0s for cascades
-    auto posTrackPar = getTrackParCov(positiveTrack);
-    auto negTrackPar = getTrackParCov(negativeTrack);
-
-    if (!buildV0Candidate(collisionIndex, pvX, pvY, pvZ, positiveTrack, negativeTrack, posTrackPar, negTrackPar, false, processCovariances, false)) {
+    auto buildCascadeV0 = [&]() {
+      auto posTrackPar = getTrackParCov(positiveTrack);
+      auto negTrackPar = getTrackParCov(negativeTrack);
+      return buildV0Candidate(collisionIndex, pvX, pvY, pvZ, positiveTrack, negativeTrack, posTrackPar, negTrackPar, false, processCovariances, false);
+    };
+
+    bool isV0Built = false;
+    if (useV0FitCache) {
+      const v0FitCacheKey key{static_cast<int>(positiveTrack.globalIndex()), static_cast<int>(negativeTrack.globalIndex()), collisionIndex, processCovariances ? 1 : 0};
+      auto [cached, isNew] = v0FitCache.v0s.try_emplace(key);
+      if (isNew) {
+        v0FitCache.misses++;
+        cached->second.first = buildCascadeV0();
+        cached->second.second = v0;
+      } else {
+        v0FitCache.hits++;
+        v0 = cached->second.second;
+      }
+      isV0Built = cached->second.first;
+    } else {
+      isV0Built = buildCascadeV0();
+    }
+    if (!isV0Built) {
       return false;
     }
     if (!buildCascadeCandidate(collisionIndex, pvX, pvY, pvZ, v0, positiveTrack, negativeTrack, bachelorTrack, calculateBachelorBaryonVariables, useCascadeMomentumAtPV, processCovariances)) {
@@ -1018,58 +1076,39 @@ class strangenessBuilderHelper
     }
 
     //__________________________________________
-    //*>~<* step 1 : V0 with dca fitter, uses material corrections implicitly
-    // This is optional - move close to minima and therefore take material
-    if (kfDoDCAFitterPreMinimV0) {
-      int nCand = 0;
-      try {
-        nCand = fitter.process(posTrackParCov, negTrackParCov);
-      } catch (...) {
-        LOG(error) << "Exception caught in DCA fitter process call!";
-        cascade = {};
-        return false;
-      }
-      if (nCand == 0) {
-        cascade = {};
-        return false;
+    //*>~<* step 1 and 2 : V0 with (optional) dca fitter pre-minimisation and KF
+    bool isV0Built = false;
+    kfV0Fit* v0Fit = nullptr;
+    if (useV0FitCache) {
+      const int fitMode = (cascade.charge < 0 ? 1 : 0) | (kfDoDCAFitterPreMinimV0 ? 2 : 0) | (kfUseV0MassConstraint ? 4 : 0) | (kfConstructMethod << 3);
+      const v0FitCacheKey key{static_cast<int>(positiveTrack.globalIndex()), static_cast<int>(negativeTrack.globalIndex()), collisionIndex, fitMode};
+      auto [cached, isNew] = v0FitCache.kfV0s.try_emplace(key);
+      if (isNew) {
+        v0FitCache.misses++;
+        cached->second.first = fitKFV0(posTrackParCov, negTrackParCov, massPosTrack, massNegTrack, kfConstructMethod, kfUseV0MassConstraint, kfDoDCAFitterPreMinimV0, cached->second.second);
+      } else {
+        v0FitCache.hits++;
       }
-      // save classical DCA daughters
-      cascade.v0DaughterDCA = TMath::Sqrt(fitter.getChi2AtPCACandidate());
-
-      // re-acquire from DCA fitter
-      posTrackParCov = fitter.getTrack(0);
-      negTrackParCov = fitter.getTrack(1);
+      isV0Built = cached->second.first;
+      v0Fit = &cached->second.second;
+    } else {
+      isV0Built = fitKFV0(posTrackParCov, negTrackParCov, massPosTrack, massNegTrack, kfConstructMethod, kfUseV0MassConstraint, kfDoDCAFitterPreMinimV0, kfV0FitBuffer);
+      v0Fit = &kfV0FitBuffer;
     }
-
-    //__________________________________________
-    //*>~<* step 2 : V0 with KF
-    // create KFParticle objects from trackParCovs
-    KFParticle kfpPos = createKFParticleFromTrackParCov(posTrackParCov, posTrackParCov.getCharge(), massPosTrack);
-    KFParticle kfpNeg = createKFParticleFromTrackParCov(negTrackParCov, negTrackParCov.getCharge(), massNegTrack);
-    const KFParticle* V0Daughters[2] = {&kfpPos, &kfpNeg};
-
-    // construct V0
-    KFParticle KFV0;
-    KFV0.SetConstructMethod(kfConstructMethod);
-    try {
-      KFV0.Construct(V0Daughters, 2);
-    } catch (std::runtime_error& e) {
-      LOG(debug) << "Failed to construct cascade V0 from daughter tracks: " << e.what();
+    if (!isV0Built) {
       cascade = {};
       return false;
     }
-
-    // Calculate V0 mass before mass constraint
-    float MLambda, SigmaLambda;
-    KFV0.GetMass(MLambda, SigmaLambda);
-    cascade.kfMLambda = MLambda;
-
-    if (kfUseV0MassConstraint) {
-      KFV0.SetNonlinearMassConstraint(o2::constants::physics::MassLambda);
+    if (kfDoDCAFitterPreMinimV0) {
+      // save classical DCA daughters
+      cascade.v0DaughterDCA = v0Fit->v0DaughterDCA;
     }
+    cascade.kfMLambda = v0Fit->kfMLambda;
+    posTrackParCov = v0Fit->positiveTrackParCov;
+    negTrackParCov = v0Fit->negativeTrackParCov;
+    const KFParticle& KFV0 = v0Fit->kfV0;
 
     // V0 constructed, now recovering TrackParCov for dca fitter minimization (with material correction)
-    KFV0.TransportToDecayVertex();
     o2::track::TrackParCov v0TrackParCov = getTrackParCovFromKFP(KFV0, o2::track::PID::Lambda, 0);
     v0TrackParCov.setAbsCharge(0); // to be sure
 
@@ -1263,6 +1302,35 @@ class strangenessBuilderHelper
   v0candidate v0;           // storage for V0 candidate properties
   cascadeCandidate cascade; // storage for cascade candidate properties
 
+  // V0 fit cache for cascade building (standard, KF and tracked cascades)
+  // N.B.: the owner has to clear it whenever PV positions or fitter settings may change
+  bool useV0FitCache = false;
+  struct {
+    std::unordered_map<v0FitCacheKey, std::pair<bool, v0candidate>, v0FitCacheKeyHash> v0s; // DCA fitter V0s
+    std::unordered_map<v0FitCacheKey, std::pair<bool, kfV0Fit>, v0FitCacheKeyHash> kfV0s;   // KF V0s
+    uint64_t hits = 0;
+    uint64_t misses = 0;
+  } v0FitCache;
+
+  void clearV0FitCache()
+  {
+    v0FitCache.v0s.clear();
+    v0FitCache.kfV0s.clear();
+    v0FitCache.hits = 0;
+    v0FitCache.misses = 0;
+  }
+
+  // copies the material LUT, the fitter (settings and magnetic field) and the selections of
+  // another helper, but neither its V0 fit cache nor its candidates
+  void copySettings(strangenessBuilderHelper const& other)
+  {
+    lut = other.lut;
+    fitter = other.fitter;
+    useV0FitCache = other.useV0FitCache;
+    v0selections = other.v0selections;
+    cascadeselections = other.cascadeselections;
+  }
+
   // v0 candidate criteria
   struct {
     int minCrossedRows;
@@ -1286,6 +1354,68 @@ class strangenessBuilderHelper
   } cascadeselections;
 
  private:
+  kfV0Fit kfV0FitBuffer; // V0 fit of the KF cascade building when the cache is not used
+
+  // V0 part of buildCascadeCandidateWithKF: optional DCA fitter pre-minimisation, then KF construction,
+  // optional mass constraint and transport to the decay vertex. Does not depend on the bachelor
+  // other than through the mass hypotheses of the daughters
+  bool fitKFV0(o2::track::TrackParCov const& posTrackParCov, o2::track::TrackParCov const& negTrackParCov,
+               float massPosTrack, float massNegTrack,
+               int kfConstructMethod, bool kfUseV0MassConstraint, bool kfDoDCAFitterPreMinimV0,
+               kfV0Fit& fit)
+  {
+    fit.positiveTrackParCov = posTrackParCov;
+    fit.negativeTrackParCov = negTrackParCov;
+
+    //*>~<* step 1 : V0 with dca fitter, uses material corrections implicitly
+    // This is optional - move close to minima and therefore take material
+    if (kfDoDCAFitterPreMinimV0) {
+      int nCand = 0;
+      try {
+        nCand = fitter.process(fit.positiveTrackParCov, fit.negativeTrackParCov);
+      } catch (...) {
+        LOG(error) << "Exception caught in DCA fitter process call!";
+        return false;
+      }
+      if (nCand == 0) {
+        return false;
+      }
+      // save classical DCA daughters
+      fit.v0DaughterDCA = TMath::Sqrt(fitter.getChi2AtPCACandidate());
+
+      // re-acquire from DCA fitter
+      fit.positiveTrackParCov = fitter.getTrack(0);
+      fit.negativeTrackParCov = fitter.getTrack(1);
+    }
+
+    //*>~<* step 2 : V0 with KF
+    // create KFParticle objects from trackParCovs
+    KFParticle kfpPos, kfpNeg;
+    if (kfCreateFromTrackParCov(kfpPos, fit.positiveTrackParCov, fit.positiveTrackParCov.getCharge(), massPosTrack) != KFStatus::Ok ||
+        kfCreateFromTrackParCov(kfpNeg, fit.negativeTrackParCov, fit.negativeTrackParCov.getCharge(), massNegTrack) != KFStatus::Ok) {
+      return false;
+    }
+
+    // construct V0
+    fit.kfV0 = KFParticle();
+    fit.kfV0.SetConstructMethod(kfConstructMethod);
+    if (kfConstruct(fit.kfV0, std::array<const KFParticle*, 2>{&kfpPos, &kfpNeg}) != KFStatus::Ok) {
+      LOG(debug) << "Failed to construct cascade V0 from daughter tracks";
+      return false;
+    }
+
+    // Calculate V0 mass before mass constraint
+    float MLambda, SigmaLambda;
+    fit.kfV0.GetMass(MLambda, SigmaLambda);
+    fit.kfMLambda = MLambda;
+
+    if (kfUseV0MassConstraint) {
+      fit.kfV0.SetNonlinearMassConstraint(o2::constants::physics::MassLambda);
+    }
+    fit.kfV0.TransportToDecayVertex();
+    return true;
+  }
+
   // internal helper to calculate DCA (3D) of a straight line to a given PV analytically
   float CalculateDCAStraightToPV(float X, float Y, float Z, float Px, float Py, float Pz, float pvX, float pvY, float pvZ)
   {
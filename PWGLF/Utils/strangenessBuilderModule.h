@@ -47,12 +47,16 @@
 #include <TPDGCode.h>
 #include <TString.h>
 
+#include <algorithm>
 #include <array>
+#include <atomic>
 #include <cmath>
+#include <cstddef>
 #include <cstdint>
 #include <cstdlib>
 #include <numeric>
 #include <string>
+#include <thread>
 #include <vector>
 
 // simple checkers, but ensure 8 bit integers
@@ -330,10 +334,17 @@ struct coreConfigurables : o2::framework::ConfigurableGroup {
   // exchanges CPU (generate V0s again) with memory (save pre-generated V0s)
   o2::framework::Configurable<bool> useV0BufferForCascades{"useV0BufferForCascades", false, "store array of V0s for cascades or not. False (default): save RAM, use more CPU; true: save CPU, use more RAM"};
 
+  // V0 fit cache: V0s shared by several cascades are fitted once per dataframe
+  // applies to all cascade flavours (standard without V0 buffer, KF, tracked)
+  o2::framework::Configurable<bool> useV0FitCache{"useV0FitCache", false, "cache V0 fits done in cascade building per dataframe. False (default): refit V0 for every cascade; true: fit once per daughter pair, collision and fit mode"};
+
   o2::framework::Configurable<int> mc_findableMode{"mc_findableMode", 0, "0: disabled; 1: add findable-but-not-found to existing V0s from AO2D; 2: reset V0s and generate only findable-but-not-found"};
 
   // test the possibility of refitting with material corrections (DCA Fitter option)
   o2::framework::Configurable<bool> refitWithMaterialCorrection{"refitWithMaterialCorrection", false, "do refit after material corrections were applied"};
+
+  // parallel building of the V0 and cascade candidates, tables are still filled sequentially in the original order
+  o2::framework::Configurable<int> nThreadsBuilding{"nThreadsBuilding", 1, "number of worker threads building V0 and cascade candidates in parallel (1: sequential)"};
 };
 
 // strangenessBuilder: V0 building options
@@ -503,11 +514,124 @@ class BuilderModule
     return preSelectOpts.massCutOm->get("constant") + pt * preSelectOpts.massCutOm->get("linear") + preSelectOpts.massCutOm->get("expoConstant") * TMath::Exp(-pt / preSelectOpts.massCutOm->get("expoRelax"));
   }
 
+  // TPC PID preselection of the V0 daughters: marks the species passing it in preSelectedPIDV0s
+  // returns false if the candidate is rejected, i.e. no species passes the PID preselection
+  template <typename TTrack>
+  bool checkV0PIDPreselection(TTrack const& posTrack, TTrack const& negTrack, std::vector<int>& preSelectedPIDV0s)
+  {
+    if (preSelectOpts.mEnabledPreselectedSpecies[kGamma] || preSelectOpts.mEnabledPreselectedSpecies[kK0Short] || preSelectOpts.mEnabledPreselectedSpecies[kLambda] || preSelectOpts.mEnabledPreselectedSpecies[kAntiLambda]) {
+      if constexpr (requires { posTrack.tpcNSigmaEl(); }) { // check PID for each particle species and mark which one passes the check
+        preSelectedPIDV0s.resize(nSelV0Types, 0);
+        if ( // photon PID selection
+          preSelectOpts.mEnabledPreselectedSpecies[kGamma] &&
+          std::abs(posTrack.tpcNSigmaEl()) < preSelectOpts.maxTPCpidNsigma &&
+          std::abs(negTrack.tpcNSigmaEl()) < preSelectOpts.maxTPCpidNsigma) {
+          preSelectedPIDV0s[kGamma] = 1;
+        }
+
+        if ( // K0Short PID selection
+          preSelectOpts.mEnabledPreselectedSpecies[kK0Short] &&
+          std::abs(posTrack.tpcNSigmaPi()) < preSelectOpts.maxTPCpidNsigma &&
+          std::abs(negTrack.tpcNSigmaPi()) < preSelectOpts.maxTPCpidNsigma) {
+          preSelectedPIDV0s[kK0Short] = 1;
+        }
+
+        if ( // Lambda PID selection
+          preSelectOpts.mEnabledPreselectedSpecies[kLambda] &&
+          std::abs(posTrack.tpcNSigmaPr()) < preSelectOpts.maxTPCpidNsigma &&
+          std::abs(negTrack.tpcNSigmaPi()) < preSelectOpts.maxTPCpidNsigma) {
+          preSelectedPIDV0s[kLambda] = 1;
+        }
+
+        if ( // antiLambda PID, mass, lifetime selection
+          preSelectOpts.mEnabledPreselectedSpecies[kAntiLambda] &&
+          std::abs(posTrack.tpcNSigmaPi()) < preSelectOpts.maxTPCpidNsigma &&
+          std::abs(negTrack.tpcNSigmaPr()) < preSelectOpts.maxTPCpidNsigma) {
+          preSelectedPIDV0s[kAntiLambda] = 1;
+        }
+
+        // if no particle species passes the PID selections, reject the candidate
+        if (!preSelectedPIDV0s[kGamma] && !preSelectedPIDV0s[kK0Short] && !preSelectedPIDV0s[kLambda] && !preSelectedPIDV0s[kAntiLambda]) {
+          return false;
+        }
+      } else { // if no PID information is available, do not cut on it and mark all PID checks as true
+        preSelectedPIDV0s.resize(nSelV0Types, 1);
+      }
+    }
+    return true;
+  }
+
+  // TPC PID preselection of the cascade daughters: marks the species passing it in preSelectedPIDCascades
+  // returns false if the candidate is rejected, i.e. no species passes the PID preselection
+  template <typename TTrack>
+  bool checkCascadePIDPreselection(TTrack const& posTrack, TTrack const& negTrack, TTrack const& bachTrack, std::vector<int>& preSelectedPIDCascades)
+  {
+    if (preSelectOpts.mEnabledPreselectedSpecies[kXiMinus] || preSelectOpts.mEnabledPreselectedSpecies[kXiPlus] || preSelectOpts.mEnabledPreselectedSpecies[kOmegaMinus] || preSelectOpts.mEnabledPreselectedSpecies[kOmegaPlus]) {
+      if constexpr (requires { posTrack.tpcNSigmaEl(); }) { // check PID for each particle species and mark which one passes the check
+        preSelectedPIDCascades.resize(nPartTypes, 0);
+        if ( // XiMinus PID selection
+          preSelectOpts.mEnabledPreselectedSpecies[kXiMinus] &&
+          std::abs(posTrack.tpcNSigmaPr()) < preSelectOpts.maxTPCpidNsigma &&
+          std::abs(negTrack.tpcNSigmaPi()) < preSelectOpts.maxTPCpidNsigma &&
+          std::abs(bachTrack.tpcNSigmaPi()) < preSelectOpts.maxTPCpidNsigma) {
+          preSelectedPIDCascades[kXiMinus] = 1;
+        }
+
+        if ( // XiPlus PID selection
+          preSelectOpts.mEnabledPreselectedSpecies[kXiPlus] &&
+          std::abs(posTrack.tpcNSigmaPi()) < preSelectOpts.maxTPCpidNsigma &&
+          std::abs(negTrack.tpcNSigmaPr()) < preSelectOpts.maxTPCpidNsigma &&
+          std::abs(bachTrack.tpcNSigmaPi()) < preSelectOpts.maxTPCpidNsigma) {
+          preSelectedPIDCascades[kXiPlus] = 1;
+        }
+
+        if ( // OmegaMinus PID selection
+          preSelectOpts.mEnabledPreselectedSpecies[kOmegaMinus] &&
+          std::abs(posTrack.tpcNSigmaPr()) < preSelectOpts.maxTPCpidNsigma &&
+          std::abs(negTrack.tpcNSigmaPi()) < preSelectOpts.maxTPCpidNsigma &&
+          std::abs(bachTrack.tpcNSigmaKa()) < preSelectOpts.maxTPCpidNsigma) {
+          preSelectedPIDCascades[kOmegaMinus] = 1;
+        }
+
+        if ( // OmegaPlus PID selection
+          preSelectOpts.mEnabledPreselectedSpecies[kOmegaPlus] &&
+          std::abs(posTrack.tpcNSigmaPi()) < preSelectOpts.maxTPCpidNsigma &&
+          std::abs(negTrack.tpcNSigmaPr()) < preSelectOpts.maxTPCpidNsigma &&
+          std::abs(bachTrack.tpcNSigmaKa()) < preSelectOpts.maxTPCpidNsigma) {
+          preSelectedPIDCascades[kOmegaPlus] = 1;
+        }
+
+        // if no particle species passes the PID selections, reject the candidate
+        if (!preSelectedPIDCascades[kXiMinus] && !preSelectedPIDCascades[kXiPlus] && !preSelectedPIDCascades[kOmegaMinus] && !preSelectedPIDCascades[kOmegaPlus]) {
+          return false;
+        }
+      } else { // if no PID information is available, do not cut on it and mark all PID checks as true
+        preSelectedPIDCascades.resize(nPartTypes, 1);
+      }
+    }
+    return true;
+  }
+
   int nEnabledTables = 0;
 
   // helper object
   o2::pwglf::strangenessBuilderHelper straHelper;
 
+  // parallel building: helpers owned by the worker threads and per-candidate build results
+  // filled before the sequential table filling, indexed by position in the sorted V0 / cascade lists
+  enum BuildStatus : int8_t {
+    kNotPrebuilt = -1, // built in the sequential loop
+    kBuildFailed = 0,
+    kBuildSucceeded = 1
+  };
+  std::vector<o2::pwglf::strangenessBuilderHelper> workerHelpers;
+  bool parallelBuildFallbackReported = false;
+  std::vector<int8_t> v0BuildStatus;
+  std::vector<o2::pwglf::v0candidate> v0BuildResults;
+  std::vector<int8_t> cascadeBuildStatus;
+  std::vector<o2::pwglf::cascadeCandidate> cascadeBuildResults;
+  std::vector<std::size_t> buildQueue; // candidates to be built by the worker threads
+
   // for handling TPC-only tracks (photons)
   int mRunNumber;
   o2::aod::common::TPCVDriftManager mVDriftMgr;
@@ -682,6 +806,12 @@ class BuilderModule
     auto h2 = histos.template add<TH1>("hInputStatistics", "hInputStatistics", o2::framework::HistType::kTH1D, {{nTablesConst, -0.5f, static_cast<float>(nTablesConst)}});
     h2->SetTitle("Input table sizes");
 
+    if (baseOpts.useV0FitCache.value) {
+      auto hV0FitCacheStatistics = histos.template add<TH1>("hV0FitCacheStatistics", "hV0FitCacheStatistics", o2::framework::HistType::kTH1D, {{2, -0.5f, 1.5f}});
+      hV0FitCacheStatistics->GetXaxis()->SetBinLabel(1, "Hits");
+      hV0FitCacheStatistics->GetXaxis()->SetBinLabel(2, "Misses");
+    }
+
     if (v0BuilderOpts.generatePhotonCandidates.value == true) {
       auto hDeduplicationStatistics = histos.template add<TH1>("hDeduplicationStatistics", "hDeduplicationStatistics", o2::framework::HistType::kTH1D, {{2, -0.5f, 1.5f}});
       hDeduplicationStatistics->GetXaxis()->SetBinLabel(1, "AO2D V0s");
@@ -824,6 +954,16 @@ class BuilderModule
     // Set option to refit with material corrections
     straHelper.fitter.setRefitWithMatCorr(baseOpts.refitWithMaterialCorrection.value);
 
+    // V0 fit cache for cascade building
+    straHelper.useV0FitCache = baseOpts.useV0FitCache.value;
+
+    // worker helpers for the parallel building, configured as straHelper before each use
+    workerHelpers.clear();
+    if (baseOpts.nThreadsBuilding.value > 1) {
+      workerHelpers.resize(baseOpts.nThreadsBuilding.value);
+      LOGF(info, "Parallel building of V0s and cascades enabled with %i worker threads", baseOpts.nThreadsBuilding.value);
+    }
+
     // Initialise the RCTFlagsChecker
     if (eventSelectOpts.cfgApplyRCTrequirement) {
       rctFlagsChecker.init(eventSelectOpts.cfgRCTLabel.value, eventSelectOpts.cfgCheckZDC, eventSelectOpts.cfgTreatLimitedAcceptanceAsBad);
@@ -1454,6 +1594,192 @@ class BuilderModule
     LOGF(debug, "V0 total %i, Cascade total %i, Tracked cascade total %i, V0s flagged used in cascades: %i", v0s.size(), cascades.size(), trackedCascadeCount, v0sUsedInCascades);
   }
 
+  //__________________________________________________
+  // the workers share the Propagator, which is only read with the material LUT (or no
+  // material correction) and the fast magnetic field: the TGeo navigator and the full
+  // field map are not thread-safe, in which case everything is built sequentially
+  bool useParallelBuild()
+  {
+    if (workerHelpers.empty()) {
+      return false;
+    }
+    if (straHelper.fitter.getMatCorrType() == o2::base::Propagator::MatCorrType::USEMatCorrTGeo || o2::base::Propagator::Instance()->getFieldFast() == nullptr) {
+      if (!parallelBuildFallbackReported) {
+        LOGF(warning, "Parallel building requires the material LUT and the fast magnetic field: V0s and cascades will be built sequentially");
+        parallelBuildFallbackReported = true;
+      }
+      return false;
+    }
+    return true;
+  }
+
+  //__________________________________________________
+  // run build(helper, index) for all the candidates in buildQueue, distributed
+  // dynamically over the worker threads, each with its own helper and fitter
+  template <typename TBuild>
+  void runParallelBuild(TBuild&& build)
+  {
+    for (auto& helper : workerHelpers) {
+      helper.copySettings(straHelper); // same selections, fitter settings and magnetic field
+      helper.clearV0FitCache();
+    }
+    const std::size_t nCandidates = buildQueue.size();
+    const std::size_t nWorkers = std::min(workerHelpers.size(), nCandidates);
+    std::atomic<std::size_t> nextCandidate{0};
+    std::vector<std::thread> threads;
+    threads.reserve(nWorkers);
+    for (std::size_t iWorker = 0; iWorker < nWorkers; iWorker++) {
+      threads.emplace_back([&, iWorker]() {
+        auto& helper = workerHelpers[iWorker];
+        for (std::size_t iCandidate = nextCandidate++; iCandidate < nCandidates; iCandidate = nextCandidate++) {
+          build(helper, buildQueue[iCandidate]);
+        }
+      });
+    }
+    for (auto& thread : threads) {
+      thread.join();
+    }
+    for (auto const& helper : workerHelpers) {
+      straHelper.v0FitCache.hits += helper.v0FitCache.hits;
+      straHelper.v0FitCache.misses += helper.v0FitCache.misses;
+    }
+  }
+
+  //__________________________________________________
+  // parallel build phase of buildV0s: candidates passing the cheap selections of the
+  // sequential loop are built by the worker threads, results are stored in v0BuildResults.
+  // V0s with TPC-only daughters to be moved in time are left to the sequential loop
+  template <typename TCollisions, typename TTracks>
+  void prebuildV0s(TCollisions const& collisions, TTracks const& tracks)
+  {
+    v0BuildStatus.assign(v0List.size(), kNotPrebuilt);
+    if (!useParallelBuild()) {
+      return;
+    }
+    v0BuildResults.resize(v0List.size());
+
+    buildQueue.clear();
+    for (std::size_t iv0 = 0; iv0 < v0List.size(); iv0++) {
+      const auto& v0 = v0List[sorted_v0[iv0]];
+      if ((!v0BuilderOpts.generatePhotonCandidates.value && v0.v0Type > 1) || (!baseOpts.mEnabledTables[kV0CoresBase] && v0Map[iv0] == -2)) {
+        continue;
+      }
+      if (v0.collisionId >= 0 && eventSelectOpts.fillOnlySelectedCollisions && !isCollisionAccepted(collisions.rawIteratorAt(v0.collisionId))) {
+        continue;
+      }
+      auto const& posTrack = tracks.rawIteratorAt(v0.posTrackId);
+      auto const& negTrack = tracks.rawIteratorAt(v0.negTrackId);
+      if (v0BuilderOpts.moveTPCOnlyTracks) {
+        bool isPosTPCOnly = (posTrack.hasTPC() && !posTrack.hasITS() && !posTrack.hasTRD() && !posTrack.hasTOF());
+        bool isNegTPCOnly = (negTrack.hasTPC() && !negTrack.hasITS() && !negTrack.hasTRD() && !negTrack.hasTOF());
+        if (isPosTPCOnly || isNegTPCOnly) {
+          continue;
+        }
+      }
+      std::vector<int> preSelectedPIDV0s;
+      if (!checkV0PIDPreselection(posTrack, negTrack, preSelectedPIDV0s)) {
+        continue;
+      }
+      buildQueue.push_back(iv0);
+    }
+
+    runParallelBuild([&](o2::pwglf::strangenessBuilderHelper& helper, std::size_t iv0) {
+      const auto& v0 = v0List[sorted_v0[iv0]];
+      float pvX = 0.0f, pvY = 0.0f, pvZ = 0.0f;
+      if (v0.collisionId >= 0) {
+        auto const& collision = collisions.rawIteratorAt(v0.collisionId);
+        pvX = collision.posX();
+        pvY = collision.posY();
+        pvZ = collision.posZ();
+      }
+      auto const& posTrack = tracks.rawIteratorAt(v0.posTrackId);
+      auto const& negTrack = tracks.rawIteratorAt(v0.negTrackId);
+      auto posTrackPar = getTrackParCov(posTrack);
+      auto negTrackPar = getTrackParCov(negTrack);
+      bool isBuilt = helper.buildV0Candidate(v0.collisionId, pvX, pvY, pvZ, posTrack, negTrack, posTrackPar, negTrackPar, v0.isCollinearV0, baseOpts.mEnabledTables[kV0Covs], v0BuilderOpts.generatePhotonCandidates);
+      v0BuildResults[iv0] = helper.v0;
+      v0BuildStatus[iv0] = isBuilt ? kBuildSucceeded : kBuildFailed;
+    });
+  }
+
+  //__________________________________________________
+  // parallel build phase of buildCascades (useKF = false) and buildKFCascades (useKF = true),
+  // results are stored in cascadeBuildResults
+  template <bool useKF, typename TCollisions, typename TTracks>
+  void prebuildCascades(TCollisions const& collisions, TTracks const& tracks)
+  {
+    cascadeBuildStatus.assign(cascadeList.size(), kNotPrebuilt);
+    if (!useParallelBuild()) {
+      return;
+    }
+    cascadeBuildResults.resize(cascadeList.size());
+
+    buildQueue.clear();
+    for (std::size_t icascade = 0; icascade < cascadeList.size(); icascade++) {
+      const auto& cascade = cascadeList[sorted_cascade[icascade]];
+      if (cascade.collisionId >= 0 && eventSelectOpts.fillOnlySelectedCollisions && !isCollisionAccepted(collisions.rawIteratorAt(cascade.collisionId))) {
+        continue;
+      }
+      if constexpr (!useKF) {
+        std::vector<int> preSelectedPIDCascades;
+        if (!checkCascadePIDPreselection(tracks.rawIteratorAt(cascade.posTrackId), tracks.rawIteratorAt(cascade.negTrackId), tracks.rawIteratorAt(cascade.bachTrackId), preSelectedPIDCascades)) {
+          continue;
+        }
+        if (baseOpts.useV0BufferForCascades && (cascade.v0Id < 0 || v0Map[cascade.v0Id] < 0)) {
+          continue;
+        }
+      }
+      buildQueue.push_back(icascade);
+    }
+
+    runParallelBuild([&](o2::pwglf::strangenessBuilderHelper& helper, std::size_t icascade) {
+      const auto& cascade = cascadeList[sorted_cascade[icascade]];
+      float pvX = 0.0f, pvY = 0.0f, pvZ = 0.0f;
+      if (cascade.collisionId >= 0) {
+        auto const& collision = collisions.rawIteratorAt(cascade.collisionId);
+        pvX = collision.posX();
+        pvY = collision.posY();
+        pvZ = collision.posZ();
+      }
+      auto const& posTrack = tracks.rawIteratorAt(cascade.posTrackId);
+      auto const& negTrack = tracks.rawIteratorAt(cascade.negTrackId);
+      auto const& bachTrack = tracks.rawIteratorAt(cascade.bachTrackId);
+      bool isBuilt = false;
+      if constexpr (useKF) {
+        isBuilt = helper.buildCascadeCandidateWithKF(cascade.collisionId, pvX, pvY, pvZ,
+                                                     posTrack,
+                                                     negTrack,
+                                                     bachTrack,
+                                                     baseOpts.mEnabledTables[kCascBBs],
+                                                     cascadeBuilderOpts.kfConstructMethod,
+                                                     cascadeBuilderOpts.kfTuneForOmega,
+                                                     cascadeBuilderOpts.kfUseV0MassConstraint,
+                                                     cascadeBuilderOpts.kfUseCascadeMassConstraint,
+                                                     cascadeBuilderOpts.kfDoDCAFitterPreMinimV0,
+                                                     cascadeBuilderOpts.kfDoDCAFitterPreMinimCasc);
+      } else if (baseOpts.useV0BufferForCascades) {
+        isBuilt = helper.buildCascadeCandidate(cascade.collisionId, pvX, pvY, pvZ,
+                                               v0sFromCascades[v0Map[cascade.v0Id]],
+                                               posTrack,
+                                               negTrack,
+                                               bachTrack,
+                                               baseOpts.mEnabledTables[kCascBBs],
+                                               cascadeBuilderOpts.useCascadeMomentumAtPrimVtx,
+                                               baseOpts.mEnabledTables[kCascCovs]);
+      } else {
+        isBuilt = helper.buildCascadeCandidate(cascade.collisionId, pvX, pvY, pvZ,
+                                               posTrack,
+                                               negTrack,
+                                               bachTrack,
+                                               baseOpts.mEnabledTables[kCascBBs],
+                                               cascadeBuilderOpts.useCascadeMomentumAtPrimVtx,
+                                               baseOpts.mEnabledTables[kCascCovs]);
+      }
+      cascadeBuildResults[icascade] = helper.cascade;
+      cascadeBuildStatus[icascade] = isBuilt ? kBuildSucceeded : kBuildFailed;
+    });
+  }
+
   //__________________________________________________
   template <class TBCs, typename THistoRegistry, typename TCollisions, typename TTracks, typename TV0s, typename TMCParticles, typename TProducts>
   void buildV0s(THistoRegistry& histos, TCollisions const& collisions, TV0s const& v0s, TTracks const& tracks, TMCParticles const& mcParticles, TProducts& products)
@@ -1467,6 +1793,9 @@ class BuilderModule
       mcParticleIsReco.resize(mcParticles.size(), false);
     }
 
+    // build the candidates with the worker threads first, if enabled
+    prebuildV0s(collisions, tracks);
+
     int nV0s = 0;
     // Loops over all V0s in the time frame
     histos.fill(HIST("hInputStatistics"), kV0CoresBase, v0s.size());
@@ -1539,49 +1868,20 @@ class BuilderModule
       }
 
       std::vector<int> preSelectedPIDV0s;
-      if (preSelectOpts.mEnabledPreselectedSpecies[kGamma] || preSelectOpts.mEnabledPreselectedSpecies[kK0Short] || preSelectOpts.mEnabledPreselectedSpecies[kLambda] || preSelectOpts.mEnabledPreselectedSpecies[kAntiLambda]) {
-        if constexpr (requires { posTrack.tpcNSigmaEl(); }) { // check PID for each particle species and mark which one passes the check
-          preSelectedPIDV0s.resize(nSelV0Types, 0);
-          if ( // photon PID selection
-            preSelectOpts.mEnabledPreselectedSpecies[kGamma] &&
-            std::abs(posTrack.tpcNSigmaEl()) < preSelectOpts.maxTPCpidNsigma &&
-            std::abs(negTrack.tpcNSigmaEl()) < preSelectOpts.maxTPCpidNsigma) {
-            preSelectedPIDV0s[kGamma] = 1;
-          }
-
-          if ( // K0Short PID selection
-            preSelectOpts.mEnabledPreselectedSpecies[kK0Short] &&
-            std::abs(posTrack.tpcNSigmaPi()) < preSelectOpts.maxTPCpidNsigma &&
-            std::abs(negTrack.tpcNSigmaPi()) < preSelectOpts.maxTPCpidNsigma) {
-            preSelectedPIDV0s[kK0Short] = 1;
-          }
-
-          if ( // Lambda PID selection
-            preSelectOpts.mEnabledPreselectedSpecies[kLambda] &&
-            std::abs(posTrack.tpcNSigmaPr()) < preSelectOpts.maxTPCpidNsigma &&
-            std::abs(negTrack.tpcNSigmaPi()) < preSelectOpts.maxTPCpidNsigma) {
-            preSelectedPIDV0s[kLambda] = 1;
-          }
-
-          if ( // antiLambda PID, mass, lifetime selection
-            preSelectOpts.mEnabledPreselectedSpecies[kAntiLambda] &&
-            std::abs(posTrack.tpcNSigmaPi()) < preSelectOpts.maxTPCpidNsigma &&
-            std::abs(negTrack.tpcNSigmaPr()) < preSelectOpts.maxTPCpidNsigma) {
-            preSelectedPIDV0s[kAntiLambda] = 1;
-          }
-
-          // if particle species pass the PID selections, move onto the next candidates
-          if (!preSelectedPIDV0s[kGamma] && !preSelectedPIDV0s[kK0Short] && !preSelectedPIDV0s[kLambda] && !preSelectedPIDV0s[kAntiLambda]) {
-            histos.fill(HIST("hPreselectionV0s"), 0);
-            products.v0dataLink(-1, -1);
-            continue;
-          }
-        } else { // if no PID information is available, do not cut on it and mark all PID checks as true
-          preSelectedPIDV0s.resize(nSelV0Types, 1);
-        }
+      if (!checkV0PIDPreselection(posTrack, negTrack, preSelectedPIDV0s)) {
+        histos.fill(HIST("hPreselectionV0s"), 0);
+        products.v0dataLink(-1, -1);
+        continue;
       }
 
-      if (!straHelper.buildV0Candidate(v0.collisionId, pvX, pvY, pvZ, posTrack, negTrack, posTrackPar, negTrackPar, v0.isCollinearV0, baseOpts.mEnabledTables[kV0Covs], v0BuilderOpts.generatePhotonCandidates)) {
+      bool isBuilt = false;
+      if (v0BuildStatus[iv0] != kNotPrebuilt) {
+        straHelper.v0 = v0BuildResults[iv0];
+        isBuilt = v0BuildStatus[iv0] == kBuildSucceeded;
+      } else {
+        isBuilt = straHelper.buildV0Candidate(v0.collisionId, pvX, pvY, pvZ, posTrack, negTrack, posTrackPar, negTrackPar, v0.isCollinearV0, baseOpts.mEnabledTables[kV0Covs], v0BuilderOpts.generatePhotonCandidates);
+      }
+      if (!isBuilt) {
         products.v0dataLink(-1, -1);
         continue;
       }
@@ -2057,6 +2357,10 @@ class BuilderModule
     if (!baseOpts.mEnabledTables[kStoredCascCores]) {
       return; // don't do if no request for cascades in place
     }
+
+    // build the candidates with the worker threads first, if enabled
+    prebuildCascades<false>(collisions, tracks);
+
     int nCascades = 0;
     // Loops over all cascades in the time frame
     histos.fill(HIST("hInputStatistics"), kStoredCascCores, cascades.size());
@@ -2082,54 +2386,22 @@ class BuilderModule
       auto const& bachTrack = tracks.rawIteratorAt(cascade.bachTrackId);
 
       std::vector<int> preSelectedPIDCascades;
-      if (preSelectOpts.mEnabledPreselectedSpecies[kXiMinus] || preSelectOpts.mEnabledPreselectedSpecies[kXiPlus] || preSelectOpts.mEnabledPreselectedSpecies[kOmegaMinus] || preSelectOpts.mEnabledPreselectedSpecies[kOmegaPlus]) {
-        if constexpr (requires { posTrack.tpcNSigmaEl(); }) { // check PID for each particle species and mark which one passes the check
-          preSelectedPIDCascades.resize(nPartTypes, 0);
-          if ( // XiMinus PID selection
-            preSelectOpts.mEnabledPreselectedSpecies[kXiMinus] &&
-            std::abs(posTrack.tpcNSigmaPr()) < preSelectOpts.maxTPCpidNsigma &&
-            std::abs(negTrack.tpcNSigmaPi()) < preSelectOpts.maxTPCpidNsigma &&
-            std::abs(bachTrack.tpcNSigmaPi()) < preSelectOpts.maxTPCpidNsigma) {
-            preSelectedPIDCascades[kXiMinus] = 1;
-          }
-
-          if ( // XiPlus PID selection
-            preSelectOpts.mEnabledPreselectedSpecies[kXiPlus] &&
-            std::abs(posTrack.tpcNSigmaPi()) < preSelectOpts.maxTPCpidNsigma &&
-            std::abs(negTrack.tpcNSigmaPr()) < preSelectOpts.maxTPCpidNsigma &&
-            std::abs(bachTrack.tpcNSigmaPi()) < preSelectOpts.maxTPCpidNsigma) {
-            preSelectedPIDCascades[kXiPlus] = 1;
-          }
-
-          if ( // OmegaMinus PID selection
-            preSelectOpts.mEnabledPreselectedSpecies[kOmegaMinus] &&
-            std::abs(posTrack.tpcNSigmaPr()) < preSelectOpts.maxTPCpidNsigma &&
-            std::abs(negTrack.tpcNSigmaPi()) < preSelectOpts.maxTPCpidNsigma &&
-            std::abs(bachTrack.tpcNSigmaKa()) < preSelectOpts.maxTPCpidNsigma) {
-            preSelectedPIDCascades[kOmegaMinus] = 1;
-          }
-
-          if ( // OmegaPlus PID selection
-            preSelectOpts.mEnabledPreselectedSpecies[kOmegaPlus] &&
-            std::abs(posTrack.tpcNSigmaPi()) < preSelectOpts.maxTPCpidNsigma &&
-            std::abs(negTrack.tpcNSigmaPr()) < preSelectOpts.maxTPCpidNsigma &&
-            std::abs(bachTrack.tpcNSigmaKa()) < preSelectOpts.maxTPCpidNsigma) {
-            preSelectedPIDCascades[kOmegaPlus] = 1;
-          }
-
-          // if particle species pass the PID selections, move onto the next candidates
-          if (!preSelectedPIDCascades[kXiMinus] && !preSelectedPIDCascades[kXiPlus] && !preSelectedPIDCascades[kOmegaMinus] && !preSelectedPIDCascades[kOmegaPlus]) {
-            histos.fill(HIST("hPreselectionCascades"), 0);
-            products.cascdataLink(-1);
-            interlinks.cascadeToCascCores.push_back(-1);
-            continue;
-          }
-        } else { // if no PID information is available, do not cut on it and mark all PID checks as true
-          preSelectedPIDCascades.resize(nPartTypes, 1);
-        }
+      if (!checkCascadePIDPreselection(posTrack, negTrack, bachTrack, preSelectedPIDCascades)) {
+        histos.fill(HIST("hPreselectionCascades"), 0);
+        products.cascdataLink(-1);
+        interlinks.cascadeToCascCores.push_back(-1);
+        continue;
       }
 
-      if (baseOpts.useV0BufferForCascades) {
+      if (cascadeBuildStatus[icascade] != kNotPrebuilt) {
+        // built by the worker threads
+        straHelper.cascade = cascadeBuildResults[icascade];
+        if (cascadeBuildStatus[icascade] != kBuildSucceeded) {
+          products.cascdataLink(-1);
+          interlinks.cascadeToCascCores.push_back(-1);
+          continue; // didn't work out, skip
+        }
+      } else if (baseOpts.useV0BufferForCascades) {
         // this processing path uses a buffer of V0s so that no
         // additional minimization step is redone. It consumes less
         // CPU at the cost of more memory. Since memory is a more
@@ -2520,6 +2792,10 @@ class BuilderModule
     if (!baseOpts.mEnabledTables[kStoredKFCascCores]) {
       return; // don't do if no request for cascades in place
     }
+
+    // build the candidates with the worker threads first, if enabled
+    prebuildCascades<true>(collisions, tracks);
+
     int nCascades = 0;
     // Loops over all cascades in the time frame
     histos.fill(HIST("hInputStatistics"), kStoredKFCascCores, cascades.size());
@@ -2543,17 +2819,24 @@ class BuilderModule
       auto const& posTrack = tracks.rawIteratorAt(cascade.posTrackId);
       auto const& negTrack = tracks.rawIteratorAt(cascade.negTrackId);
       auto const& bachTrack = tracks.rawIteratorAt(cascade.bachTrackId);
-      if (!straHelper.buildCascadeCandidateWithKF(cascade.collisionId, pvX, pvY, pvZ,
-                                                  posTrack,
-                                                  negTrack,
-                                                  bachTrack,
-                                                  baseOpts.mEnabledTables[kCascBBs],
-                                                  cascadeBuilderOpts.kfConstructMethod,
-                                                  cascadeBuilderOpts.kfTuneForOmega,
-                                                  cascadeBuilderOpts.kfUseV0MassConstraint,
-                                                  cascadeBuilderOpts.kfUseCascadeMassConstraint,
-                                                  cascadeBuilderOpts.kfDoDCAFitterPreMinimV0,
-                                                  cascadeBuilderOpts.kfDoDCAFitterPreMinimCasc)) {
+      bool isBuilt = false;
+      if (cascadeBuildStatus[icascade] != kNotPrebuilt) {
+        straHelper.cascade = cascadeBuildResults[icascade];
+        isBuilt = cascadeBuildStatus[icascade] == kBuildSucceeded;
+      } else {
+        isBuilt = straHelper.buildCascadeCandidateWithKF(cascade.collisionId, pvX, pvY, pvZ,
+                                                         posTrack,
+                                                         negTrack,
+                                                         bachTrack,
+                                                         baseOpts.mEnabledTables[kCascBBs],
+                                                         cascadeBuilderOpts.kfConstructMethod,
+                                                         cascadeBuilderOpts.kfTuneForOmega,
+                                                         cascadeBuilderOpts.kfUseV0MassConstraint,
+                                                         cascadeBuilderOpts.kfUseCascadeMassConstraint,
+                                                         cascadeBuilderOpts.kfDoDCAFitterPreMinimV0,
+                                                         cascadeBuilderOpts.kfDoDCAFitterPreMinimCasc);
+      }
+      if (!isBuilt) {
         products.kfcascdataLink(-1);
         interlinks.cascadeToKFCascCores.push_back(-1);
         continue; // didn't work out, skip
@@ -2771,6 +3054,9 @@ class BuilderModule
     // reset vectors for cascade interlinks
     resetInterlinks();
 
+    // V0 fits are cached per dataframe only
+    straHelper.clearV0FitCache();
+
     // prepare v0List, cascadeList
     prepareBuildingLists<TBCs>(histos, collisions, mccollisions, v0s, cascades, tracks, mcParticles);
 
@@ -2790,6 +3076,12 @@ class BuilderModule
     }
 
     populateCascadeInterlinks();
+
+    if (baseOpts.useV0FitCache) {
+      histos.fill(HIST("hV0FitCacheStatistics"), 0, straHelper.v0FitCache.hits);
+      histos.fill(HIST("hV0FitCacheStatistics"), 1, straHelper.v0FitCache.misses);
+      LOGF(debug, "V0 fit cache: %llu hits, %llu misses", static_cast<unsigned long long>(straHelper.v0FitCache.hits), static_cast<unsigned long long>(straHelper.v0FitCache.misses));
+    }
   }
 }; // end BuilderModule
 
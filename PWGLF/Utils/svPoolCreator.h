@@ -25,10 +25,13 @@
 
 #include <Rtypes.h>
 
+#include <algorithm>
 #include <array>
 #include <cmath>
+#include <cstddef>
 #include <cstdint>
 #include <cstdlib>
+#include <numeric>
 #include <unordered_map>
 #include <utility>
 #include <vector>
@@ -198,70 +201,28 @@ class svPoolCreator
         continue;
       }
 
-      int poolIndex = (1 - isDau0) * 2 + (trackCand.sign() < 0);
       trForpool.Idxtr = trackCand.globalIndex();
       trForpool.collBracket = {static_cast<int>(collIdx), static_cast<int>(collIdx)};
-      // LOG(info) << "Adding track to pool: " << trForpool.Idxtr << " with bracket: " << trForpool.collBracket.getMin() << " " << trForpool.collBracket.getMax() << " and pool index: " << poolIndex;
-      trackCandPool[poolIndex].emplace_back(trForpool);
-      tmap[trackCand.globalIndex()] = {trackCandPool[poolIndex].size() - 1, poolIndex};
+      addTrackCand(trForpool, isDau0, trackCand.sign() < 0);
     }
+  }
 
-    // is Sorting Needed ? TBD
+  /// Add a track candidate with an already known bracket of compatible collisions
+  void addTrackCand(const TrackCand& trackCand, bool isDau0, bool isNegative)
+  {
+    int poolIndex = (1 - isDau0) * 2 + isNegative;
+    trackCandPool[poolIndex].emplace_back(trackCand);
+    tmap[trackCand.Idxtr] = {trackCandPool[poolIndex].size() - 1, poolIndex};
   }
 
+  /// All the (track0, track1) pairs with overlapping collision brackets, without duplicates.
+  /// For each charge combination the pairs are ordered by track1 in pool order, then by the first common collision.
   template <typename C>
   std::vector<SVCand>& getSVCandPool(const C& collisions, bool combineLikeSign = false)
   {
-    gsl::span<std::vector<TrackCand>> track0Pool{trackCandPool.data(), NChargeSigns};
-    gsl::span<std::vector<TrackCand>> track1Pool{trackCandPool.data() + NChargeSigns, NChargeSigns};
-    std::array<std::vector<int>, NChargeSigns> mVtxTrack0{}; // 1st pos. and neg. track of the kink pool for each vertex
-
-    for (int i = 0; i < NChargeSigns; i++) {
-      mVtxTrack0[i].clear();
-      mVtxTrack0[i].resize(collisions.size(), -1);
-    }
     for (int iCharge = 0; iCharge < NChargeSigns; iCharge++) {
-      auto& vtxFirstT = mVtxTrack0[iCharge];
-      const auto& signTrack0Pool = track0Pool[iCharge];
-      for (unsigned i = 0; i < signTrack0Pool.size(); i++) {
-        const auto& track0Seed = signTrack0Pool[i];
-        for (int j{track0Seed.collBracket.getMin()}; j <= track0Seed.collBracket.getMax(); ++j) {
-          if (vtxFirstT[j] == -1) {
-            vtxFirstT[j] = i;
-          }
-        }
-      }
       int track1sign = combineLikeSign ? iCharge : 1 - iCharge;
-      auto& signTrack1 = track1Pool[track1sign];
-      for (unsigned iTrack1 = 0; iTrack1 < signTrack1.size(); iTrack1++) {
-        auto& track1Seed = signTrack1[iTrack1];
-        int firstOverlapIdx = -1;
-        for (int j{track1Seed.collBracket.getMin()}; j <= track1Seed.collBracket.getMax(); ++j) {
-          LOG(debug) << "Checking vtxFirstT at position " << j << " with value " << vtxFirstT[j];
-          if (vtxFirstT[j] != -1) {
-            firstOverlapIdx = vtxFirstT[j];
-            break;
-          }
-        }
-        if (firstOverlapIdx < 0) {
-          continue;
-        }
-        for (unsigned iTrack0 = firstOverlapIdx; iTrack0 < signTrack0Pool.size(); iTrack0++) {
-          auto& track0Seed = signTrack0Pool[iTrack0];
-
-          if (track0Seed.collBracket.getMin() > track1Seed.collBracket.getMax()) {
-            break;
-          }
-
-          if (track0Seed.collBracket.isOutside(track1Seed.collBracket)) {
-            LOG(debug) << "Brackets do not match";
-            continue;
-          }
-          auto overlapBracket = track0Seed.collBracket.getOverlap(track1Seed.collBracket);
-
-          svCandPool.emplace_back(SVCand{track0Seed.Idxtr, track1Seed.Idxtr, overlapBracket});
-        }
-      }
+      sweepPairs(trackCandPool[iCharge], trackCandPool[NChargeSigns + track1sign], collisions.size());
     }
     return svCandPool;
   }
@@ -270,6 +231,52 @@ class svPoolCreator
   bool fitSV(unsigned int idxDau0, unsigned int idxDau1, T& trackTable);
 
  private:
+  /// Pairs of candidates of pool0 and pool1 with overlapping brackets.
+  /// The track0 candidates are copied per collision: those whose bracket contains it and those whose bracket
+  /// starts there. Each track1 candidate then sweeps its own bracket [a, b]: the track0 candidates containing a
+  /// and those starting in (a, b] are exactly the overlapping ones, each found once. The cost is proportional
+  /// to the bracket lengths and to the number of pairs, independent of the order of the pools.
+  void sweepPairs(const std::vector<TrackCand>& pool0, const std::vector<TrackCand>& pool1, int nCollisions)
+  {
+    sweepCoverOffsets.assign(nCollisions + 1, 0);
+    sweepStartOffsets.assign(nCollisions + 1, 0);
+    for (const auto& track0Seed : pool0) {
+      for (int j{track0Seed.collBracket.getMin()}; j <= track0Seed.collBracket.getMax(); ++j) {
+        sweepCoverOffsets[j + 1]++;
+      }
+      sweepStartOffsets[track0Seed.collBracket.getMin() + 1]++;
+    }
+    for (int j = 0; j < nCollisions; j++) {
+      sweepCoverOffsets[j + 1] += sweepCoverOffsets[j];
+      sweepStartOffsets[j + 1] += sweepStartOffsets[j];
+    }
+    sweepCover.resize(sweepCoverOffsets[nCollisions]);
+    sweepStart.resize(sweepStartOffsets[nCollisions]);
+    sweepCoverFill.assign(sweepCoverOffsets.begin(), sweepCoverOffsets.end() - 1);
+    sweepStartFill.assign(sweepStartOffsets.begin(), sweepStartOffsets.end() - 1);
+    for (const auto& track0Seed : pool0) {
+      const auto& bracket = track0Seed.collBracket;
+      for (int j{bracket.getMin()}; j <= bracket.getMax(); ++j) {
+        sweepCover[sweepCoverFill[j]++] = track0Seed;
+      }
+      sweepStart[sweepStartFill[bracket.getMin()]++] = track0Seed;
+    }
+
+    for (const auto& track1Seed : pool1) {
+      const int first = track1Seed.collBracket.getMin();
+      const int last = track1Seed.collBracket.getMax();
+      auto addPair = [&](const TrackCand& track0Seed) {
+        svCandPool.emplace_back(SVCand{track0Seed.Idxtr, track1Seed.Idxtr, track0Seed.collBracket.getOverlap(track1Seed.collBracket)});
+      };
+      for (uint32_t k = sweepCoverOffsets[first]; k < sweepCoverOffsets[first + 1]; k++) {
+        addPair(sweepCover[k]);
+      }
+      for (uint32_t k = sweepStartOffsets[first + 1]; k < sweepStartOffsets[last + 1]; k++) {
+        addPair(sweepStart[k]);
+      }
+    }
+  }
+
   o2::vertexing::DCAFitterN<2> fitter;
   int track0Pdg;
   int track1Pdg;
@@ -281,6 +288,12 @@ class svPoolCreator
   std::array<std::vector<TrackCand>, 4> trackCandPool; // Sorting: dau0 pos, dau0 neg, dau1 pos, dau1 neg
   std::vector<SVCand> svCandPool;                      // index of the two tracks in the track table
   TrackCand trForpool;
+
+  // track0 candidates per collision for the sweep, kept to avoid reallocations
+  std::vector<uint32_t> sweepCoverOffsets, sweepStartOffsets;
+  std::vector<TrackCand> sweepCover; // candidates whose bracket contains the collision
+  std::vector<TrackCand> sweepStart; // candidates whose bracket starts at the collision
+  std::vector<uint32_t> sweepCoverFill, sweepStartFill;
 };
 
 /// Build time-compatible three-track combinations by joining two svPoolCreator
@@ -350,21 +363,36 @@ class svPoolCreator3Body
     }
   }
 
+  /// Add a track candidate with an already known bracket of compatible collisions
+  void addTrackCand(const TrackCand& trackCand, int pdgHypo, bool isNegative)
+  {
+    if (pdgHypo == track0Pdg) {
+      pool01.addTrackCand(trackCand, true, isNegative);
+      pool02.addTrackCand(trackCand, true, isNegative);
+    } else if (pdgHypo == track1Pdg) {
+      pool01.addTrackCand(trackCand, false, isNegative);
+    } else if (pdgHypo == track2Pdg) {
+      pool02.addTrackCand(trackCand, false, isNegative);
+    } else {
+      LOGP(debug, "Wrong PDG hypothesis for three-body pool");
+    }
+  }
+
   template <typename C>
   std::vector<SVCand3>& getSVCandPool(const C& collisions, bool combineLikeSign01 = false, bool combineLikeSign02 = false)
   {
     auto& candidates01 = pool01.getSVCandPool(collisions, combineLikeSign01);
     auto& candidates02 = pool02.getSVCandPool(collisions, combineLikeSign02);
-    std::unordered_multimap<int, const SVCand*> candidates02ByTrack0;
-    candidates02ByTrack0.reserve(candidates02.size());
-    for (const auto& candidate02 : candidates02) {
-      candidates02ByTrack0.emplace(candidate02.tr0Idx, &candidate02);
-    }
+
+    // candidates02 grouped by first prong, in pool order within the group
+    candidates02ByTrack0.resize(candidates02.size());
+    std::iota(candidates02ByTrack0.begin(), candidates02ByTrack0.end(), 0);
+    std::stable_sort(candidates02ByTrack0.begin(), candidates02ByTrack0.end(), [&candidates02](uint32_t a, uint32_t b) { return candidates02[a].tr0Idx < candidates02[b].tr0Idx; });
 
     for (const auto& candidate01 : candidates01) {
-      const auto [begin, end] = candidates02ByTrack0.equal_range(candidate01.tr0Idx);
-      for (auto candidate02It = begin; candidate02It != end; ++candidate02It) {
-        const auto& candidate02 = *candidate02It->second;
+      auto candidate02It = std::lower_bound(candidates02ByTrack0.begin(), candidates02ByTrack0.end(), candidate01.tr0Idx, [&candidates02](uint32_t a, int tr0Idx) { return candidates02[a].tr0Idx < tr0Idx; });
+      for (; candidate02It != candidates02ByTrack0.end() && candidates02[*candidate02It].tr0Idx == candidate01.tr0Idx; ++candidate02It) {
+        const auto& candidate02 = candidates02[*candidate02It];
         if (candidate01.tr1Idx == candidate02.tr1Idx ||
             candidate01.collBracket.isOutside(candidate02.collBracket)) {
           continue;
@@ -385,6 +413,7 @@ class svPoolCreator3Body
   svPoolCreator pool01;
   svPoolCreator pool02;
   std::vector<SVCand3> svCandPool;
+  std::vector<uint32_t> candidates02ByTrack0; // indices of the pool02 candidates sorted by first prong
 };
 
 #endif // PWGLF_UTILS_SVPOOLCREATOR_H_
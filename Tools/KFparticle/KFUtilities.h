@@ -39,9 +39,11 @@
 
 #include <array>
 #include <cmath>
+#include <cstddef>
 #include <cstdint>
 #include <stdexcept>
 #include <utility>
+#include <vector>
 
 constexpr float ArbitrarySmallNumber{1e-8f};
 constexpr float ArbitraryHugeNumber{1e8f};
@@ -160,6 +162,136 @@ KFParticle createKFParticleFromTrackParCov(const o2::track::TrackParametrization
   return kfPart;
 }
 
+/// @brief Outcome of the KFParticle helpers below, reported instead of exceptions
+enum class KFStatus : uint8_t {
+  Ok = 0,
+  CovarianceFailed, // covariance matrix not available from the TrackParCov
+  CreateFailed,     // daughter KFParticle not created
+  ConstructFailed   // mother construction failed
+};
+
+/// @brief Function to create a KFParticle from a o2::track::TrackParametrizationWithError track, with a status instead of exceptions
+/// @param kfPart KFParticle to fill, left as it is in case of failure
+/// @param trackparCov TrackParCov
+/// @param charge charge of track
+/// @param mass mass hypothesis
+/// @return status of the creation
+template <typename T>
+KFStatus kfCreateFromTrackParCov(KFParticle& kfPart, const o2::track::TrackParametrizationWithError<T>& trackparCov, int charge, float mass)
+{
+  std::array<T, 3> xyz, pxpypz;
+  float xyzpxpypz[6];
+  trackparCov.getPxPyPzGlo(pxpypz);
+  trackparCov.getXYZGlo(xyz);
+  for (int i{0}; i < NumberOfMomentumComponents; ++i) {
+    xyzpxpypz[i] = xyz[i];
+    xyzpxpypz[i + 3] = pxpypz[i];
+  }
+  std::array<float, NumberOfCovMatrixComponents> cv{};
+  try {
+    trackparCov.getCovXYZPxPyPzGlo(cv);
+  } catch (const std::runtime_error&) {
+    return KFStatus::CovarianceFailed;
+  }
+  try {
+    kfPart.Create(xyzpxpypz, cv.data(), charge, mass);
+  } catch (const std::runtime_error&) {
+    return KFStatus::CreateFailed;
+  }
+  return KFStatus::Ok;
+}
+
+/// @brief Construct a mother from N daughters, with a status instead of exceptions
+/// @param mother KFParticle to construct, its construct method must be set beforehand
+/// @param daughters daughter KFParticles
+/// @return status of the construction
+template <std::size_t N>
+KFStatus kfConstruct(KFParticle& mother, std::array<const KFParticle*, N> daughters)
+{
+  try {
+    mother.Construct(daughters.data(), static_cast<int>(N));
+  } catch (const std::runtime_error&) {
+    return KFStatus::ConstructFailed;
+  }
+  return KFStatus::Ok;
+}
+
+/// @brief Construct one N-body mother per set of daughters with the same construct method, one after the other
+/// @param daughters daughters of each mother
+/// @param constructMethod KFParticle construct method
+/// @param mothers constructed mothers
+/// @param status status of each mother
+/// @return true if all the mothers were constructed
+template <std::size_t N, std::size_t NMothers>
+bool kfConstructEach(const std::array<std::array<const KFParticle*, N>, NMothers>& daughters, int constructMethod,
+                     std::array<KFParticle, NMothers>& mothers, std::array<KFStatus, NMothers>& status)
+{
+  bool allOk = true;
+  for (std::size_t iMother = 0; iMother < NMothers; iMother++) {
+    mothers[iMother] = KFParticle();
+    mothers[iMother].SetConstructMethod(constructMethod);
+    status[iMother] = kfConstruct(mothers[iMother], daughters[iMother]);
+    allOk &= status[iMother] == KFStatus::Ok;
+  }
+  return allOk;
+}
+
+/// @brief Block of daughter tracks converted once to KFParticles, one per mass hypothesis.
+/// The tracks are identified by their index in the track table, the candidates sharing a track reuse its lane
+/// instead of converting the track again. The status of each lane is kept instead of throwing.
+/// @tparam NHypotheses number of mass hypotheses (PDG codes) per track
+template <std::size_t NHypotheses>
+class KFDaughterBlock
+{
+ public:
+  /// @brief Empty the block, to be called for each table of tracks
+  /// @param nTracks size of the track table
+  void reset(std::size_t nTracks)
+  {
+    laneOfTrack.assign(nTracks, -1);
+    particles.clear();
+    status.clear();
+  }
+
+  /// @brief Lane of a track of the table, converting it on first use
+  /// @param track track from aod::Tracks, aod::TracksExtra, aod::TracksCov
+  /// @param pdgCodes mass hypotheses, as for the KFParticle(KFPTrack, PDG) constructor
+  /// @return lane of the track
+  template <typename T>
+  int addTrack(const T& track, const std::array<int, NHypotheses>& pdgCodes)
+  {
+    const auto trackIndex = static_cast<std::size_t>(track.globalIndex());
+    if (trackIndex >= laneOfTrack.size()) {
+      laneOfTrack.resize(trackIndex + 1, -1);
+    }
+    if (laneOfTrack[trackIndex] >= 0) {
+      return laneOfTrack[trackIndex];
+    }
+    const int lane = static_cast<int>(status.size());
+    laneOfTrack[trackIndex] = lane;
+    auto& laneParticles = particles.emplace_back();
+    auto& laneStatus = status.emplace_back(KFStatus::Ok);
+    try {
+      const KFPTrack kfpTrack = createKFPTrackFromTrack(track);
+      for (std::size_t iHypo = 0; iHypo < NHypotheses; iHypo++) {
+        laneParticles[iHypo] = KFParticle(kfpTrack, pdgCodes[iHypo]);
+      }
+    } catch (const std::runtime_error&) {
+      laneStatus = KFStatus::CreateFailed;
+    }
+    return lane;
+  }
+
+  const KFParticle& particle(int lane, std::size_t iHypo) const { return particles[lane][iHypo]; }
+  KFStatus laneStatus(int lane) const { return status[lane]; }
+  std::size_t size() const { return status.size(); }
+
+ private:
+  std::vector<int> laneOfTrack;                               // lane of each track of the table, -1 if not converted
+  std::vector<std::array<KFParticle, NHypotheses>> particles; // daughter KFParticles of each lane
+  std::vector<KFStatus> status;                               // conversion status of each lane
+};
+
 /// @brief Function to create a o2::track::TrackParametrizationWithError track from a KFParticle
 /// @param kfParticle KFParticle to transform
 /// @param pid PID hypothesis
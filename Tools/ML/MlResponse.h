@@ -17,6 +17,7 @@
 #ifndef TOOLS_ML_MLRESPONSE_H_
 #define TOOLS_ML_MLRESPONSE_H_
 
+#include "Common/Core/CCDBNodeCache.h"
 #include "Tools/ML/model.h"
 
 #include <CCDB/CcdbApi.h>
@@ -25,8 +26,10 @@
 
 #include <cstddef>
 #include <cstdint>
+#include <filesystem>
 #include <map>
 #include <string>
+#include <system_error>
 #include <vector>
 
 namespace o2
@@ -108,21 +111,7 @@ class MlResponse
   /// \note On the CCDB, different models must be stored in different folders
   void setModelPathsCCDB(const std::vector<std::string>& onnxFiles, const o2::ccdb::CcdbApi& ccdbApi, const std::vector<std::string>& pathsCCDB, int64_t timestampCCDB)
   {
-    if (onnxFiles.size() != mNModels) {
-      LOG(fatal) << "Number of expected models (" << mNModels << ") different from the one set (" << onnxFiles.size() << ")! Please check your configurables.";
-    }
-    if (pathsCCDB.size() != mNModels) {
-      LOG(fatal) << "Number of expected models (" << mNModels << ") different from the number of CCDB paths (" << pathsCCDB.size() << ")! Please check your configurables.";
-    }
-
-    // check that the path is unique for each BDT model (otherwise CCDB download does not work as expected)
-    for (auto iThisFile{0}; iThisFile < mNModels; ++iThisFile) {
-      for (auto iOtherFile{iThisFile + 1}; iOtherFile < mNModels; ++iOtherFile) {
-        if ((pathsCCDB[iThisFile] == pathsCCDB[iOtherFile]) && (onnxFiles[iThisFile] != onnxFiles[iOtherFile])) {
-          LOGP(fatal, "More than one model ({} and {}) in the same CCDB directory ({})! Each directory in CCDB can contain only one model. Please check your configurables.", onnxFiles[iThisFile], onnxFiles[iOtherFile], pathsCCDB[iThisFile]);
-        }
-      }
-    }
+    checkModelPathsCCDB(onnxFiles, pathsCCDB);
 
     for (auto iFile{0}; iFile < mNModels; ++iFile) {
       std::map<std::string, std::string> metadata;
@@ -135,6 +124,32 @@ class MlResponse
     }
   }
 
+  /// Set model paths to CCDB through the node-local cache, so that the devices of a node download each model once
+  /// \param onnxFiles is a vector of onnx file names, one for each bin
+  /// \param nodeCache is the node-local CCDB cache, already initialised
+  /// \param pathsCCDB is a vector of model paths in CCDB, one for each bin
+  /// \param timestampCCDB is the timestamp for the CCDB query
+  /// \note The onnx files are links in the working directory to the files of the node cache
+  void setModelPathsCCDB(const std::vector<std::string>& onnxFiles, o2::common::core::CCDBNodeCache& nodeCache, const std::vector<std::string>& pathsCCDB, int64_t timestampCCDB)
+  {
+    checkModelPathsCCDB(onnxFiles, pathsCCDB);
+
+    for (auto iFile{0}; iFile < mNModels; ++iFile) {
+      std::map<std::string, std::string> metadata;
+      const std::string cachedFile = nodeCache.getFile(pathsCCDB[iFile], metadata, timestampCCDB);
+      if (cachedFile.empty()) {
+        LOG(fatal) << "Error encountered while accessing the ML model from " << pathsCCDB[iFile] << "! Maybe the ML model doesn't exist yet for this run number or timestamp?";
+      }
+      std::error_code ec;
+      std::filesystem::remove(onnxFiles[iFile], ec);
+      std::filesystem::create_symlink(cachedFile, onnxFiles[iFile], ec);
+      if (ec) {
+        LOGP(fatal, "Could not link the ML model {} to {}: {}", cachedFile, onnxFiles[iFile], ec.message());
+      }
+      mPaths[iFile] = onnxFiles[iFile];
+    }
+  }
+
   /// Set model paths to local or cvmfs
   /// \param onnxFiles is a vector of onnx file names, one for each bin
   void setModelPathsLocal(const std::vector<std::string>& onnxFiles)
@@ -293,6 +308,26 @@ class MlResponse
   virtual void setAvailableInputFeatures() {} // method to fill the map of available input features
 
  private:
+  /// Checks the number of models and that the path is unique for each model (otherwise CCDB download does not work as expected)
+  /// \param onnxFiles is a vector of onnx file names, one for each bin
+  /// \param pathsCCDB is a vector of model paths in CCDB, one for each bin
+  void checkModelPathsCCDB(const std::vector<std::string>& onnxFiles, const std::vector<std::string>& pathsCCDB)
+  {
+    if (onnxFiles.size() != mNModels) {
+      LOG(fatal) << "Number of expected models (" << mNModels << ") different from the one set (" << onnxFiles.size() << ")! Please check your configurables.";
+    }
+    if (pathsCCDB.size() != mNModels) {
+      LOG(fatal) << "Number of expected models (" << mNModels << ") different from the number of CCDB paths (" << pathsCCDB.size() << ")! Please check your configurables.";
+    }
+    for (auto iThisFile{0}; iThisFile < mNModels; ++iThisFile) {
+      for (auto iOtherFile{iThisFile + 1}; iOtherFile < mNModels; ++iOtherFile) {
+        if ((pathsCCDB[iThisFile] == pathsCCDB[iOtherFile]) && (onnxFiles[iThisFile] != onnxFiles[iOtherFile])) {
+          LOGP(fatal, "More than one model ({} and {}) in the same CCDB directory ({})! Each directory in CCDB can contain only one model. Please check your configurables.", onnxFiles[iThisFile], onnxFiles[iOtherFile], pathsCCDB[iThisFile]);
+        }
+      }
+    }
+  }
+
   /// Finds matching bin in mBinsLimits
   /// \param value e.g. pT
   /// \return index of the matching bin, used to access mModels